@@ -0,0 +1,23 @@
+#version 450
+
+// Lines of the DebugDraw list, see DebugVertex
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec4 inColor;
+
+layout (push_constant) uniform PushConstants
+{
+	mat4 viewProj;
+} pushConstants;
+
+layout (location = 0) out vec4 outColor;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main() 
+{
+	outColor = inColor;
+	gl_Position = pushConstants.viewProj * vec4(inPos, 1.0);
+}
@@ -0,0 +1,124 @@
+// Lighting of one G-Buffer sample, shared by deferred.frag (sampled G-Buffer) and
+// deferred_subpass.frag (G-Buffer read as input attachments in the same render pass).
+// Needs LightingCalc.h and GBufferPacking.h included first
+
+// Lighting data Uniform buffer
+layout (binding = 6) uniform LightingData 
+{
+    uint DirLightCount;
+    uint PointLightCount;
+
+    uvec4 ClusterCounts;    // Number of light clusters in x, y, z
+    vec4 ClusterScale;      // Tile size in pixels, depth slice scale and bias
+
+	DirLight DirLights[8];  // see @GeometrySubpass.h for the defintions of this
+} lights;
+
+// Clustered point lights, see @LightClusters.h
+layout (std430, binding = 8) readonly buffer PointLightData
+{
+    PointLight PointLights[];
+};
+
+// Offset and count into LightIndices of each cluster
+layout (std430, binding = 9) readonly buffer ClusterData
+{
+    uvec2 Clusters[];
+};
+
+layout (std430, binding = 10) readonly buffer LightIndexData
+{
+    uint LightIndices[];
+};
+
+// Camera info UBO that we will use for PBR
+layout (binding = 7) uniform UBO 
+{
+	mat4 projection;
+	mat4 modelview;
+	mat4 invViewProj;
+	vec4 camPos;
+    float gamma;
+    float exposure;
+    vec4 gbufferUVScale;    // Scale to the rendered part of the G-Buffer and the largest UV in it
+} ubo;
+
+// Shade a pixel that has something drawn in it
+vec4 ShadeGBuffer(vec2 uv, float depth, vec2 encodedNormal, vec4 albedo, vec4 material)
+{
+	// Get G-Buffer values
+	vec3 fragPos = ReconstructPosition(uv, depth, ubo.invViewProj);
+	vec3 normal = DecodeNormal(encodedNormal);
+	float metal = material.r;
+	float roughness = material.g;
+    vec3 specColor = mix( F0_NON_METAL.rrr, albedo.rgb, metal );
+
+    // Use these to calculate shading and lighting in screen space, 
+    // so that calculations only have to be done for visible fragments 
+    // independent of no. of lights.
+
+	// Ambient part
+	vec3 LightColor  = vec3(0.0, 0.0, 0.0);   
+	// Directional lights -------------------------
+    for(uint i = 0; i < lights.DirLightCount; i++)
+    {
+        LightColor += DirLightPBR( 
+            lights.DirLights[i],
+            normal, 
+            fragPos, 
+            ubo.camPos.xyz, 
+            roughness, 
+            metal, 
+            albedo.rgb, 
+            specColor 
+        );
+    }
+
+	// Point lights -------------------------
+    // Find the cluster of this fragment, only the lights that touch it need to be checked
+    float viewDepth = -(ubo.modelview * vec4(fragPos, 1.0)).z;
+    uvec2 tile = uvec2(clamp(gl_FragCoord.xy / lights.ClusterScale.xy, vec2(0.0), vec2(lights.ClusterCounts.xy - 1u)));
+    float slice = floor(log(max(viewDepth, 0.0001)) * lights.ClusterScale.z + lights.ClusterScale.w);
+    uint cluster = tile.x + lights.ClusterCounts.x * (tile.y + lights.ClusterCounts.y * uint(clamp(slice, 0.0, float(lights.ClusterCounts.z - 1u))));
+    uvec2 clusterLights = Clusters[cluster];
+
+    for(uint i = 0; i < clusterLights.y; i++)
+    {
+        uint lightIndex = LightIndices[clusterLights.x + i];
+
+        // Vector to light
+		vec3 L = PointLights[lightIndex].Pos.xyz - fragPos;
+		// Distance from light to fragment position
+		float dist = length(L);
+
+        // Only calculate lights that are in the range of this light
+        if(dist < PointLights[lightIndex].Range)
+        {
+            LightColor += CalculatePointLight( 
+                PointLights[ lightIndex ], 
+                normal, 
+                fragPos,
+                ubo.camPos.xyz, 
+                roughness,
+                metal, 
+                albedo.rgb,
+                specColor 
+            );
+        }
+    }
+
+    LightColor = abs( LightColor * albedo.rgb );
+
+    // Tone mapping
+	LightColor = Uncharted2Tonemap(LightColor * ubo.exposure);
+	LightColor = LightColor * (1.0f / Uncharted2Tonemap(vec3(11.2f)));	
+
+	// Gamma correction
+    vec3 gammaCorrect = vec3( pow( LightColor, vec3(1.0 / ubo.gamma) ) );
+	return vec4(gammaCorrect, 1.0);
+
+	// Return one of these instead to see the different G-Buffers
+	//return vec4(fragPos, 1.0);
+	//return vec4(normal, 1.0);
+	//return albedo;
+}
@@ -0,0 +1,35 @@
+// Packing helpers for the G-Buffer, see @OffscreenSubpass.cpp for the attachment formats
+//
+// Mirrored on the CPU by Fling::GBufferPacking so that it can be tested, keep the two the same
+//
+// Normals are stored octahedral encoded in two channels
+// @see http://jcgt.org/published/0003/02/01/
+vec2 SignNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit vector to a point on the octahedron in [-1, 1]
+vec2 EncodeNormal(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * SignNotZero(n.xy);
+}
+
+vec3 DecodeNormal(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+    {
+        n.xy = (1.0 - abs(n.yx)) * SignNotZero(n.xy);
+    }
+    return normalize(n);
+}
+
+// World space position from a depth buffer value. The G-Buffer is rendered with a Y flipped
+// projection, so UV (0, 0) is NDC (-1, -1)
+vec3 ReconstructPosition(vec2 uv, float depth, mat4 invViewProj)
+{
+    vec4 world = invViewProj * vec4(uv * 2.0 - 1.0, depth, 1.0);
+    return world.xyz / world.w;
+}
@@ -0,0 +1,17 @@
+// Decoding for the vertex formats, see @Vertex.h
+// Needs GBufferPacking.h for DecodeNormal
+//
+// The bounds come from Model::GetDecodeCenter and Model::GetDecodeExtents,
+// extents.w is 1 when the vertex buffer holds compact vertices
+
+// Compact positions are UNORM across the bounds of the mesh
+vec3 DecodePosition(vec4 pos, vec4 center, vec4 extents)
+{
+	return extents.w > 0.5 ? center.xyz + (pos.xyz * 2.0 - 1.0) * extents.xyz : pos.xyz;
+}
+
+// Compact normals and tangents are octahedral encoded in xy
+vec3 DecodeDirection(vec3 dir, vec4 extents)
+{
+	return extents.w > 0.5 ? DecodeNormal(dir.xy) : normalize(dir);
+}
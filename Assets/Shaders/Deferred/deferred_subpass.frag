@@ -0,0 +1,39 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive: require
+
+#include "LightingCalc.h"
+#include "GBufferPacking.h"
+
+// The G-Buffer written by the previous subpass of the same render pass. Each pixel only
+// reads its own texel, so the targets can stay in tile memory on tiled GPUs
+layout (input_attachment_index = 0, binding = 1) uniform subpassInput inputDepth;
+layout (input_attachment_index = 1, binding = 2) uniform subpassInput inputNormal;
+layout (input_attachment_index = 2, binding = 3) uniform subpassInput inputAlbedo;
+layout (input_attachment_index = 3, binding = 4) uniform subpassInput inputMaterial;  // Metal, roughness, AO
+
+// In UV from the vertex shader
+layout (location = 0) in vec2 inUV;
+
+// Final screen color 
+layout (location = 0) out vec4 outFragcolor;
+
+#include "DeferredLighting.h"
+
+void main() 
+{
+	// Nothing was drawn here
+	float depth = subpassLoad(inputDepth).r;
+	if (depth >= 1.0)
+	{
+		outFragcolor = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	outFragcolor = ShadeGBuffer(
+		inUV,
+		depth,
+		subpassLoad(inputNormal).rg,
+		subpassLoad(inputAlbedo),
+		subpassLoad(inputMaterial));
+}
\ No newline at end of file
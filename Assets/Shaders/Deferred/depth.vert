@@ -0,0 +1,41 @@
+#version 450
+#extension GL_GOOGLE_include_directive: require
+
+#include "GBufferPacking.h"
+#include "VertexDecode.h"
+
+// Depth only prepass of the G-Buffer. Only reads the position stream, see Model::GetPositionBuffer.
+// The position has to be worked out exactly like mrt.vert does, the G-Buffer tests against it with EQUAL
+layout(location = 0) in vec4 inPos;
+
+layout (binding = 0) uniform CameraUBO 
+{
+	mat4 projection;
+	mat4 view;
+} camera;
+
+// Per mesh data, see OffscreenPushConstants
+layout (push_constant) uniform ObjectConstants
+{
+	mat4 model;
+	uvec4 textureSlots;	// Not used here
+	vec4 boundsCenter;	// Model::GetDecodeCenter
+	vec4 boundsExtents;	// Model::GetDecodeExtents
+} object;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+invariant gl_Position;
+
+void main() 
+{
+	vec4 boundsCenter = object.boundsCenter;
+	vec4 boundsExtents = object.boundsExtents;
+
+	vec3 worldPos = (object.model * vec4(DecodePosition(inPos, boundsCenter, boundsExtents), 1.0)).rgb;
+
+	gl_Position =  camera.projection * camera.view * vec4(worldPos, 1.0);
+}
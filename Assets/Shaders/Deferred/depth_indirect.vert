@@ -0,0 +1,52 @@
+#version 450
+#extension GL_GOOGLE_include_directive: require
+
+#include "GBufferPacking.h"
+#include "VertexDecode.h"
+
+// Same as depth.vert, but the model matrix comes from the object buffer 
+// written for GPU driven rendering. See @IndirectDraw.h and mrt_indirect.vert
+layout(location = 0) in vec4 inPos;
+
+layout (binding = 0) uniform CameraUBO 
+{
+	mat4 projection;
+	mat4 view;
+} camera;
+
+// Must match GpuObjectData
+struct ObjectData
+{
+	mat4 world;
+	vec4 boundsCenter;
+	vec4 boundsExtents;	// w is 1 for compact vertices, see VertexDecode.h
+	uint firstIndex;
+	uint indexCount;
+	int vertexOffset;
+	uint batchIndex;
+	uvec4 textureSlots;	// Albedo, normal, metal, roughness
+};
+
+layout (binding = 5) readonly buffer Objects
+{
+	ObjectData objects[];
+};
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+invariant gl_Position;
+
+void main() 
+{
+	// The cull shader puts the object index in firstInstance
+	mat4 model = objects[gl_InstanceIndex].world;
+	vec4 boundsCenter = objects[gl_InstanceIndex].boundsCenter;
+	vec4 boundsExtents = objects[gl_InstanceIndex].boundsExtents;
+
+	vec3 worldPos = (model * vec4(DecodePosition(inPos, boundsCenter, boundsExtents), 1.0)).rgb;
+
+	gl_Position =  camera.projection * camera.view * vec4(worldPos, 1.0);
+}
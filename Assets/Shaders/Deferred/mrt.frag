@@ -1,10 +1,11 @@
 #version 450
+#extension GL_GOOGLE_include_directive: require
+#extension GL_EXT_nonuniform_qualifier : require
 
-// Texture samplers for this part of the mesh
-layout (binding = 1) uniform sampler2D samplerColor;
-layout (binding = 2) uniform sampler2D samplerNormalMap;
-layout (binding = 3) uniform sampler2D samplerMetalMap;
-layout (binding = 4) uniform sampler2D samplerRoughnessMap;
+#include "GBufferPacking.h"
+
+// Every material texture, see @BindlessTextures.h
+layout (set = 1, binding = 0) uniform sampler2D textures[];
 
 // Inputs from the mrt vert shader
 layout (location = 0) in vec3 inNormal;
@@ -12,18 +13,17 @@ layout (location = 1) in vec2 inUV;
 layout (location = 2) in vec3 inColor;
 layout (location = 3) in vec3 inWorldPos;
 layout (location = 4) in vec3 inTangent;
+layout (location = 5) flat in uvec4 inTextureSlots;	// Albedo, normal, metal, roughness
 
-// Outputs set as the frame buffer
-layout (location = 0) out vec4 outPosition;
-layout (location = 1) out vec4 outNormal;
-layout (location = 2) out vec4 outAlbedo;
-layout (location = 3) out vec4 outMetal;
-layout (location = 4) out vec4 outRoughness;
+// Outputs set as the frame buffer. Position is rebuilt from depth
+layout (location = 0) out vec2 outNormal;
+layout (location = 1) out vec4 outAlbedo;
+layout (location = 2) out vec4 outMaterial;    // Metal, roughness, AO
 
 // Perturb normal, see http://www.thetenthplanet.de/archives/1180
 vec3 perturbNormal()
 {
-	vec3 tangentNormal = texture(samplerNormalMap, inUV).xyz * 2.0 - 1.0;
+	vec3 tangentNormal = texture(textures[nonuniformEXT(inTextureSlots.y)], inUV).xyz * 2.0 - 1.0;
 
 	vec3 q1 = dFdx(inWorldPos);
 	vec3 q2 = dFdy(inWorldPos);
@@ -41,12 +41,12 @@ vec3 perturbNormal()
 void main() 
 {
 	// Use the perturbed normal for our calculations 
-	vec3 N = normalize(inNormal);
-	outNormal = vec4(perturbNormal(), 1.0);
+	outNormal = EncodeNormal(perturbNormal());
 
-	outPosition = vec4(inWorldPos, 1.0);
-	outAlbedo = texture(samplerColor, inUV);
+	outAlbedo = texture(textures[nonuniformEXT(inTextureSlots.x)], inUV);
 
-	outMetal = texture(samplerMetalMap, inUV);
-	outRoughness = texture(samplerRoughnessMap, inUV);
+	// There are no AO maps yet, so leave it fully unoccluded
+	float metal = texture(textures[nonuniformEXT(inTextureSlots.z)], inUV).r;
+	float roughness = texture(textures[nonuniformEXT(inTextureSlots.w)], inUV).r;
+	outMaterial = vec4(metal, roughness, 1.0, 0.0);
 }
\ No newline at end of file
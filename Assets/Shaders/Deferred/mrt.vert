@@ -1,43 +1,62 @@
 #version 450
+#extension GL_GOOGLE_include_directive: require
 
-// Vertex bindings, see @Vertex.h
-layout(location = 0) in vec3 inPos;
-layout(location = 1) in vec3 inColor;
+#include "GBufferPacking.h"
+#include "VertexDecode.h"
+
+// Vertex bindings, see @Vertex.h. Compact vertices have no color at 1
+layout(location = 0) in vec4 inPos;
 layout(location = 2) in vec3 inTangent;
 layout(location = 3) in vec3 inNormal;
 layout(location = 4) in vec2 inUV;
 
-layout (binding = 0) uniform UBO 
+layout (binding = 0) uniform CameraUBO 
 {
 	mat4 projection;
-	mat4 model;
 	mat4 view;
-	vec3 objPos;
-} ubo;
+} camera;
+
+// Per mesh data, see OffscreenPushConstants
+layout (push_constant) uniform ObjectConstants
+{
+	mat4 model;
+	uvec4 textureSlots;	// Albedo, normal, metal, roughness
+	vec4 boundsCenter;	// Model::GetDecodeCenter
+	vec4 boundsExtents;	// Model::GetDecodeExtents
+} object;
 
 layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec2 outUV;
 layout (location = 2) out vec3 outColor;
 layout (location = 3) out vec3 outWorldPos;
 layout (location = 4) out vec3 outTangent;
+layout (location = 5) flat out uvec4 outTextureSlots;
 
 out gl_PerVertex
 {
 	vec4 gl_Position;
 };
 
+// The depth prepass works the position out the same way, so it has to come out bit for bit the same
+invariant gl_Position;
+
 void main() 
 {
 	// GL UV Coords to Vulkan coord space
 	outUV = inUV;
 	outUV.t = 1.0 - outUV.t;
 	
-	// Currently just vertex color
-	outColor = inColor;
+	// Every mesh is white for now, so the color stream isn't read
+	outColor = vec3(1.0);
 	
-	outWorldPos = (ubo.model * vec4(inPos, 1.0)).rgb;
-	outNormal = mat3(ubo.model) * normalize(inNormal);
+	outTextureSlots = object.textureSlots;
+
+	vec4 boundsCenter = object.boundsCenter;
+	vec4 boundsExtents = object.boundsExtents;
+
+	outWorldPos = (object.model * vec4(DecodePosition(inPos, boundsCenter, boundsExtents), 1.0)).rgb;
+	outNormal = mat3(object.model) * DecodeDirection(inNormal, boundsExtents);
 
-	gl_Position =  ubo.projection * ubo.view * vec4(outWorldPos, 1.0);
-	outTangent = normalize( inTangent * mat3(ubo.model) );
+	gl_Position =  camera.projection * camera.view * vec4(outWorldPos, 1.0);
+	outTangent = normalize( DecodeDirection(inTangent, boundsExtents) * mat3(object.model) );
 }
@@ -0,0 +1,75 @@
+#version 450
+#extension GL_GOOGLE_include_directive: require
+
+#include "GBufferPacking.h"
+#include "VertexDecode.h"
+
+// Same as mrt.vert, but the model matrix comes from the object buffer 
+// written for GPU driven rendering. See @IndirectDraw.h
+
+// Vertex bindings, see @Vertex.h. Compact vertices have no color at 1
+layout(location = 0) in vec4 inPos;
+layout(location = 2) in vec3 inTangent;
+layout(location = 3) in vec3 inNormal;
+layout(location = 4) in vec2 inUV;
+
+layout (binding = 0) uniform CameraUBO 
+{
+	mat4 projection;
+	mat4 view;
+} camera;
+
+// Must match GpuObjectData
+struct ObjectData
+{
+	mat4 world;
+	vec4 boundsCenter;
+	vec4 boundsExtents;	// w is 1 for compact vertices, see VertexDecode.h
+	uint firstIndex;
+	uint indexCount;
+	int vertexOffset;
+	uint batchIndex;
+	uvec4 textureSlots;	// Albedo, normal, metal, roughness
+};
+
+layout (binding = 5) readonly buffer Objects
+{
+	ObjectData objects[];
+};
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec2 outUV;
+layout (location = 2) out vec3 outColor;
+layout (location = 3) out vec3 outWorldPos;
+layout (location = 4) out vec3 outTangent;
+layout (location = 5) flat out uvec4 outTextureSlots;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+// The depth prepass works the position out the same way, so it has to come out bit for bit the same
+invariant gl_Position;
+
+void main() 
+{
+	// The cull shader puts the object index in firstInstance
+	mat4 model = objects[gl_InstanceIndex].world;
+	outTextureSlots = objects[gl_InstanceIndex].textureSlots;
+	vec4 boundsCenter = objects[gl_InstanceIndex].boundsCenter;
+	vec4 boundsExtents = objects[gl_InstanceIndex].boundsExtents;
+
+	// GL UV Coords to Vulkan coord space
+	outUV = inUV;
+	outUV.t = 1.0 - outUV.t;
+	
+	// Every mesh is white for now, so the color stream isn't read
+	outColor = vec3(1.0);
+	
+	outWorldPos = (model * vec4(DecodePosition(inPos, boundsCenter, boundsExtents), 1.0)).rgb;
+	outNormal = mat3(model) * DecodeDirection(inNormal, boundsExtents);
+
+	gl_Position =  camera.projection * camera.view * vec4(outWorldPos, 1.0);
+	outTangent = normalize( DecodeDirection(inTangent, boundsExtents) * mat3(model) );
+}
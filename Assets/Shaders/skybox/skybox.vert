@@ -8,6 +8,7 @@ layout (binding = 0) uniform UBO
 {
 	mat4 projection;
 	mat4 modelView;
+	mat4 decode;
 } ubo;
 
 layout (location = 0) out vec3 outUVW;
@@ -19,7 +20,8 @@ out gl_PerVertex
 
 void main() 
 {
-	vec3 position = mat3(ubo.modelView) * inPos.xyz;
+	vec3 localPos = (ubo.decode * vec4(inPos.xyz, 1.0)).xyz;
+	vec3 position = mat3(ubo.modelView) * localPos;
 	gl_Position = (ubo.projection * vec4(position, 0.0)).xyzz;
-	outUVW = inPos.xyz;
+	outUVW = localPos;
 }
@@ -12,4 +12,12 @@
 #include <glm/gtx/hash.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtx/transform.hpp> 
-#include <glm/gtc/random.hpp>
\ No newline at end of file
+#include <glm/gtc/random.hpp>
+
+// SIMD 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define FLING_SIMD_SSE	1
+#	include <emmintrin.h>
+#else
+#	define FLING_SIMD_SSE	0
+#endif
@@ -32,8 +32,14 @@ namespace Fling
 			F_LOG_WARN("NO EngineConf.ini has been provided! This may result in unexpected behavior from Fling!");
 		}
 
+#if WITH_DEBUG_DRAW
+		const uint32 DebugPipeline = PipelineFlags::DEBUG;
+#else
+		const uint32 DebugPipeline = 0;
+#endif
+
 		VulkanApp::Get().Init(
-			static_cast<PipelineFlags>(PipelineFlags::DEFERRED | PipelineFlags::IMGUI),
+			static_cast<PipelineFlags>(PipelineFlags::DEFERRED | DebugPipeline | PipelineFlags::IMGUI),
 			g_Registry,
 			m_Editor
 		);
@@ -97,6 +103,9 @@ namespace Fling
 
 	void Engine::Shutdown()
 	{
+		// The render thread may still be drawing the last frame, which uses the world's resources
+		VulkanApp::Get().StopRenderThread();
+
 		// Cleanup game play stuff
 		if(m_World)
 		{
@@ -166,7 +166,7 @@ namespace Fling
 		// Update imgui mouse events and timings
 		ImGuiIO& io = ImGui::GetIO();
 
-		DesktopWindow* Window = static_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
+		FlingWindow* Window = VulkanApp::Get().GetCurrentWindow();
 
 		io.DisplaySize = ImVec2(
 			static_cast<float>(Window->GetWidth()),
@@ -182,7 +182,8 @@ namespace Fling
 
 	bool WindowsInput::IsKeyDownImpl(const std::string& t_KeyName)
 	{
-		DesktopWindow* Window = static_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
+		// Headless windows have no GLFW window, so every key reads as up
+		DesktopWindow* Window = dynamic_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
 		if (Window)
 		{
 			// Check the old state of this input!
@@ -206,7 +207,7 @@ namespace Fling
 
 	bool WindowsInput::IsKeyHelpImpl(const std::string& t_KeyName)
 	{
-		DesktopWindow* Window = static_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
+		DesktopWindow* Window = dynamic_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
 		if (Window)
 		{
 			// Check the old state of this input!
@@ -230,7 +231,7 @@ namespace Fling
 
 	bool WindowsInput::IsMouseButtonPressedImpl(const std::string& t_KeyName)
 	{
-		DesktopWindow* Window = static_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
+		DesktopWindow* Window = dynamic_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
 		if (Window)
 		{
 			Key& CurKey = m_KeyMap.at(t_KeyName);
@@ -253,7 +254,7 @@ namespace Fling
 
 	bool WindowsInput::IsMouseDownImpl(const std::string& t_KeyName)
 	{
-		DesktopWindow* Window = static_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
+		DesktopWindow* Window = dynamic_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
 		if (Window)
 		{
 			Key& CurKey = m_KeyMap.at(t_KeyName);
@@ -270,7 +271,7 @@ namespace Fling
 		MousePos CurPos = {};
 
 		// #TODO Get rid of this WINDOW DEPENDECNY!!!!
-		DesktopWindow* Window = static_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
+		DesktopWindow* Window = dynamic_cast<DesktopWindow*>(VulkanApp::Get().GetCurrentWindow());
 		if (Window)
 		{
 			double xPos = 0.0;
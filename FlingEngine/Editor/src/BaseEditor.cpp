@@ -14,6 +14,8 @@
 #include "ImFileBrowser.hpp"
 #include "World.h"
 #include "EditableComponent.h"
+#include "Stats.h"
+#include "GpuProfiler.h"
 
 #include <stdio.h> 
 #include <string.h> 
@@ -25,9 +27,14 @@ namespace Fling
     {
         void Transform(Fling::Transform& t)
         {
-            ImGui::InputFloat3( "Position", ( float* ) &t.m_Pos );
-            ImGui::InputFloat3( "Scale", ( float* )  &t.m_Scale );
-            ImGui::InputFloat3( "Rotation", ( float* )  &t.m_Rotation );
+            bool Changed = ImGui::InputFloat3( "Position", ( float* ) &t.m_Pos );
+            Changed |= ImGui::InputFloat3( "Scale", ( float* )  &t.m_Scale );
+            Changed |= ImGui::InputFloat3( "Rotation", ( float* )  &t.m_Rotation );
+
+            if (Changed)
+            {
+                t.MarkDirty();
+            }
         }
 
         void PointLight(Fling::PointLight& t_Light)
@@ -500,6 +507,39 @@ namespace Fling
         {
             ImGui::Text("FPS: %f", frameTime);
             ImGui::PlotLines("FPS", &fpsGraph[0], fpsGraph.size(), 0, "", m_FrameTimeMin, m_FrameTimeMax, ImVec2(0, 80));
+
+            ImGui::Separator();
+            ImGui::Text("Visible: %u / %u", Stats::Culling::GetVisibleCount(), Stats::Culling::GetTotalCount());
+            ImGui::Text("Frustum Culled: %u", Stats::Culling::GetFrustumCulledCount());
+            ImGui::Text("Occlusion Culled: %u (%u occluders)", Stats::Culling::GetOcclusionCulledCount(), Stats::Culling::GetOccluderCount());
+            ImGui::Text("LOD Triangles: %u / %u", Stats::Lod::GetTriangleCount(), Stats::Lod::GetFullDetailTriangleCount());
+            ImGui::Text("Meshlets Culled: %u / %u (%u / %u triangles)", Stats::Meshlets::GetCulledClusterCount(), Stats::Meshlets::GetClusterCount(), Stats::Meshlets::GetCulledTriangleCount(), Stats::Meshlets::GetTriangleCount());
+            ImGui::Text("G-Buffer Draws: %u (%u state changes, %u skipped)", Stats::Draws::GetDrawCount(), Stats::Draws::GetStateChangeCount(), Stats::Draws::GetSkippedStateChangeCount());
+            ImGui::Text("Render Resolution: %ux%u (%.0f%%)", Stats::Resolution::GetWidth(), Stats::Resolution::GetHeight(), Stats::Resolution::GetScale() * 100.0f);
+            if (Stats::Overdraw::GetFrameCount() > 0)
+            {
+                ImGui::Text("Overdraw: %.2f (avg %.2f), depth prepass %s", Stats::Overdraw::GetRatio(), Stats::Overdraw::GetAverageRatio(), Stats::Overdraw::WasPrepassEnabled() ? "on" : "off");
+            }
+            ImGui::Text("Point Lights: %u (%u cluster refs, max %u per cluster)", Stats::Lighting::GetPointLightCount(), Stats::Lighting::GetLightIndexCount(), Stats::Lighting::GetMaxLightsPerCluster());
+            ImGui::Text("Render Graph: %u passes (%u culled), %u barriers (%u skipped)", Stats::RenderGraph::GetPassCount(), Stats::RenderGraph::GetCulledPassCount(), Stats::RenderGraph::GetBarrierCount(), Stats::RenderGraph::GetSkippedBarrierCount());
+            ImGui::Text("Render Targets: %.2f MB (%.2f MB without aliasing)", Stats::RenderGraph::GetTextureMemory() / (1024.0f * 1024.0f), Stats::RenderGraph::GetUnaliasedTextureMemory() / (1024.0f * 1024.0f));
+            ImGui::Text("Pipelines: %u cached (%u compiling), %u hits, %u compiles", Stats::Pipelines::GetCachedCount(), Stats::Pipelines::GetPendingCount(), Stats::Pipelines::GetHitCount(), Stats::Pipelines::GetCompileCount());
+
+            GpuProfiler* Profiler = VulkanApp::Get().GetGpuProfiler();
+            if (Profiler)
+            {
+                ImGui::Separator();
+                ImGui::Text("GPU Frame: %.3f ms (avg %.3f ms)", Stats::Gpu::GetFrameTime(), Stats::Gpu::GetAverageFrameTime());
+                for (const Stats::GpuScopeTiming& Scope : Stats::Gpu::GetScopes())
+                {
+                    ImGui::Text("%*s%s: %.3f ms (avg %.3f ms)", static_cast<int>(Scope.Depth * 2 + 2), "", Scope.Name, Scope.Milliseconds, Scope.AverageMilliseconds);
+                }
+
+                if (ImGui::Button("Export GPU Trace"))
+                {
+                    Profiler->ExportTrace(FlingPaths::EngineLogDir() + "/GpuTrace.json");
+                }
+            }
         }
         ImGui::End();
     }
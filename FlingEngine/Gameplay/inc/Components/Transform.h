@@ -3,6 +3,8 @@
 #include "Serilization.h"
 #include "FlingMath.h"
 
+#include <entt/entity/registry.hpp>
+
 namespace Fling
 {
     struct Transform
@@ -11,6 +13,13 @@ namespace Fling
 
 		static void CalculateWorldMatrix(Transform& t_Trans);
 
+        /**
+        * @brief    Recalculate the cached world matrix of every dirty transform in the registry.
+        *           Should be called once per frame before anything reads GetWorldMat
+        * @param t_OutChanged   Entities whose world matrix changed. Cleared before being written to.
+        */
+        static void UpdateDirtyWorldMatrices(entt::registry& t_Reg, std::vector<entt::entity>& t_OutChanged);
+
         bool operator==(const Transform &other) const;
 	    bool operator!=(const Transform &other) const;
         friend std::ostream& operator << (std::ostream& t_OutStream, const Fling::Transform& t_Transform); 
@@ -23,6 +32,12 @@ namespace Fling
         inline const glm::vec3& GetRotation() const { return m_Rotation; }
 		inline const glm::mat4& GetWorldMat() const { return m_worldMat; }
 
+        /** True if the world matrix is out of date with the position, scale, or rotation */
+        inline bool IsDirty() const { return m_IsDirty; }
+
+        /** Flag the world matrix to be recalculated. Needed if you write to m_Pos, m_Scale, or m_Rotation directly */
+        inline void MarkDirty() { m_IsDirty = true; }
+
         void SetPos(const glm::vec3& t_Pos);
         void SetScale(const glm::vec3& t_Scale);
         void SetRotation(const glm::vec3& t_Rot);
@@ -32,6 +47,7 @@ namespace Fling
         glm::vec3 m_Rotation { 0.0f, 0.0f, 0.0f };
         glm::vec3 m_Scale { 1.0f, 1.0f, 1.0f };
 		glm::mat4 m_worldMat {};
+        bool m_IsDirty = true;
     };
     
     /** Serilazation to an archive */
@@ -45,18 +45,43 @@ namespace Fling
 		t_Trans.m_worldMat = glm::scale(t_Trans.m_worldMat, t_Trans.m_Scale);
 	}
 
+	void Transform::UpdateDirtyWorldMatrices(entt::registry& t_Reg, std::vector<entt::entity>& t_OutChanged)
+	{
+		t_OutChanged.clear();
+
+		// Walk the transform pool directly. It is tightly packed, so when nothing
+		// has moved this is just a linear scan over the dirty flags
+		const size_t Count = t_Reg.size<Transform>();
+		Transform* Transforms = t_Reg.raw<Transform>();
+		const entt::entity* Entities = t_Reg.data<Transform>();
+
+		for (size_t i = 0; i < Count; ++i)
+		{
+			Transform& Trans = Transforms[i];
+			if (Trans.m_IsDirty)
+			{
+				CalculateWorldMatrix(Trans);
+				Trans.m_IsDirty = false;
+				t_OutChanged.emplace_back(Entities[i]);
+			}
+		}
+	}
+
     void Transform::SetPos(const glm::vec3& t_Pos)
     {
         m_Pos = t_Pos;
+        m_IsDirty = true;
     }
 
     void Transform::SetScale(const glm::vec3& t_Scale)
     {
         m_Scale = t_Scale;
+        m_IsDirty = true;
     }
 
     void Transform::SetRotation(const glm::vec3& t_Rot)
     {
         m_Rotation = t_Rot;
+        m_IsDirty = true;
     }
 }   // namespace Fling
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "FlingVulkan.h"
+#include "NonCopyable.hpp"
+#include "TextureSlots.h"
+
+namespace Fling
+{
+	class LogicalDevice;
+	class Material;
+
+	/**
+	 * @brief	One descriptor set with an array of every texture that the G-Buffer samples. Materials
+	 *			pass their slots in the array through per object data, so the set is bound once per
+	 *			pass instead of once per mesh. The array is partially bound and updated after bind,
+	 *			so textures can be added while frames that use the set are still in flight.
+	 */
+	class BindlessTextures : public NonCopyable
+	{
+	public:
+
+		/** Upper limit of the array, the device limit is used if it is smaller */
+		static constexpr uint32 MaxTextures = 4096;
+
+		/** Set index that the MRT shaders expect the array at */
+		static constexpr uint32 SetIndex = 1;
+
+		explicit BindlessTextures(const LogicalDevice* t_Dev);
+
+		~BindlessTextures();
+
+		/**
+		 * @brief	Add a reference to each texture of the material, writing any that are new.
+		 *			Textures that don't fit fall back to the default material
+		 */
+		MaterialTextureSlots AcquireMaterial(Material* t_Mat);
+
+		/** @param t_Slots	What AcquireMaterial returned for the material */
+		void ReleaseMaterial(Material* t_Mat, const MaterialTextureSlots& t_Slots);
+
+		/** Call once per frame so that released slots can be reused */
+		void NextFrame() { m_Slots.NextFrame(); }
+
+		VkDescriptorSetLayout GetSetLayout() const { return m_SetLayout; }
+
+		VkDescriptorSet GetSet() const { return m_Set; }
+
+		uint32 GetUsedCount() const { return m_Slots.GetUsedCount(); }
+
+	private:
+
+		uint32 AcquireTexture(Texture* t_Tex, uint32 t_Fallback);
+
+		void ReleaseTexture(Texture* t_Tex, uint32 t_Slot);
+
+		const LogicalDevice* m_Device;
+
+		TextureSlotAllocator m_Slots;
+
+		VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool m_Pool = VK_NULL_HANDLE;
+		VkDescriptorSet m_Set = VK_NULL_HANDLE;
+
+		/** Slots of the default material, always referenced so that they can be used as a fallback */
+		MaterialTextureSlots m_DefaultSlots;
+	};
+}   // namespace Fling
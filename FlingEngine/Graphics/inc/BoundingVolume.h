@@ -0,0 +1,85 @@
+#pragma once
+
+#include "FlingMath.h"
+
+#include <cfloat>
+
+namespace Fling
+{
+	struct Vertex;
+
+	/**
+	 * @brief	An axis aligned bounding box. Stored as min/max corners, which is what
+	 *			we get while building one from vertices.
+	 */
+	struct AABB
+	{
+		glm::vec3 Min = glm::vec3(FLT_MAX);
+		glm::vec3 Max = glm::vec3(-FLT_MAX);
+
+		/** Grow this box to include the given point */
+		void Expand(const glm::vec3& t_Point);
+
+		/** True if at least one point has been added to this box */
+		FORCEINLINE bool IsValid() const { return Min.x <= Max.x && Min.y <= Max.y && Min.z <= Max.z; }
+
+		FORCEINLINE glm::vec3 GetCenter() const { return (Min + Max) * 0.5f; }
+
+		/** Half size of the box along each axis */
+		FORCEINLINE glm::vec3 GetExtents() const { return (Max - Min) * 0.5f; }
+
+		/** Half of the surface area of this box. Good enough as a cost metric for trees */
+		FORCEINLINE float GetSurfaceArea() const
+		{
+			const glm::vec3 Size = Max - Min;
+			return Size.x * Size.y + Size.y * Size.z + Size.z * Size.x;
+		}
+
+		/** True if the given box is entirely inside of this one */
+		FORCEINLINE bool Contains(const AABB& t_Other) const
+		{
+			return	Min.x <= t_Other.Min.x && Min.y <= t_Other.Min.y && Min.z <= t_Other.Min.z &&
+					Max.x >= t_Other.Max.x && Max.y >= t_Other.Max.y && Max.z >= t_Other.Max.z;
+		}
+
+		FORCEINLINE bool Overlaps(const AABB& t_Other) const
+		{
+			return	Min.x <= t_Other.Max.x && Max.x >= t_Other.Min.x &&
+					Min.y <= t_Other.Max.y && Max.y >= t_Other.Min.y &&
+					Min.z <= t_Other.Max.z && Max.z >= t_Other.Min.z;
+		}
+
+		/** Create a box that encloses both of the given boxes */
+		static FORCEINLINE AABB Merge(const AABB& t_A, const AABB& t_B)
+		{
+			AABB Result;
+			Result.Min = glm::min(t_A.Min, t_B.Min);
+			Result.Max = glm::max(t_A.Max, t_B.Max);
+			return Result;
+		}
+
+		/**
+		 * @brief	Transform this box by the given matrix and return the AABB that
+		 *			encloses the result (Arvo's method, no need to transform all 8 corners)
+		 */
+		AABB Transformed(const glm::mat4& t_Mat) const;
+
+		static AABB FromVertices(const Vertex* t_Verts, size_t t_Count);
+	};
+
+	/**
+	 * @brief	A bounding sphere. Used where a single distance is good enough
+	 *			(screen size estimates, coarse rejection)
+	 */
+	struct BoundingSphere
+	{
+		glm::vec3 Center = glm::vec3(0.0f);
+		float Radius = 0.0f;
+
+		/** Transform this sphere by the given matrix, scaling the radius by the largest axis scale */
+		BoundingSphere Transformed(const glm::mat4& t_Mat) const;
+
+		/** Create a sphere centered on the given box that encloses all the given vertices */
+		static BoundingSphere FromVertices(const AABB& t_Box, const Vertex* t_Verts, size_t t_Count);
+	};
+}   // namespace Fling
@@ -64,8 +64,10 @@ namespace Fling
          * @param t_SrcBuffer     Source buffer data
          * @param t_DstBuffer     Destination buffer data
          * @param t_Size        Size of the data to copy
+         * @param t_SrcOffset   Where to start reading in the source buffer
+         * @param t_DstOffset   Where to start writing in the destination buffer
          */
-        static void CopyBuffer(Buffer* t_SrcBuffer, Buffer* t_DstBuffer, VkDeviceSize t_Size);
+        static void CopyBuffer(Buffer* t_SrcBuffer, Buffer* t_DstBuffer, VkDeviceSize t_Size, VkDeviceSize t_SrcOffset = 0, VkDeviceSize t_DstOffset = 0);
 
         /**
          * @brief Destroy the VK buffer object, frees vk memory. 
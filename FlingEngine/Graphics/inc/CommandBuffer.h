@@ -44,6 +44,9 @@ namespace Fling
 
 		void BeginRenderPass(const FrameBuffer& t_frameBuf, const std::vector<VkClearValue>& t_ClearVales);
 
+		/** Begin a render pass that isn't owned by a FrameBuffer, like the ones in a RenderGraph */
+		void BeginRenderPass(VkRenderPass t_RenderPass, VkFramebuffer t_FrameBuf, VkExtent2D t_Extent, const std::vector<VkClearValue>& t_ClearVales);
+
 		void NextSubpass();
 
 		void BindPipeline(VkPipelineBindPoint t_BindPoint, VkPipeline t_Pipeline);
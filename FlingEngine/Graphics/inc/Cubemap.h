@@ -55,18 +55,9 @@ namespace Fling
             VkDescriptorSet& GetDescriptorSet() { return m_DescriptorSet; }
 
             /**
-             * @brief Get the Vertex Buffer object
-             * 
-             * @return const Buffer* 
-             */
-            Buffer* GetVertexBuffer() const { return m_Cube->GetVertexBuffer(); }
-
-            /**
-             * @brief Get the Index Buffer object
-             * 
-             * @return const Buffer* 
+             * @brief Get where the cube is in the geometry buffer
              */
-            Buffer* GetIndexBuffer() const { return m_Cube->GetIndexBuffer(); }
+            const GeometryAllocation& GetGeometry() const { return m_Cube->GetGeometry(); }
 
             /**
              * @brief Get the Index Count object
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "BoundingVolume.h"
+
+#include <string>
+#include <vector>
+
+namespace Fling
+{
+	/** A line end point of the debug draw list. The color is RGBA8, read as VK_FORMAT_R8G8B8A8_UNORM */
+	struct DebugVertex
+	{
+		glm::vec3 Pos {};
+		uint32 Color = 0;
+	};
+
+	static_assert(sizeof(DebugVertex) == 16, "DebugVertex has to match the attributes of the debug pipeline");
+
+	/** A label that is drawn on top of the screen at a world position */
+	struct DebugText
+	{
+		glm::vec3 Pos {};
+		uint32 Color = 0;
+		std::string Text;
+	};
+
+	/**
+	 * @brief	Immediate mode debug shapes. Everything is turned into lines and appended to one vertex
+	 *			list, so the DebugSubpass draws a whole frame of them with a single draw call no matter
+	 *			how many shapes there are. Text is drawn by ImGui when it is enabled.
+	 *			Use the DebugDraw functions instead of this directly, they are compiled out of shipping builds.
+	 */
+	class DebugDrawList
+	{
+	public:
+
+		void Line(const glm::vec3& t_From, const glm::vec3& t_To, const glm::vec4& t_Color);
+
+		void Box(const AABB& t_Box, const glm::vec4& t_Color);
+
+		/** The -1 to 1 cube transformed by the given matrix, for oriented boxes */
+		void Box(const glm::mat4& t_Transform, const glm::vec4& t_Color);
+
+		/** A circle around each axis */
+		void Sphere(const glm::vec3& t_Center, float t_Radius, const glm::vec4& t_Color, uint32 t_Segments = 16);
+
+		/** The frustum of a view projection matrix with a 0 to 1 depth range */
+		void Frustum(const glm::mat4& t_ViewProj, const glm::vec4& t_Color);
+
+		void Text(const glm::vec3& t_Pos, const std::string& t_Text, const glm::vec4& t_Color);
+
+		/** Called once a frame after everything was drawn */
+		void Clear();
+
+		FORCEINLINE const std::vector<DebugVertex>& GetVertices() const { return m_Vertices; }
+		FORCEINLINE const std::vector<DebugText>& GetTexts() const { return m_Texts; }
+		FORCEINLINE uint32 GetLineCount() const { return static_cast<uint32>(m_Vertices.size() / 2); }
+
+		static uint32 PackColor(const glm::vec4& t_Color);
+
+		/**
+		 * @brief	Find the pixel that a world position lands on, with 0,0 at the top left
+		 * @param t_ViewProj	View projection matrix with Vulkan's Y down clip space
+		 * @return	False if the position is behind the camera
+		 */
+		static bool ProjectToScreen(const glm::mat4& t_ViewProj, const glm::vec3& t_Pos, const glm::vec2& t_ScreenSize, glm::vec2& t_OutPixel);
+
+	private:
+
+		/** The 12 edges of a box from its 8 corners, indexed by the bits of x, y, and z */
+		void BoxEdges(const glm::vec3 (&t_Corners)[8], uint32 t_Color);
+
+		std::vector<DebugVertex> m_Vertices;
+		std::vector<DebugText> m_Texts;
+	};
+
+	/** Draw debug shapes for this frame from anywhere on the main thread. These do nothing with WITH_DEBUG_DRAW off */
+	namespace DebugDraw
+	{
+#if WITH_DEBUG_DRAW
+		/** The list that the DebugSubpass draws and VulkanApp clears every frame */
+		DebugDrawList& GetList();
+
+		inline void Line(const glm::vec3& t_From, const glm::vec3& t_To, const glm::vec4& t_Color) { GetList().Line(t_From, t_To, t_Color); }
+		inline void Box(const AABB& t_Box, const glm::vec4& t_Color) { GetList().Box(t_Box, t_Color); }
+		inline void Box(const glm::mat4& t_Transform, const glm::vec4& t_Color) { GetList().Box(t_Transform, t_Color); }
+		inline void Sphere(const glm::vec3& t_Center, float t_Radius, const glm::vec4& t_Color) { GetList().Sphere(t_Center, t_Radius, t_Color); }
+		inline void Frustum(const glm::mat4& t_ViewProj, const glm::vec4& t_Color) { GetList().Frustum(t_ViewProj, t_Color); }
+		inline void Text(const glm::vec3& t_Pos, const std::string& t_Text, const glm::vec4& t_Color) { GetList().Text(t_Pos, t_Text, t_Color); }
+#else
+		inline void Line(const glm::vec3&, const glm::vec3&, const glm::vec4&) {}
+		inline void Box(const AABB&, const glm::vec4&) {}
+		inline void Box(const glm::mat4&, const glm::vec4&) {}
+		inline void Sphere(const glm::vec3&, float, const glm::vec4&) {}
+		inline void Frustum(const glm::mat4&, const glm::vec4&) {}
+		inline void Text(const glm::vec3&, const std::string&, const glm::vec4&) {}
+#endif	// WITH_DEBUG_DRAW
+	}	// namespace DebugDraw
+}   // namespace Fling
@@ -2,56 +2,52 @@
 
 #include "Subpass.h"
 
+#include <array>
+
 namespace Fling
 {
 	class CommandBuffer;
 	class LogicalDevice;
-	class FrameBuffer;	
-	struct MeshRenderer;
+	class FrameBuffer;
 	class Swapchain;
-	class FirstPersonCamera;
+	class Buffer;
 
+	/**
+	* @brief	Draws the lines of DebugDraw on top of the lit scene, in the same subpass as the lighting.
+	*			The list that was taken with the frame's snapshot is copied into a vertex buffer and drawn with one draw call
+	*/
 	class DebugSubpass : public Subpass
 	{
 	public:
 		DebugSubpass(
 			const LogicalDevice* t_Dev,
 			const Swapchain* t_Swap,
-			entt::registry& t_reg,
 			VkRenderPass t_GlobalRenderPass,
-			FirstPersonCamera* t_Cam,
 			std::shared_ptr<Fling::Shader> t_Vert,
 			std::shared_ptr<Fling::Shader> t_Frag
 		);
 
 		virtual ~DebugSubpass();
 
-		void Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, entt::registry& t_reg, float DeltaTime) override;
-
-		void CreateDescriptorSets(VkDescriptorPool t_Pool, entt::registry& t_reg) override;
+		void Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot) override;
 
-		void PrepareAttachments() override;
+		const char* GetProfileName() const override { return "Debug"; }
 
 		void CreateGraphicsPipeline() override;
 
-		void CleanUp(entt::registry& t_reg) override;
+		void OnSwapchainResized(entt::registry& t_reg) override;
 
-	private:
+		/** Room for this many lines is allocated for every frame up front */
+		static constexpr VkDeviceSize InitialLineCapacity = 16 * 1024;
 
-		void OnMeshRendererAdded(entt::entity t_Ent, entt::registry& t_Reg, MeshRenderer& t_MeshRend);
+	private:
 
-		void CreateMeshDescriptorSet(MeshRenderer& t_MeshRend);
+		/** Make sure the vertex buffer of a frame can hold the given size, grows by doubling and never shrinks */
+		void ReserveVertexBuffer(uint32 t_ActiveFrameInFlight, VkDeviceSize t_Size);
 
 		VkRenderPass m_GlobalRenderPass = VK_NULL_HANDLE;
 
-		const FirstPersonCamera* m_Camera;
-
-		struct DebugUBO
-		{
-			glm::mat4 Projection;
-			glm::mat4 Model;
-		} m_Ubo;
-
-		VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+		/** One persistently mapped vertex buffer per frame in flight, only written once that frame's fence was waited on */
+		std::array<std::unique_ptr<Buffer>, VkConfig::MAX_FRAMES_IN_FLIGHT> m_VertexBuffers;
 	};
-}   // namespace Fling
\ No newline at end of file
+}   // namespace Fling
@@ -9,7 +9,16 @@ namespace Fling
 	class DepthBuffer
 	{
 	public:
-		explicit DepthBuffer(LogicalDevice* t_Dev, VkSampleCountFlagBits t_SampleCount, VkExtent2D t_Extents);
+		/**
+		* @param t_ExtraUsage	Usage on top of being a depth attachment, i.e. an input attachment
+		* @param t_MemoryProps	Memory properties of the image, lazily allocated if it is transient
+		*/
+		explicit DepthBuffer(
+			LogicalDevice* t_Dev,
+			VkSampleCountFlagBits t_SampleCount,
+			VkExtent2D t_Extents,
+			VkImageUsageFlags t_ExtraUsage = 0,
+			VkMemoryPropertyFlags t_MemoryProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
 		~DepthBuffer();
 
@@ -51,5 +60,8 @@ namespace Fling
 		VkExtent2D m_Extents{};
 
 		VkSampleCountFlagBits m_SampleCount = VK_SAMPLE_COUNT_1_BIT;
+
+		VkImageUsageFlags m_ExtraUsage = 0;
+		VkMemoryPropertyFlags m_MemoryProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 	};
 }   // namespace Fling
\ No newline at end of file
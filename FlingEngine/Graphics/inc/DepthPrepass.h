@@ -0,0 +1,114 @@
+#pragma once
+
+#include "FlingVulkan.h"
+
+#include <string>
+
+namespace Fling
+{
+	/** Value of the Graphics.DepthPrepass option */
+	enum class DepthPrepassMode : uint8
+	{
+		/** Never draw the prepass */
+		Off,
+		/** Always draw it */
+		On,
+		/** Time the G-Buffer both ways and keep whichever is cheaper */
+		Auto
+	};
+
+	/** Which pipeline a batch of G-Buffer draws is recorded with */
+	enum class GBufferDrawMode : uint8
+	{
+		/** Every target and depth, without a prepass */
+		NoPrepass,
+		/** Only depth, the prepass */
+		DepthOnly,
+		/** Every target after the prepass, depth is tested with EQUAL and not written */
+		AfterPrepass
+	};
+
+	/** Tuning of DepthPrepassSelector, read from the Graphics.DepthPrepass options */
+	struct DepthPrepassSettings
+	{
+		DepthPrepassMode Mode = DepthPrepassMode::Off;
+
+		/** Frames that are averaged to measure each choice */
+		uint32 SampleFrames = 16;
+
+		/** Frames after a change that were already in flight with the old choice, their costs are ignored */
+		uint32 LatencyFrames = VkConfig::MAX_FRAMES_IN_FLIGHT;
+
+		/** Frames to keep a choice before both are measured again, the scene may have changed by then */
+		uint32 RetestFrames = 600;
+
+		/** How much cheaper the other choice has to be to switch to it, as a fraction of the current cost */
+		float Margin = 0.05f;
+	};
+
+	/**
+	 * @brief	Decides if the G-Buffer draws a depth only prepass first. With it every mesh is drawn
+	 *			twice, but the G-Buffer only shades the closest fragment of each pixel, so it pays off
+	 *			when there is a lot of overdraw and loses when there isn't.
+	 *			In Auto mode the current choice is measured, then the other one, and the cheaper one is
+	 *			kept until it is time to test again. Costs should not depend on the render size, like
+	 *			milliseconds per pixel, so that dynamic resolution doesn't skew the comparison.
+	 */
+	class DepthPrepassSelector
+	{
+	public:
+
+		explicit DepthPrepassSelector(const DepthPrepassSettings& t_Settings);
+
+		/**
+		 * @brief	Add the cost of a frame that finished
+		 * @return	True if the prepass was turned on or off
+		 */
+		bool AddFrameCost(float t_Cost);
+
+		FORCEINLINE bool IsEnabled() const { return m_Enabled; }
+
+		/** True while Auto mode is trying out a choice */
+		FORCEINLINE bool IsMeasuring() const { return m_Phase != Phase::Hold; }
+
+		FORCEINLINE const DepthPrepassSettings& GetSettings() const { return m_Settings; }
+
+		/** Off, On, or Auto, case insensitive. Anything else is Off */
+		static DepthPrepassMode ParseMode(const std::string& t_Value);
+
+	private:
+
+		enum class Phase : uint8
+		{
+			/** Measuring the choice that was kept last time */
+			MeasureCurrent,
+			/** Measuring the other choice to compare against */
+			MeasureOther,
+			/** Keeping a choice until the next test */
+			Hold
+		};
+
+		/** Add a sample to the current measurement, true once it has enough of them */
+		bool AddSample(float t_Cost, float& t_Average);
+
+		void SetEnabled(bool t_Enabled);
+
+		DepthPrepassSettings m_Settings;
+
+		bool m_Enabled = false;
+
+		Phase m_Phase = Phase::Hold;
+
+		/** Average cost of the choice that was measured first */
+		float m_CurrentCost = 0.0f;
+
+		/** Frames left to ignore since the last change */
+		uint32 m_SkipFrames = 0;
+
+		/** Frames left in the hold phase */
+		uint32 m_HoldFrames = 0;
+
+		uint32 m_SampleCount = 0;
+		float m_SampleSum = 0.0f;
+	};
+}   // namespace Fling
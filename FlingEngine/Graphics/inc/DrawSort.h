@@ -0,0 +1,155 @@
+#pragma once
+
+#include "FlingTypes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Fling
+{
+	/**
+	 * @brief	Packs what a draw needs bound into 64 bits so that sorting the keys groups draws with
+	 *			the same state. From the highest bits down:
+	 *				Pass			4	Opaque first, anything blended after
+	 *				Pipeline		6
+	 *				Depth bucket	6	Coarse distance, so opaque meshes are drawn roughly front to back
+	 *				Material		16
+	 *				Mesh			16
+	 *				Depth			16	Fine distance, front to back within the same material and mesh
+	 *			Materials are bindless and every mesh is in the same geometry buffer, so switching either
+	 *			only changes push constants. That is why a coarse depth goes above them, early-Z saves
+	 *			more than grouping every material together would.
+	 */
+	struct DrawSortKey
+	{
+		static constexpr uint32 PassBits = 4;
+		static constexpr uint32 PipelineBits = 6;
+		static constexpr uint32 DepthBucketBits = 6;
+		static constexpr uint32 MaterialBits = 16;
+		static constexpr uint32 MeshBits = 16;
+		static constexpr uint32 DepthBits = 16;
+
+		static constexpr uint32 DepthShift = 0;
+		static constexpr uint32 MeshShift = DepthShift + DepthBits;
+		static constexpr uint32 MaterialShift = MeshShift + MeshBits;
+		static constexpr uint32 DepthBucketShift = MaterialShift + MaterialBits;
+		static constexpr uint32 PipelineShift = DepthBucketShift + DepthBucketBits;
+		static constexpr uint32 PassShift = PipelineShift + PipelineBits;
+
+		static_assert(PassShift + PassBits == 64, "The fields of a draw sort key have to fill 64 bits");
+
+		/**
+		 * @param t_Material	Any id of the material, ids wider than the field are folded into it.
+		 *						Two materials that end up with the same bits are only grouped worse
+		 * @param t_Mesh		Same for the mesh
+		 * @param t_Depth		Distance from the camera over the far plane, clamped to [0, 1]
+		 */
+		static uint64 Make(uint32 t_Pass, uint32 t_Pipeline, uint32 t_Material, uint32 t_Mesh, float t_Depth);
+
+		static uint32 GetPass(uint64 t_Key) { return GetField(t_Key, PassShift, PassBits); }
+		static uint32 GetPipeline(uint64 t_Key) { return GetField(t_Key, PipelineShift, PipelineBits); }
+		static uint32 GetDepthBucket(uint64 t_Key) { return GetField(t_Key, DepthBucketShift, DepthBucketBits); }
+		static uint32 GetMaterial(uint64 t_Key) { return GetField(t_Key, MaterialShift, MaterialBits); }
+		static uint32 GetMesh(uint64 t_Key) { return GetField(t_Key, MeshShift, MeshBits); }
+		static uint32 GetDepth(uint64 t_Key) { return GetField(t_Key, DepthShift, DepthBits); }
+
+		/** Fold an id into the given number of bits, mixing in the high bits instead of dropping them */
+		static uint32 FoldId(uint32 t_Id, uint32 t_Bits);
+
+	private:
+
+		static uint32 GetField(uint64 t_Key, uint32 t_Shift, uint32 t_Bits)
+		{
+			return static_cast<uint32>((t_Key >> t_Shift) & ((1ull << t_Bits) - 1));
+		}
+	};
+
+	/**
+	 * @brief	Stable LSD radix sort of draw keys, a byte at a time. Bytes that are the same in every
+	 *			key are skipped, which is most of the pass and pipeline bits.
+	 *			Big lists are split into one chunk per thread. Each pass counts the bytes of every chunk
+	 *			in parallel and then scatters every chunk in parallel, so the result doesn't depend on
+	 *			which thread took which chunk.
+	 */
+	class DrawSorter
+	{
+	public:
+
+		/** Lists shorter than this are sorted on the calling thread, waking the workers costs more */
+		static constexpr uint32 MinParallelCount = 4096;
+
+		/** @param t_WorkerCount	Threads that help with big lists, with 0 the calling thread does all of it */
+		explicit DrawSorter(uint32 t_WorkerCount = 0);
+
+		~DrawSorter();
+
+		/**
+		 * @brief	Find the order that sorts the keys, equal keys keep the order they were given in
+		 * @param t_OutOrder	Resized to the number of keys. Entry i is the index of the i-th smallest key
+		 */
+		void Sort(const std::vector<uint64>& t_Keys, std::vector<uint32>& t_OutOrder);
+
+		/** Byte passes that the last sort needed, out of 8 */
+		FORCEINLINE uint32 GetLastPassCount() const { return m_LastPassCount; }
+
+	private:
+
+		struct SortItem
+		{
+			uint64 Key;
+			uint32 Index;
+		};
+
+		enum class SortPhase : uint8
+		{
+			Count,
+			Scatter
+		};
+
+		static constexpr uint32 RadixBits = 8;
+		static constexpr uint32 BucketCount = 1 << RadixBits;
+
+		/** Run the phase over every chunk, on the workers too if there is more than one chunk */
+		void RunPhase(SortPhase t_Phase);
+
+		/** Pull chunks off of the list until there are none left */
+		void RunChunks();
+
+		void CountChunk(uint32 t_Chunk);
+
+		void ScatterChunk(uint32 t_Chunk);
+
+		void WorkerLoop();
+
+		std::vector<SortItem> m_Items;
+		std::vector<SortItem> m_Scratch;
+
+		/** Counts and then write offsets of every bucket, BucketCount per chunk */
+		std::vector<uint32> m_Buckets;
+
+		uint32 m_ItemCount = 0;
+		uint32 m_Shift = 0;
+		SortPhase m_Phase = SortPhase::Count;
+
+		uint32 m_LastPassCount = 0;
+
+		// Workers ----------
+		std::vector<std::thread> m_Workers;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_WorkAvailable;
+		std::condition_variable m_WorkDone;
+
+		/** Bumped every time there is a new phase to run */
+		uint64 m_Generation = 0;
+		bool m_ShuttingDown = false;
+
+		/** Atomic because a worker that is still leaving the last phase compares against it */
+		std::atomic<uint32> m_ChunkCount { 1 };
+		std::atomic<uint32> m_NextChunk { 1 };
+		std::atomic<uint32> m_ChunksLeft { 0 };
+	};
+}   // namespace Fling
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Frustum.h"
+
+namespace Fling
+{
+	/**
+	 * @brief	A dynamic bounding volume hierarchy of AABBs. Leaves are stored with a
+	 *			"fat" box so that small movements don't require touching the tree.
+	 *			Leaves are inserted with a surface area heuristic and the tree is kept
+	 *			balanced with AVL style rotations (same idea as Box2D's b2DynamicTree).
+	 *
+	 *			Proxy IDs are stable for the lifetime of a proxy, even across Rebuild.
+	 */
+	class DynamicBVH
+	{
+	public:
+
+		static constexpr int32 NullNode = -1;
+
+		/**
+		 * @param t_Margin	Fraction of a box's size that fat boxes are grown by on each side
+		 */
+		explicit DynamicBVH(float t_Margin = 0.1f);
+
+		/** Insert a new box into the tree. @return The proxy ID of this box */
+		int32 CreateProxy(const AABB& t_Box, uint32 t_UserData);
+
+		void DestroyProxy(int32 t_ProxyId);
+
+		/**
+		 * @brief	Update the box of a proxy. Only re-inserts the leaf if the new box has
+		 *			escaped the fat box that is stored in the tree
+		 * @return	True if the proxy was re-inserted
+		 */
+		bool MoveProxy(int32 t_ProxyId, const AABB& t_Box);
+
+		/** Remove every proxy from the tree */
+		void Clear();
+
+		/**
+		 * @brief	Throw away all the internal nodes and build them again top down from
+		 *			the current leaves. Fixes any quality lost from incremental updates
+		 */
+		void Rebuild();
+
+		/**
+		 * @brief	Find every proxy that could be inside of the given frustum.
+		 * @param t_OutInside		User data of proxies in subtrees fully inside the frustum
+		 * @param t_OutIntersecting	User data of leaves whose fat box crosses the frustum,
+		 *							these should be tested on their tight bounds
+		 */
+		void QueryFrustum(const Frustum& t_Frustum, std::vector<uint32>& t_OutInside, std::vector<uint32>& t_OutIntersecting) const;
+
+		/** Find every proxy whose fat box overlaps the given box */
+		void QueryAABB(const AABB& t_Box, std::vector<uint32>& t_OutUserData) const;
+
+		FORCEINLINE uint32 GetUserData(int32 t_ProxyId) const { return m_Nodes[t_ProxyId].UserData; }
+
+		FORCEINLINE const AABB& GetFatAABB(int32 t_ProxyId) const { return m_Nodes[t_ProxyId].Box; }
+
+		FORCEINLINE uint32 GetProxyCount() const { return m_ProxyCount; }
+
+		/** Number of leaves that have been inserted or re-inserted since the last rebuild */
+		FORCEINLINE uint32 GetReinsertCount() const { return m_ReinsertsSinceRebuild; }
+
+		/** Height of the tree, 0 if there is only one leaf */
+		int32 GetHeight() const;
+
+		/** Sum of the surface area of every node over the surface area of the root. Lower is better */
+		float GetAreaRatio() const;
+
+	private:
+
+		struct Node
+		{
+			AABB Box;
+
+			union
+			{
+				int32 Parent;
+				int32 Next;
+			};
+
+			int32 Child1 = NullNode;
+			int32 Child2 = NullNode;
+
+			/** Leaf = 0, free node = -1 */
+			int32 Height = 0;
+
+			uint32 UserData = 0;
+
+			FORCEINLINE bool IsLeaf() const { return Child1 == NullNode; }
+		};
+
+		int32 AllocateNode();
+
+		void FreeNode(int32 t_Node);
+
+		void InsertLeaf(int32 t_Leaf);
+
+		void RemoveLeaf(int32 t_Leaf);
+
+		/** Perform a left or right rotation if node A is imbalanced. @return The new root of this subtree */
+		int32 Balance(int32 t_A);
+
+		/** Walk up from the given node fixing heights and boxes */
+		void RefitAncestors(int32 t_Node);
+
+		int32 BuildTopDown(int32* t_Leaves, int32 t_Count);
+
+		/** Push the user data of every leaf under the given node */
+		void GatherLeaves(int32 t_Node, std::vector<uint32>& t_Out) const;
+
+		AABB MakeFat(const AABB& t_Box) const;
+
+		std::vector<Node> m_Nodes;
+
+		int32 m_Root = NullNode;
+
+		int32 m_FreeList = NullNode;
+
+		uint32 m_ProxyCount = 0;
+
+		uint32 m_ReinsertsSinceRebuild = 0;
+
+		float m_Margin = 0.1f;
+
+		/** Scratch stack for traversals so that we don't allocate every query */
+		mutable std::vector<int32> m_Stack;
+		mutable std::vector<int32> m_GatherStack;
+	};
+}   // namespace Fling
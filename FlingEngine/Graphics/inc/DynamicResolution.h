@@ -0,0 +1,72 @@
+#pragma once
+
+#include "FlingVulkan.h"
+
+namespace Fling
+{
+	/** Bounds and tuning of DynamicResolution, read from the Graphics.DynamicResolution options */
+	struct DynamicResolutionSettings
+	{
+		/** GPU frame time to stay under */
+		float TargetMilliseconds = 16.0f;
+
+		/** Smallest and largest scale of the output size, along each axis */
+		float MinScale = 0.5f;
+		float MaxScale = 1.0f;
+
+		/** How far under the target a frame has to be before the scale goes back up, as a fraction of it */
+		float Headroom = 0.15f;
+
+		/** Most that the scale moves in one step */
+		float MaxStep = 0.1f;
+
+		/** Frames that are averaged for every decision */
+		uint32 SampleFrames = 8;
+
+		/** Frames after a change that were already in flight at the old scale, their times are ignored */
+		uint32 LatencyFrames = VkConfig::MAX_FRAMES_IN_FLIGHT;
+	};
+
+	/**
+	 * @brief	Picks the scale to render the scene at from measured GPU frame times. Targets are
+	 *			allocated once for the max scale and drawn into a viewport of them, so a new scale
+	 *			never reallocates anything. The cost of a frame is assumed to follow its pixel count,
+	 *			so the scale moves by the square root of how far the frame time is from the target.
+	 */
+	class DynamicResolution
+	{
+	public:
+
+		explicit DynamicResolution(const DynamicResolutionSettings& t_Settings);
+
+		/**
+		 * @brief	Add the GPU time of a frame that finished
+		 * @return	True if the scale changed
+		 */
+		bool AddFrameTime(float t_Milliseconds);
+
+		FORCEINLINE float GetScale() const { return m_Scale; }
+
+		FORCEINLINE const DynamicResolutionSettings& GetSettings() const { return m_Settings; }
+
+		/** Size to allocate the targets at so that every scale fits */
+		VkExtent2D GetAllocatedExtent(VkExtent2D t_Output) const;
+
+		/** Size to render at with the current scale */
+		VkExtent2D GetRenderExtent(VkExtent2D t_Output) const;
+
+	private:
+
+		static VkExtent2D Scale(VkExtent2D t_Extent, float t_Scale);
+
+		DynamicResolutionSettings m_Settings;
+
+		float m_Scale = 1.0f;
+
+		/** Frames left to ignore since the last change */
+		uint32 m_SkipFrames = 0;
+
+		uint32 m_SampleCount = 0;
+		float m_SampleSum = 0.0f;
+	};
+}   // namespace Fling
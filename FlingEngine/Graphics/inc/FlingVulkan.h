@@ -18,6 +18,8 @@
 
 #endif // NOMINMAX
 
+#include "RenderHandoff.h"
+
 // Some Vulkan constant definitions
 // Grabbed these from Granite: https://github.com/Themaister/Granite/blob/master/vulkan/shader.cpp
 namespace Fling
@@ -34,6 +36,13 @@ namespace Fling
 	namespace VkConfig
 	{
 		static const int MAX_FRAMES_IN_FLIGHT = 2;
+
+		/**
+		 * Frames that something freed on the main thread waits before it is reused. With the render
+		 * thread, the last snapshot that uses it can still be queued in every handoff slot, and it
+		 * is only done on the GPU once the frames in flight after it have waited on its fence
+		 */
+		static const uint32 RETIRE_FRAMES = MAX_FRAMES_IN_FLIGHT + RenderHandoff::SlotCount;
 	}
 
 }   // namespace Fling
\ No newline at end of file
@@ -19,6 +19,8 @@ namespace Fling
 		uint32 LayerCount = {};
 		VkFormat Format = {};
 		VkImageUsageFlags Usage = {};
+		/** Lazily allocated memory lets tiled GPUs keep transient attachments on chip */
+		VkMemoryPropertyFlags MemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 	};
 
     struct FrameBufferAttachment
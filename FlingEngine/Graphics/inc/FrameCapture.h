@@ -0,0 +1,103 @@
+#pragma once
+
+#include "FlingVulkan.h"
+#include "NonCopyable.hpp"
+
+#include <array>
+#include <future>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace Fling
+{
+	class Buffer;
+	class CommandBuffer;
+	class LogicalDevice;
+
+	/**
+	 * @brief	Copies selected frames back to the CPU and writes them out as PNG or raw RGBA files.
+	 *			The copy is recorded at the end of the frame and read once the fence of that frame
+	 *			in flight has been waited on, so the CPU never waits for the GPU just to take a capture.
+	 *			Files are encoded and written on another thread.
+	 *			Reads the [Headless] CaptureFrames, CaptureInterval, CaptureFormat and CaptureDir options.
+	 */
+	class FrameCapture : public NonCopyable
+	{
+	public:
+
+		enum class FileFormat : uint8
+		{
+			Png,
+			/** Tightly packed RGBA8, the size is part of the file name */
+			Raw
+		};
+
+		/**
+		 * @param t_Extent	Size of the images that will be captured
+		 * @param t_Format	Format of the images, has to be 4 bytes per pixel in RGBA order
+		 */
+		FrameCapture(const LogicalDevice* t_Dev, VkExtent2D t_Extent, VkFormat t_Format);
+
+		/** Writes out any captures that are still pending and waits for every file to finish */
+		~FrameCapture();
+
+		/**
+		 * @brief	Call once per frame, after the render pass has ended. Records the copy if this frame
+		 *			is one that should be captured.
+		 * @param t_Image	Image to capture, in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+		 */
+		void Record(CommandBuffer& t_CmdBuf, uint32 t_FrameInFlight, VkImage t_Image);
+
+		/** Call after waiting on the fence of the frame in flight. Starts writing its capture if it has one */
+		void Resolve(uint32 t_FrameInFlight);
+
+		/** True if anything is going to be captured at all */
+		bool IsEnabled() const { return !m_Frames.empty() || m_Interval > 0; }
+
+		uint32 GetWrittenCount() const { return m_WrittenCount; }
+
+	private:
+
+		struct Readback
+		{
+			Buffer* Staging = nullptr;
+			/** Frame number of the copy that is in the buffer */
+			uint32 Frame = 0;
+			bool Pending = false;
+		};
+
+		bool ShouldCapture(uint32 t_Frame) const;
+
+		/** Runs on a worker thread */
+		static bool WriteFile(std::string t_Path, FileFormat t_Format, VkExtent2D t_Extent, std::vector<uint8> t_Pixels);
+
+		/** Forget about writes that are done, logging any that failed */
+		void CollectFinishedWrites(bool t_Wait);
+
+		const LogicalDevice* m_Device;
+
+		VkExtent2D m_Extent;
+
+		VkDeviceSize m_ImageSize = 0;
+
+		std::array<Readback, VkConfig::MAX_FRAMES_IN_FLIGHT> m_Readbacks;
+
+		/** Frame numbers that should be captured */
+		std::set<uint32> m_Frames;
+
+		/** Capture every n'th frame as well, 0 to disable */
+		uint32 m_Interval = 0;
+
+		FileFormat m_FileFormat = FileFormat::Png;
+
+		std::string m_Directory;
+
+		/** Number of frames that Record has been called for */
+		uint32 m_FrameCount = 0;
+
+		uint32 m_WrittenCount = 0;
+
+		std::vector<std::future<bool>> m_Writes;
+	};
+}   // namespace Fling
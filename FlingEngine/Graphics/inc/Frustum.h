@@ -0,0 +1,92 @@
+#pragma once
+
+#include "BoundingVolume.h"
+
+namespace Fling
+{
+	/** Result of classifying a volume against a frustum */
+	enum class Containment : uint8
+	{
+		Outside,
+		Intersecting,
+		Inside
+	};
+
+	/**
+	 * @brief	A view frustum represented by 6 normalized planes (xyz = normal pointing
+	 *			inside, w = distance). Extracted from a view projection matrix.
+	 */
+	struct Frustum
+	{
+		enum Plane : uint8
+		{
+			Left,
+			Right,
+			Bottom,
+			Top,
+			Near,
+			Far,
+			Count
+		};
+
+		glm::vec4 m_Planes[Plane::Count] = {};
+
+		Frustum() = default;
+
+		explicit Frustum(const glm::mat4& t_ViewProj) { Update(t_ViewProj); }
+
+		/**
+		 * @brief	Extract the frustum planes from the given view projection matrix.
+		 *			Expects a 0 to 1 depth range (GLM_FORCE_DEPTH_ZERO_TO_ONE)
+		 */
+		void Update(const glm::mat4& t_ViewProj);
+
+		/** True if the given sphere is at least partially inside of the frustum */
+		bool IntersectsSphere(const glm::vec3& t_Center, float t_Radius) const;
+
+		/** True if the given box (center and half extents) is at least partially inside of the frustum */
+		bool IntersectsBox(const glm::vec3& t_Center, const glm::vec3& t_Extents) const;
+
+		FORCEINLINE bool IntersectsAABB(const AABB& t_Box) const { return IntersectsBox(t_Box.GetCenter(), t_Box.GetExtents()); }
+
+		/** Check if the given box is outside, partially inside, or fully inside of the frustum */
+		Containment Classify(const AABB& t_Box) const;
+	};
+
+	/**
+	 * @brief	A list of world space bounding boxes stored as a structure of arrays so that
+	 *			they can be tested against a frustum 4 at a time with SSE.
+	 */
+	class FrustumCuller
+	{
+	public:
+
+		/** Remove all bounds, but keep the allocated memory around for next frame */
+		void Reset();
+
+		void Reserve(size_t t_Count);
+
+		/** Add a box to be culled. @return The index of this box */
+		uint32 Add(const AABB& t_WorldBox);
+
+		FORCEINLINE uint32 GetCount() const { return static_cast<uint32>(m_CenterX.size()); }
+
+		/**
+		 * @brief	Test every box against the frustum.
+		 * @param t_OutVisible 	Indices of the boxes that are in the frustum, in ascending order.
+		 *						Cleared before being written to.
+		 * @return	The number of visible boxes
+		 */
+		uint32 Cull(const Frustum& t_Frustum, std::vector<uint32>& t_OutVisible) const;
+
+	private:
+
+		std::vector<float> m_CenterX;
+		std::vector<float> m_CenterY;
+		std::vector<float> m_CenterZ;
+
+		std::vector<float> m_ExtentX;
+		std::vector<float> m_ExtentY;
+		std::vector<float> m_ExtentZ;
+	};
+}   // namespace Fling
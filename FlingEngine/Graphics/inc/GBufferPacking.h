@@ -0,0 +1,33 @@
+#pragma once
+
+#include "FlingMath.h"
+
+namespace Fling
+{
+	/**
+	 * @brief	CPU reference of the G-Buffer packing helpers in the shaders (Deferred/GBufferPacking.h).
+	 *			Every function does the same math as its GLSL version so that it can be tested here
+	 */
+	namespace GBufferPacking
+	{
+		/** Sign of each component, with 0 counted as positive */
+		glm::vec2 SignNotZero(const glm::vec2& t_Value);
+
+		/**
+		 * @brief	Unit vector to a point on the octahedron in [-1, 1], which is what the normal target stores
+		 * @see		http://jcgt.org/published/0003/02/01/
+		 */
+		glm::vec2 EncodeNormal(const glm::vec3& t_Normal);
+
+		/** Point on the octahedron back to a unit vector */
+		glm::vec3 DecodeNormal(const glm::vec2& t_Encoded);
+
+		/**
+		 * @brief	World space position from a depth buffer value
+		 * @param t_UV				Screen UV. The G-Buffer is rendered with a Y flipped projection, so (0, 0) is NDC (-1, -1)
+		 * @param t_Depth			Value in the depth buffer
+		 * @param t_InvViewProj		Inverse of the view projection that the G-Buffer was rendered with
+		 */
+		glm::vec3 ReconstructPosition(const glm::vec2& t_UV, float t_Depth, const glm::mat4& t_InvViewProj);
+	}   // namespace GBufferPacking
+}   // namespace Fling
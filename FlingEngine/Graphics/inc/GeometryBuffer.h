@@ -0,0 +1,118 @@
+#pragma once
+
+#include "FlingVulkan.h"
+#include "NonCopyable.hpp"
+#include "RangeAllocator.h"
+#include "Vertex.h"
+
+#include <memory>
+#include <vector>
+
+namespace Fling
+{
+	class Buffer;
+
+	/** Where a mesh is in the geometry buffers, in vertices and indices */
+	struct GeometryAllocation
+	{
+		uint32 FirstVertex = 0;
+		uint32 VertexCount = 0;
+		uint32 FirstIndex = 0;
+		uint32 IndexCount = 0;
+
+		bool IsValid() const { return VertexCount > 0 && IndexCount > 0; }
+	};
+
+	/**
+	 * @brief	The geometry buffers as they were when a frame was extracted. The buffers that these
+	 *			point to stay alive until that frame is done even if the geometry buffer grows, so the
+	 *			render thread can bind them without touching the GeometryBuffer
+	 */
+	struct GeometryBindings
+	{
+		VkBuffer Vertices = VK_NULL_HANDLE;
+		VkBuffer Positions = VK_NULL_HANDLE;
+		VkBuffer Indices = VK_NULL_HANDLE;
+
+		/** Bind the vertex and index buffer, or just the positions for depth only pipelines */
+		void Bind(VkCommandBuffer t_CmdBuf, bool t_PositionsOnly = false) const;
+	};
+
+	/**
+	 * @brief	One vertex, position, and index buffer that every model is sub allocated from, so
+	 *			a pass binds them once and picks the mesh with firstIndex and vertexOffset. This is
+	 *			what lets the indirect path draw every batch with a single call.
+	 *			The buffers double when they are full. The old ones are copied over and kept until
+	 *			the frames that bound them are done, same as ranges that are freed.
+	 */
+	class GeometryBuffer : public NonCopyable
+	{
+	public:
+
+		static constexpr VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+
+		/**
+		 * @param t_Format			Format of every vertex that is uploaded, @see Model::GetVertexFormat
+		 * @param t_VertexCapacity	Vertices that there is room for before the first time it grows
+		 * @param t_IndexCapacity	Same for indices
+		 */
+		GeometryBuffer(VertexFormat t_Format, uint32 t_VertexCapacity, uint32 t_IndexCapacity);
+
+		~GeometryBuffer();
+
+		/**
+		 * @brief	Allocate room for a mesh and upload it. Indices stay relative to the mesh, draws
+		 *			add FirstVertex as the vertex offset
+		 * @param t_Vertices	t_VertexCount vertices in the format of the buffer
+		 * @param t_Positions	The same vertices in the layout of Vertex::GetPositionBindingDescription
+		 */
+		GeometryAllocation Allocate(const void* t_Vertices, const void* t_Positions, uint32 t_VertexCount, const uint32* t_Indices, uint32 t_IndexCount);
+
+		/** The ranges are reused once the frames that may still draw them are done */
+		void Free(const GeometryAllocation& t_Allocation);
+
+		/** Call once per frame, from the thread that allocates */
+		void NextFrame();
+
+		GeometryBindings GetBindings() const;
+
+		VertexFormat GetVertexFormat() const { return m_Format; }
+
+		uint32 GetUsedVertexCount() const { return m_VertexRanges.GetUsedSize(); }
+		uint32 GetUsedIndexCount() const { return m_IndexRanges.GetUsedSize(); }
+
+	private:
+
+		/** Replace the buffers of a stream with bigger ones that have room for at least t_Count more */
+		void GrowVertices(uint32 t_Count);
+		void GrowIndices(uint32 t_Count);
+
+		/** Create a bigger buffer, copy the old one into it and retire the old one */
+		void GrowBuffer(std::unique_ptr<Buffer>& t_Buffer, VkDeviceSize t_NewSize, VkBufferUsageFlags t_Usage);
+
+		static std::unique_ptr<Buffer> CreateDeviceBuffer(VkDeviceSize t_Size, VkBufferUsageFlags t_Usage);
+
+		VertexFormat m_Format;
+		uint32 m_VertexStride;
+		uint32 m_PositionStride;
+
+		std::unique_ptr<Buffer> m_Vertices;
+		std::unique_ptr<Buffer> m_Positions;
+		std::unique_ptr<Buffer> m_Indices;
+
+		/** In vertices, the vertex and position buffers are allocated together */
+		RangeAllocator m_VertexRanges;
+		RangeAllocator m_IndexRanges;
+
+		struct RetiredBuffer
+		{
+			std::unique_ptr<Fling::Buffer> Replaced;
+			uint64 ReleaseFrame;
+		};
+
+		/** Buffers that were replaced when growing, in the order that they were replaced */
+		std::vector<RetiredBuffer> m_RetiredBuffers;
+
+		uint64 m_Frame = 0;
+	};
+}   // namespace Fling
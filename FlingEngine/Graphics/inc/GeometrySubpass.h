@@ -5,22 +5,22 @@
 #include "Lighting/DirectionalLight.hpp"
 #include "Lighting/PointLight.hpp"
 #include "Lighting/Lighting.hpp"
+#include "LightClusters.h"
 
 namespace Fling
 {
 	class CommandBuffer;
 	class LogicalDevice;
-	class FrameBuffer;	
+	class OffscreenSubpass;
 	struct MeshRenderer;
 	class Swapchain;
 	class GraphicsPipeline;
 	class Model;
 	class Buffer;
-	class FirstPersonCamera;
 
 	/**
-	* @brief	Settings for the max directional lights and max point lights.
-	*			These settings are used 
+	* @brief	Settings for the max directional lights. Point lights have no limit, they are
+	*			assigned to clusters and stored in storage buffers (see LightClusterGrid)
 	* @todo		Ideally we would load these settings in from the game config file
 	*/
 	struct DeferredLightSettings
@@ -28,8 +28,11 @@ namespace Fling
 		/** Dir Lights */
 		static const uint32 MaxDirectionalLights = 8;
 
-		/** Point Lights */
-		static const uint32 MaxPointLights = 128;
+		/** How many point lights the storage buffers start with room for. They grow if there are more */
+		static const uint32 InitialPointLightCapacity = 256;
+
+		/** How many cluster light indices the storage buffers start with room for */
+		static const uint32 InitialLightIndexCapacity = 4096;
 	};
 
 	/** Uniform buffer for passing lights to our final screen pass */
@@ -38,18 +41,27 @@ namespace Fling
 		alignas(4) uint32 DirLightCount = 0;
 		alignas(4) uint32 PointLightCount = 0;
 
-		alignas(16) DirectionalLight DirLightBuffer[DeferredLightSettings::MaxDirectionalLights] = {};
+		/** Number of light clusters along x, y, and z */
+		alignas(16) glm::uvec4 ClusterCounts = {};
 
-		alignas(16) PointLight PointLightBuffer[DeferredLightSettings::MaxPointLights] = {};
+		/** Tile size in pixels and the depth slice scale and bias. See LightClusterGrid::GetClusterScale */
+		alignas(16) glm::vec4 ClusterScale = {};
+
+		alignas(16) DirectionalLight DirLightBuffer[DeferredLightSettings::MaxDirectionalLights] = {};
 	};
 
 	struct CameraInfoUbo
 	{
 		glm::mat4 Projection;
 		glm::mat4 ModelView;
+		/** Inverse of the G-Buffer view projection, for getting world positions from depth */
+		glm::mat4 InvViewProj;
 		glm::vec4 CamPos = {};
 		float Gamma = 2.2f;
 		float Exposure = 4.5f;
+
+		/** Part of the G-Buffer that was rendered with dynamic resolution. See OffscreenSubpass::GetGBufferUVScale */
+		alignas(16) glm::vec4 GBufferUVScale = glm::vec4(1.0f);
 	};
 
 	/**
@@ -66,15 +78,19 @@ namespace Fling
 			const Swapchain* t_Swap,
 			entt::registry& t_reg,
 			VkRenderPass t_GlobalRenderPass,
-			FirstPersonCamera* t_Cam,
-			FrameBuffer* t_OffscreenDep,
+			const OffscreenSubpass* t_OffscreenDep,
 			std::shared_ptr<Fling::Shader> t_Vert,
 			std::shared_ptr<Fling::Shader> t_Frag
 		);
 
 		virtual ~GeometrySubpass();
 
-		void Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, entt::registry& t_reg, float DeltaTime) override;
+		/** Copy the lights out of the registry */
+		void Extract(entt::registry& t_reg, RenderSnapshot& t_Snapshot) override;
+
+		void Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot) override;
+
+		const char* GetProfileName() const override { return "Lighting"; }
 
 		void CreateDescriptorSets(VkDescriptorPool t_Pool, entt::registry& t_reg) override;
 
@@ -89,7 +105,15 @@ namespace Fling
 
 		void OnPointLightAdded(entt::entity t_Ent, entt::registry& t_Reg, PointLight& t_Light);
 
-		void UpdateLightingUBO(entt::registry& t_Reg, uint32 t_ActiveFrame);
+		void UpdateLightingUBO(const RenderSnapshot& t_Snapshot, uint32 t_ActiveFrame);
+
+		/**
+		 * @brief	Copy data to one of the per frame light storage buffers. If it doesn't fit, the buffer
+		 *			is recreated with double the size and the descriptor set of that frame is updated
+		 */
+		void WriteLightBuffer(std::vector<Buffer*>& t_Buffers, uint32 t_ActiveFrame, uint32 t_Binding, const void* t_Data, VkDeviceSize t_Size);
+
+		static Buffer* CreateLightBuffer(VkDeviceSize t_Size);
 
 		// Global render pass for frame buffer writes
 		std::shared_ptr<Model> m_QuadModel;
@@ -97,20 +121,31 @@ namespace Fling
 		VkRenderPass m_GlobalRenderPass = VK_NULL_HANDLE;
 		VkDescriptorPool m_DescPool = VK_NULL_HANDLE;
 
-		const FirstPersonCamera* m_Camera;
+		/** The offscreen subpass that has the G Buffer targets */
+		const OffscreenSubpass* m_Offscreen = nullptr;
 
-		/** The offscreen frame buffer that has the G Buffer attachments */
-		FrameBuffer* m_OffscreenFrameBuf = nullptr;
-
-		// Descriptor sets and Uniform buffers -- one per swap image
+		// Descriptor sets and Uniform buffers -- one per frame in flight
 		std::vector<VkDescriptorSet> m_DescriptorSets;
 		std::vector<Buffer*> m_LightingUboBuffers;
 		std::vector<Buffer*> m_CameraUboBuffers;
 
 		std::vector<Buffer*> m_QuadUboBuffer;
 
+		// Clustered point lights -- one storage buffer of each per frame in flight
+		std::vector<Buffer*> m_PointLightBuffers;
+		std::vector<Buffer*> m_ClusterBuffers;
+		std::vector<Buffer*> m_LightIndexBuffers;
+
+		LightClusterGrid m_LightClusters;
+
+		/** View space position and range of every point light in the snapshot, for clustering */
+		std::vector<glm::vec4> m_ViewSpaceLights;
+
 		LightingUbo m_LightingUBO = {};
 
 		CameraInfoUbo m_CamInfoUBO = {};
+
+		/** Draw a small sphere on every point light with DebugDraw, set by Graphics.DebugDrawLights */
+		bool m_DrawLightGizmos = false;
 	};
 }   // namespace Fling
\ No newline at end of file
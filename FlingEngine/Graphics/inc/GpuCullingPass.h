@@ -0,0 +1,229 @@
+#pragma once
+
+#include "FlingVulkan.h"
+#include "IndirectDraw.h"
+#include "MeshSimplifier.h"
+#include "DepthPrepass.h"
+#include "Shader.h"
+#include "NonCopyable.hpp"
+
+#include <entt/entity/registry.hpp>
+
+namespace Fling
+{
+	class LogicalDevice;
+	class CommandBuffer;
+	class GraphicsPipeline;
+	class Buffer;
+	class Model;
+	class BindlessTextures;
+	struct GeometryBindings;
+	struct MeshRenderer;
+	struct Transform;
+
+	/** Camera UBO for mrt_indirect.vert */
+	struct alignas(16) IndirectCameraUBO
+	{
+		glm::mat4 Projection;
+		glm::mat4 View;
+	};
+
+	/**
+	 * @brief	Optional GPU driven path for the offscreen pass. Per object data lives in a storage
+	 *			buffer, cull.comp frustum culls it, picks the level of detail of what is visible and
+	 *			writes the indirect draw commands, and the G-Buffer is drawn with one indirect call
+	 *			per batch of objects that share a model. Materials don't split batches, each object
+	 *			has its slots in the bindless texture array. Per frame CPU work only depends on the
+	 *			batch count and what moved.
+	 *
+	 *			Enabled with [Graphics] GpuDrivenRendering. With [Graphics] GpuCullingValidation
+	 *			the results are read back each frame and compared against IndirectDrawList::Cull,
+	 *			which is also the only time that Stats::Lod is filled in on this path.
+	 *
+	 *			Everything the GPU writes or reads per frame is duplicated for each frame in flight,
+	 *			so a frame slot is only touched again once its fence has been waited on. When meshes
+	 *			are added or removed, each frame slot makes new buffers the next time it is recorded,
+	 *			and the other slot keeps drawing from its old ones in the meantime.
+	 */
+	class GpuCullingPass : public NonCopyable
+	{
+	public:
+
+		/** @param t_Bindless	Texture array that the material slots of each mesh renderer point into */
+		GpuCullingPass(
+			const LogicalDevice* t_Dev,
+			entt::registry& t_Reg,
+			BindlessTextures* t_Bindless,
+			std::shared_ptr<Fling::Shader> t_Cull,
+			std::shared_ptr<Fling::Shader> t_Vert,
+			std::shared_ptr<Fling::Shader> t_Frag
+		);
+
+		virtual ~GpuCullingPass();
+
+		/** Check if the device has the features that this path needs */
+		static bool IsSupported(const LogicalDevice* t_Dev);
+
+		/** The G-Buffer pipeline used for the indirect draws. The offscreen pass sets its state and creates it */
+		FORCEINLINE GraphicsPipeline* GetGraphicsPipeline() const { return m_GraphicsPipeline; }
+
+		/**
+		 * @brief	Make the pipelines for the depth prepass. Call before they are created
+		 * @param t_DepthVert	depth_indirect.vert, only reads positions
+		 */
+		void EnableDepthPrepass(std::shared_ptr<Fling::Shader> t_DepthVert);
+
+		/** Depth only pipeline of the prepass, null unless it was enabled. Created by the offscreen pass */
+		FORCEINLINE GraphicsPipeline* GetDepthPipeline() const { return m_DepthPipeline; }
+
+		/** G-Buffer pipeline for after the prepass, null unless it was enabled. Created by the offscreen pass */
+		FORCEINLINE GraphicsPipeline* GetPrepassedPipeline() const { return m_PrepassedPipeline; }
+
+		/**
+		 * @brief	Upload anything that changed and record the cull dispatch. Must be recorded outside of a render pass
+		 * @param t_ActiveFrame	The frame in flight being recorded. Its last submission must have finished
+		 * @param t_Changed		Entities whose world matrix changed since the last frame
+		 * @param t_Lods		Settings that cull.comp picks the level of detail of each visible object with
+		 */
+		void RecordCull(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrame, entt::registry& t_Reg, const std::vector<entt::entity>& t_Changed, const Frustum& t_Frustum, const IndirectCameraUBO& t_Camera, const LodSelector& t_Lods);
+
+		/**
+		 * @brief	Record the indirect draws of every batch. Must be inside of the G-Buffer render pass,
+		 *			or the depth prepass for DepthOnly. Both read the same commands that RecordCull wrote
+		 * @param t_Geometry	Buffers of the frame's snapshot, every batch draws out of them
+		 */
+		void RecordDraws(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrame, const GeometryBindings& t_Geometry, GBufferDrawMode t_Mode = GBufferDrawMode::NoPrepass);
+
+		/** Disconnect from the registry */
+		void CleanUp(entt::registry& t_Reg);
+
+	private:
+
+		/** Vulkan resources for drawing one batch */
+		struct BatchResources
+		{
+			Model* m_Model = nullptr;
+		};
+
+		/** Buffers that the GPU reads or writes while a frame is in flight */
+		struct FrameResources
+		{
+			/** Sized for the objects of m_LayoutVersion */
+			VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+
+			VkDescriptorSet m_ComputeSet = VK_NULL_HANDLE;
+
+			/** Camera and object buffers for the G-Buffer pipeline, set 1 is the bindless textures */
+			VkDescriptorSet m_GraphicsSet = VK_NULL_HANDLE;
+
+			/** GpuObjectData of every object, persistently mapped */
+			Buffer* m_ObjectBuffer = nullptr;
+
+			/** One DrawIndexedCommand per object, written by cull.comp */
+			Buffer* m_CommandBuffer = nullptr;
+
+			/** IndirectBatch of each batch */
+			Buffer* m_BatchBuffer = nullptr;
+
+			/** GpuLodData of every batch */
+			Buffer* m_LodBuffer = nullptr;
+
+			/**
+			 * Level that each object was last drawn with by this frame, cull.comp reads it for the
+			 * hysteresis and writes it back. Starts at full detail whenever the objects are rebuilt
+			 */
+			Buffer* m_LodLevelBuffer = nullptr;
+
+			/** Visible draw count of each batch when compacting */
+			Buffer* m_CountBuffer = nullptr;
+
+			Buffer* m_CameraBuffer = nullptr;
+
+			/** Objects that moved since this frame's object buffer was last written */
+			std::vector<uint32> m_PendingObjects;
+
+			/** Objects layout that the buffers were made for, older than the current one until this frame is recorded again */
+			uint64 m_LayoutVersion = 0;
+
+			/** True if a dispatch has been recorded since the objects were last rebuilt */
+			bool m_HasResults = false;
+
+			/** Frustum of the last dispatch, for validation */
+			Frustum m_Frustum;
+		};
+
+		void CreateComputePipeline();
+
+		/** Gather every drawable entity into batches. Each frame makes its buffers again the next time it is recorded */
+		void RebuildObjects(entt::registry& t_Reg);
+
+		/** Make the buffers and sets of a frame for the current objects. Its last submission must have finished */
+		void CreateBuffers(FrameResources& t_Frame);
+
+		void CreateDescriptorSets(FrameResources& t_Frame);
+
+		void ReleaseBuffers(FrameResources& t_Frame);
+
+		/** Compare the results of the last dispatch of this frame against the CPU reference */
+		void ValidateResults(const FrameResources& t_Frame);
+
+		void OnMeshRendererChanged(entt::entity t_Ent, entt::registry& t_Reg, MeshRenderer& t_MeshRend);
+
+		void OnTransformAdded(entt::entity t_Ent, entt::registry& t_Reg, Transform& t_Trans);
+
+		void OnComponentRemoved(entt::entity t_Ent, entt::registry& t_Reg);
+
+		const LogicalDevice* m_Device;
+
+		BindlessTextures* m_Bindless;
+
+		std::shared_ptr<Fling::Shader> m_CullShader;
+		std::shared_ptr<Fling::Shader> m_VertexShader;
+		std::shared_ptr<Fling::Shader> m_FragShader;
+
+		GraphicsPipeline* m_GraphicsPipeline = nullptr;
+
+		/** Only used with the depth prepass, see EnableDepthPrepass */
+		std::shared_ptr<Fling::Shader> m_DepthShader;
+		GraphicsPipeline* m_DepthPipeline = nullptr;
+		GraphicsPipeline* m_PrepassedPipeline = nullptr;
+
+		VkDescriptorSetLayout m_ComputeSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout m_ComputePipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_ComputePipeline = VK_NULL_HANDLE;
+
+		std::array<FrameResources, VkConfig::MAX_FRAMES_IN_FLIGHT> m_Frames;
+
+		IndirectDrawList m_DrawList;
+
+		std::vector<BatchResources> m_Batches;
+
+		/** Where each entity is in the object buffer */
+		std::unordered_map<entt::entity, uint32> m_ObjectIndices;
+
+		/** Entity of each object in the object buffer */
+		std::vector<entt::entity> m_ObjectEntities;
+
+		/** Set when something was added or removed and the batches need to be built again */
+		bool m_LayoutDirty = true;
+
+		/** Bumped every time the objects are rebuilt */
+		uint64 m_LayoutVersion = 0;
+
+		/** Pack visible draws together and use vkCmdDrawIndexedIndirectCount */
+		bool m_Compact = false;
+
+		PFN_vkCmdDrawIndexedIndirectCountKHR m_CmdDrawIndexedIndirectCount = nullptr;
+
+		/** Put a GPU profiler scope around every batch. Set from Graphics.GpuProfileDrawBuckets */
+		bool m_ProfileBatches = false;
+
+		// Validation ----------
+		bool m_Validate = false;
+
+		std::vector<DrawIndexedCommand> m_ReferenceCommands;
+		std::vector<uint32> m_ReferenceCounts;
+		std::vector<uint32> m_GpuVisible;
+		std::vector<uint32> m_CpuVisible;
+	};
+}   // namespace Fling
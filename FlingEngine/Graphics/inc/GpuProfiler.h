@@ -0,0 +1,200 @@
+#pragma once
+
+#include "FlingVulkan.h"
+#include "NonCopyable.hpp"
+#include "Stats.h"
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Fling
+{
+	class CommandBuffer;
+	class LogicalDevice;
+
+	/**
+	 * @brief	Measures how long the GPU spends in named scopes of a frame with timestamp queries.
+	 *			Every frame in flight has its own query pool, which is read back after the fence
+	 *			of that frame has been waited on, so reading the results never stalls. Scopes can
+	 *			be recorded in any command buffer of the frame as long as the frame start buffer
+	 *			is submitted before all of them.
+	 *			Results go to Stats::Gpu and the last frames can be exported as a Chrome trace.
+	 *			Frames are recorded and resolved on whichever thread renders, the frame time and
+	 *			ExportTrace can be used from any thread.
+	 */
+	class GpuProfiler : public NonCopyable
+	{
+	public:
+
+		/** Scopes that fit in one frame, any more are dropped */
+		static constexpr uint32 MaxScopes = 128;
+
+		/** Frames kept around for ExportTrace */
+		static constexpr uint32 TraceFrameCount = 300;
+
+		static constexpr uint32 InvalidScope = ~0U;
+
+		/**
+		 * @brief	Begins a scope when constructed and ends it when destroyed. Does nothing
+		 *			if there is no profiler
+		 */
+		class Scope : public NonCopyable
+		{
+		public:
+			Scope(GpuProfiler* t_Profiler, CommandBuffer& t_CmdBuf, const char* t_Name)
+				: m_Profiler(t_Profiler)
+				, m_CmdBuf(t_CmdBuf)
+				, m_Index(t_Profiler ? t_Profiler->BeginScope(t_CmdBuf, t_Name) : InvalidScope)
+			{
+			}
+
+			~Scope()
+			{
+				if (m_Profiler)
+				{
+					m_Profiler->EndScope(m_CmdBuf, m_Index);
+				}
+			}
+
+		private:
+			GpuProfiler* m_Profiler;
+			CommandBuffer& m_CmdBuf;
+			uint32 m_Index;
+		};
+
+		/** @param t_Pool	Pool that the frame start command buffers are allocated from */
+		GpuProfiler(const LogicalDevice* t_Dev, VkCommandPool t_Pool);
+
+		~GpuProfiler();
+
+		/** False if the graphics queue can't write timestamps, nothing is recorded then */
+		bool IsSupported() const { return m_ValidBitMask != 0; }
+
+		/**
+		 * @brief	Call after waiting on the fence of the frame in flight. Reads the results of the
+		 *			last frame that used it and records the frame start command buffer
+		 */
+		void BeginFrame(uint32 t_FrameInFlight);
+
+		/** Resets the queries of the frame. Has to be the first command buffer of the frame that is submitted */
+		CommandBuffer* GetFrameStartCommandBuffer(uint32 t_FrameInFlight) const { return m_Frames[t_FrameInFlight].StartCmdBuf; }
+
+		/** Write the end of the frame into the last command buffer that is submitted */
+		void EndFrame(CommandBuffer& t_CmdBuf);
+
+		/** @return	Index to pass to EndScope, InvalidScope if the scope won't be measured */
+		uint32 BeginScope(CommandBuffer& t_CmdBuf, const char* t_Name);
+
+		void EndScope(CommandBuffer& t_CmdBuf, uint32 t_Scope);
+
+		/** Milliseconds of the last frame that was read back */
+		FORCEINLINE float GetLastFrameTime() const { return m_LastFrameTime; }
+
+		/** Goes up every time a frame is read back, to tell if GetLastFrameTime is a new frame */
+		FORCEINLINE uint64 GetResolvedFrameCount() const { return m_ResolvedFrameCount; }
+
+		/** Milliseconds of the first scope with this name in the last frame that was read back, 0 if there was none */
+		float GetLastScopeTime(const char* t_Name) const;
+
+		/**
+		 * @brief	Write the last frames that were resolved in the Chrome trace event format
+		 *			(chrome://tracing or Perfetto)
+		 * @return	True if the file was written
+		 */
+		bool ExportTrace(const std::string& t_Path) const;
+
+		/** Milliseconds between two raw timestamps. Handles the counter wrapping around */
+		static double TicksToMilliseconds(uint64 t_Begin, uint64 t_End, uint64 t_ValidBitMask, float t_NanosecondsPerTick)
+		{
+			const uint64 Ticks = (t_End - t_Begin) & t_ValidBitMask;
+			return static_cast<double>(Ticks) * static_cast<double>(t_NanosecondsPerTick) / 1000000.0;
+		}
+
+	private:
+
+		struct ScopeRecord
+		{
+			uint32 NameId = 0;
+			uint32 Depth = 0;
+		};
+
+		struct FrameQueries
+		{
+			VkQueryPool Pool = VK_NULL_HANDLE;
+			CommandBuffer* StartCmdBuf = nullptr;
+			std::vector<ScopeRecord> Scopes;
+			/** True once the frame start buffer was recorded, until the results are read */
+			bool Pending = false;
+		};
+
+		struct TraceEvent
+		{
+			uint32 NameId;
+			uint32 Depth;
+			/** The whole frame, every scope after it until the next frame belongs to it */
+			bool IsFrame;
+			/** Microseconds since the first frame that was resolved */
+			double Start;
+			double Duration;
+		};
+
+		/** Query 0 is the start of the frame and 1 the end, scopes use two each after that */
+		static constexpr uint32 QueriesPerFrame = 2 + MaxScopes * 2;
+
+		/** Weight of the newest frame in the averages */
+		static constexpr float AverageWeight = 0.05f;
+
+		uint32 GetNameId(const char* t_Name);
+
+		void Resolve(FrameQueries& t_Frame);
+
+		const LogicalDevice* m_Device;
+
+		std::array<FrameQueries, VkConfig::MAX_FRAMES_IN_FLIGHT> m_Frames;
+
+		/** Frame that scopes are being recorded for */
+		uint32 m_ActiveFrame = 0;
+
+		uint32 m_OpenDepth = 0;
+
+		uint64 m_ValidBitMask = 0;
+
+		float m_NanosecondsPerTick = 1.0f;
+
+		/** Scope names, a deque so that the strings never move */
+		std::deque<std::string> m_Names;
+		std::unordered_map<std::string, uint32> m_NameIds;
+
+		std::vector<float> m_AverageMilliseconds;
+
+		float m_AverageFrameTime = 0.0f;
+
+		/** Read by dynamic resolution on the main thread while the render thread resolves */
+		std::atomic<float> m_LastFrameTime { 0.0f };
+
+		std::atomic<uint64> m_ResolvedFrameCount { 0 };
+
+		std::vector<Stats::GpuScopeTiming> m_LastTimings;
+
+		/** Guards m_Trace and adding to m_Names, so that ExportTrace can run while frames are resolved */
+		mutable std::mutex m_TraceMutex;
+
+		std::deque<TraceEvent> m_Trace;
+
+		/** Number of frames in m_Trace */
+		uint32 m_TraceFrames = 0;
+
+		uint32 m_FrameNameId = 0;
+
+		/** Timestamp that trace events are relative to */
+		uint64 m_TraceBase = 0;
+		bool m_HasTraceBase = false;
+
+		bool m_WarnedOverflow = false;
+	};
+}   // namespace Fling
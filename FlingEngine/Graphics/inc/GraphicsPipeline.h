@@ -3,6 +3,7 @@
 #include "Shader.h"
 #include "Vertex.h"
 #include "MultiSampler.h"
+#include "PipelineKey.h"
 
 namespace Fling
 {
@@ -26,8 +27,35 @@ namespace Fling
             VkCullModeFlags t_CullMode = VK_CULL_MODE_BACK_BIT,
             VkFrontFace t_FrontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE);
 
+        /**
+        * Recreate the pipeline layout with set layouts after set 0 and a push constant range.
+        * Must be called before the pipeline is created
+        */
+        void SetPipelineLayout(const std::vector<VkDescriptorSetLayout>& t_ExtraSetLayouts, VkShaderStageFlags t_PushConstantStages, uint32 t_PushConstantSize);
+
+        /**
+        * Only read the position stream of models, @see GeometryBindings::Bind.
+        * For depth only pipelines, must be called before the pipeline is created
+        */
+        void UsePositionStream();
+
         void BindGraphicsPipeline(const VkCommandBuffer& t_CommandBuffer);
-        void CreateGraphicsPipeline(VkRenderPass& t_RenderPass, Multisampler* t_Sampler);
+
+        /**
+        * Get the pipeline for the current state from the pipeline cache.
+        * @param t_Async    Compile it on a worker thread if it isn't cached. The previous pipeline
+        *                   is kept as a fallback if it is compatible with the render pass, @see PrepareForDraw
+        */
+        void CreateGraphicsPipeline(VkRenderPass& t_RenderPass, Multisampler* t_Sampler, bool t_Async = false);
+
+        /**
+        * Swap in a pipeline that finished compiling in the background.
+        * @return False if there is nothing to draw with yet and the draw should be skipped
+        */
+        bool PrepareForDraw();
+
+        /** True while an async pipeline is still compiling */
+        bool IsCompiling() const { return m_HasPendingPipeline; }
 
         const std::vector<Shader*> GetShaders() const { return m_Shaders; }
 
@@ -55,15 +83,30 @@ namespace Fling
         VkCullModeFlags m_CullMode;
         VkFrontFace m_FrontFace;
 
+        /** Owned by the pipeline cache, which destroys it along with the pipeline layout */
         VkPipeline m_Pipeline = VK_NULL_HANDLE;
-        VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
         VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
         VkPipelineBindPoint m_PipelineBindPoint;
 
-		VkGraphicsPipelineCreateInfo m_PipelineCreateInfo = {};
+        /** Key of the pipeline that is compiling in the background */
+        PipelineKey m_PendingKey;
+        bool m_HasPendingPipeline = false;
+
+        /** Render pass compatibility of m_Pipeline, so a fallback is only used with a pass it works with */
+        uint64 m_RenderPassHash = 0;
+
+        /** Subpass of the render pass that this pipeline is used in */
+        uint32 m_Subpass = 0;
 
         VkDescriptorSetLayout m_DescriptorSetLayout;
-        VkPipelineVertexInputStateCreateInfo m_VertexInputStateCreateInfo = {};
+
+        /**
+        * Layout of Fling::Vertex by default, clear them for pipelines that don't read vertex buffers
+        * or call UsePositionStream for ones that only read positions
+        */
+        std::vector<VkVertexInputBindingDescription> m_VertexBindings;
+        std::vector<VkVertexInputAttributeDescription> m_VertexAttributes;
+
         VkPipelineInputAssemblyStateCreateInfo m_InputAssemblyState = {};
         VkPipelineRasterizationStateCreateInfo m_RasterizationState = {};
         std::vector<VkPipelineColorBlendAttachmentState> m_ColorBlendAttachmentStates;
@@ -72,7 +115,6 @@ namespace Fling
         VkPipelineViewportStateCreateInfo m_ViewportState = {};
         VkPipelineMultisampleStateCreateInfo m_MultisampleState = {};
         VkPipelineDynamicStateCreateInfo m_DynamicState = {};
-        VkPipelineTessellationStateCreateInfo m_TessellationState = {};
     };
 
 }
\ No newline at end of file
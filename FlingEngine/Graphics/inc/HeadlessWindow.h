@@ -0,0 +1,58 @@
+#pragma once
+
+#include "FlingWindow.h"
+
+namespace Fling
+{
+	/**
+	* A window without anything on screen, for rendering to offscreen images only.
+	* It never creates a surface and closes itself after a set number of frames
+	*/
+	class HeadlessWindow : public FlingWindow
+	{
+	public:
+
+		/** @param t_FrameCount	Frames to run before closing, 0 runs until something else stops the engine */
+		HeadlessWindow(const WindowProps& t_Props, uint32 t_FrameCount);
+		virtual ~HeadlessWindow() = default;
+
+		/** Leaves the surface as VK_NULL_HANDLE */
+		virtual void CreateSurface(void* t_GraphicsInstance, void* t_SurfData) override;
+
+		/** Counts the frame, there are no events to poll */
+		virtual void Update() override;
+
+		virtual void WaitForNewWindowSize() override {}
+
+		/** Non-zero once the frame count has been reached */
+		virtual int ShouldClose() override;
+
+		virtual bool IsMinimized() const override final { return false; }
+
+		virtual uint32 GetWidth() const override { return m_Width; }
+
+		virtual uint32 GetHeight() const override { return m_Height; }
+
+		virtual float GetAspectRatio() const override { return static_cast<float>(m_Width) / static_cast<float>(m_Height); }
+
+		virtual void SetMouseVisible(bool t_IsVisible) override { m_IsMouseVisible = t_IsVisible; }
+
+		virtual bool GetMouseVisible() override { return m_IsMouseVisible; }
+
+		/** There is nothing to show an icon on */
+		void SetWindowIcon(Guid t_ID) override {}
+
+		virtual void SetWindowMode(WindowMode t_WindowMode) override { m_WindowMode = t_WindowMode; }
+		virtual WindowMode GetWindowMode() override { return m_WindowMode; }
+
+		uint32 GetFrameCount() const { return m_FramesUpdated; }
+
+	private:
+
+		uint32 m_Width;
+		uint32 m_Height;
+
+		uint32 m_FrameLimit;
+		uint32 m_FramesUpdated = 0;
+	};
+}   // namespace Fling
@@ -9,6 +9,7 @@ namespace Fling
 	class Swapchain;
 	class BaseEditor;
 	class FlingWindow;
+	struct UiDrawSnapshot;
 
 	class ImGuiSubpass : public Subpass
 	{
@@ -26,7 +27,12 @@ namespace Fling
 
 		virtual ~ImGuiSubpass();
 
-		void Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, entt::registry& t_reg, float DeltaTime) override;
+		/** Build the UI with ImGui and copy its draw data, ImGui isn't touched outside of the main thread */
+		void Extract(entt::registry& t_reg, RenderSnapshot& t_Snapshot) override;
+
+		void Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot) override;
+
+		const char* GetProfileName() const override { return "ImGui"; }
 
 		void CreateDescriptorSets(VkDescriptorPool t_Pool, entt::registry& t_reg) override;
 
@@ -42,9 +48,26 @@ namespace Fling
 
 		void PrepareResources();
 
-		void BuildCommandBuffer(VkCommandBuffer t_commandBuffer);
+		void BuildCommandBuffer(VkCommandBuffer t_commandBuffer, const UiDrawSnapshot& t_Ui, uint32 t_ActiveFrameInFlight);
+
+		/** Copy the draw data of the last ImGui::Render into the snapshot */
+		static void CopyDrawData(UiDrawSnapshot& t_Ui);
+
+		/** Copy the UI geometry of a snapshot into the vertex and index buffers of this frame in flight */
+		void UpdateUniforms(const UiDrawSnapshot& t_Ui, uint32 t_ActiveFrameInFlight);
 
-		void UpdateUniforms();
+		/** Add the labels of DebugDraw to the ImGui background, at their position on screen */
+		void DrawDebugText(const RenderSnapshot& t_Snapshot);
+
+		/**
+		* Make sure a geometry buffer can hold the given size. Grows by doubling and never shrinks, so
+		* after the first few frames of a session the UI never allocates again
+		*/
+		static void ReserveGeometryBuffer(std::unique_ptr<class Buffer>& t_Buffer, VkDeviceSize t_Size, VkBufferUsageFlags t_Usage);
+
+		/** Space for this many vertices and indices is allocated for every frame up front */
+		static constexpr VkDeviceSize InitialVertexCapacity = 8 * 1024;
+		static constexpr VkDeviceSize InitialIndexCapacity = 16 * 1024;
 
 		struct PushConstBlock
 		{
@@ -52,8 +75,12 @@ namespace Fling
 			glm::vec2 translate;
 		} pushConstBlock;
 
-		std::unique_ptr<class Buffer> m_vertexBuffer;
-		std::unique_ptr<class Buffer> m_indexBuffer;
+		/**
+		* One vertex and index buffer per frame in flight, host coherent and mapped for as long as they live.
+		* A frame's buffers are only written after its fence was waited on, so nothing else is reading them
+		*/
+		std::array<std::unique_ptr<class Buffer>, VkConfig::MAX_FRAMES_IN_FLIGHT> m_vertexBuffers;
+		std::array<std::unique_ptr<class Buffer>, VkConfig::MAX_FRAMES_IN_FLIGHT> m_indexBuffers;
 
 		VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
 		VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
@@ -73,9 +100,6 @@ namespace Fling
 		/** Instance of the editor that we will get what commands to build from */
 		std::shared_ptr<Fling::BaseEditor> m_Editor;
 
-		int32 m_vertexCount = 0;
-		int32 m_indexCount = 0;
-
 		VkRenderPass m_GlobalRenderPass = VK_NULL_HANDLE;
 	};
 }   // namespace Fling
\ No newline at end of file
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "Frustum.h"
+#include "TextureSlots.h"
+#include "MeshSimplifier.h"
+
+namespace Fling
+{
+	/**
+	 * @brief	Per object data for GPU driven rendering. Read by cull.comp and mrt_indirect.vert,
+	 *			so the layout has to match ObjectData in those shaders (std430)
+	 */
+	struct alignas(16) GpuObjectData
+	{
+		glm::mat4 World = glm::mat4(1.0f);
+
+		/** Local space bounds of the mesh. Extents w is 1 if the vertices are compact, see Model::GetDecodeExtents */
+		glm::vec4 BoundsCenter = glm::vec4(0.0f);
+		glm::vec4 BoundsExtents = glm::vec4(0.0f);
+
+		/** Range of the index buffer to draw at full detail, or always if the batch has no levels of detail */
+		uint32 FirstIndex = 0;
+		uint32 IndexCount = 0;
+		int32 VertexOffset = 0;
+
+		/** The batch (model) that this object is drawn with */
+		uint32 BatchIndex = 0;
+
+		/** Where the material textures are in the bindless array, @see BindlessTextures */
+		MaterialTextureSlots Textures;
+	};
+
+	static_assert(sizeof(GpuObjectData) == 128, "GpuObjectData must match the std430 layout in cull.comp");
+
+	/** Same layout as VkDrawIndexedIndirectCommand so that the CPU reference doesn't need Vulkan */
+	struct DrawIndexedCommand
+	{
+		uint32 IndexCount = 0;
+		uint32 InstanceCount = 0;
+		uint32 FirstIndex = 0;
+		int32 VertexOffset = 0;
+		/** Index of the object in the object buffer, the vertex shader reads it from gl_InstanceIndex */
+		uint32 FirstInstance = 0;
+	};
+
+	/** Push constants of cull.comp */
+	struct GpuCullConstants
+	{
+		glm::vec4 Planes[Frustum::Count];
+		uint32 ObjectCount = 0;
+
+		/**
+		 * If set, visible draws are packed to the front of their batch and counted for vkCmdDrawIndexedIndirectCount.
+		 * Otherwise every object keeps its own command and culled ones get an instance count of 0
+		 */
+		uint32 Compact = 0;
+
+		/** Same as the LodSelector settings, a threshold of 0 always draws full detail */
+		float LodThreshold = 0.0f;
+		float LodHysteresis = 0.0f;
+
+		/** xyz is the camera position, w is LodSelector::PixelsPerUnit */
+		glm::vec4 LodCamera = glm::vec4(0.0f);
+	};
+
+	static_assert(sizeof(GpuCullConstants) <= 128, "Only 128 bytes of push constants are guaranteed");
+
+	/** One level of detail of a batch's model. Read by cull.comp, so it has to match LodData (std430) */
+	struct GpuLodData
+	{
+		/** Range of the index buffer, already offset by where the model is in the geometry buffer */
+		uint32 FirstIndex = 0;
+		uint32 IndexCount = 0;
+
+		/** Model space error of the level, @see MeshLod::Error */
+		float Error = 0.0f;
+
+		uint32 Padding = 0;
+	};
+
+	static_assert(sizeof(GpuLodData) == 16, "GpuLodData must match the std430 layout in cull.comp");
+
+	/**
+	 * @brief	A range of objects that share a model and material, drawn with a single indirect call.
+	 *			Uploaded as is for cull.comp, so it has to match BatchData (std430)
+	 */
+	struct IndirectBatch
+	{
+		uint32 FirstCommand = 0;
+		uint32 CommandCount = 0;
+
+		/** Levels of detail of the batch, finest first. With none every object draws its own index range */
+		uint32 FirstLod = 0;
+		uint32 LodCount = 0;
+	};
+
+	static_assert(sizeof(IndirectBatch) == 16, "IndirectBatch must match the std430 layout in cull.comp");
+
+	/**
+	 * @brief	The objects and batches that are uploaded for GPU driven rendering. Objects
+	 *			are stored sorted by batch, so object i always writes draw command i.
+	 *			Also has a CPU version of the cull shader to check the GPU results against.
+	 */
+	class IndirectDrawList
+	{
+	public:
+
+		void Clear();
+
+		/** Start a new batch, any objects added after this go into it. @return Index of the batch */
+		uint32 BeginBatch();
+
+		/** Add an object to the current batch. @return Index of the object */
+		uint32 AddObject(GpuObjectData t_Object);
+
+		/** Add a level of detail to the current batch, finest first */
+		void AddLod(const GpuLodData& t_Lod);
+
+		FORCEINLINE std::vector<GpuObjectData>& GetObjects() { return m_Objects; }
+		FORCEINLINE const std::vector<GpuObjectData>& GetObjects() const { return m_Objects; }
+
+		FORCEINLINE const std::vector<IndirectBatch>& GetBatches() const { return m_Batches; }
+
+		FORCEINLINE const std::vector<GpuLodData>& GetLods() const { return m_Lods; }
+
+		FORCEINLINE uint32 GetObjectCount() const { return static_cast<uint32>(m_Objects.size()); }
+
+		FORCEINLINE uint32 GetBatchCount() const { return static_cast<uint32>(m_Batches.size()); }
+
+		/** Fill in the push constants that cull.comp needs for this frustum. Every object is drawn at full detail */
+		void GetCullConstants(const Frustum& t_Frustum, bool t_Compact, GpuCullConstants& t_OutConstants) const;
+
+		/** Same as above, but visible objects of batches with levels of detail get one picked with these settings */
+		void GetCullConstants(const Frustum& t_Frustum, bool t_Compact, const LodSelector& t_Lods, GpuCullConstants& t_OutConstants) const;
+
+		/**
+		 * @brief	CPU reference of cull.comp without levels of detail. Writes the same draw commands and batch counts that the GPU would
+		 * @param t_OutCommands		One command per object
+		 * @param t_OutBatchCounts	Number of visible draws per batch. Only meaningful when compacting
+		 */
+		void Cull(const Frustum& t_Frustum, bool t_Compact, std::vector<DrawIndexedCommand>& t_OutCommands, std::vector<uint32>& t_OutBatchCounts) const;
+
+		/**
+		 * @brief	CPU reference of cull.comp with everything that it is given
+		 * @param t_LodLevels	Level that each object was drawn with last, updated for the visible ones
+		 *						the same way that cull.comp updates its buffer. Missing entries start at 0
+		 */
+		void Cull(const GpuCullConstants& t_Constants, std::vector<uint32>& t_LodLevels, std::vector<DrawIndexedCommand>& t_OutCommands, std::vector<uint32>& t_OutBatchCounts) const;
+
+		/**
+		 * @brief	Find the indices of every object that the given commands will draw, sorted
+		 * @param t_BatchCounts		Draw count of each batch if the commands were compacted, otherwise nullptr
+		 */
+		void GatherVisibleObjects(const DrawIndexedCommand* t_Commands, const uint32* t_BatchCounts, std::vector<uint32>& t_OutVisible) const;
+
+		/**
+		 * @brief	Count the triangles that the given commands draw, and what the same objects would have at full detail
+		 * @param t_BatchCounts		Same as GatherVisibleObjects
+		 */
+		void CountTriangles(const DrawIndexedCommand* t_Commands, const uint32* t_BatchCounts, uint32& t_OutTriangles, uint32& t_OutFullDetailTriangles) const;
+
+		/** Transform the local bounds into world space the same way that cull.comp does and test them */
+		static bool IsVisible(const GpuObjectData& t_Object, const Frustum& t_Frustum);
+
+		/**
+		 * @brief	Pick a level of detail for an object the same way that cull.comp does. Like LodSelector::Select,
+		 *			but the bounding sphere is the one around the world space box that the cull tests
+		 * @param t_Current		Level that the object was drawn with last
+		 */
+		uint32 SelectLod(const GpuObjectData& t_Object, const GpuCullConstants& t_Constants, uint32 t_Current) const;
+
+	private:
+
+		/** World space box of an object, the same one that cull.comp computes */
+		static void GetWorldBounds(const GpuObjectData& t_Object, glm::vec3& t_OutCenter, glm::vec3& t_OutExtents);
+
+		std::vector<GpuObjectData> m_Objects;
+
+		std::vector<IndirectBatch> m_Batches;
+
+		std::vector<GpuLodData> m_Lods;
+	};
+}   // namespace Fling
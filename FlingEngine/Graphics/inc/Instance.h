@@ -12,7 +12,8 @@ namespace Fling
     {
     public:
 
-        explicit Instance();
+        /** @param t_Headless	Don't enable any window system extensions, there won't be a surface to present to */
+        explicit Instance(bool t_Headless = false);
 
         ~Instance();
 
@@ -26,6 +27,11 @@ namespace Fling
 
 		const std::vector<const char*>& GetEnabledExtensions() const { return m_DeviceExtensions; };
 
+		bool IsHeadless() const { return m_Headless; }
+
+		/** True if VK_KHR_get_physical_device_properties2 is enabled on this instance */
+		bool SupportsPhysicalDeviceProperties2() const { return m_SupportsPhysicalDeviceProperties2; }
+
     private:
 
         /** The Vulkan instance */
@@ -37,6 +43,10 @@ namespace Fling
          */
         uint8 m_EnableValidationLayers : 1;
 
+        bool m_SupportsPhysicalDeviceProperties2 = false;
+
+        bool m_Headless = false;
+
         /**
          * @brief Create the VkInstance of this object and application information
          */
@@ -84,8 +94,8 @@ namespace Fling
             "VK_LAYER_LUNARG_standard_validation"
         };
 
-		/** Device extension support for the swap chain */
-		const std::vector<const char*> m_DeviceExtensions =
+		/** Device extension support for the swap chain. Empty when headless */
+		std::vector<const char*> m_DeviceExtensions =
 		{
 			VK_KHR_SWAPCHAIN_EXTENSION_NAME
 		};
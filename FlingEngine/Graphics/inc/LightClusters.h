@@ -0,0 +1,102 @@
+#pragma once
+
+#include "BoundingVolume.h"
+
+namespace Fling
+{
+	/** Where the lights of one cluster start in the light index list. Matches a uvec2 in deferred.frag */
+	struct LightClusterRange
+	{
+		uint32 Offset = 0;
+		uint32 Count = 0;
+	};
+
+	/**
+	 * @brief	Splits the view frustum into a grid of clusters (screen tiles by exponential depth slices)
+	 *			and finds which point lights touch each one. Lights are tested against the view space
+	 *			bounds of every cluster in their screen rectangle 4 at a time with SSE, and the results
+	 *			are packed into one light index list that the lighting shader reads from.
+	 */
+	class LightClusterGrid
+	{
+	public:
+
+		static constexpr uint32 CountX = 16;
+		static constexpr uint32 CountY = 9;
+		static constexpr uint32 CountZ = 24;
+		static constexpr uint32 ClusterCount = CountX * CountY * CountZ;
+
+		/**
+		 * @brief	Calculate the bounds of every cluster. Does nothing if none of the arguments changed
+		 * @param t_Projection	The projection that the G-Buffer was rendered with (Y flipped for Vulkan)
+		 * @param t_Width		Width of the screen in pixels
+		 * @param t_Height		Height of the screen in pixels
+		 */
+		void SetProjection(const glm::mat4& t_Projection, float t_Near, float t_Far, uint32 t_Width, uint32 t_Height);
+
+		/**
+		 * @brief	Assign lights to clusters. SetProjection must have been called first
+		 * @param t_ViewSpaceLights		View space position of each light in xyz and its range in w
+		 */
+		void Build(const glm::vec4* t_ViewSpaceLights, uint32 t_Count);
+
+		FORCEINLINE const std::vector<LightClusterRange>& GetClusters() const { return m_Clusters; }
+
+		/** Light indices of every cluster, packed together. Lights in a cluster are in ascending order */
+		FORCEINLINE const std::vector<uint32>& GetLightIndices() const { return m_LightIndices; }
+
+		FORCEINLINE uint32 GetMaxLightsPerCluster() const { return m_MaxLightsPerCluster; }
+
+		/**
+		 * @brief	What the shader needs to find the cluster of a fragment.
+		 *			x, y = tile size in pixels, z = slice scale, w = slice bias
+		 */
+		FORCEINLINE const glm::vec4& GetClusterScale() const { return m_ClusterScale; }
+
+		FORCEINLINE static uint32 GetClusterIndex(uint32 t_X, uint32 t_Y, uint32 t_Z) { return t_X + CountX * (t_Y + CountY * t_Z); }
+
+		/** Depth slice of a positive view space distance, the same way that deferred.frag does it */
+		uint32 GetSlice(float t_ViewDepth) const;
+
+		/** Cluster that a view space position is in, using the same math as the shader. */
+		uint32 GetClusterAt(const glm::vec3& t_ViewPos) const;
+
+		/** View space bounds of a cluster */
+		AABB GetClusterBounds(uint32 t_Cluster) const;
+
+		/** True if the sphere touches the box */
+		static bool SphereIntersectsBox(const glm::vec3& t_Center, float t_Radius, const glm::vec3& t_Min, const glm::vec3& t_Max);
+
+	private:
+
+		/** Find every cluster in the given span of one row that the sphere touches */
+		void TestRow(uint32 t_First, uint32 t_Count, const glm::vec4& t_Light, uint32 t_LightIndex);
+
+		/** Depth of the near side of the given slice. Slice CountZ is the far plane */
+		float GetSliceDepth(uint32 t_Slice) const;
+
+		/** Screen space tile of a normalized device coordinate, clamped to the grid */
+		uint32 GetTileX(float t_Ndc) const;
+		uint32 GetTileY(float t_Ndc) const;
+
+		glm::mat4 m_Projection = glm::mat4(1.0f);
+		float m_Near = 0.0f;
+		float m_Far = 0.0f;
+		uint32 m_Width = 0;
+		uint32 m_Height = 0;
+
+		glm::vec4 m_ClusterScale = glm::vec4(0.0f);
+
+		/** View space bounds of each cluster as a structure of arrays */
+		std::vector<float> m_MinX, m_MinY, m_MinZ;
+		std::vector<float> m_MaxX, m_MaxY, m_MaxZ;
+
+		std::vector<LightClusterRange> m_Clusters;
+		std::vector<uint32> m_LightIndices;
+		uint32 m_MaxLightsPerCluster = 0;
+
+		/** Every (cluster, light) pair that was found before they get sorted by cluster */
+		std::vector<uint32> m_PairClusters;
+		std::vector<uint32> m_PairLights;
+	};
+}   // namespace Fling
@@ -33,6 +33,20 @@ namespace Fling
 
 		void WaitForIdle();
 
+		/** True if multiDrawIndirect and drawIndirectFirstInstance are enabled, needed for GPU driven rendering */
+		bool SupportsIndirectDraws() const { return m_SupportsIndirectDraws; }
+
+		/** True if VK_KHR_draw_indirect_count is enabled on this device */
+		bool SupportsDrawIndirectCount() const { return m_SupportsDrawIndirectCount; }
+
+		/** True if the descriptor indexing features needed for a bindless texture array are enabled */
+		bool SupportsBindlessTextures() const { return m_SupportsBindlessTextures; }
+
+		/** True if pipelineStatisticsQuery is enabled, needed to count fragment shader invocations */
+		bool SupportsPipelineStatistics() const { return m_SupportsPipelineStatistics; }
+
+		/** Most sampled images that one update after bind descriptor set can hold */
+		uint32 GetMaxBindlessTextures() const { return m_MaxBindlessTextures; }
 
     private:
 
@@ -56,6 +70,15 @@ namespace Fling
 		uint32 m_ComputeFamily = 0;
 		uint32 m_TransferFamily = 0;
 
+		/** Extensions required by the instance plus any optional ones this device supports */
+		std::vector<const char*> m_EnabledExtensions;
+
+		bool m_SupportsIndirectDraws = false;
+		bool m_SupportsDrawIndirectCount = false;
+		bool m_SupportsBindlessTextures = false;
+		bool m_SupportsPipelineStatistics = false;
+		uint32 m_MaxBindlessTextures = 0;
+
 		/**
 		 * @brief	Get what queue Indecies/families this device should use
 		 */
@@ -4,6 +4,7 @@
 #include "Material.h"
 #include "Model.h"
 #include "Buffer.h"
+#include "TextureSlots.h"
 
 #include <entt/entity/registry.hpp>
 
@@ -34,10 +35,23 @@ namespace Fling
         /** Pointer to the material that this mesh renderer uses */
         Material* m_Material = nullptr;
 
-        /** We need a uniform buffer per-swap chain image */
-        Buffer* m_UniformBuffer = nullptr;
+        /** Level of detail of the model that was drawn last frame, @see LodSelector. The GPU driven path keeps its own in cull.comp */
+        uint32 m_LodLevel = 0;
 
-        VkDescriptorSet m_DescriptorSet  = VK_NULL_HANDLE;
+        /** Where the material textures are in the bindless array. Set by the offscreen pass */
+        MaterialTextureSlots m_TextureSlots = {};
+
+        /** Material that m_TextureSlots was acquired for, null if it wasn't. @see BindlessTextures */
+        Material* m_TextureSlotsMaterial = nullptr;
+
+        /** 
+        * One uniform buffer per frame in flight so the CPU never writes one that the GPU is reading.
+        * Only used by the debug pass, the offscreen pass pushes its per mesh data
+        */
+        std::array<Buffer*, VkConfig::MAX_FRAMES_IN_FLIGHT> m_UniformBuffers = {};
+
+        /** Descriptor sets that point at the uniform buffer of the same frame in flight */
+        std::array<VkDescriptorSet, VkConfig::MAX_FRAMES_IN_FLIGHT> m_DescriptorSets = {};
 
         void Release();
 
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "BoundingVolume.h"
+
+#include <vector>
+
+namespace Fling
+{
+	struct Vertex;
+
+	/** A range of a model's index buffer that draws it at one level of detail */
+	struct MeshLod
+	{
+		uint32 FirstIndex = 0;
+		uint32 IndexCount = 0;
+
+		/** How far the surface can be from the full detail mesh, in model space */
+		float Error = 0.0f;
+
+		/** Clusters that the range is split into, @see Model::GetMeshlets. None if it wasn't split */
+		uint32 FirstMeshlet = 0;
+		uint32 MeshletCount = 0;
+	};
+
+	/** How many levels of detail to build and how coarse they can get */
+	struct LodChainSettings
+	{
+		/** Levels including the full detail one */
+		uint32 MaxLevels = 4;
+
+		/** Index count of each level relative to the one before it */
+		float Reduction = 0.5f;
+
+		/** Largest error that a level can have, relative to the bounding sphere radius */
+		float MaxError = 0.05f;
+
+		/** Don't go below this many triangles */
+		uint32 MinTriangles = 32;
+	};
+
+	/**
+	 * @brief	Quadric error metric simplification (Garland and Heckbert). Edges are collapsed into
+	 *			one of their vertices, so every level can share the vertex buffer of the full detail
+	 *			mesh. Vertices on open borders and attribute seams (the same position with a different
+	 *			normal or UV) are never moved, which keeps holes and UV islands from tearing open.
+	 */
+	class MeshSimplifier
+	{
+	public:
+
+		/**
+		 * @param t_TargetIndexCount	Stop once there are this many indices left
+		 * @param t_MaxError			Don't collapse anything that would move the surface further than this
+		 * @param t_OutError			Error of the result, in the same units as the positions
+		 * @return	Triangles of the simplified mesh, as indices into t_Verts
+		 */
+		static std::vector<uint32> Simplify(
+			const Vertex* t_Verts,
+			uint32 t_VertCount,
+			const uint32* t_Indices,
+			uint32 t_IndexCount,
+			uint32 t_TargetIndexCount,
+			float t_MaxError,
+			float* t_OutError = nullptr);
+
+		/**
+		 * @brief	Simplify the mesh into a chain of levels and append each one to t_Indices. Stops early
+		 *			once a level can't be reduced enough without going over the max error
+		 * @return	Every level, starting with the full detail mesh that t_Indices held to begin with
+		 */
+		static std::vector<MeshLod> BuildLodChain(const std::vector<Vertex>& t_Verts, std::vector<uint32>& t_Indices, const LodChainSettings& t_Settings);
+	};
+
+	/** Picks the coarsest level of detail whose error covers less than a pixel threshold on screen */
+	struct LodSelector
+	{
+		glm::vec3 CameraPos = glm::vec3(0.0f);
+
+		/** Pixels that one unit covers at a distance of one, @see ProjectionScale */
+		float PixelsPerUnit = 0.0f;
+
+		/** Largest error that can be on screen, 0 always picks full detail */
+		float ThresholdPixels = 1.0f;
+
+		/**
+		 * Fraction of the threshold that a coarser level has to be under before switching to it.
+		 * Going back to a finer level happens at the threshold, so an object sitting right on it doesn't flicker
+		 */
+		float Hysteresis = 0.25f;
+
+		/** Pixels per unit at a distance of one for a perspective projection and a render target height */
+		static float ProjectionScale(const glm::mat4& t_Projection, uint32 t_ScreenHeight);
+
+		/**
+		 * @param t_LocalSphere		Model space bounds of the mesh
+		 * @param t_World			Transform of the object
+		 * @param t_Current			Level that the object was drawn with last
+		 */
+		uint32 Select(const std::vector<MeshLod>& t_Lods, const BoundingSphere& t_LocalSphere, const glm::mat4& t_World, uint32 t_Current) const;
+	};
+}   // namespace Fling
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "BoundingVolume.h"
+
+#include <vector>
+
+namespace Fling
+{
+	struct Vertex;
+	struct Frustum;
+
+	/**
+	 * @brief	A small cluster of neighbouring triangles that is culled on its own. Its triangles are
+	 *			one contiguous range of the model's index buffer, so what survives culling is drawn
+	 *			as index ranges without touching the indices.
+	 */
+	struct Meshlet
+	{
+		uint32 FirstIndex = 0;
+		uint32 IndexCount = 0;
+
+		/** Unique vertices that the triangles use */
+		uint32 VertexCount = 0;
+
+		/** Model space bounds of the triangles */
+		BoundingSphere Bounds;
+
+		/** Average facing of the triangles, every one of them is within the cone around it */
+		glm::vec3 ConeAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+
+		/** Sine of how far the normals spread from the axis, 1 if the cluster can't be back face culled */
+		float ConeCutoff = 1.0f;
+	};
+
+	/** A range of a model's index buffer to draw */
+	struct IndexRange
+	{
+		uint32 FirstIndex = 0;
+		uint32 IndexCount = 0;
+	};
+
+	/** What culling the meshlets of some meshes removed, in clusters and triangles */
+	struct MeshletCullStats
+	{
+		uint32 Clusters = 0;
+		uint32 CulledClusters = 0;
+		uint32 Triangles = 0;
+		uint32 CulledTriangles = 0;
+	};
+
+	/**
+	 * @brief	Splits meshes into meshlets when they are imported, and culls them by their bounding
+	 *			sphere against the frustum and by their normal cone against the camera position
+	 *			for back faces. The limits match what mesh shaders usually take, so the same
+	 *			clusters can be used by a GPU path later.
+	 */
+	class MeshletBuilder
+	{
+	public:
+
+		static constexpr uint32 MaxVertices = 64;
+		static constexpr uint32 MaxTriangles = 124;
+
+		/**
+		 * @brief	Group the triangles of an index range into meshlets, growing each one over the
+		 *			triangles that add the fewest new vertices. Reorders the triangles of the range
+		 *			so that each meshlet is contiguous, the winding of every triangle stays the same
+		 * @return	The meshlets of the range, in index order
+		 */
+		static std::vector<Meshlet> Build(const std::vector<Vertex>& t_Verts, std::vector<uint32>& t_Indices, uint32 t_FirstIndex, uint32 t_IndexCount);
+
+		/** True if every triangle of the meshlet faces away from a model space camera position */
+		static bool IsBackFacing(const Meshlet& t_Meshlet, const glm::vec3& t_LocalCameraPos);
+
+		/**
+		 * @brief	Cull the meshlets of one mesh and merge what is left into index ranges. Neighbouring
+		 *			meshlets that both survive become one range, and the closest ranges are merged
+		 *			until there are at most t_MaxRanges, drawing a few culled triangles instead of more draws
+		 * @param t_World			Transform of the mesh
+		 * @param t_CameraPos		World space position of the camera
+		 * @param t_OutRanges		Cleared before being written to
+		 * @param t_Stats			Added to, the culled triangles are the ones that aren't in a range
+		 */
+		static void Cull(
+			const Meshlet* t_Meshlets,
+			uint32 t_Count,
+			const glm::mat4& t_World,
+			const glm::vec3& t_CameraPos,
+			const Frustum& t_Frustum,
+			uint32 t_MaxRanges,
+			std::vector<IndexRange>& t_OutRanges,
+			MeshletCullStats& t_Stats);
+	};
+}   // namespace Fling
@@ -2,15 +2,21 @@
 
 #include "Resource.h"
 
-#include "Buffer.h"
+#include "GeometryBuffer.h"
 #include "Vertex.h"
+#include "BoundingVolume.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
 
 namespace Fling
 {
 	/**
 	 * @brief 	A model represents a 3D model (.obj files for now) with vertices
-	 * 			and indecies. A model has a vertex and index buffer and can be 
-	 * 			bound to a command buffer.
+	 * 			and indecies. The GPU copy of those is a range of the shared
+	 * 			GeometryBuffer, so a model is only drawn by its offsets into it.
+	 *			Models loaded from a file get a chain of simplified levels of detail when
+	 *			they are imported, which are stored after the full detail indices. Each
+	 *			level is then split into meshlets that can be culled on their own.
 	 */
     class Model : public Resource
     {
@@ -34,28 +40,86 @@ namespace Fling
 
 		~Model();
 
-		FORCEINLINE Buffer* GetVertexBuffer() const { return m_VertexBuffer; }
-		FORCEINLINE Buffer* GetIndexBuffer() const { return m_IndexBuffer; }
+		/** Where this model is in the vertex, position, and index buffers of the GeometryBuffer */
+		FORCEINLINE const GeometryAllocation& GetGeometry() const { return m_Geometry; }
+
+		/** Add to the first index of a LOD to get where it starts in the shared index buffer */
+		FORCEINLINE uint32 GetFirstIndex() const { return m_Geometry.FirstIndex; }
+
+		/** The vertexOffset that draws of this model use, indices are relative to the model's first vertex */
+		FORCEINLINE int32 GetVertexOffset() const { return static_cast<int32>(m_Geometry.FirstVertex); }
 
 		FORCEINLINE const std::vector<Vertex>& GetVerts() const { return m_Verts; }
 		FORCEINLINE const std::vector<uint32>& GetIndices() const { return m_Indices; }
 
-		FORCEINLINE uint32 GetIndexCount() const { return static_cast<uint32>(m_Indices.size()); }
+		/** Same as the positions of GetVerts, packed tightly for things that only read those */
+		FORCEINLINE const std::vector<glm::vec3>& GetPositions() const { return m_Positions; }
+
+		/** Index count of the full detail mesh */
+		FORCEINLINE uint32 GetIndexCount() const { return m_Lods.empty() ? 0 : m_Lods[0].IndexCount; }
 		FORCEINLINE uint32 GetVertexCount() const { return static_cast<uint32>(m_Verts.size()); }
 
-		constexpr static VkIndexType GetIndexType() { return VK_INDEX_TYPE_UINT32; }
+		constexpr static VkIndexType GetIndexType() { return GeometryBuffer::IndexType; }
+
+		/** Local space bounds of this model, calculated when the model is loaded */
+		FORCEINLINE const AABB& GetBoundingBox() const { return m_BoundingBox; }
+		FORCEINLINE const BoundingSphere& GetBoundingSphere() const { return m_BoundingSphere; }
+
+		/** Every level of detail, the first one is the full detail mesh */
+		FORCEINLINE const std::vector<MeshLod>& GetLods() const { return m_Lods; }
+
+		/** @param t_Level	Clamped to the coarsest level that there is */
+		FORCEINLINE const MeshLod& GetLod(uint32 t_Level) const { return m_Lods[t_Level < m_Lods.size() ? t_Level : m_Lods.size() - 1]; }
+
+		/** Meshlets of every level of detail, each level has a range of them. Their index ranges are relative to the model */
+		FORCEINLINE const std::vector<Meshlet>& GetMeshlets() const { return m_Meshlets; }
+
+		/** Layout of the vertices in the GeometryBuffer, set by the [Graphics] VertexFormat option */
+		static VertexFormat GetVertexFormat();
+
+		/**
+		 * Center of the bounds that compact positions are relative to, w is unused.
+		 * This and GetDecodeExtents are what DecodePosition in VertexDecode.h takes
+		 */
+		FORCEINLINE glm::vec4 GetDecodeCenter() const { return glm::vec4(m_BoundingBox.GetCenter(), 0.0f); }
+
+		/** Extents of the bounds, w is 1 if the uploaded vertices are compact */
+		FORCEINLINE glm::vec4 GetDecodeExtents() const { return glm::vec4(m_BoundingBox.GetExtents(), m_VertexFormat == VertexFormat::Compact ? 1.0f : 0.0f); }
+
+		/** Takes a position from the geometry buffer to model space, for shaders that don't decode it themselves */
+		glm::mat4 GetDecodeMatrix() const;
 
 	private:
 
-		void CreateBuffers();
+		/** Pack the vertices in the vertex format and upload them to the GeometryBuffer */
+		void UploadGeometry();
+
+		void CalculateBounds();
+
+		/** Simplify the full detail mesh into the levels set by the [Graphics] Lod options */
+		void GenerateLods();
+
+		/** Split every level of detail into meshlets, this reorders the triangles of each level */
+		void GenerateMeshlets();
 
 		static void CalculateVertexTangents(Vertex* verts, uint32 numVerts, uint32* indices, uint32 numIndices);
 
 		std::vector<Vertex> m_Verts;
+		std::vector<glm::vec3> m_Positions;
+		/** Indices of every level of detail, one after another */
 		std::vector<uint32> m_Indices;
 
-		Buffer* m_VertexBuffer = nullptr;
-		Buffer* m_IndexBuffer = nullptr;
+		std::vector<MeshLod> m_Lods;
+
+		std::vector<Meshlet> m_Meshlets;
+
+		GeometryAllocation m_Geometry;
+
+		/** What was uploaded, m_Verts always has the full vertices */
+		VertexFormat m_VertexFormat = VertexFormat::Full;
+
+		AABB m_BoundingBox;
+		BoundingSphere m_BoundingSphere;
 
 		/**
 		 * @brief	Load this model from Tiny Obj loader
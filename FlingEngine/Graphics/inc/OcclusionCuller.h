@@ -0,0 +1,128 @@
+#pragma once
+
+#include "BoundingVolume.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Fling
+{
+	/**
+	 * @brief	Occlusion culling with a software rasterizer. Occluder meshes are drawn into a small
+	 *			depth buffer on the CPU, which is reduced to the farthest depth of every block, and
+	 *			bounding boxes are tested against those blocks.
+	 *			The screen is split into bands of one block row that are rasterized in parallel. Each
+	 *			band is only ever written by one thread, so the result doesn't depend on timing.
+	 *			Depth goes from 0 at the near plane to 1 at the far plane, like the G-Buffer.
+	 */
+	class OcclusionCuller
+	{
+	public:
+
+		static constexpr uint32 Width = 256;
+		static constexpr uint32 Height = 128;
+
+		/** Pixels on each side of a block of the hierarchical depth buffer */
+		static constexpr uint32 BlockSize = 8;
+		static constexpr uint32 BlocksX = Width / BlockSize;
+		static constexpr uint32 BlocksY = Height / BlockSize;
+
+		/** @param t_WorkerCount	Threads that help rasterize, with 0 the calling thread does all of it */
+		explicit OcclusionCuller(uint32 t_WorkerCount = 0);
+
+		~OcclusionCuller();
+
+		/** Forget last frame's occluders. Everything after this is projected with the given matrix */
+		void BeginFrame(const glm::mat4& t_ViewProj);
+
+		/** Queue a mesh to draw into the depth buffer. The positions and indices have to stay alive until Rasterize */
+		void AddOccluder(const glm::vec3* t_Positions, const uint32* t_Indices, uint32 t_IndexCount, const glm::mat4& t_World);
+
+		/** Draw every occluder and build the block depths. Returns once all of the threads are done */
+		void Rasterize();
+
+		/** False only if the whole box is behind the occluders. Anything crossing the near plane is visible */
+		bool IsVisible(const AABB& t_WorldBox) const;
+
+		FORCEINLINE uint32 GetOccluderCount() const { return static_cast<uint32>(m_Occluders.size()); }
+
+		/** Triangles that were drawn last time, after clipping */
+		FORCEINLINE uint32 GetTriangleCount() const { return static_cast<uint32>(m_Triangles.size()); }
+
+		/** Row major, Width * Height */
+		FORCEINLINE const std::vector<float>& GetDepth() const { return m_Depth; }
+
+		/** Farthest depth in a block */
+		FORCEINLINE float GetBlockDepth(uint32 t_X, uint32 t_Y) const { return m_BlockDepth[t_Y * BlocksX + t_X]; }
+
+	private:
+
+		struct Occluder
+		{
+			const glm::vec3* Positions;
+			const uint32* Indices;
+			uint32 IndexCount;
+			glm::mat4 World;
+		};
+
+		/** Edge functions and depth plane of a triangle in screen space, set up once for every band */
+		struct ScreenTriangle
+		{
+			/** Edge i is A * x + B * y + C, inside is positive */
+			float EdgeA[3];
+			float EdgeB[3];
+			float EdgeC[3];
+
+			/** If pixel centers that land exactly on the edge are inside */
+			bool EdgeInclusive[3];
+
+			/** Depth at the origin and its slopes, pushed back by half a pixel of slope to never be too close */
+			float Depth;
+			float DepthDx;
+			float DepthDy;
+
+			int32 MinX, MinY, MaxX, MaxY;
+		};
+
+		static constexpr uint32 BandCount = BlocksY;
+
+		/** Clip a triangle against the near plane and set up whatever is left */
+		void SetupTriangle(const glm::vec4 t_Clip[3]);
+
+		void AddScreenTriangle(const glm::vec3& t_A, const glm::vec3& t_B, const glm::vec3& t_C);
+
+		/** Pull bands off of the list until there are none left */
+		void RasterizeBands();
+
+		void RasterizeBand(uint32 t_Band);
+
+		void WorkerLoop();
+
+		glm::mat4 m_ViewProj = glm::mat4(1.0f);
+
+		std::vector<Occluder> m_Occluders;
+
+		std::vector<ScreenTriangle> m_Triangles;
+
+		std::vector<float> m_Depth;
+
+		std::vector<float> m_BlockDepth;
+
+		// Workers ----------
+		std::vector<std::thread> m_Workers;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_WorkAvailable;
+		std::condition_variable m_WorkDone;
+
+		/** Bumped every time there is a new frame to rasterize */
+		uint64 m_Generation = 0;
+		bool m_ShuttingDown = false;
+
+		std::atomic<uint32> m_NextBand { BandCount };
+		std::atomic<uint32> m_BandsLeft { 0 };
+	};
+}   // namespace Fling
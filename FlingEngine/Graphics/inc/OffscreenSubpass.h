@@ -1,43 +1,101 @@
 #pragma once
 
 #include "Subpass.h"
+#include "Frustum.h"
+#include "SceneBVH.h"
+#include "RenderGraph.h"
+#include "BindlessTextures.h"
+#include "MeshSimplifier.h"
+#include "OcclusionCuller.h"
+#include "DynamicResolution.h"
+#include "DepthPrepass.h"
+#include "OverdrawCounter.h"
+#include "RenderSnapshot.h"
+#include "DrawSort.h"
 
 namespace Fling
 {
 	class CommandBuffer;
 	class LogicalDevice;
-	class FrameBuffer;	
 	struct MeshRenderer;
+	struct Transform;
 	class Swapchain;
-	class FirstPersonCamera;
+	class GpuCullingPass;
+	class PhysicalDevice;
+	class Buffer;
+	class Model;
 
-	/** UBO for mesh data */
+	/** Camera UBO of the G-Buffer, one per frame in flight */
 	struct alignas(16) OffscreenUBO
 	{
 		glm::mat4 Projection;
-		glm::mat4 Model;
 		glm::mat4 View;
-		glm::vec3 ObjPos;
 	};
 
-	// Uses the MRT shaders (mulitple render targets)
+	/** Render targets of the G-Buffer in the order that the MRT shader writes them, then depth */
+	enum class GBufferTarget : uint8
+	{
+		Normal,
+		Albedo,
+		Material,
+		Depth,
+		Count
+	};
+
+	/**
+	* Uses the MRT shaders (mulitple render targets). By default the G-Buffer is drawn in its own
+	* render pass and command buffer and the lighting pass samples it. With a single pass render pass
+	* the G-Buffer is the first subpass of the global render pass instead, and the lighting subpass
+	* reads it as input attachments. @see VulkanApp::BuildGlobalRenderPass
+	*
+	* With Graphics.DepthPrepass the G-Buffer pass is preceded by a depth only pass over the same
+	* meshes, and then only shades the fragments that are equal to the closest depth.
+	*/
 	class OffscreenSubpass : public Subpass
 	{
 	public:
+		/**
+		* @param t_SinglePassRenderPass		Global render pass to draw the G-Buffer in as subpass 0.
+		*									Null to give the G-Buffer its own render pass
+		*/
 		OffscreenSubpass(
 			const LogicalDevice* t_Dev,
 			const Swapchain* t_Swap,
 			entt::registry& t_reg,
-			FirstPersonCamera* t_Cam,
 			std::shared_ptr<Fling::Shader> t_Vert,
-			std::shared_ptr<Fling::Shader> t_Frag
+			std::shared_ptr<Fling::Shader> t_Frag,
+			VkRenderPass t_SinglePassRenderPass = VK_NULL_HANDLE
 		);
 
 		virtual ~OffscreenSubpass();
 
-		FrameBuffer* GetOffscreenFrameBuffer() const { return m_OffscreenFrameBuf; }
+		/** Format of a G-Buffer target on the given device */
+		static VkFormat GetGBufferFormat(const PhysicalDevice* t_Dev, GBufferTarget t_Target);
+
+		/** True if the G-Buffer is drawn in the first subpass of the global render pass */
+		bool IsSinglePass() const { return m_SinglePassRenderPass != VK_NULL_HANDLE; }
+
+		/** View of a G-Buffer target. Recreated when the swap chain is resized */
+		VkImageView GetGBufferView(GBufferTarget t_Target) const;
+
+		/** Null in single pass mode, input attachments are not sampled */
+		VkSampler GetGBufferSampler() const { return m_GBufferSampler; }
+
+		/**
+		 * @brief	Maps a UV over the output to the part of the G-Buffer that was rendered this frame.
+		 *			xy is the scale and zw the largest UV that is inside of the rendered area
+		 */
+		glm::vec4 GetGBufferUVScale() const;
+
+		/** Update the BVH, pick the render scale, and cull and pick LODs on the CPU path */
+		void Extract(entt::registry& t_reg, RenderSnapshot& t_Snapshot) override final;
+
+		void PrepareDraw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot) override final;
 
-		void Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveSwapImage, entt::registry& t_reg, float DeltaTime) override final;
+		void Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot) override final;
+
+		/** The G-Buffer is profiled inside of the offscreen command buffer unless it's a subpass of the global render pass */
+		const char* GetProfileName() const override final { return IsSinglePass() ? "GBuffer" : nullptr; }
 
 		void PrepareAttachments() override final;
 
@@ -53,13 +111,88 @@ namespace Fling
 
 		virtual void OnSwapchainResized(entt::registry& t_reg) override final;
 
+		/** Cull and draw the G-Buffer on the GPU instead. Must be called before the graphics pipeline is created */
+		void EnableGpuCulling(std::unique_ptr<GpuCullingPass> t_GpuCulling);
+
+		/** True if Graphics.DepthPrepass is On or Auto. The prepass shader has to be given with EnableDepthPrepass */
+		bool UsesDepthPrepass() const { return m_DepthPrepass != nullptr; }
+
+		/**
+		* Give the prepass its shader. Must be called before the graphics pipeline is created, and after
+		* EnableGpuCulling when that is used
+		* @param t_DepthVert		depth.vert
+		* @param t_IndirectDepthVert	depth_indirect.vert, only needed with GPU culling
+		*/
+		void EnableDepthPrepass(std::shared_ptr<Fling::Shader> t_DepthVert, std::shared_ptr<Fling::Shader> t_IndirectDepthVert);
+
+		/** Textures of every material that the G-Buffer draws */
+		BindlessTextures* GetBindlessTextures() const { return m_Bindless.get(); }
+
 	private:
 
+		/** Declare the G-Buffer textures and the passes that write them */
+		void BuildRenderGraph();
+
+		/** Size of the G-Buffer targets, bigger than what is rendered with dynamic resolution */
+		VkExtent2D GetGBufferExtent() const;
+
+		/** Feed the last GPU frame time to the dynamic resolution */
+		void UpdateRenderScale();
+
+		/** Size that the G-Buffer is rendered at with the current scale */
+		VkExtent2D GetRenderExtent() const;
+
+		/**
+		* Set the G-Buffer state on the given pipeline and create it
+		* @param t_AfterPrepass	Test depth with EQUAL against what the prepass wrote
+		*/
+		void CreateGBufferPipeline(GraphicsPipeline* t_Pipeline, VkRenderPass t_RenderPass, bool t_AfterPrepass = false);
+
+		/** Set the state of the depth prepass on the given pipeline and create it */
+		void CreateDepthPipeline(GraphicsPipeline* t_Pipeline, VkRenderPass t_RenderPass);
+
+		/** Feed the G-Buffer cost of the last GPU frame to the prepass selector */
+		void UpdateDepthPrepass();
+
+		/** True if the prepass is drawn this frame */
+		bool IsDepthPrepassEnabled() const { return m_DepthPrepass && m_DepthPrepass->IsEnabled(); }
+
+		/** Update the camera UBO and render area and do the GPU cull dispatch. Must be outside of a render pass */
+		void BeginFrame(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot);
+
+		/** Record the G-Buffer draws into the current render pass, or the depth prepass for DepthOnly */
+		void DrawGBuffer(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, GBufferDrawMode t_Mode, const RenderSnapshot& t_Snapshot);
+
+		/** Cull on the CPU and add every visible mesh to the draws */
+		void GatherVisibleMeshes(entt::registry& t_reg, std::vector<MeshDraw>& t_OutDraws);
+
+		/** Order the draws by their sort key, so state is grouped and opaque meshes go roughly front to back */
+		void SortDraws(std::vector<MeshDraw>& t_Draws, const glm::vec3& t_CameraPos, float t_FarPlane);
+
+		/** Bind the geometry buffer and record a draw for each of the snapshot's meshes, skipping push constants that didn't change */
+		void DrawVisibleMeshes(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, GBufferDrawMode t_Mode, const RenderSnapshot& t_Snapshot);
+
+		/**
+		 * @brief	Rasterize the biggest visible meshes and anything tagged "Occluder" into the occlusion
+		 *			depth buffer and remove whatever is behind them from m_VisibleEntities
+		 * @return	Number of meshes that were removed
+		 */
+		uint32 CullOccluded(entt::registry& t_reg);
+
 		void OnMeshRendererAdded(entt::entity t_Ent, entt::registry& t_Reg, MeshRenderer& t_MeshRend);
 
-		void OnMeshRendererDestroyed(entt::registry& t_Reg, MeshRenderer& t_MeshRend);
+		/** Called before the component is replaced, the old one is still in the registry */
+		void OnMeshRendererReplaced(entt::entity t_Ent, entt::registry& t_Reg, MeshRenderer& t_MeshRend);
+
+		void OnMeshRendererDestroyed(entt::entity t_Ent, entt::registry& t_Reg);
 
-		void CreateMeshDescriptorSet(MeshRenderer& t_MeshRend);
+		/** Reference the textures of the mesh's material in the bindless array */
+		void AcquireTextureSlots(MeshRenderer& t_MeshRend);
+
+		void ReleaseTextureSlots(MeshRenderer& t_MeshRend);
+
+		/** Camera UBO and descriptor set for each frame in flight */
+		void CreateCameraDescriptorSets();
 
 		void BuildOffscreenCommandBuffer(entt::registry& t_reg, uint32 t_ActiveFrameInFlight);
 
@@ -69,13 +202,113 @@ namespace Fling
 
 		VkCommandPool m_CommandPool = VK_NULL_HANDLE;
 
-		// Offscreen command buffers for populating the GBuffer
+		// Offscreen command buffers for populating the GBuffer, one per frame in flight
 		std::vector<CommandBuffer*> m_OffscreenCmdBufs;
 
-		FrameBuffer* m_OffscreenFrameBuf = nullptr;
+		/** Owns the G-Buffer targets and the barriers that hand them to the lighting pass */
+		RenderGraph m_RenderGraph;
+
+		std::array<RenderGraphTexture, static_cast<size_t>(GBufferTarget::Count)> m_GBuffer = {};
+
+		uint32 m_GBufferPass = 0;
 
-		const FirstPersonCamera* m_Camera;
+		uint32 m_DepthPrepassPass = 0;
+
+		VkSampler m_GBufferSampler = VK_NULL_HANDLE;
+
+		/** Camera matrices of the frame being recorded, used by the G-Buffer pass */
+		OffscreenUBO m_CurrentUBO = {};
+
+		/** The global render pass if the G-Buffer is its first subpass, otherwise null */
+		VkRenderPass m_SinglePassRenderPass = VK_NULL_HANDLE;
 
 		VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+
+		std::unique_ptr<BindlessTextures> m_Bindless;
+
+		std::array<Buffer*, VkConfig::MAX_FRAMES_IN_FLIGHT> m_CameraBuffers = {};
+
+		/** Set 0 of the G-Buffer pipeline, set 1 is the bindless texture array */
+		std::array<VkDescriptorSet, VkConfig::MAX_FRAMES_IN_FLIGHT> m_CameraSets = {};
+
+		// Frustum culling ----------
+		Frustum m_Frustum;
+
+		/** View projection of the snapshot being extracted, m_CurrentUBO is the frame being recorded */
+		glm::mat4 m_CullViewProj = glm::mat4(1.0f);
+
+		SceneBVH m_SceneBVH;
+
+		/** Tests the entities that the BVH found crossing the frustum on their tight bounds */
+		FrustumCuller m_FrustumCuller;
+
+		std::vector<entt::entity> m_VisibleEntities;
+		std::vector<entt::entity> m_IntersectingEntities;
+		std::vector<uint32> m_VisibleIndices;
+
+		/** Null unless Graphics.DynamicResolution is on and the G-Buffer has its own render pass */
+		std::unique_ptr<DynamicResolution> m_DynamicResolution;
+
+		/** GpuProfiler::GetResolvedFrameCount when the last frame time was used */
+		uint64 m_ResolvedGpuFrames = 0;
+
+		bool m_WarnedNoFrameTimes = false;
+
+		/** Null if Graphics.OcclusionCulling is off */
+		std::unique_ptr<OcclusionCuller> m_OcclusionCuller;
+
+		/** Height on screen, as a fraction of the screen, that a mesh needs to be drawn as an occluder */
+		float m_OccluderScreenSize = 0.25f;
+
+		uint32 m_MaxOccluders = 16;
+
+		/** Screen size and entity of each occluder this frame, biggest first */
+		std::vector<std::pair<float, entt::entity>> m_OccluderCandidates;
+
+		/** Picks mesh LODs with this frame's camera. Set from the Graphics.LodErrorPixels and LodHysteresis options */
+		LodSelector m_LodSelector;
+
+		/** Cull the meshlets of visible meshes, set by Graphics.MeshletCulling */
+		bool m_MeshletCulling = true;
+
+		/** Most draws that the meshlets left of a mesh are merged into, set by Graphics.MeshletMaxDraws */
+		uint32 m_MeshletMaxDraws = 8;
+
+		/** Ranges of the mesh that is being gathered, kept to reuse the memory */
+		std::vector<IndexRange> m_MeshletRanges;
+
+		/** Null if Graphics.DrawSorting is off, then draws are recorded in the order they were gathered */
+		std::unique_ptr<DrawSorter> m_DrawSorter;
+
+		/** Key of every gathered draw, then the order that sorts them. Kept to reuse the memory */
+		std::vector<uint64> m_DrawKeys;
+		std::vector<uint32> m_DrawOrder;
+		std::vector<MeshDraw> m_SortedDraws;
+
+		/** Optional GPU driven path, null if the CPU does the culling */
+		std::unique_ptr<GpuCullingPass> m_GpuCulling;
+
+		// Depth prepass ----------
+		/** Null if Graphics.DepthPrepass is off or the G-Buffer is a subpass of the global render pass */
+		std::unique_ptr<DepthPrepassSelector> m_DepthPrepass;
+
+		std::shared_ptr<Fling::Shader> m_DepthShader;
+
+		/** Depth only pipeline of the prepass for the CPU path */
+		GraphicsPipeline* m_DepthPipeline = nullptr;
+
+		/** G-Buffer pipeline that tests with EQUAL and doesn't write depth, for the CPU path */
+		GraphicsPipeline* m_PrepassedPipeline = nullptr;
+
+		/** GpuProfiler::GetResolvedFrameCount when the last G-Buffer cost was used */
+		uint64 m_PrepassResolvedGpuFrames = 0;
+
+		bool m_WarnedNoPrepassTimes = false;
+
+		/** Null unless Graphics.OverdrawStats is on and the device supports pipeline statistics */
+		std::unique_ptr<OverdrawCounter> m_OverdrawCounter;
+
+		/** Draw the bounds of every visible mesh with DebugDraw, set by Graphics.DebugDrawBounds */
+		bool m_DrawBounds = false;
 	};
 }   // namespace Fling
\ No newline at end of file
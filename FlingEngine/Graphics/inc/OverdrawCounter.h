@@ -0,0 +1,61 @@
+#pragma once
+
+#include "FlingVulkan.h"
+#include "NonCopyable.hpp"
+
+#include <array>
+
+namespace Fling
+{
+	class CommandBuffer;
+	class LogicalDevice;
+
+	/**
+	 * @brief	Counts the fragment shader invocations of a pass with a pipeline statistics query and
+	 *			compares them to the pixels it covers. Like the GPU profiler, every frame in flight has
+	 *			its own query, which is read back without waiting once that frame's fence was waited on.
+	 *			Helper invocations may be counted too, so a ratio a little over the real overdraw is normal.
+	 *			Results go to Stats::Overdraw.
+	 */
+	class OverdrawCounter : public NonCopyable
+	{
+	public:
+
+		explicit OverdrawCounter(const LogicalDevice* t_Dev);
+
+		~OverdrawCounter();
+
+		/** Check if the device can count fragment shader invocations */
+		static bool IsSupported(const LogicalDevice* t_Dev);
+
+		/**
+		 * @brief	Read the results of the last frame that used this frame in flight and reset its query.
+		 *			Must be recorded outside of a render pass
+		 * @param t_Pixels		Pixels that the counted pass draws to this frame
+		 * @param t_Prepass		If the depth prepass is on this frame, only to label the results
+		 */
+		void BeginFrame(CommandBuffer& t_CmdBuf, uint32 t_FrameInFlight, uint64 t_Pixels, bool t_Prepass);
+
+		/** Start counting, must be in the same subpass as End */
+		void Begin(CommandBuffer& t_CmdBuf);
+
+		void End(CommandBuffer& t_CmdBuf);
+
+	private:
+
+		struct FrameQuery
+		{
+			VkQueryPool Pool = VK_NULL_HANDLE;
+			uint64 Pixels = 0;
+			bool Prepass = false;
+			/** True once the query was reset, until the results are read */
+			bool Pending = false;
+		};
+
+		const LogicalDevice* m_Device;
+
+		std::array<FrameQuery, VkConfig::MAX_FRAMES_IN_FLIGHT> m_Frames;
+
+		uint32 m_ActiveFrame = 0;
+	};
+}   // namespace Fling
@@ -41,10 +41,22 @@ namespace Fling
          */
         VkFormatProperties GetFormatProperties(VkFormat t_Form) const;
 
+		/** Check if this device supports the given device extension */
+		bool IsExtensionSupported(const char* t_Extension) const;
+
 		VkSampleCountFlagBits GetMaxUsableSampleCount();
 
 		VkBool32 GetSupportedDepthFormat(VkFormat* depthFormat) const;
 
+		/** Check if any memory type on this device has all of the given properties */
+		bool HasMemoryType(VkMemoryPropertyFlags t_Props) const;
+
+		/** True if VK_EXT_descriptor_indexing is supported and its features were queried */
+		bool HasDescriptorIndexing() const { return m_HasDescriptorIndexing; }
+
+		const VkPhysicalDeviceDescriptorIndexingFeaturesEXT& GetDescriptorIndexingFeatures() const { return m_DescriptorIndexingFeatures; }
+		const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& GetDescriptorIndexingProperties() const { return m_DescriptorIndexingProperties; }
+
     private:
 
 		/**
@@ -53,6 +65,9 @@ namespace Fling
 		 */
 		VkPhysicalDevice ChooseBestPhyscialDevice(std::vector<VkPhysicalDevice>& t_AvailableDevices);
 
+		/** Fill in the descriptor indexing features and limits if the instance and device can report them */
+		void QueryDescriptorIndexing();
+
         /** The Vulkan physical device */
         VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
 
@@ -64,6 +79,10 @@ namespace Fling
         VkPhysicalDeviceFeatures m_DeviceFeatures{};
 		VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
 
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT m_DescriptorIndexingFeatures{};
+		VkPhysicalDeviceDescriptorIndexingPropertiesEXT m_DescriptorIndexingProperties{};
+		bool m_HasDescriptorIndexing = false;
+
 		/** The max supported MSSA level on this device */
 		VkSampleCountFlagBits m_MSAASamples = VK_SAMPLE_COUNT_1_BIT;
     };
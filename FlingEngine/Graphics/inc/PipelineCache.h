@@ -0,0 +1,140 @@
+#pragma once
+
+#include "FlingVulkan.h"
+#include "NonCopyable.hpp"
+#include "PipelineKey.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Fling
+{
+	class LogicalDevice;
+
+	/**
+	 * @brief	A copy of the state that a graphics pipeline is created with. Owns its arrays so
+	 *			that it can be handed to a worker thread after the pipeline that described it is gone.
+	 *			Viewport and scissor are expected to be dynamic.
+	 */
+	struct GraphicsPipelineDesc
+	{
+		std::vector<VkPipelineShaderStageCreateInfo> Stages;
+		std::vector<VkVertexInputBindingDescription> VertexBindings;
+		std::vector<VkVertexInputAttributeDescription> VertexAttributes;
+		VkPipelineInputAssemblyStateCreateInfo InputAssembly = {};
+		VkPipelineRasterizationStateCreateInfo Rasterization = {};
+		VkPipelineMultisampleStateCreateInfo Multisample = {};
+		VkPipelineDepthStencilStateCreateInfo DepthStencil = {};
+		VkPipelineColorBlendStateCreateInfo ColorBlend = {};
+		std::vector<VkPipelineColorBlendAttachmentState> BlendAttachments;
+		VkPipelineViewportStateCreateInfo Viewport = {};
+		std::vector<VkDynamicState> DynamicStates;
+		VkPipelineLayout Layout = VK_NULL_HANDLE;
+		VkRenderPass RenderPass = VK_NULL_HANDLE;
+		uint32 Subpass = 0;
+	};
+
+	/**
+	 * @brief	Graphics pipelines keyed by the state that they were created with, so every
+	 *			combination is only ever compiled once. Pipelines that aren't needed right away
+	 *			can be requested and are compiled on worker threads while the frame keeps going.
+	 *			Render passes are keyed by their attachment formats, so a render pass that is
+	 *			recreated the same way (like on resize) finds the pipelines of the old one.
+	 *			Pipelines live until the layout they were made with is released.
+	 */
+	class PipelineCache : public NonCopyable
+	{
+	public:
+
+		/** Used if Graphics.PipelineCompileThreads isn't set */
+		static constexpr uint32 DefaultWorkerCount = 2;
+
+		PipelineCache(const LogicalDevice* t_Dev, uint32 t_WorkerCount);
+
+		~PipelineCache();
+
+		/**
+		 * @brief	Remember what a render pass is compatible with. Passes that aren't registered
+		 *			are keyed by their handle, so their pipelines can't be shared
+		 */
+		void RegisterRenderPass(VkRenderPass t_RenderPass, const VkRenderPassCreateInfo& t_Info);
+
+		void UnregisterRenderPass(VkRenderPass t_RenderPass);
+
+		/** Render pass compatibility part of the key. Only call from the thread that registers passes */
+		uint64 GetRenderPassHash(VkRenderPass t_RenderPass) const;
+
+		PipelineKey MakeKey(const GraphicsPipelineDesc& t_Desc) const;
+
+		/** Get the pipeline or compile it on this thread. Waits if a worker is already compiling it */
+		VkPipeline GetOrCreate(const PipelineKey& t_Key, const GraphicsPipelineDesc& t_Desc);
+
+		/**
+		 * @brief	Get the pipeline if it is ready, otherwise queue it for a worker thread
+		 * @return	VK_NULL_HANDLE until the pipeline has been compiled, @see Find
+		 */
+		VkPipeline Request(const PipelineKey& t_Key, const GraphicsPipelineDesc& t_Desc);
+
+		/** @return The pipeline if it has been compiled, VK_NULL_HANDLE otherwise */
+		VkPipeline Find(const PipelineKey& t_Key);
+
+		/** Destroy every pipeline made with the layout. Waits for any that are being compiled */
+		void ReleaseLayout(VkPipelineLayout t_Layout);
+
+		/** Publish the cache counters to Stats::Pipelines */
+		void UpdateStats();
+
+	private:
+
+		enum class Status : uint8
+		{
+			Queued,
+			Compiling,
+			Ready,
+			Failed
+		};
+
+		struct Entry
+		{
+			VkPipeline Pipeline = VK_NULL_HANDLE;
+			VkPipelineLayout Layout = VK_NULL_HANDLE;
+			Status State = Status::Queued;
+			/** Only kept until a worker picks the entry up */
+			std::unique_ptr<GraphicsPipelineDesc> Desc;
+		};
+
+		void WorkerLoop();
+
+		/** Compile the pipeline and mark the entry as done. Expects the lock to be held and releases it while compiling */
+		VkPipeline CompileEntry(std::unique_lock<std::mutex>& t_Lock, const PipelineKey& t_Key, const GraphicsPipelineDesc& t_Desc);
+
+		/** Thread safe, the driver synchronizes the Vulkan pipeline cache */
+		VkPipeline Compile(const GraphicsPipelineDesc& t_Desc) const;
+
+		const LogicalDevice* m_Device;
+
+		/** Shared by every compile so that the driver can reuse work between similar pipelines */
+		VkPipelineCache m_VkCache = VK_NULL_HANDLE;
+
+		std::unordered_map<PipelineKey, Entry, PipelineKey::Hasher> m_Entries;
+
+		/** Keys of queued entries in the order that they were requested */
+		std::deque<PipelineKey> m_Queue;
+
+		std::unordered_map<VkRenderPass, uint64> m_RenderPassHashes;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_WorkAvailable;
+		std::condition_variable m_WorkDone;
+		std::vector<std::thread> m_Workers;
+		bool m_ShuttingDown = false;
+
+		uint32 m_HitCount = 0;
+		uint32 m_CompileCount = 0;
+	};
+}   // namespace Fling
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "FlingTypes.h"
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace Fling
+{
+	/**
+	 * @brief	Everything that a pipeline is created from, written out as bytes. Two keys are equal
+	 *			if the same state was added in the same order, so a pipeline can be looked up
+	 *			by the state that it needs instead of by who created it.
+	 *			Add fields one at a time instead of whole Vulkan structs so that padding and
+	 *			pNext pointers don't end up in the key.
+	 */
+	class PipelineKey
+	{
+	public:
+
+		template<class T>
+		void Add(const T& t_Val)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be part of a pipeline key");
+			AddBytes(&t_Val, sizeof(T));
+		}
+
+		/** Adds the count as well so that {a, b} + {c} and {a} + {b, c} are different keys */
+		template<class T>
+		void AddArray(const T* t_Vals, size_t t_Count)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be part of a pipeline key");
+			Add(static_cast<uint64>(t_Count));
+			if (t_Count)
+			{
+				AddBytes(t_Vals, sizeof(T) * t_Count);
+			}
+		}
+
+		/** FNV-1a of every byte that was added */
+		uint64 GetHash() const { return m_Hash; }
+
+		size_t GetSize() const { return m_Bytes.size(); }
+
+		bool operator==(const PipelineKey& t_Other) const
+		{
+			return m_Hash == t_Other.m_Hash && m_Bytes == t_Other.m_Bytes;
+		}
+
+		bool operator!=(const PipelineKey& t_Other) const { return !(*this == t_Other); }
+
+		struct Hasher
+		{
+			size_t operator()(const PipelineKey& t_Key) const { return static_cast<size_t>(t_Key.GetHash()); }
+		};
+
+	private:
+
+		static constexpr uint64 FnvOffset = 14695981039346656037ull;
+		static constexpr uint64 FnvPrime = 1099511628211ull;
+
+		void AddBytes(const void* t_Data, size_t t_Size)
+		{
+			const uint8* Bytes = static_cast<const uint8*>(t_Data);
+			const size_t Start = m_Bytes.size();
+			m_Bytes.resize(Start + t_Size);
+			std::memcpy(m_Bytes.data() + Start, Bytes, t_Size);
+
+			for (size_t i = 0; i < t_Size; ++i)
+			{
+				m_Hash = (m_Hash ^ Bytes[i]) * FnvPrime;
+			}
+		}
+
+		std::vector<uint8> m_Bytes;
+		uint64 m_Hash = FnvOffset;
+	};
+}   // namespace Fling
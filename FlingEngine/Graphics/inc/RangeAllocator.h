@@ -0,0 +1,75 @@
+#pragma once
+
+#include "FlingTypes.h"
+
+#include <map>
+#include <vector>
+
+namespace Fling
+{
+	/**
+	 * @brief	Hands out ranges of a bigger buffer, first fit from a list of free ranges that are
+	 *			merged with their neighbours when they are freed. Like texture slots, a range that
+	 *			is freed isn't given out again until the frames that may still be reading it on the
+	 *			GPU are done. Units are up to the owner, elements or bytes.
+	 *			Doesn't touch Vulkan so that it can be tested on its own, @see GeometryBuffer
+	 */
+	class RangeAllocator
+	{
+	public:
+
+		static constexpr uint32 InvalidOffset = ~0u;
+
+		/**
+		 * @param t_Capacity		Size of the buffer that ranges are allocated from
+		 * @param t_RetireFrames	Frames that a freed range has to wait before it can be given out again
+		 */
+		RangeAllocator(uint32 t_Capacity, uint32 t_RetireFrames);
+
+		/** @return Offset of the first free range that fits, InvalidOffset if none does */
+		uint32 Allocate(uint32 t_Size);
+
+		/** Retire a range that Allocate returned. It becomes free after the retire frames */
+		void Free(uint32 t_Offset, uint32 t_Size);
+
+		/** Call once per frame. Ranges that were retired long enough ago become free */
+		void NextFrame();
+
+		/** Add free space to the end, for when the buffer was replaced with a bigger one */
+		void Grow(uint32 t_NewCapacity);
+
+		/** Allocated ranges and ones that are waiting to retire */
+		uint32 GetUsedSize() const { return m_Capacity - m_FreeSize; }
+
+		uint32 GetCapacity() const { return m_Capacity; }
+
+		/** Biggest size that Allocate can return right now */
+		uint32 GetLargestFreeRange() const;
+
+		/** How fragmented the free space is, 1 if it is all in one piece */
+		uint32 GetFreeRangeCount() const { return static_cast<uint32>(m_FreeRanges.size()); }
+
+	private:
+
+		/** Add a range to the free list, merging it with the ranges right before and after it */
+		void AddFreeRange(uint32 t_Offset, uint32 t_Size);
+
+		struct RetiredRange
+		{
+			uint32 Offset;
+			uint32 Size;
+			uint64 ReleaseFrame;
+		};
+
+		/** Size of each free range by its offset, never two ranges that touch */
+		std::map<uint32, uint32> m_FreeRanges;
+
+		/** Freed ranges in the order that they were freed */
+		std::vector<RetiredRange> m_Retired;
+
+		uint32 m_Capacity;
+		uint32 m_FreeSize;
+		uint32 m_RetireFrames;
+		uint64 m_Frame = 0;
+	};
+}   // namespace Fling
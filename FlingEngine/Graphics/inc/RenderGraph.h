@@ -0,0 +1,299 @@
+#pragma once
+
+#include "FlingVulkan.h"
+#include "NonCopyable.hpp"
+
+#include <functional>
+#include <string>
+
+namespace Fling
+{
+	class LogicalDevice;
+	class CommandBuffer;
+	struct RenderSnapshot;
+
+	/** Index of a texture in a RenderGraph */
+	using RenderGraphTexture = uint32;
+
+	/** How a pass uses a texture. The graph turns these into layouts, barriers, and load/store ops */
+	enum class RenderGraphUsage : uint8
+	{
+		ColorAttachment,
+		DepthAttachment,
+		/** Depth tested against without being written */
+		DepthReadOnly,
+		/** Sampled in a fragment shader */
+		Sampled
+	};
+
+	/** What a pass does with the previous contents of a texture that it writes */
+	enum class RenderGraphLoad : uint8
+	{
+		Clear,
+		Load,
+		DontCare
+	};
+
+	struct RenderGraphTextureDesc
+	{
+		/** Size in pixels. 0 uses the extent that the graph is realized with */
+		uint32 Width = 0;
+		uint32 Height = 0;
+		VkFormat Format = VK_FORMAT_UNDEFINED;
+	};
+
+	/** Everything a pass gets when it is executed */
+	struct RenderGraphContext
+	{
+		CommandBuffer& CmdBuf;
+		uint32 ActiveFrame;
+		const RenderSnapshot& Snapshot;
+	};
+
+	using RenderGraphExecute = std::function<void(const RenderGraphContext&)>;
+
+	/** Layout, pipeline stages, and access of a texture at some point in the graph */
+	struct RenderGraphState
+	{
+		VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags Stages = 0;
+		VkAccessFlags Access = 0;
+	};
+
+	struct RenderGraphBarrier
+	{
+		RenderGraphTexture Texture;
+		RenderGraphState Before;
+		RenderGraphState After;
+	};
+
+	/** A block of memory that a texture needs for the passes it is alive for */
+	struct RenderGraphAllocation
+	{
+		VkDeviceSize Size = 0;
+		VkDeviceSize Alignment = 1;
+		uint32 FirstPass = 0;
+		uint32 LastPass = 0;
+
+		/** Where the allocation was placed in its heap */
+		VkDeviceSize Offset = 0;
+	};
+
+	/**
+	 * @brief	Passes declare the textures that they read and write and the graph works out the rest.
+	 *			Compile culls passes whose results are never used, finds the lifetime of each texture,
+	 *			and builds the layout transitions and barriers between passes, skipping any that are
+	 *			not needed (reads after reads in the same layout). Realize creates the Vulkan objects:
+	 *			textures whose lifetimes don't overlap share memory, and each pass with attachments
+	 *			gets its own render pass and frame buffer.
+	 *
+	 *			The graph is declared once and executed every frame. Textures that are used outside
+	 *			of the graph after it runs need to be exported so that they are kept alive.
+	 */
+	class RenderGraph : public NonCopyable
+	{
+	public:
+
+		static constexpr uint32 InvalidIndex = ~0u;
+
+		/** Given to a pass in its setup to declare what it uses */
+		class PassBuilder
+		{
+		public:
+
+			void Read(RenderGraphTexture t_Tex, RenderGraphUsage t_Usage);
+
+			void Write(RenderGraphTexture t_Tex, RenderGraphUsage t_Usage, RenderGraphLoad t_Load = RenderGraphLoad::Clear);
+
+			/** Never cull this pass. For passes that do work that the graph can't see */
+			void SetSideEffects();
+
+		private:
+
+			friend class RenderGraph;
+
+			PassBuilder(RenderGraph& t_Graph, uint32 t_Pass) : m_Graph(t_Graph), m_Pass(t_Pass) {}
+
+			RenderGraph& m_Graph;
+			uint32 m_Pass;
+		};
+
+		/** @param t_Dev	Can be null if the graph is only going to be compiled */
+		explicit RenderGraph(const LogicalDevice* t_Dev);
+
+		~RenderGraph();
+
+		RenderGraphTexture CreateTexture(const std::string& t_Name, const RenderGraphTextureDesc& t_Desc);
+
+		/** Keep a texture alive after the graph runs and leave it in the layout of the given usage */
+		void ExportTexture(RenderGraphTexture t_Tex, RenderGraphUsage t_FinalUsage);
+
+		/** @return Index of the pass */
+		uint32 AddPass(const std::string& t_Name, const std::function<void(PassBuilder&)>& t_Setup, RenderGraphExecute t_Execute);
+
+		/** Cull passes, find texture lifetimes, and plan the barriers. Call again after adding passes */
+		void Compile();
+
+		/** Create the images, memory, render passes, and frame buffers. Must be compiled first */
+		void Realize(VkExtent2D t_Extent);
+
+		/** Recreate everything that depends on the extent. The GPU must be idle */
+		void Resize(VkExtent2D t_Extent);
+
+		/** Record every pass that wasn't culled along with the barriers between them */
+		void Execute(const RenderGraphContext& t_Context);
+
+		/** Destroy everything that Realize created except for the render passes */
+		void Release();
+
+		/**
+		 * @brief	Place allocations in one heap so that any two that are alive at the same time
+		 *			don't overlap. The biggest ones are placed first and the rest fill the gaps
+		 * @return	Size of the heap
+		 */
+		static VkDeviceSize PlaceAllocations(std::vector<RenderGraphAllocation>& t_Allocations);
+
+		FORCEINLINE const VkExtent2D& GetExtent() const { return m_Extent; }
+
+		/**
+		 * @brief	Part of the extent sized targets that passes render into, from the top left corner.
+		 *			The rest of the targets is left alone. Zero means all of it
+		 */
+		FORCEINLINE void SetRenderArea(VkExtent2D t_Area) { m_RenderArea = t_Area; }
+
+		/** The render area clamped to the extent */
+		VkExtent2D GetRenderArea() const;
+
+		FORCEINLINE bool IsPassCulled(uint32 t_Pass) const { return m_Passes[t_Pass].bCulled; }
+
+		/** Render pass of a pass with attachments, so that its pipelines can be created */
+		FORCEINLINE VkRenderPass GetRenderPass(uint32 t_Pass) const { return m_Passes[t_Pass].RenderPass; }
+
+		FORCEINLINE VkImageView GetImageView(RenderGraphTexture t_Tex) const { return m_Textures[t_Tex].View; }
+
+		/** Passes that will be executed, in order */
+		FORCEINLINE const std::vector<uint32>& GetExecutionOrder() const { return m_ExecutionOrder; }
+
+		/** Barriers recorded before the given pass */
+		FORCEINLINE const std::vector<RenderGraphBarrier>& GetBarriers(uint32 t_Pass) const { return m_Passes[t_Pass].Barriers; }
+
+		/** Barriers recorded after the last pass for exported textures */
+		FORCEINLINE const std::vector<RenderGraphBarrier>& GetExportBarriers() const { return m_ExportBarriers; }
+
+		/** First and last position in the execution order that a texture is used. Exported textures live until the end */
+		FORCEINLINE uint32 GetFirstUse(RenderGraphTexture t_Tex) const { return m_Textures[t_Tex].FirstPass; }
+		FORCEINLINE uint32 GetLastUse(RenderGraphTexture t_Tex) const { return m_Textures[t_Tex].LastPass; }
+
+		FORCEINLINE uint32 GetBarrierCount() const { return m_BarrierCount; }
+
+		/** Barriers that were not needed because a texture was read again in the same layout */
+		FORCEINLINE uint32 GetSkippedBarrierCount() const { return m_SkippedBarrierCount; }
+
+		/** Memory used by every texture after aliasing */
+		FORCEINLINE VkDeviceSize GetTextureMemory() const { return m_TextureMemory; }
+
+		/** Memory that every texture would use if they each had their own */
+		FORCEINLINE VkDeviceSize GetUnaliasedTextureMemory() const { return m_UnaliasedTextureMemory; }
+
+	private:
+
+		struct TextureAccess
+		{
+			RenderGraphTexture Texture;
+			RenderGraphUsage Usage;
+			RenderGraphLoad Load;
+			bool bWrite;
+		};
+
+		struct PassNode
+		{
+			std::string Name;
+			std::vector<TextureAccess> Accesses;
+			RenderGraphExecute Execute;
+			bool bSideEffects = false;
+			bool bCulled = false;
+
+			std::vector<RenderGraphBarrier> Barriers;
+			VkPipelineStageFlags SrcStages = 0;
+			VkPipelineStageFlags DstStages = 0;
+
+			/** Color attachments in the order they were declared, then depth */
+			std::vector<RenderGraphTexture> Attachments;
+			std::vector<VkClearValue> ClearValues;
+			VkRenderPass RenderPass = VK_NULL_HANDLE;
+			VkFramebuffer FrameBuffer = VK_NULL_HANDLE;
+			VkExtent2D Extent = {};
+
+			/** True if the attachments follow the graph extent, these use the render area */
+			bool bExtentSized = false;
+		};
+
+		struct TextureNode
+		{
+			std::string Name;
+			RenderGraphTextureDesc Desc;
+			bool bExported = false;
+			RenderGraphUsage ExportUsage = RenderGraphUsage::Sampled;
+
+			uint32 FirstPass = InvalidIndex;
+			uint32 LastPass = InvalidIndex;
+
+			/** Every usage flag that the image needs */
+			VkImageUsageFlags Usage = 0;
+
+			/** State that the texture is left in at the end of the graph */
+			RenderGraphState FinalState;
+
+			VkImage Image = VK_NULL_HANDLE;
+			VkImageView View = VK_NULL_HANDLE;
+			uint32 Heap = InvalidIndex;
+			VkDeviceSize Offset = 0;
+			VkDeviceSize Size = 0;
+			VkDeviceSize Alignment = 1;
+		};
+
+		void AddAccess(uint32 t_Pass, const TextureAccess& t_Access);
+
+		/** Walk the passes in order and record the barriers that each one needs */
+		void PlanBarriers();
+
+		/** Make the first barrier of each texture wait for the textures that share its memory */
+		void AddAliasingBarriers();
+
+		void UpdatePassStages(PassNode& t_Pass);
+
+		void UpdateExportStages();
+
+		void CreateRenderPass(PassNode& t_Pass);
+
+		void RecordBarriers(VkCommandBuffer t_Cmd, const std::vector<RenderGraphBarrier>& t_Barriers, VkPipelineStageFlags t_Src, VkPipelineStageFlags t_Dst);
+
+		VkImageAspectFlags GetAspectMask(RenderGraphTexture t_Tex) const;
+
+		const LogicalDevice* m_Device;
+
+		std::vector<PassNode> m_Passes;
+		std::vector<TextureNode> m_Textures;
+		std::vector<uint32> m_ExecutionOrder;
+		std::vector<RenderGraphBarrier> m_ExportBarriers;
+		VkPipelineStageFlags m_ExportSrcStages = 0;
+		VkPipelineStageFlags m_ExportDstStages = 0;
+
+		/** One allocation per group of textures that can share memory */
+		std::vector<VkDeviceMemory> m_Heaps;
+
+		VkExtent2D m_Extent = {};
+
+		VkExtent2D m_RenderArea = {};
+
+		uint32 m_BarrierCount = 0;
+		uint32 m_SkippedBarrierCount = 0;
+		VkDeviceSize m_TextureMemory = 0;
+		VkDeviceSize m_UnaliasedTextureMemory = 0;
+
+		bool m_Compiled = false;
+
+		/** Reused every time barriers are recorded */
+		std::vector<VkImageMemoryBarrier> m_ImageBarriers;
+	};
+}   // namespace Fling
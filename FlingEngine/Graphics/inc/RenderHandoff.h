@@ -0,0 +1,72 @@
+#pragma once
+
+#include "FlingTypes.h"
+#include "NonCopyable.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+
+namespace Fling
+{
+	/**
+	 * @brief	Passes frames from the main thread to the render thread through two slots. The main
+	 *			thread extracts frame N+1 into one slot while the render thread draws frame N from
+	 *			the other, so the simulation is never more than one frame ahead of rendering.
+	 *			Only hands out slot indices, the owner keeps what is in them. Doesn't touch Vulkan
+	 *			so that it can be tested on its own, @see VulkanApp::RenderThreadLoop
+	 */
+	class RenderHandoff : public NonCopyable
+	{
+	public:
+
+		static constexpr uint32 SlotCount = 2;
+
+		/** Main thread. Blocks until the render thread is done with the slot that is written next */
+		uint32 BeginWrite();
+
+		/** Main thread. Give the slot that BeginWrite returned to the render thread */
+		void Submit(uint32 t_Slot);
+
+		/**
+		 * @brief	Render thread. Blocks until a frame is submitted
+		 * @return	False once Stop was called and every submitted frame has been read
+		 */
+		bool BeginRead(uint32& t_OutSlot);
+
+		/** Render thread. The slot can be written again */
+		void EndRead(uint32 t_Slot);
+
+		/** Main thread. Blocks until every submitted frame has been read and ended */
+		void WaitIdle();
+
+		/** Let the render thread return from BeginRead once it has read what is left */
+		void Stop();
+
+		/** Frames that were submitted and haven't been ended yet */
+		uint32 GetPendingCount() const;
+
+	private:
+
+		enum class SlotState : uint8
+		{
+			Free,
+			Writing,
+			Submitted,
+			Reading
+		};
+
+		mutable std::mutex m_Mutex;
+
+		/** Notified whenever a slot changes state */
+		std::condition_variable m_SlotChanged;
+
+		std::array<SlotState, SlotCount> m_Slots = { SlotState::Free, SlotState::Free };
+
+		/** Slots are written and read in the same order, so frames never overtake each other */
+		uint32 m_NextWrite = 0;
+		uint32 m_NextRead = 0;
+
+		bool m_Stopped = false;
+	};
+}   // namespace Fling
@@ -23,7 +23,13 @@ namespace Fling
 		RenderPipeline(entt::registry& t_Reg, LogicalDevice* t_dev, Swapchain* t_Swap, std::vector<std::unique_ptr<Subpass>>& t_Subpasses);
 		~RenderPipeline();
 
-		void Draw(CommandBuffer& t_CmdBuf, VkFramebuffer t_PresentFrameBuf, uint32 t_ActiveFrameInFlight, entt::registry& t_Reg, float DeltaTime);
+		/** Called on the main thread once the simulation is done with the frame. @see Subpass::Extract */
+		void Extract(entt::registry& t_Reg, RenderSnapshot& t_Snapshot);
+
+		/** Called before the global render pass begins. @see Subpass::PrepareDraw */
+		void PrepareDraw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot);
+
+		void Draw(CommandBuffer& t_CmdBuf, VkFramebuffer t_PresentFrameBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot);
 
 		/** Given a frame index, get any semaphores that the swap chain command buffer needs to wait for */
 		void GatherPresentDependencies(std::vector<CommandBuffer*>& t_CmdBuffs, std::vector<VkSemaphore>& t_Deps, uint32 t_ActiveFrameIndex, uint32 t_CurrentFrameInFlight);
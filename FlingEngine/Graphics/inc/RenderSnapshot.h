@@ -0,0 +1,113 @@
+#pragma once
+
+#include "FlingVulkan.h"
+#include "TextureSlots.h"
+#include "DebugDraw.h"
+#include "GeometryBuffer.h"
+#include "Lighting/DirectionalLight.hpp"
+#include "Lighting/PointLight.hpp"
+
+#include <entt/entity/registry.hpp>
+#include <vector>
+
+namespace Fling
+{
+	class Model;
+
+	/** Per mesh data of mrt.vert */
+	struct OffscreenPushConstants
+	{
+		glm::mat4 Model;
+		MaterialTextureSlots Textures;
+
+		/** Bounds that the vertices are decoded with, see Model::GetDecodeCenter */
+		glm::vec4 BoundsCenter;
+		glm::vec4 BoundsExtents;
+	};
+
+	static_assert(sizeof(OffscreenPushConstants) <= 128, "OffscreenPushConstants must fit in the minimum push constant size");
+
+	/** A visible mesh at the level of detail that was picked for it, recorded once for the prepass and once for the G-Buffer */
+	struct MeshDraw
+	{
+		OffscreenPushConstants Constants;
+		const Fling::Model* Model;
+		/** Where the LOD is in the geometry buffer, so drawing it doesn't touch the model */
+		uint32 FirstIndex;
+		uint32 IndexCount;
+		int32 VertexOffset;
+	};
+
+	/** The UI of a frame, copied out of ImGui's draw data so that ImGui can start on the next frame */
+	struct UiDrawSnapshot
+	{
+		/** One scissored draw of the index buffer */
+		struct Command
+		{
+			glm::vec4 ClipRect;
+			uint32 ElemCount;
+			uint32 FirstIndex;
+			int32 VertexOffset;
+		};
+
+		glm::vec2 DisplaySize {};
+
+		/** ImDrawVerts of every draw list in order, kept as bytes so that this doesn't need ImGui */
+		std::vector<uint8> Vertices;
+
+		/** ImDrawIdx, the index buffer is bound as 16 bit */
+		std::vector<uint16> Indices;
+
+		std::vector<Command> Commands;
+	};
+
+	/**
+	 * @brief	Everything the renderer needs to draw a frame, copied out of the registry at the end of
+	 *			the simulation tick by Subpass::Extract. Once it is filled in, recording the frame doesn't
+	 *			read the registry, the camera, or ImGui, so it can happen on the render thread while the
+	 *			main thread simulates the next frame. VulkanApp keeps one per RenderHandoff slot and
+	 *			reuses them, so the vectors stop allocating after the first few frames.
+	 */
+	struct RenderSnapshot
+	{
+		// Camera ---------
+		/** As the camera has them. Subpasses flip Y for Vulkan's clip space themselves */
+		glm::mat4 View { 1.0f };
+		glm::mat4 Projection { 1.0f };
+		glm::vec3 CameraPos {};
+		float NearPlane = 0.1f;
+		float FarPlane = 100.0f;
+		float Gamma = 2.2f;
+		float Exposure = 4.5f;
+
+		float DeltaTime = 0.0f;
+
+		// G-Buffer ---------
+		/** Every mesh is drawn out of these, they are bound once per pass */
+		GeometryBindings Geometry;
+
+		/** Meshes that survived CPU culling. Empty with the GPU driven path, it culls while recording */
+		std::vector<MeshDraw> MeshDraws;
+
+		/** Part of the G-Buffer that is rendered, picked by dynamic resolution */
+		VkExtent2D RenderExtent {};
+
+		// Lighting ---------
+		std::vector<DirectionalLight> DirectionalLights;
+
+		/** Positions are already set from their transforms */
+		std::vector<PointLight> PointLights;
+
+		// Debug and UI ---------
+		/** Shapes that were drawn with DebugDraw during the frame */
+		DebugDrawList DebugShapes;
+
+		UiDrawSnapshot Ui;
+
+		/**
+		 * Only set when the frame is recorded on the main thread. The GPU driven path keeps its
+		 * object buffers in sync with the registry while it records, so it needs this
+		 */
+		entt::registry* Registry = nullptr;
+	};
+}   // namespace Fling
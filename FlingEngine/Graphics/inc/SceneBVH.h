@@ -0,0 +1,98 @@
+#pragma once
+
+#include "DynamicBVH.h"
+#include "NonCopyable.hpp"
+
+#include <entt/entity/registry.hpp>
+
+namespace Fling
+{
+	struct Transform;
+	struct MeshRenderer;
+
+	/**
+	 * @brief	Where an entity lives in the scene BVH. Added and removed by the SceneBVH
+	 *			whenever an entity has both a Transform and a MeshRenderer
+	 */
+	struct SpatialProxy
+	{
+		int32 m_ProxyId = DynamicBVH::NullNode;
+
+		/** Tight world space bounds from the last time this entity was updated */
+		AABB m_WorldBounds;
+
+		/** Set when a component was replaced and the bounds need to be calculated again */
+		bool m_Dirty = false;
+	};
+
+	/**
+	 * @brief	Keeps a DynamicBVH of every mesh in the scene up to date by listening to
+	 *			the registry. Used for visibility and any other spatial queries.
+	 */
+	class SceneBVH : public NonCopyable
+	{
+	public:
+
+		explicit SceneBVH(entt::registry& t_Reg);
+
+		virtual ~SceneBVH() = default;
+
+		/** Disconnect from the registry signals and remove every proxy */
+		void Shutdown(entt::registry& t_Reg);
+
+		/**
+		 * @brief	Update any dirty world matrices, refit the entities that moved, and
+		 *			rebuild the tree if enough of it has changed
+		 */
+		void Update(entt::registry& t_Reg);
+
+		/**
+		 * @brief	Find the entities that may be visible in the given frustum.
+		 * @param t_OutInside		Entities that are definitely inside of the frustum
+		 * @param t_OutIntersecting	Entities that should be tested with their SpatialProxy::m_WorldBounds
+		 */
+		void QueryFrustum(const Frustum& t_Frustum, std::vector<entt::entity>& t_OutInside, std::vector<entt::entity>& t_OutIntersecting) const;
+
+		/** Find every entity that may overlap the given world space box */
+		void QueryAABB(const AABB& t_Box, std::vector<entt::entity>& t_OutEntities) const;
+
+		FORCEINLINE const DynamicBVH& GetTree() const { return m_Tree; }
+
+		/** Entities whose world matrix or mesh changed during the last Update */
+		FORCEINLINE const std::vector<entt::entity>& GetChangedEntities() const { return m_ChangedEntities; }
+
+	private:
+
+		void OnMeshRendererAdded(entt::entity t_Ent, entt::registry& t_Reg, MeshRenderer& t_MeshRend);
+
+		void OnTransformAdded(entt::entity t_Ent, entt::registry& t_Reg, Transform& t_Trans);
+
+		void OnMeshRendererReplaced(entt::entity t_Ent, entt::registry& t_Reg, MeshRenderer& t_MeshRend);
+
+		void OnTransformReplaced(entt::entity t_Ent, entt::registry& t_Reg, Transform& t_Trans);
+
+		/** Called when a Transform or MeshRenderer is removed */
+		void OnComponentRemoved(entt::entity t_Ent, entt::registry& t_Reg);
+
+		void OnProxyRemoved(entt::entity t_Ent, entt::registry& t_Reg);
+
+		/** Add a proxy for this entity if it has everything it needs */
+		void TryAddProxy(entt::entity t_Ent, entt::registry& t_Reg);
+
+		void MarkDirty(entt::entity t_Ent, entt::registry& t_Reg);
+
+		/** Recalculate the world bounds of this entity from its cached world matrix */
+		static void RefreshBounds(const Transform& t_Trans, const MeshRenderer& t_MeshRend, SpatialProxy& t_Proxy);
+
+		DynamicBVH m_Tree;
+
+		/** Entities whose world matrix changed this frame */
+		std::vector<entt::entity> m_ChangedEntities;
+
+		/** Entities that had a component replaced since the last update */
+		std::vector<entt::entity> m_PendingRefits;
+
+		mutable std::vector<uint32> m_ScratchInside;
+		mutable std::vector<uint32> m_ScratchIntersecting;
+	};
+}   // namespace Fling
@@ -93,6 +93,9 @@ namespace Fling
         /** get the Vulkan stage bit flags that we should bind to */
 		VkShaderStageFlagBits GetStage() const { return m_Stage; }
 
+		/** Work group size of a compute shader */
+		uint32 GetLocalSizeX() const { return localSizeX; }
+
 		/**
 		* @breif	Release any resrources created by this shader (the module)
 		*/
@@ -100,7 +103,13 @@ namespace Fling
 
 		static VkDescriptorSetLayout CreateSetLayout(VkDevice t_Dev, std::vector<Shader*>& t_Shaders, bool t_SupportPushDescriptor = false);
 
-		static VkPipelineLayout CreatePipelineLayout(VkDevice t_Dev, VkDescriptorSetLayout t_SetLayout, VkShaderStageFlags t_PushConstantStages, size_t t_PushConstantSize);
+		/** @param t_ExtraSetLayouts	Layouts of set 1 onwards, which shader reflection skips */
+		static VkPipelineLayout CreatePipelineLayout(
+			VkDevice t_Dev,
+			VkDescriptorSetLayout t_SetLayout,
+			VkShaderStageFlags t_PushConstantStages,
+			size_t t_PushConstantSize,
+			const std::vector<VkDescriptorSetLayout>& t_ExtraSetLayouts = {});
 
     private:
 
@@ -13,6 +13,7 @@ namespace Fling
 	class FrameBuffer;
 	class Swapchain;
 	class GraphicsPipeline;
+	struct RenderSnapshot;
 
 	/**
 	* @brief	A subpass represents one part of a RenderPipeline. Each subpass should 
@@ -34,7 +35,20 @@ namespace Fling
 
 		virtual void CreateGraphicsPipeline() = 0;
 
-		virtual void Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, entt::registry& t_reg, float DeltaTime) = 0;
+		/**
+		* @brief	Copy whatever this subpass draws out of the registry and into the snapshot. Runs on the
+		*			main thread after the simulation and is the only place a subpass may read the registry
+		*			while the game is running, PrepareDraw and Draw may be on the render thread
+		*/
+		virtual void Extract(entt::registry& t_reg, RenderSnapshot& t_Snapshot) {}
+
+		/**
+		* @brief	Record anything that can't happen inside of a render pass (compute dispatches, copies)
+		*			into the swap chain command buffer before the global render pass begins
+		*/
+		virtual void PrepareDraw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot) {}
+
+		virtual void Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot) = 0;
 
 		/** Cleanup any allocated resources that you may need a registry for */
 		virtual void CleanUp(entt::registry& t_reg) {}
@@ -61,9 +75,18 @@ namespace Fling
 		/** Function that is called when the swap chain is resized. Put any logic that may depend on Swapchain extents */
 		virtual void OnSwapchainResized(entt::registry& t_reg) {}
 
+		/**
+		* @brief	Name of the GPU profiler scope around Draw. Return null if the subpass
+		*			doesn't draw into the given command buffer and profiles itself instead
+		*/
+		virtual const char* GetProfileName() const { return "Subpass"; }
+
 		inline GraphicsPipeline* GetGraphicsPipeline() const noexcept { return m_GraphicsPipeline; }
 		inline const std::vector<VkClearValue>& GetClearValues() const { return m_ClearValues; }
 
+		/** Set which subpass of its render pass this draws in. Must be called before the graphics pipeline is created */
+		inline void SetSubpassIndex(uint32 t_Index) { m_SubpassIndex = t_Index; }
+
 	protected:
 
 		void InitalizeGraphicsPipeline();
@@ -81,6 +104,9 @@ namespace Fling
 		/** The clear values that will be used when building the command buffer to run this subpass */
 		std::vector<VkClearValue> m_ClearValues = std::vector<VkClearValue>(2);
 
+		/** Index of the subpass in the render pass that the graphics pipeline is created for */
+		uint32 m_SubpassIndex = 0;
+
 		/** Layouts created in the constructor via shader reflection */
 		GraphicsPipeline* m_GraphicsPipeline = nullptr;
 	};
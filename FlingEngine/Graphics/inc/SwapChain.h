@@ -16,12 +16,18 @@ namespace Fling
 	class LogicalDevice;
 
     /**
-     * @brief	Represents a swap chain that can be used throughout the program
+     * @brief	Represents a swap chain that can be used throughout the program.
+     *			Without a surface the swap chain is headless and owns plain images instead,
+     *			that are cycled through on acquire and left for a readback on present.
      */
     class Swapchain
     {
     public:
 
+		/** Format of the images when there is no surface to ask for one */
+		static constexpr VkFormat HeadlessFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+		/** Pass VK_NULL_HANDLE as the surface for a headless swap chain */
 		explicit Swapchain(const VkExtent2D& t_Extent, LogicalDevice* t_Dev, PhysicalDevice* t_PhysDev, VkSurfaceKHR t_Surface);
 
 		~Swapchain();
@@ -41,6 +47,11 @@ namespace Fling
 		 */
 		void Cleanup();
 
+		bool IsHeadless() const { return m_Surface == VK_NULL_HANDLE; }
+
+		/** Layout that images have to be in at the end of the frame */
+		VkImageLayout GetPresentLayout() const { return IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+
 		const VkSwapchainKHR& GetVkSwapChain() const { return m_SwapChain; }
 		const VkPresentModeKHR& GetPresentMode() const { return m_PresentMode; }
 		const VkExtent2D& GetExtents() const { return m_Extents; }
@@ -74,11 +85,17 @@ namespace Fling
 		std::vector<VkImage> m_Images;
 		std::vector<VkImageView> m_ImageViews;
 
+		/** Memory of the images when headless, the images are owned by the swap chain otherwise */
+		std::vector<VkDeviceMemory> m_HeadlessMemory;
+
 		/**
 		 * @brief	Create any swap chain resources (present mode, KGR swap chain)
 		 */
 		void CreateResources();
 
+		/** Create images that can be rendered to and copied from, one per frame in flight */
+		void CreateHeadlessResources();
+
 		/**
 		* Create the image views from the swap chain so that we can actually render them
 		*/
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "FlingTypes.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace Fling
+{
+	class Texture;
+
+	/** Slots of the PBR textures of a material. Matches the uvec4 of texture indices in the MRT shaders */
+	struct MaterialTextureSlots
+	{
+		uint32 Albedo = 0;
+		uint32 Normal = 0;
+		uint32 Metal = 0;
+		uint32 Roughness = 0;
+	};
+
+	/**
+	 * @brief	Hands out indices into the bindless texture array. Textures are ref counted so that
+	 *			materials that share a texture share its slot. A slot that is released isn't reused
+	 *			until the frames that may still be reading it on the GPU are done.
+	 *			Doesn't touch Vulkan so that it can be tested on its own, @see BindlessTextures
+	 */
+	class TextureSlotAllocator
+	{
+	public:
+
+		static constexpr uint32 InvalidSlot = ~0u;
+
+		/**
+		 * @param t_Capacity		Number of slots in the array
+		 * @param t_RetireFrames	Frames that a released slot has to wait before it can be given out again
+		 */
+		TextureSlotAllocator(uint32 t_Capacity, uint32 t_RetireFrames);
+
+		/**
+		 * @brief	Add a reference to the texture and get its slot
+		 * @param t_OutIsNew	True if the slot has to be written with the texture
+		 * @return	InvalidSlot if every slot is in use
+		 */
+		uint32 Acquire(Texture* t_Tex, bool& t_OutIsNew);
+
+		/** Remove a reference. The slot is retired once nothing references the texture */
+		void Release(Texture* t_Tex);
+
+		/** Call once per frame. Slots that were retired long enough ago become free */
+		void NextFrame();
+
+		/** @return Slot of the texture or InvalidSlot if it doesn't have one */
+		uint32 GetSlot(const Texture* t_Tex) const;
+
+		/** Slots that are referenced or waiting to retire */
+		uint32 GetUsedCount() const { return m_NextSlot - static_cast<uint32>(m_FreeSlots.size()); }
+
+		uint32 GetCapacity() const { return m_Capacity; }
+
+	private:
+
+		struct Entry
+		{
+			uint32 Slot = InvalidSlot;
+			uint32 RefCount = 0;
+			/** Frame of the last release, so that a slot that was acquired and released again isn't retired early */
+			uint64 ReleaseFrame = 0;
+		};
+
+		struct RetiredSlot
+		{
+			const Texture* Tex;
+			uint64 ReleaseFrame;
+		};
+
+		std::unordered_map<const Texture*, Entry> m_Entries;
+
+		/** Released textures in the order that they were released */
+		std::vector<RetiredSlot> m_Retired;
+
+		std::vector<uint32> m_FreeSlots;
+
+		/** Slots at and after this one have never been used */
+		uint32 m_NextSlot = 0;
+
+		uint32 m_Capacity;
+		uint32 m_RetireFrames;
+		uint64 m_Frame = 0;
+	};
+}   // namespace Fling
@@ -21,5 +21,7 @@ namespace Fling
     {
         glm::mat4 Projection;
         glm::mat4 ModelView;
+        // Takes the cube's vertex positions to model space, see Model::GetDecodeMatrix
+        glm::mat4 Decode;
     };
 }   // namespace Fling
\ No newline at end of file
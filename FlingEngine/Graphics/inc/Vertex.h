@@ -2,8 +2,22 @@
 
 #include "FlingVulkan.h"
 
+#include <vector>
+
 namespace Fling
 {
+	struct AABB;
+
+	/** Layout of the vertex buffers on the GPU. Every model uses the same one, see Model::GetVertexFormat */
+	enum class VertexFormat : uint8
+	{
+		/** Vertex as it is, 56 bytes */
+		Full,
+
+		/** CompactVertex, 20 bytes */
+		Compact
+	};
+
     /**
     * Basic Vertex outline for use with our vertex buffers
     */
@@ -23,18 +37,29 @@ namespace Fling
 		/**
 		 * @brief	Gets the shader binding of a vertex
 		 */
-        static VkVertexInputBindingDescription GetBindingDescription() 
-        {
-            VkVertexInputBindingDescription bindingDescription = {};
-            bindingDescription.binding = 0;
-            bindingDescription.stride = sizeof(Vertex);
-            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        static VkVertexInputBindingDescription GetBindingDescription(VertexFormat t_Format = VertexFormat::Full);
 
-            return bindingDescription;
-        }
+		/**
+		 * @brief	Attributes of a vertex in the given format. Compact vertices don't have a color
+		 *			and fill only the xy of the normal and tangent, see VertexDecode.h in the shaders
+		 */
+		static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(VertexFormat t_Format = VertexFormat::Full);
+
+		/**
+		 * @brief	Binding of the position only stream, @see GeometryBindings::Bind. Positions are
+		 *			at location 0 like in the full stream, so a shader can be used with either one
+		 */
+		static VkVertexInputBindingDescription GetPositionBindingDescription(VertexFormat t_Format = VertexFormat::Full);
+
+		static VkVertexInputAttributeDescription GetPositionAttributeDescription(VertexFormat t_Format = VertexFormat::Full);
+
+		/** Size of one position in the position only stream */
+		static uint32 GetPositionStride(VertexFormat t_Format);
+
+	private:
 
 		//#TODO Use shader reflection to get our bindings for this vertex instead
-        static std::array<VkVertexInputAttributeDescription, 5> GetAttributeDescriptions()
+        static std::array<VkVertexInputAttributeDescription, 5> GetFullAttributeDescriptions()
         {
             std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions = {};
 
@@ -67,6 +92,36 @@ namespace Fling
         }
 
     };
+
+	/**
+	 * @brief	Quantized vertex for the Compact vertex format. The color is dropped since every
+	 *			mesh is white, and everything else is fetched as normalized or half float values
+	 */
+	struct CompactVertex
+	{
+		/** UNORM across the bounds of the mesh, w is unused */
+		uint16 Pos[4];
+
+		/** Octahedral encoded SNORM, see GBufferPacking.h */
+		int16 Tangent[2];
+		int16 Normal[2];
+
+		/** Half floats */
+		uint16 TexCoord[2];
+
+		/** @param t_Bounds	Bounds of every vertex of the mesh, positions are relative to these */
+		static CompactVertex Pack(const Vertex& t_Vert, const AABB& t_Bounds);
+
+		/** What the vertex shader decodes. Color is white */
+		static Vertex Unpack(const CompactVertex& t_Vert, const AABB& t_Bounds);
+
+		/** Unit vector to a point on the octahedron in [-1, 1] */
+		static glm::vec2 OctEncode(const glm::vec3& t_Dir);
+
+		static glm::vec3 OctDecode(const glm::vec2& t_Oct);
+	};
+
+	static_assert(sizeof(CompactVertex) == 20, "CompactVertex has to match the attributes of VertexFormat::Compact");
 }   // namespace Fling
 
 // Hash function for a vertex so that we can put thing std::maps and what not
@@ -3,10 +3,15 @@
 #include "FlingTypes.h"
 #include "FlingVulkan.h"
 #include "Singleton.hpp"
+#include "RenderHandoff.h"
+#include "RenderSnapshot.h"
 
 #include <entt/entity/registry.hpp>
 #include <vector>
+#include <array>
 #include <atomic>
+#include <mutex>
+#include <thread>
 
 namespace Fling
 {
@@ -29,8 +34,14 @@ namespace Fling
 	class RenderPipeline;
 	class CommandBuffer;
 	class FirstPersonCamera;
+	class PipelineCache;
+	class FrameCapture;
+	class GpuProfiler;
+	class GeometryBuffer;
 	class DepthBuffer;
 	class BaseEditor;
+	struct FrameBufferAttachment;
+	enum class GBufferTarget : uint8;
 
 	/**
 	* @brief	Core rendering functionality of the Fling Engine. Controls what Render pipelines 
@@ -51,16 +62,45 @@ namespace Fling
         ~VulkanApp() = default;
 
 		/**
-		* @brief	Updates all rendering buffers and sends commands to draw a frame
+		* @brief	Takes a snapshot of the frame and draws it. With Graphics.RenderThread the snapshot is
+		*			handed to the render thread and this only blocks if that is still on the frame before
 		*/
 		void Update(float DeltaTime, entt::registry& t_Reg);
 
+		/** Draws whatever was handed off and joins the render thread. Does nothing if there is none */
+		void StopRenderThread();
+
+		/** True if frames are recorded and submitted on their own thread */
+		inline bool HasRenderThread() const { return m_RenderThread.joinable(); }
+
 		inline FlingWindow* GetCurrentWindow() const { return m_CurrentWindow; }
 		inline LogicalDevice* GetLogicalDevice() const { return m_LogicalDevice; }
 		inline PhysicalDevice* GetPhysicalDevice() const { return m_PhysicalDevice; }
 		inline const VkCommandPool GetCommandPool() const { return m_CommandPool; }
+
+		/** Pool for GraphicsHelpers::BeginSingleTimeCommands, the draw pool belongs to whichever thread renders */
+		inline const VkCommandPool GetSingleTimeCommandPool() const { return m_SingleTimeCommandPool; }
+
+		/** Lock when submitting to or waiting on the graphics or present queue outside of the frame */
+		inline std::mutex& GetQueueMutex() { return m_QueueMutex; }
 		inline FirstPersonCamera* GetCamera() const { return m_Camera; }
 		inline VkRenderPass GetGlobalRenderPass() const { return m_RenderPass; }
+		inline PipelineCache* GetPipelineCache() const { return m_PipelineCache; }
+
+		/** Null if the profiler is turned off or timestamps aren't supported */
+		inline GpuProfiler* GetGpuProfiler() const { return m_GpuProfiler; }
+
+		/** Vertices and indices of every model. Null before Init and after Shutdown */
+		inline GeometryBuffer* GetGeometryBuffer() const { return m_GeometryBuffer; }
+
+		/** True if there is no surface and frames are rendered to offscreen images. Set from Headless.Enabled */
+		inline bool IsHeadless() const { return m_Headless; }
+
+		/** True if the deferred G-Buffer and lighting are two subpasses of the global render pass */
+		inline bool IsSinglePassDeferred() const { return m_SinglePassDeferred; }
+
+		/** View of a G-Buffer attachment of the global render pass. Only valid with single pass deferred */
+		VkImageView GetGBufferAttachmentView(GBufferTarget t_Target) const;
 
 		/** Callback for when a window is resized and to what width and height */
 		void OnWindowResized(int Width, int Height);
@@ -90,6 +130,18 @@ namespace Fling
 
 		void RecreateFrameResourcesForResize(entt::registry& t_Reg);
 
+		/** Main thread. Copy everything that is drawn this frame out of the registry, the camera, and ImGui */
+		void Extract(float DeltaTime, entt::registry& t_Reg, RenderSnapshot& t_Snapshot);
+
+		/**
+		* @brief	Record and submit a frame from a snapshot, on the main thread or the render thread.
+		*			Doesn't touch the registry unless the snapshot has one
+		*/
+		void Render(const RenderSnapshot& t_Snapshot);
+
+		/** Renders every snapshot that is handed off until StopRenderThread */
+		void RenderThreadLoop();
+
 		/** Returns the current extents needed to render based on the physical device and surface */
 		VkExtent2D ChooseSwapExtent();
 
@@ -106,12 +158,30 @@ namespace Fling
 
 		void BuildGlobalRenderPass();
 
+		/**
+		* @brief	Build the global render pass with the deferred G-Buffer as subpass 0 and everything
+		*			that draws to the swap chain in subpass 1, which reads the G-Buffer as input attachments
+		*/
+		void BuildSinglePassRenderPass();
+
+		/** Create the transient G-Buffer color attachments of the single pass render pass */
+		void BuildGBufferAttachments();
+
+		void CleanupGBufferAttachments();
+
+		/** Lazily allocated if the device has it, device local otherwise */
+		VkMemoryPropertyFlags GetTransientMemoryProperties() const;
+
+		/** Subpass of the global render pass that draws to the swap chain image */
+		inline uint32 GetPresentSubpassIndex() const { return m_SinglePassDeferred ? 1 : 0; }
+
 		void BuildSwapChainFrameBuffer();
 
 		/** Vulkan Devices that need to get created. @See VulkanApp::Prepare */
 		Instance* m_Instance = nullptr;
 		LogicalDevice* m_LogicalDevice = nullptr;
 		PhysicalDevice* m_PhysicalDevice = nullptr;
+		PipelineCache* m_PipelineCache = nullptr;
 		FlingWindow* m_CurrentWindow = nullptr;
 		
 		// Swap chain related stuff ---------------------------------------------------------------------
@@ -125,16 +195,50 @@ namespace Fling
 		/** The clear values that will be used when building the command buffer to run this subpass */
 		std::vector<VkClearValue> m_SwapChainClearVals = std::vector<VkClearValue>(2);
 
+		bool m_Headless = false;
+
+		/** Reads back frames when headless, null if there is nothing to capture */
+		FrameCapture* m_FrameCapture = nullptr;
+
+		/** GPU timings of the subpasses. Set from Graphics.GpuProfiler */
+		GpuProfiler* m_GpuProfiler = nullptr;
+
+		/** Every model is sub allocated from this. Main thread only, the render thread binds what the snapshot has */
+		GeometryBuffer* m_GeometryBuffer = nullptr;
+
+		/** Set from the Graphics.SinglePassDeferred config option when the deferred pipeline is used */
+		bool m_SinglePassDeferred = false;
+
+		static constexpr uint32 GBufferColorCount = 3;
+
+		/** Normal, albedo, and material attachments of the single pass render pass. Depth is the depth buffer */
+		std::vector<FrameBufferAttachment*> m_GBufferAttachments;
+
 		/** 
 		* Flag that when set to true, means that there is a pending resize of a window
-		* so we must recreate the necessary swap chain/frame buffer elements
+		* so we must recreate the necessary swap chain/frame buffer elements.
+		* Set by the render thread too, the main thread does the resize once it is idle
 		*/
-		uint8 bNeedsResizing : 1;
+		std::atomic<bool> bNeedsResizing { false };
+
+		/** Set from Graphics.GpuDrivenRendering, it syncs with the registry while recording so it can't use the render thread */
+		bool m_GpuDrivenRendering = false;
+
+		// Render thread ---------------------------------------------------------------------
+		std::thread m_RenderThread;
+
+		RenderHandoff m_Handoff;
+
+		/** One per handoff slot. Only slot 0 is used without a render thread */
+		std::array<RenderSnapshot, RenderHandoff::SlotCount> m_Snapshots;
+
+		/** Guards the graphics and present queues, which single time commands on the main thread also submit to */
+		std::mutex m_QueueMutex;
 
 		// Stages that the swap chain needs to wait on in order to present
 		VkPipelineStageFlags m_WaitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
-		/** Keep a vector of command buffers that we want to use so that we can have one for each active frame */
+		/** Keep a vector of command buffers that we want to use so that we can have one for each frame in flight */
 		std::vector<CommandBuffer*> m_DrawCmdBuffers;
 
 		/** Synchronization primitives for drawing the frame. @see VulkanApp::CreateFrameSyncResources */
@@ -152,6 +256,9 @@ namespace Fling
 		// Command Buffer pool
 		VkCommandPool m_CommandPool = VK_NULL_HANDLE;
 
+		/** Used by the main thread for uploads, so that it never shares a pool with the render thread */
+		VkCommandPool m_SingleTimeCommandPool = VK_NULL_HANDLE;
+
 		std::vector<RenderPipeline*> m_RenderPipelines;
 
 		/** The Vulkan app will specify the current camera and be limited to one for now */
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "BindlessTextures.h"
+#include "LogicalDevice.h"
+#include "GraphicsHelpers.h"
+#include "Material.h"
+#include "Texture.h"
+
+namespace Fling
+{
+	// Slots are released on the main thread, so they wait for the handoff as well as the frames in flight
+	BindlessTextures::BindlessTextures(const LogicalDevice* t_Dev)
+		: m_Device(t_Dev)
+		, m_Slots(std::min(MaxTextures, t_Dev->GetMaxBindlessTextures()), VkConfig::RETIRE_FRAMES)
+	{
+		assert(m_Device);
+
+		if (!m_Device->SupportsBindlessTextures())
+		{
+			F_LOG_FATAL("The G-Buffer needs descriptor indexing (VK_EXT_descriptor_indexing) for its bindless textures!");
+		}
+
+		VkDevice Device = m_Device->GetVkDevice();
+		const uint32 Capacity = m_Slots.GetCapacity();
+
+		VkDescriptorSetLayoutBinding Binding = {};
+		Binding.binding = 0;
+		Binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		Binding.descriptorCount = Capacity;
+		Binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		// Slots that no material uses are never written, and new textures are written while the set is bound
+		VkDescriptorBindingFlagsEXT BindingFlags =
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfoEXT BindingFlagsInfo = {};
+		BindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+		BindingFlagsInfo.bindingCount = 1;
+		BindingFlagsInfo.pBindingFlags = &BindingFlags;
+
+		VkDescriptorSetLayoutCreateInfo LayoutInfo = {};
+		LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		LayoutInfo.pNext = &BindingFlagsInfo;
+		LayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+		LayoutInfo.bindingCount = 1;
+		LayoutInfo.pBindings = &Binding;
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(Device, &LayoutInfo, nullptr, &m_SetLayout));
+
+		VkDescriptorPoolSize PoolSize = Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, Capacity);
+
+		VkDescriptorPoolCreateInfo PoolInfo = {};
+		PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		PoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+		PoolInfo.poolSizeCount = 1;
+		PoolInfo.pPoolSizes = &PoolSize;
+		PoolInfo.maxSets = 1;
+		VK_CHECK_RESULT(vkCreateDescriptorPool(Device, &PoolInfo, nullptr, &m_Pool));
+
+		VkDescriptorSetAllocateInfo AllocInfo = Initializers::DescriptorSetAllocateInfo(m_Pool, &m_SetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(Device, &AllocInfo, &m_Set));
+
+		// The default material is the fallback when the array is full, so it always has to have slots
+		m_DefaultSlots = AcquireMaterial(Material::GetDefaultMat().get());
+
+		F_LOG_TRACE("Bindless texture array created with {} slots", Capacity);
+	}
+
+	BindlessTextures::~BindlessTextures()
+	{
+		VkDevice Device = m_Device->GetVkDevice();
+
+		// Destroying the pool frees the set
+		vkDestroyDescriptorPool(Device, m_Pool, nullptr);
+		vkDestroyDescriptorSetLayout(Device, m_SetLayout, nullptr);
+	}
+
+	MaterialTextureSlots BindlessTextures::AcquireMaterial(Material* t_Mat)
+	{
+		assert(t_Mat);
+		const PBRTextures& Textures = t_Mat->GetPBRTextures();
+
+		MaterialTextureSlots Slots = {};
+		Slots.Albedo = AcquireTexture(Textures.m_AlbedoTexture, m_DefaultSlots.Albedo);
+		Slots.Normal = AcquireTexture(Textures.m_NormalTexture, m_DefaultSlots.Normal);
+		Slots.Metal = AcquireTexture(Textures.m_MetalTexture, m_DefaultSlots.Metal);
+		Slots.Roughness = AcquireTexture(Textures.m_RoughnessTexture, m_DefaultSlots.Roughness);
+		return Slots;
+	}
+
+	void BindlessTextures::ReleaseMaterial(Material* t_Mat, const MaterialTextureSlots& t_Slots)
+	{
+		assert(t_Mat);
+		const PBRTextures& Textures = t_Mat->GetPBRTextures();
+
+		ReleaseTexture(Textures.m_AlbedoTexture, t_Slots.Albedo);
+		ReleaseTexture(Textures.m_NormalTexture, t_Slots.Normal);
+		ReleaseTexture(Textures.m_MetalTexture, t_Slots.Metal);
+		ReleaseTexture(Textures.m_RoughnessTexture, t_Slots.Roughness);
+	}
+
+	uint32 BindlessTextures::AcquireTexture(Texture* t_Tex, uint32 t_Fallback)
+	{
+		if (!t_Tex)
+		{
+			return t_Fallback;
+		}
+
+		bool IsNew = false;
+		const uint32 Slot = m_Slots.Acquire(t_Tex, IsNew);
+		if (Slot == TextureSlotAllocator::InvalidSlot)
+		{
+			F_LOG_WARN("Bindless texture array is full ({} slots), using the default material texture", m_Slots.GetCapacity());
+			return t_Fallback;
+		}
+
+		if (IsNew)
+		{
+			VkWriteDescriptorSet Write = Initializers::WriteDescriptorSetImage(t_Tex, m_Set, 0);
+			Write.dstArrayElement = Slot;
+			vkUpdateDescriptorSets(m_Device->GetVkDevice(), 1, &Write, 0, nullptr);
+		}
+
+		return Slot;
+	}
+
+	void BindlessTextures::ReleaseTexture(Texture* t_Tex, uint32 t_Slot)
+	{
+		// Textures that fell back to the default material never got a slot of their own
+		if (t_Tex && m_Slots.GetSlot(t_Tex) == t_Slot)
+		{
+			m_Slots.Release(t_Tex);
+		}
+	}
+}   // namespace Fling
@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "BoundingVolume.h"
+#include "Vertex.h"
+
+namespace Fling
+{
+	void AABB::Expand(const glm::vec3& t_Point)
+	{
+		Min = glm::min(Min, t_Point);
+		Max = glm::max(Max, t_Point);
+	}
+
+	AABB AABB::Transformed(const glm::mat4& t_Mat) const
+	{
+		// Transform the center, then project the extents onto each axis with the
+		// absolute value of the rotation/scale part of the matrix
+		const glm::vec3 Center = glm::vec3(t_Mat * glm::vec4(GetCenter(), 1.0f));
+		const glm::vec3 Extents = GetExtents();
+
+		glm::vec3 NewExtents;
+		for (int i = 0; i < 3; ++i)
+		{
+			NewExtents[i] =
+				glm::abs(t_Mat[0][i]) * Extents.x +
+				glm::abs(t_Mat[1][i]) * Extents.y +
+				glm::abs(t_Mat[2][i]) * Extents.z;
+		}
+
+		AABB Result;
+		Result.Min = Center - NewExtents;
+		Result.Max = Center + NewExtents;
+		return Result;
+	}
+
+	AABB AABB::FromVertices(const Vertex* t_Verts, size_t t_Count)
+	{
+		AABB Result;
+		for (size_t i = 0; i < t_Count; ++i)
+		{
+			Result.Expand(t_Verts[i].Pos);
+		}
+		return Result;
+	}
+
+	BoundingSphere BoundingSphere::Transformed(const glm::mat4& t_Mat) const
+	{
+		const float ScaleX = glm::dot(glm::vec3(t_Mat[0]), glm::vec3(t_Mat[0]));
+		const float ScaleY = glm::dot(glm::vec3(t_Mat[1]), glm::vec3(t_Mat[1]));
+		const float ScaleZ = glm::dot(glm::vec3(t_Mat[2]), glm::vec3(t_Mat[2]));
+
+		BoundingSphere Result;
+		Result.Center = glm::vec3(t_Mat * glm::vec4(Center, 1.0f));
+		Result.Radius = Radius * glm::sqrt(glm::max(ScaleX, glm::max(ScaleY, ScaleZ)));
+		return Result;
+	}
+
+	BoundingSphere BoundingSphere::FromVertices(const AABB& t_Box, const Vertex* t_Verts, size_t t_Count)
+	{
+		BoundingSphere Result;
+		Result.Center = t_Box.GetCenter();
+
+		// The half diagonal of the box is an upper bound, but the farthest vertex
+		// from the center is usually a lot tighter
+		float MaxDistSq = 0.0f;
+		for (size_t i = 0; i < t_Count; ++i)
+		{
+			const glm::vec3 Offset = t_Verts[i].Pos - Result.Center;
+			MaxDistSq = glm::max(MaxDistSq, glm::dot(Offset, Offset));
+		}
+
+		Result.Radius = glm::sqrt(MaxDistSq);
+		return Result;
+	}
+}   // namespace Fling
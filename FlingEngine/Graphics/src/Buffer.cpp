@@ -133,7 +133,7 @@ namespace Fling
 		}
 	}
 	
-	void Buffer::CopyBuffer(Buffer* t_SrcBuffer, Buffer* t_DstBuffer, VkDeviceSize t_Size)
+	void Buffer::CopyBuffer(Buffer* t_SrcBuffer, Buffer* t_DstBuffer, VkDeviceSize t_Size, VkDeviceSize t_SrcOffset, VkDeviceSize t_DstOffset)
 	{
 		assert(t_SrcBuffer && t_SrcBuffer->IsUsed() && t_DstBuffer && t_DstBuffer->IsUsed());
 
@@ -141,8 +141,8 @@ namespace Fling
 		VkCommandBuffer commandBuffer = GraphicsHelpers::BeginSingleTimeCommands();
 
 		VkBufferCopy copyRegion = {};
-		copyRegion.srcOffset = 0; // Optional
-		copyRegion.dstOffset = 0; // Optional
+		copyRegion.srcOffset = t_SrcOffset;
+		copyRegion.dstOffset = t_DstOffset;
 		copyRegion.size = t_Size;
 		vkCmdCopyBuffer(commandBuffer, t_SrcBuffer->GetVkBuffer(), t_DstBuffer->GetVkBuffer(), 1, &copyRegion);
 
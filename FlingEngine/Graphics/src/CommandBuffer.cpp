@@ -67,6 +67,19 @@ namespace Fling
 		vkCmdBeginRenderPass(GetHandle(), &begin_info, VK_SUBPASS_CONTENTS_INLINE);
 	}
 
+	void CommandBuffer::BeginRenderPass(VkRenderPass t_RenderPass, VkFramebuffer t_FrameBuf, VkExtent2D t_Extent, const std::vector<VkClearValue>& t_ClearVales)
+	{
+		VkRenderPassBeginInfo begin_info{ VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+		begin_info.renderPass = t_RenderPass;
+		begin_info.framebuffer = t_FrameBuf;
+		begin_info.renderArea.offset = { 0, 0 };
+		begin_info.renderArea.extent = t_Extent;
+		begin_info.clearValueCount = to_u32(t_ClearVales.size());
+		begin_info.pClearValues = t_ClearVales.data();
+
+		vkCmdBeginRenderPass(GetHandle(), &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
 	void CommandBuffer::NextSubpass()
 	{
 		// track pipeline state ?
@@ -500,6 +500,7 @@ namespace Fling
         m_UboVS.ModelView[3][0] = 0.0f;
         m_UboVS.ModelView[3][1] = 0.0f;
         m_UboVS.ModelView[3][2] = 0.0f;
+        m_UboVS.Decode = m_Cube->GetDecodeMatrix();
 
         memcpy(m_UniformBuffers[t_CurrentImage]->m_MappedMem, &m_UboVS, sizeof(m_UboVS));
     }
@@ -516,11 +517,8 @@ namespace Fling
             0, 
             NULL);
 
-        VkDeviceSize offsets[1] = { 0 };
-
-        vkCmdBindVertexBuffers(t_CommandBuffer, 0, 1, &GetVertexBuffer()->GetVkBuffer(), offsets);
-        vkCmdBindIndexBuffer(t_CommandBuffer, GetIndexBuffer()->GetVkBuffer(), 0, GetIndexType());
+        VulkanApp::Get().GetGeometryBuffer()->GetBindings().Bind(t_CommandBuffer);
         vkCmdBindPipeline(t_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline->GetPipeline());
-        vkCmdDrawIndexed(t_CommandBuffer, GetIndexCount(), 1, 0, 0, 0);
+        vkCmdDrawIndexed(t_CommandBuffer, GetIndexCount(), 1, m_Cube->GetFirstIndex(), m_Cube->GetVertexOffset(), 0);
     }
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "pch.h"
+#include "DebugDraw.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace Fling
+{
+	void DebugDrawList::Line(const glm::vec3& t_From, const glm::vec3& t_To, const glm::vec4& t_Color)
+	{
+		const uint32 Color = PackColor(t_Color);
+		m_Vertices.push_back({ t_From, Color });
+		m_Vertices.push_back({ t_To, Color });
+	}
+
+	void DebugDrawList::Box(const AABB& t_Box, const glm::vec4& t_Color)
+	{
+		glm::vec3 Corners[8];
+		for (uint32 i = 0; i < 8; ++i)
+		{
+			Corners[i] = glm::vec3(
+				(i & 1) ? t_Box.Max.x : t_Box.Min.x,
+				(i & 2) ? t_Box.Max.y : t_Box.Min.y,
+				(i & 4) ? t_Box.Max.z : t_Box.Min.z);
+		}
+
+		BoxEdges(Corners, PackColor(t_Color));
+	}
+
+	void DebugDrawList::Box(const glm::mat4& t_Transform, const glm::vec4& t_Color)
+	{
+		glm::vec3 Corners[8];
+		for (uint32 i = 0; i < 8; ++i)
+		{
+			const glm::vec4 Corner(
+				(i & 1) ? 1.0f : -1.0f,
+				(i & 2) ? 1.0f : -1.0f,
+				(i & 4) ? 1.0f : -1.0f,
+				1.0f);
+
+			Corners[i] = glm::vec3(t_Transform * Corner);
+		}
+
+		BoxEdges(Corners, PackColor(t_Color));
+	}
+
+	void DebugDrawList::Sphere(const glm::vec3& t_Center, float t_Radius, const glm::vec4& t_Color, uint32 t_Segments)
+	{
+		assert(t_Segments >= 3);
+
+		const uint32 Color = PackColor(t_Color);
+		const float Step = glm::two_pi<float>() / static_cast<float>(t_Segments);
+
+		// One circle in each of the XY, YZ, and ZX planes
+		for (uint32 Axis = 0; Axis < 3; ++Axis)
+		{
+			const uint32 U = Axis;
+			const uint32 V = (Axis + 1) % 3;
+
+			glm::vec3 Prev = t_Center;
+			Prev[U] += t_Radius;
+
+			for (uint32 i = 1; i <= t_Segments; ++i)
+			{
+				const float Angle = Step * static_cast<float>(i);
+
+				glm::vec3 Cur = t_Center;
+				Cur[U] += glm::cos(Angle) * t_Radius;
+				Cur[V] += glm::sin(Angle) * t_Radius;
+
+				m_Vertices.push_back({ Prev, Color });
+				m_Vertices.push_back({ Cur, Color });
+				Prev = Cur;
+			}
+		}
+	}
+
+	void DebugDrawList::Frustum(const glm::mat4& t_ViewProj, const glm::vec4& t_Color)
+	{
+		const glm::mat4 InvViewProj = glm::inverse(t_ViewProj);
+
+		// The corners of the clip space box, depth goes from 0 to 1
+		glm::vec3 Corners[8];
+		for (uint32 i = 0; i < 8; ++i)
+		{
+			const glm::vec4 Corner = InvViewProj * glm::vec4(
+				(i & 1) ? 1.0f : -1.0f,
+				(i & 2) ? 1.0f : -1.0f,
+				(i & 4) ? 1.0f : 0.0f,
+				1.0f);
+
+			Corners[i] = glm::vec3(Corner) / Corner.w;
+		}
+
+		BoxEdges(Corners, PackColor(t_Color));
+	}
+
+	void DebugDrawList::Text(const glm::vec3& t_Pos, const std::string& t_Text, const glm::vec4& t_Color)
+	{
+		m_Texts.push_back({ t_Pos, PackColor(t_Color), t_Text });
+	}
+
+	void DebugDrawList::Clear()
+	{
+		// Keeps the capacity, so a steady amount of shapes doesn't allocate
+		m_Vertices.clear();
+		m_Texts.clear();
+	}
+
+	uint32 DebugDrawList::PackColor(const glm::vec4& t_Color)
+	{
+		// Red in the lowest byte, which is both R8G8B8A8 in memory and ImGui's IM_COL32
+		return glm::packUnorm4x8(t_Color);
+	}
+
+	bool DebugDrawList::ProjectToScreen(const glm::mat4& t_ViewProj, const glm::vec3& t_Pos, const glm::vec2& t_ScreenSize, glm::vec2& t_OutPixel)
+	{
+		const glm::vec4 Clip = t_ViewProj * glm::vec4(t_Pos, 1.0f);
+		if (Clip.w <= 0.0f)
+		{
+			return false;
+		}
+
+		const glm::vec2 Ndc = glm::vec2(Clip) / Clip.w;
+		t_OutPixel = (Ndc * 0.5f + 0.5f) * t_ScreenSize;
+		return true;
+	}
+
+	void DebugDrawList::BoxEdges(const glm::vec3 (&t_Corners)[8], uint32 t_Color)
+	{
+		// Every edge connects two corners that differ in one bit
+		for (uint32 i = 0; i < 8; ++i)
+		{
+			for (uint32 Bit = 1; Bit < 8; Bit <<= 1)
+			{
+				if ((i & Bit) == 0)
+				{
+					m_Vertices.push_back({ t_Corners[i], t_Color });
+					m_Vertices.push_back({ t_Corners[i | Bit], t_Color });
+				}
+			}
+		}
+	}
+
+#if WITH_DEBUG_DRAW
+	namespace DebugDraw
+	{
+		DebugDrawList& GetList()
+		{
+			static DebugDrawList List;
+			return List;
+		}
+	}	// namespace DebugDraw
+#endif	// WITH_DEBUG_DRAW
+}   // namespace Fling
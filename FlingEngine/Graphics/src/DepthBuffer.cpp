@@ -5,10 +5,17 @@
 
 namespace Fling
 {
-	DepthBuffer::DepthBuffer(LogicalDevice* t_Dev, VkSampleCountFlagBits t_SampleCount, VkExtent2D t_Extents)
+	DepthBuffer::DepthBuffer(
+		LogicalDevice* t_Dev,
+		VkSampleCountFlagBits t_SampleCount,
+		VkExtent2D t_Extents,
+		VkImageUsageFlags t_ExtraUsage,
+		VkMemoryPropertyFlags t_MemoryProps)
 		: m_Device(t_Dev)
 		, m_Extents(t_Extents)
 		, m_SampleCount(t_SampleCount)
+		, m_ExtraUsage(t_ExtraUsage)
+		, m_MemoryProps(t_MemoryProps)
 	{
 		assert(m_Device);
 		Create();
@@ -85,8 +92,8 @@ namespace Fling
 			m_Extents.height,
 			/* Format */ m_Format,
 			/* Tiling */ VK_IMAGE_TILING_OPTIMAL,
-			/* Usage */ VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-			/* Props */ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			/* Usage */ VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | m_ExtraUsage,
+			/* Props */ m_MemoryProps,
 			m_Image,
 			m_Memory,
 			m_SampleCount
@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "DepthPrepass.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace Fling
+{
+	DepthPrepassSelector::DepthPrepassSelector(const DepthPrepassSettings& t_Settings)
+		: m_Settings(t_Settings)
+	{
+		m_Settings.SampleFrames = std::max(m_Settings.SampleFrames, 1u);
+		m_Settings.RetestFrames = std::max(m_Settings.RetestFrames, 1u);
+		m_Settings.Margin = std::min(std::max(m_Settings.Margin, 0.0f), 0.9f);
+
+		m_Enabled = m_Settings.Mode == DepthPrepassMode::On;
+
+		if (m_Settings.Mode == DepthPrepassMode::Auto)
+		{
+			// The first frames also pay for creating pipelines and uploading things, don't count those
+			m_Phase = Phase::MeasureCurrent;
+			m_SkipFrames = m_Settings.LatencyFrames;
+		}
+	}
+
+	bool DepthPrepassSelector::AddFrameCost(float t_Cost)
+	{
+		if (m_Settings.Mode != DepthPrepassMode::Auto)
+		{
+			return false;
+		}
+
+		if (m_Phase == Phase::Hold)
+		{
+			// Nothing changed, so every frame after this one is a fair sample
+			if (--m_HoldFrames == 0)
+			{
+				m_Phase = Phase::MeasureCurrent;
+			}
+			return false;
+		}
+
+		if (m_SkipFrames > 0)
+		{
+			--m_SkipFrames;
+			return false;
+		}
+
+		// Frames without a measurement don't say anything
+		float Average = 0.0f;
+		if (t_Cost <= 0.0f || !AddSample(t_Cost, Average))
+		{
+			return false;
+		}
+
+		if (m_Phase == Phase::MeasureCurrent)
+		{
+			m_CurrentCost = Average;
+			m_Phase = Phase::MeasureOther;
+			SetEnabled(!m_Enabled);
+			return true;
+		}
+
+		m_Phase = Phase::Hold;
+		m_HoldFrames = m_Settings.RetestFrames;
+
+		// Only keep the other choice if it is clearly cheaper, so noise doesn't flip it back and forth
+		if (Average < m_CurrentCost * (1.0f - m_Settings.Margin))
+		{
+			return false;
+		}
+
+		SetEnabled(!m_Enabled);
+		return true;
+	}
+
+	DepthPrepassMode DepthPrepassSelector::ParseMode(const std::string& t_Value)
+	{
+		std::string Value = t_Value;
+		std::transform(Value.begin(), Value.end(), Value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		if (Value == "on" || Value == "true" || Value == "1")
+		{
+			return DepthPrepassMode::On;
+		}
+
+		if (Value == "auto")
+		{
+			return DepthPrepassMode::Auto;
+		}
+
+		return DepthPrepassMode::Off;
+	}
+
+	bool DepthPrepassSelector::AddSample(float t_Cost, float& t_Average)
+	{
+		m_SampleSum += t_Cost;
+		if (++m_SampleCount < m_Settings.SampleFrames)
+		{
+			return false;
+		}
+
+		t_Average = m_SampleSum / static_cast<float>(m_SampleCount);
+		m_SampleSum = 0.0f;
+		m_SampleCount = 0;
+		return true;
+	}
+
+	void DepthPrepassSelector::SetEnabled(bool t_Enabled)
+	{
+		m_Enabled = t_Enabled;
+		m_SkipFrames = m_Settings.LatencyFrames;
+	}
+}   // namespace Fling
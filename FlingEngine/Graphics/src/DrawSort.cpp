@@ -0,0 +1,218 @@
+#include "pch.h"
+#include "DrawSort.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Fling
+{
+	uint64 DrawSortKey::Make(uint32 t_Pass, uint32 t_Pipeline, uint32 t_Material, uint32 t_Mesh, float t_Depth)
+	{
+		assert(t_Pass < (1u << PassBits) && t_Pipeline < (1u << PipelineBits));
+
+		// NaN fails both compares and ends up at the far plane
+		const float Depth = t_Depth >= 0.0f ? (t_Depth <= 1.0f ? t_Depth : 1.0f) : (t_Depth < 0.0f ? 0.0f : 1.0f);
+
+		// More buckets close to the camera, where what is in front covers the most
+		const uint32 MaxBucket = (1u << DepthBucketBits) - 1;
+		const uint32 MaxDepth = (1u << DepthBits) - 1;
+		const uint32 Bucket = static_cast<uint32>(std::sqrt(Depth) * static_cast<float>(MaxBucket) + 0.5f);
+		const uint32 Fine = static_cast<uint32>(Depth * static_cast<float>(MaxDepth) + 0.5f);
+
+		return
+			(static_cast<uint64>(t_Pass) << PassShift) |
+			(static_cast<uint64>(t_Pipeline) << PipelineShift) |
+			(static_cast<uint64>(Bucket) << DepthBucketShift) |
+			(static_cast<uint64>(FoldId(t_Material, MaterialBits)) << MaterialShift) |
+			(static_cast<uint64>(FoldId(t_Mesh, MeshBits)) << MeshShift) |
+			(static_cast<uint64>(Fine) << DepthShift);
+	}
+
+	uint32 DrawSortKey::FoldId(uint32 t_Id, uint32 t_Bits)
+	{
+		assert(t_Bits > 0 && t_Bits <= 32);
+		if (t_Bits == 32)
+		{
+			return t_Id;
+		}
+
+		uint32 Folded = 0;
+		for (uint32 Id = t_Id; Id != 0; Id >>= t_Bits)
+		{
+			Folded ^= Id;
+		}
+		return Folded & ((1u << t_Bits) - 1);
+	}
+
+	DrawSorter::DrawSorter(uint32 t_WorkerCount)
+	{
+		for (uint32 i = 0; i < t_WorkerCount; ++i)
+		{
+			m_Workers.emplace_back(&DrawSorter::WorkerLoop, this);
+		}
+	}
+
+	DrawSorter::~DrawSorter()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			m_ShuttingDown = true;
+		}
+		m_WorkAvailable.notify_all();
+
+		for (std::thread& Worker : m_Workers)
+		{
+			Worker.join();
+		}
+	}
+
+	void DrawSorter::Sort(const std::vector<uint64>& t_Keys, std::vector<uint32>& t_OutOrder)
+	{
+		m_ItemCount = static_cast<uint32>(t_Keys.size());
+		t_OutOrder.resize(m_ItemCount);
+		m_LastPassCount = 0;
+		if (m_ItemCount == 0)
+		{
+			return;
+		}
+
+		m_Items.resize(m_ItemCount);
+		m_Scratch.resize(m_ItemCount);
+
+		// Bits that are the same in every key don't change the order
+		uint64 Differs = 0;
+		for (uint32 i = 0; i < m_ItemCount; ++i)
+		{
+			m_Items[i] = { t_Keys[i], i };
+			Differs |= t_Keys[i] ^ t_Keys[0];
+		}
+
+		const uint32 ChunkCount = m_ItemCount >= MinParallelCount ? static_cast<uint32>(m_Workers.size()) + 1 : 1;
+		m_ChunkCount = ChunkCount;
+		m_Buckets.resize(static_cast<size_t>(ChunkCount) * BucketCount);
+
+		for (m_Shift = 0; m_Shift < 64; m_Shift += RadixBits)
+		{
+			if (((Differs >> m_Shift) & (BucketCount - 1)) == 0)
+			{
+				continue;
+			}
+			++m_LastPassCount;
+
+			RunPhase(SortPhase::Count);
+
+			// Every chunk writes its part of a bucket after the chunks before it, which keeps it stable
+			uint32 Offset = 0;
+			for (uint32 Bucket = 0; Bucket < BucketCount; ++Bucket)
+			{
+				for (uint32 Chunk = 0; Chunk < ChunkCount; ++Chunk)
+				{
+					uint32& Slot = m_Buckets[Chunk * BucketCount + Bucket];
+					const uint32 Count = Slot;
+					Slot = Offset;
+					Offset += Count;
+				}
+			}
+
+			RunPhase(SortPhase::Scatter);
+			m_Items.swap(m_Scratch);
+		}
+
+		for (uint32 i = 0; i < m_ItemCount; ++i)
+		{
+			t_OutOrder[i] = m_Items[i].Index;
+		}
+	}
+
+	void DrawSorter::RunPhase(SortPhase t_Phase)
+	{
+		m_Phase = t_Phase;
+
+		if (m_ChunkCount == 1)
+		{
+			t_Phase == SortPhase::Count ? CountChunk(0) : ScatterChunk(0);
+			return;
+		}
+
+		m_ChunksLeft = m_ChunkCount.load();
+		m_NextChunk = 0;
+
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			++m_Generation;
+		}
+		m_WorkAvailable.notify_all();
+
+		RunChunks();
+
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		m_WorkDone.wait(Lock, [this]() { return m_ChunksLeft == 0; });
+	}
+
+	void DrawSorter::RunChunks()
+	{
+		for (;;)
+		{
+			const uint32 Chunk = m_NextChunk.fetch_add(1);
+			if (Chunk >= m_ChunkCount)
+			{
+				return;
+			}
+
+			m_Phase == SortPhase::Count ? CountChunk(Chunk) : ScatterChunk(Chunk);
+
+			if (m_ChunksLeft.fetch_sub(1) == 1)
+			{
+				std::lock_guard<std::mutex> Lock(m_Mutex);
+				m_WorkDone.notify_all();
+			}
+		}
+	}
+
+	void DrawSorter::CountChunk(uint32 t_Chunk)
+	{
+		const uint32 ChunkCount = m_ChunkCount;
+		const uint32 Begin = static_cast<uint32>(static_cast<uint64>(m_ItemCount) * t_Chunk / ChunkCount);
+		const uint32 End = static_cast<uint32>(static_cast<uint64>(m_ItemCount) * (t_Chunk + 1) / ChunkCount);
+
+		uint32* Counts = m_Buckets.data() + static_cast<size_t>(t_Chunk) * BucketCount;
+		std::fill(Counts, Counts + BucketCount, 0);
+		for (uint32 i = Begin; i < End; ++i)
+		{
+			++Counts[(m_Items[i].Key >> m_Shift) & (BucketCount - 1)];
+		}
+	}
+
+	void DrawSorter::ScatterChunk(uint32 t_Chunk)
+	{
+		const uint32 ChunkCount = m_ChunkCount;
+		const uint32 Begin = static_cast<uint32>(static_cast<uint64>(m_ItemCount) * t_Chunk / ChunkCount);
+		const uint32 End = static_cast<uint32>(static_cast<uint64>(m_ItemCount) * (t_Chunk + 1) / ChunkCount);
+
+		uint32* Offsets = m_Buckets.data() + static_cast<size_t>(t_Chunk) * BucketCount;
+		for (uint32 i = Begin; i < End; ++i)
+		{
+			const SortItem& Item = m_Items[i];
+			m_Scratch[Offsets[(Item.Key >> m_Shift) & (BucketCount - 1)]++] = Item;
+		}
+	}
+
+	void DrawSorter::WorkerLoop()
+	{
+		uint64 SeenGeneration = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> Lock(m_Mutex);
+				m_WorkAvailable.wait(Lock, [&]() { return m_ShuttingDown || m_Generation != SeenGeneration; });
+				if (m_ShuttingDown)
+				{
+					return;
+				}
+				SeenGeneration = m_Generation;
+			}
+
+			RunChunks();
+		}
+	}
+}   // namespace Fling
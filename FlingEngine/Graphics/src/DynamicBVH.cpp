@@ -0,0 +1,567 @@
+#include "pch.h"
+#include "DynamicBVH.h"
+
+#include <algorithm>
+
+namespace Fling
+{
+	DynamicBVH::DynamicBVH(float t_Margin)
+		: m_Margin(t_Margin)
+	{
+	}
+
+	AABB DynamicBVH::MakeFat(const AABB& t_Box) const
+	{
+		// Grow by a fraction of the size, with a small minimum so that flat
+		// boxes (planes, quads) still get some room to move
+		const glm::vec3 Margin = glm::max((t_Box.Max - t_Box.Min) * m_Margin, glm::vec3(0.05f));
+
+		AABB Fat;
+		Fat.Min = t_Box.Min - Margin;
+		Fat.Max = t_Box.Max + Margin;
+		return Fat;
+	}
+
+	int32 DynamicBVH::AllocateNode()
+	{
+		int32 NodeId = m_FreeList;
+		if (NodeId == NullNode)
+		{
+			NodeId = static_cast<int32>(m_Nodes.size());
+			m_Nodes.emplace_back();
+		}
+		else
+		{
+			m_FreeList = m_Nodes[NodeId].Next;
+		}
+
+		Node& NewNode = m_Nodes[NodeId];
+		NewNode.Parent = NullNode;
+		NewNode.Child1 = NullNode;
+		NewNode.Child2 = NullNode;
+		NewNode.Height = 0;
+		NewNode.UserData = 0;
+		return NodeId;
+	}
+
+	void DynamicBVH::FreeNode(int32 t_Node)
+	{
+		assert(0 <= t_Node && t_Node < static_cast<int32>(m_Nodes.size()));
+		m_Nodes[t_Node].Next = m_FreeList;
+		m_Nodes[t_Node].Height = -1;
+		m_FreeList = t_Node;
+	}
+
+	int32 DynamicBVH::CreateProxy(const AABB& t_Box, uint32 t_UserData)
+	{
+		int32 ProxyId = AllocateNode();
+		m_Nodes[ProxyId].Box = MakeFat(t_Box);
+		m_Nodes[ProxyId].UserData = t_UserData;
+
+		InsertLeaf(ProxyId);
+		++m_ProxyCount;
+		++m_ReinsertsSinceRebuild;
+		return ProxyId;
+	}
+
+	void DynamicBVH::DestroyProxy(int32 t_ProxyId)
+	{
+		assert(m_Nodes[t_ProxyId].IsLeaf());
+
+		RemoveLeaf(t_ProxyId);
+		FreeNode(t_ProxyId);
+		--m_ProxyCount;
+	}
+
+	bool DynamicBVH::MoveProxy(int32 t_ProxyId, const AABB& t_Box)
+	{
+		assert(m_Nodes[t_ProxyId].IsLeaf());
+
+		if (m_Nodes[t_ProxyId].Box.Contains(t_Box))
+		{
+			return false;
+		}
+
+		RemoveLeaf(t_ProxyId);
+		m_Nodes[t_ProxyId].Box = MakeFat(t_Box);
+		InsertLeaf(t_ProxyId);
+
+		++m_ReinsertsSinceRebuild;
+		return true;
+	}
+
+	void DynamicBVH::Clear()
+	{
+		m_Nodes.clear();
+		m_Root = NullNode;
+		m_FreeList = NullNode;
+		m_ProxyCount = 0;
+		m_ReinsertsSinceRebuild = 0;
+	}
+
+	void DynamicBVH::InsertLeaf(int32 t_Leaf)
+	{
+		if (m_Root == NullNode)
+		{
+			m_Root = t_Leaf;
+			m_Nodes[m_Root].Parent = NullNode;
+			return;
+		}
+
+		// Find the best sibling for this leaf by walking down the tree, picking the
+		// child that increases the total surface area the least
+		const AABB LeafBox = m_Nodes[t_Leaf].Box;
+		int32 Index = m_Root;
+		while (!m_Nodes[Index].IsLeaf())
+		{
+			const Node& Cur = m_Nodes[Index];
+			const int32 Child1 = Cur.Child1;
+			const int32 Child2 = Cur.Child2;
+
+			const float Area = Cur.Box.GetSurfaceArea();
+			const float CombinedArea = AABB::Merge(Cur.Box, LeafBox).GetSurfaceArea();
+
+			// Cost of creating a new parent for this node and the new leaf
+			const float Cost = 2.0f * CombinedArea;
+
+			// Minimum cost of pushing the leaf further down the tree
+			const float InheritanceCost = 2.0f * (CombinedArea - Area);
+
+			auto DescendCost = [&](int32 t_Child)
+			{
+				const AABB& ChildBox = m_Nodes[t_Child].Box;
+				const float NewArea = AABB::Merge(LeafBox, ChildBox).GetSurfaceArea();
+				if (m_Nodes[t_Child].IsLeaf())
+				{
+					return NewArea + InheritanceCost;
+				}
+				return (NewArea - ChildBox.GetSurfaceArea()) + InheritanceCost;
+			};
+
+			const float Cost1 = DescendCost(Child1);
+			const float Cost2 = DescendCost(Child2);
+
+			if (Cost < Cost1 && Cost < Cost2)
+			{
+				break;
+			}
+
+			Index = Cost1 < Cost2 ? Child1 : Child2;
+		}
+
+		const int32 Sibling = Index;
+
+		// Create a new parent for the sibling and the leaf
+		const int32 OldParent = m_Nodes[Sibling].Parent;
+		const int32 NewParent = AllocateNode();
+		m_Nodes[NewParent].Parent = OldParent;
+		m_Nodes[NewParent].Box = AABB::Merge(LeafBox, m_Nodes[Sibling].Box);
+		m_Nodes[NewParent].Height = m_Nodes[Sibling].Height + 1;
+
+		if (OldParent != NullNode)
+		{
+			if (m_Nodes[OldParent].Child1 == Sibling)
+			{
+				m_Nodes[OldParent].Child1 = NewParent;
+			}
+			else
+			{
+				m_Nodes[OldParent].Child2 = NewParent;
+			}
+		}
+		else
+		{
+			m_Root = NewParent;
+		}
+
+		m_Nodes[NewParent].Child1 = Sibling;
+		m_Nodes[NewParent].Child2 = t_Leaf;
+		m_Nodes[Sibling].Parent = NewParent;
+		m_Nodes[t_Leaf].Parent = NewParent;
+
+		RefitAncestors(m_Nodes[t_Leaf].Parent);
+	}
+
+	void DynamicBVH::RemoveLeaf(int32 t_Leaf)
+	{
+		if (t_Leaf == m_Root)
+		{
+			m_Root = NullNode;
+			return;
+		}
+
+		const int32 Parent = m_Nodes[t_Leaf].Parent;
+		const int32 GrandParent = m_Nodes[Parent].Parent;
+		const int32 Sibling = m_Nodes[Parent].Child1 == t_Leaf ? m_Nodes[Parent].Child2 : m_Nodes[Parent].Child1;
+
+		if (GrandParent != NullNode)
+		{
+			// Destroy the parent and connect the sibling to the grand parent
+			if (m_Nodes[GrandParent].Child1 == Parent)
+			{
+				m_Nodes[GrandParent].Child1 = Sibling;
+			}
+			else
+			{
+				m_Nodes[GrandParent].Child2 = Sibling;
+			}
+			m_Nodes[Sibling].Parent = GrandParent;
+			FreeNode(Parent);
+
+			RefitAncestors(GrandParent);
+		}
+		else
+		{
+			m_Root = Sibling;
+			m_Nodes[Sibling].Parent = NullNode;
+			FreeNode(Parent);
+		}
+	}
+
+	void DynamicBVH::RefitAncestors(int32 t_Node)
+	{
+		int32 Index = t_Node;
+		while (Index != NullNode)
+		{
+			Index = Balance(Index);
+
+			Node& Cur = m_Nodes[Index];
+			const Node& Child1 = m_Nodes[Cur.Child1];
+			const Node& Child2 = m_Nodes[Cur.Child2];
+
+			Cur.Height = 1 + glm::max(Child1.Height, Child2.Height);
+			Cur.Box = AABB::Merge(Child1.Box, Child2.Box);
+
+			Index = Cur.Parent;
+		}
+	}
+
+	int32 DynamicBVH::Balance(int32 t_A)
+	{
+		// A has children B and C. If one side is more than one level taller than
+		// the other then rotate it up to be the new root of this subtree
+		Node& A = m_Nodes[t_A];
+		if (A.IsLeaf() || A.Height < 2)
+		{
+			return t_A;
+		}
+
+		const int32 iB = A.Child1;
+		const int32 iC = A.Child2;
+		Node& B = m_Nodes[iB];
+		Node& C = m_Nodes[iC];
+
+		const int32 BalanceFactor = C.Height - B.Height;
+
+		// Rotate C up
+		if (BalanceFactor > 1)
+		{
+			const int32 iF = C.Child1;
+			const int32 iG = C.Child2;
+			Node& F = m_Nodes[iF];
+			Node& G = m_Nodes[iG];
+
+			// Swap A and C
+			C.Child1 = t_A;
+			C.Parent = A.Parent;
+			A.Parent = iC;
+
+			// A's old parent should point to C
+			if (C.Parent != NullNode)
+			{
+				if (m_Nodes[C.Parent].Child1 == t_A)
+				{
+					m_Nodes[C.Parent].Child1 = iC;
+				}
+				else
+				{
+					m_Nodes[C.Parent].Child2 = iC;
+				}
+			}
+			else
+			{
+				m_Root = iC;
+			}
+
+			// Keep the taller of F and G under C
+			if (F.Height > G.Height)
+			{
+				C.Child2 = iF;
+				A.Child2 = iG;
+				G.Parent = t_A;
+				A.Box = AABB::Merge(B.Box, G.Box);
+				C.Box = AABB::Merge(A.Box, F.Box);
+
+				A.Height = 1 + glm::max(B.Height, G.Height);
+				C.Height = 1 + glm::max(A.Height, F.Height);
+			}
+			else
+			{
+				C.Child2 = iG;
+				A.Child2 = iF;
+				F.Parent = t_A;
+				A.Box = AABB::Merge(B.Box, F.Box);
+				C.Box = AABB::Merge(A.Box, G.Box);
+
+				A.Height = 1 + glm::max(B.Height, F.Height);
+				C.Height = 1 + glm::max(A.Height, G.Height);
+			}
+
+			return iC;
+		}
+
+		// Rotate B up
+		if (BalanceFactor < -1)
+		{
+			const int32 iD = B.Child1;
+			const int32 iE = B.Child2;
+			Node& D = m_Nodes[iD];
+			Node& E = m_Nodes[iE];
+
+			// Swap A and B
+			B.Child1 = t_A;
+			B.Parent = A.Parent;
+			A.Parent = iB;
+
+			// A's old parent should point to B
+			if (B.Parent != NullNode)
+			{
+				if (m_Nodes[B.Parent].Child1 == t_A)
+				{
+					m_Nodes[B.Parent].Child1 = iB;
+				}
+				else
+				{
+					m_Nodes[B.Parent].Child2 = iB;
+				}
+			}
+			else
+			{
+				m_Root = iB;
+			}
+
+			// Keep the taller of D and E under B
+			if (D.Height > E.Height)
+			{
+				B.Child2 = iD;
+				A.Child1 = iE;
+				E.Parent = t_A;
+				A.Box = AABB::Merge(C.Box, E.Box);
+				B.Box = AABB::Merge(A.Box, D.Box);
+
+				A.Height = 1 + glm::max(C.Height, E.Height);
+				B.Height = 1 + glm::max(A.Height, D.Height);
+			}
+			else
+			{
+				B.Child2 = iE;
+				A.Child1 = iD;
+				D.Parent = t_A;
+				A.Box = AABB::Merge(C.Box, D.Box);
+				B.Box = AABB::Merge(A.Box, E.Box);
+
+				A.Height = 1 + glm::max(C.Height, D.Height);
+				B.Height = 1 + glm::max(A.Height, E.Height);
+			}
+
+			return iB;
+		}
+
+		return t_A;
+	}
+
+	void DynamicBVH::Rebuild()
+	{
+		m_ReinsertsSinceRebuild = 0;
+		if (m_ProxyCount < 2)
+		{
+			return;
+		}
+
+		// Collect the leaves and free every internal node. Leaves keep their index
+		// so that proxy IDs stay valid
+		std::vector<int32> Leaves;
+		Leaves.reserve(m_ProxyCount);
+		for (int32 i = 0; i < static_cast<int32>(m_Nodes.size()); ++i)
+		{
+			Node& Cur = m_Nodes[i];
+			if (Cur.Height < 0)
+			{
+				continue;
+			}
+
+			if (Cur.IsLeaf())
+			{
+				Cur.Parent = NullNode;
+				Leaves.push_back(i);
+			}
+			else
+			{
+				FreeNode(i);
+			}
+		}
+
+		m_Root = BuildTopDown(Leaves.data(), static_cast<int32>(Leaves.size()));
+		m_Nodes[m_Root].Parent = NullNode;
+	}
+
+	int32 DynamicBVH::BuildTopDown(int32* t_Leaves, int32 t_Count)
+	{
+		if (t_Count == 1)
+		{
+			return t_Leaves[0];
+		}
+
+		// Split on the median of the longest axis of the centroids
+		AABB CentroidBounds;
+		for (int32 i = 0; i < t_Count; ++i)
+		{
+			CentroidBounds.Expand(m_Nodes[t_Leaves[i]].Box.GetCenter());
+		}
+
+		const glm::vec3 Size = CentroidBounds.Max - CentroidBounds.Min;
+		int32 Axis = 0;
+		if (Size.y > Size.x) { Axis = 1; }
+		if (Size.z > Size[Axis]) { Axis = 2; }
+
+		const int32 Mid = t_Count / 2;
+		std::nth_element(t_Leaves, t_Leaves + Mid, t_Leaves + t_Count, [&](int32 t_A, int32 t_B)
+		{
+			return m_Nodes[t_A].Box.GetCenter()[Axis] < m_Nodes[t_B].Box.GetCenter()[Axis];
+		});
+
+		const int32 Child1 = BuildTopDown(t_Leaves, Mid);
+		const int32 Child2 = BuildTopDown(t_Leaves + Mid, t_Count - Mid);
+
+		// m_Nodes may have grown, so don't hold on to any references until here
+		const int32 Parent = AllocateNode();
+		Node& ParentNode = m_Nodes[Parent];
+		ParentNode.Child1 = Child1;
+		ParentNode.Child2 = Child2;
+		ParentNode.Box = AABB::Merge(m_Nodes[Child1].Box, m_Nodes[Child2].Box);
+		ParentNode.Height = 1 + glm::max(m_Nodes[Child1].Height, m_Nodes[Child2].Height);
+
+		m_Nodes[Child1].Parent = Parent;
+		m_Nodes[Child2].Parent = Parent;
+
+		return Parent;
+	}
+
+	void DynamicBVH::GatherLeaves(int32 t_Node, std::vector<uint32>& t_Out) const
+	{
+		m_GatherStack.clear();
+		m_GatherStack.push_back(t_Node);
+		while (!m_GatherStack.empty())
+		{
+			const Node& Cur = m_Nodes[m_GatherStack.back()];
+			m_GatherStack.pop_back();
+
+			if (Cur.IsLeaf())
+			{
+				t_Out.push_back(Cur.UserData);
+			}
+			else
+			{
+				m_GatherStack.push_back(Cur.Child1);
+				m_GatherStack.push_back(Cur.Child2);
+			}
+		}
+	}
+
+	void DynamicBVH::QueryFrustum(const Frustum& t_Frustum, std::vector<uint32>& t_OutInside, std::vector<uint32>& t_OutIntersecting) const
+	{
+		t_OutInside.clear();
+		t_OutIntersecting.clear();
+		if (m_Root == NullNode)
+		{
+			return;
+		}
+
+		m_Stack.clear();
+		m_Stack.push_back(m_Root);
+		while (!m_Stack.empty())
+		{
+			const int32 Index = m_Stack.back();
+			m_Stack.pop_back();
+
+			const Node& Cur = m_Nodes[Index];
+			switch (t_Frustum.Classify(Cur.Box))
+			{
+			case Containment::Outside:
+				break;
+			case Containment::Inside:
+				// Everything under here is visible, no need to test any more planes
+				GatherLeaves(Index, t_OutInside);
+				break;
+			case Containment::Intersecting:
+				if (Cur.IsLeaf())
+				{
+					t_OutIntersecting.push_back(Cur.UserData);
+				}
+				else
+				{
+					m_Stack.push_back(Cur.Child1);
+					m_Stack.push_back(Cur.Child2);
+				}
+				break;
+			}
+		}
+	}
+
+	void DynamicBVH::QueryAABB(const AABB& t_Box, std::vector<uint32>& t_OutUserData) const
+	{
+		t_OutUserData.clear();
+		if (m_Root == NullNode)
+		{
+			return;
+		}
+
+		m_Stack.clear();
+		m_Stack.push_back(m_Root);
+		while (!m_Stack.empty())
+		{
+			const Node& Cur = m_Nodes[m_Stack.back()];
+			m_Stack.pop_back();
+
+			if (!Cur.Box.Overlaps(t_Box))
+			{
+				continue;
+			}
+
+			if (Cur.IsLeaf())
+			{
+				t_OutUserData.push_back(Cur.UserData);
+			}
+			else
+			{
+				m_Stack.push_back(Cur.Child1);
+				m_Stack.push_back(Cur.Child2);
+			}
+		}
+	}
+
+	int32 DynamicBVH::GetHeight() const
+	{
+		return m_Root == NullNode ? 0 : m_Nodes[m_Root].Height;
+	}
+
+	float DynamicBVH::GetAreaRatio() const
+	{
+		if (m_Root == NullNode)
+		{
+			return 0.0f;
+		}
+
+		const float RootArea = m_Nodes[m_Root].Box.GetSurfaceArea();
+		float TotalArea = 0.0f;
+		for (const Node& Cur : m_Nodes)
+		{
+			if (Cur.Height > 0)
+			{
+				TotalArea += Cur.Box.GetSurfaceArea();
+			}
+		}
+
+		return RootArea > 0.0f ? TotalArea / RootArea : 0.0f;
+	}
+}   // namespace Fling
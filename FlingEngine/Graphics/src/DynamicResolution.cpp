@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Fling
+{
+	DynamicResolution::DynamicResolution(const DynamicResolutionSettings& t_Settings)
+		: m_Settings(t_Settings)
+	{
+		m_Settings.MinScale = std::max(m_Settings.MinScale, 0.1f);
+		m_Settings.MaxScale = std::max(m_Settings.MaxScale, m_Settings.MinScale);
+		m_Settings.Headroom = std::min(std::max(m_Settings.Headroom, 0.0f), 0.9f);
+		m_Settings.SampleFrames = std::max(m_Settings.SampleFrames, 1u);
+
+		// Start sharp and only drop if the GPU can't keep up
+		m_Scale = m_Settings.MaxScale;
+	}
+
+	bool DynamicResolution::AddFrameTime(float t_Milliseconds)
+	{
+		if (m_SkipFrames > 0)
+		{
+			--m_SkipFrames;
+			return false;
+		}
+
+		m_SampleSum += t_Milliseconds;
+		if (++m_SampleCount < m_Settings.SampleFrames)
+		{
+			return false;
+		}
+
+		const float Average = m_SampleSum / static_cast<float>(m_SampleCount);
+		m_SampleSum = 0.0f;
+		m_SampleCount = 0;
+
+		const float Target = m_Settings.TargetMilliseconds;
+		if (Average <= 0.0f || (Average <= Target && Average >= Target * (1.0f - m_Settings.Headroom)))
+		{
+			return false;
+		}
+
+		// Aim for the middle of the band between the target and the headroom so that
+		// the next frames don't land right on one of its edges
+		const float Goal = Target * (1.0f - 0.5f * m_Settings.Headroom);
+		float NewScale = m_Scale * std::sqrt(Goal / Average);
+		NewScale = std::min(std::max(NewScale, m_Scale - m_Settings.MaxStep), m_Scale + m_Settings.MaxStep);
+		NewScale = std::min(std::max(NewScale, m_Settings.MinScale), m_Settings.MaxScale);
+
+		// Not worth throwing away the frames in flight over
+		if (std::abs(NewScale - m_Scale) < 0.01f)
+		{
+			return false;
+		}
+
+		m_Scale = NewScale;
+		m_SkipFrames = m_Settings.LatencyFrames;
+		return true;
+	}
+
+	VkExtent2D DynamicResolution::GetAllocatedExtent(VkExtent2D t_Output) const
+	{
+		return Scale(t_Output, m_Settings.MaxScale);
+	}
+
+	VkExtent2D DynamicResolution::GetRenderExtent(VkExtent2D t_Output) const
+	{
+		const VkExtent2D Allocated = GetAllocatedExtent(t_Output);
+		const VkExtent2D Render = Scale(t_Output, m_Scale);
+
+		VkExtent2D Result = {};
+		Result.width = std::min(Render.width, Allocated.width);
+		Result.height = std::min(Render.height, Allocated.height);
+		return Result;
+	}
+
+	VkExtent2D DynamicResolution::Scale(VkExtent2D t_Extent, float t_Scale)
+	{
+		VkExtent2D Result = {};
+		Result.width = std::max(static_cast<uint32>(std::ceil(static_cast<float>(t_Extent.width) * t_Scale)), 1u);
+		Result.height = std::max(static_cast<uint32>(std::ceil(static_cast<float>(t_Extent.height) * t_Scale)), 1u);
+		return Result;
+	}
+}   // namespace Fling
@@ -0,0 +1,238 @@
+#include "pch.h"
+#include "FrameCapture.h"
+#include "Buffer.h"
+#include "CommandBuffer.h"
+#include "LogicalDevice.h"
+#include "FlingConfig.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+namespace Fling
+{
+	FrameCapture::FrameCapture(const LogicalDevice* t_Dev, VkExtent2D t_Extent, VkFormat t_Format)
+		: m_Device(t_Dev)
+		, m_Extent(t_Extent)
+	{
+		assert(m_Device);
+		assert(t_Format == VK_FORMAT_R8G8B8A8_UNORM || t_Format == VK_FORMAT_R8G8B8A8_SRGB);
+
+		m_ImageSize = static_cast<VkDeviceSize>(m_Extent.width) * m_Extent.height * 4;
+
+		// Comma separated list of frame numbers, starting at 0
+		std::stringstream FrameList(FlingConfig::GetString("Headless", "CaptureFrames", ""));
+		std::string Frame;
+		while (std::getline(FrameList, Frame, ','))
+		{
+			char* End = nullptr;
+			unsigned long Val = strtoul(Frame.c_str(), &End, 10);
+			if (End != Frame.c_str())
+			{
+				m_Frames.insert(static_cast<uint32>(Val));
+			}
+		}
+
+		int Interval = FlingConfig::GetInt("Headless", "CaptureInterval", 0);
+		m_Interval = Interval > 0 ? static_cast<uint32>(Interval) : 0;
+
+		std::string Format = FlingConfig::GetString("Headless", "CaptureFormat", "png");
+		std::transform(Format.begin(), Format.end(), Format.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (Format == "raw")
+		{
+			m_FileFormat = FileFormat::Raw;
+		}
+		else if (Format != "png")
+		{
+			F_LOG_WARN("Unknown capture format {}, writing PNGs instead", Format);
+		}
+
+		m_Directory = FlingConfig::GetString("Headless", "CaptureDir", FlingPaths::BinaryDir() + "/Captures");
+		if (IsEnabled() && !FlingPaths::DirExists(m_Directory.c_str()) && FlingPaths::MakeDir(m_Directory.c_str()) != 0)
+		{
+			F_LOG_ERROR("Failed to create the capture directory {}", m_Directory);
+		}
+
+		// Only pay for the staging memory if something is going to be captured
+		if (IsEnabled())
+		{
+			for (Readback& Read : m_Readbacks)
+			{
+				Read.Staging = new Buffer(m_ImageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+				Read.Staging->MapMemory(m_ImageSize);
+			}
+		}
+	}
+
+	FrameCapture::~FrameCapture()
+	{
+		// The device is idle by now, so anything that was recorded has landed
+		for (uint32 i = 0; i < static_cast<uint32>(m_Readbacks.size()); ++i)
+		{
+			Resolve(i);
+		}
+
+		CollectFinishedWrites(true);
+
+		for (Readback& Read : m_Readbacks)
+		{
+			if (Read.Staging)
+			{
+				delete Read.Staging;
+				Read.Staging = nullptr;
+			}
+		}
+
+		if (IsEnabled())
+		{
+			F_LOG_TRACE("Wrote {} frame captures to {}", m_WrittenCount, m_Directory);
+		}
+	}
+
+	bool FrameCapture::ShouldCapture(uint32 t_Frame) const
+	{
+		return (m_Interval > 0 && t_Frame % m_Interval == 0) || m_Frames.count(t_Frame) > 0;
+	}
+
+	void FrameCapture::Record(CommandBuffer& t_CmdBuf, uint32 t_FrameInFlight, VkImage t_Image)
+	{
+		const uint32 Frame = m_FrameCount++;
+		if (!ShouldCapture(Frame))
+		{
+			return;
+		}
+
+		Readback& Read = m_Readbacks[t_FrameInFlight];
+		assert(Read.Staging && !Read.Pending);
+
+		VkCommandBuffer Cmd = t_CmdBuf.GetHandle();
+
+		// The render pass already left the image in the transfer layout, only wait for the writes to it.
+		// Its transition is part of the implicit dependency to the bottom of the pipe, so chain on to that
+		VkImageMemoryBarrier ImageBarrier = {};
+		ImageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		ImageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		ImageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		ImageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		ImageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		ImageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		ImageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		ImageBarrier.image = t_Image;
+		ImageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		vkCmdPipelineBarrier(
+			Cmd,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &ImageBarrier);
+
+		VkBufferImageCopy Region = {};
+		Region.bufferOffset = 0;
+		// Tightly packed
+		Region.bufferRowLength = 0;
+		Region.bufferImageHeight = 0;
+		Region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		Region.imageOffset = { 0, 0, 0 };
+		Region.imageExtent = { m_Extent.width, m_Extent.height, 1 };
+
+		vkCmdCopyImageToBuffer(Cmd, t_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, Read.Staging->GetVkBuffer(), 1, &Region);
+
+		// Make the copy visible to the host once the fence is signaled
+		VkBufferMemoryBarrier BufferBarrier = {};
+		BufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		BufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		BufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		BufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		BufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		BufferBarrier.buffer = Read.Staging->GetVkBuffer();
+		BufferBarrier.offset = 0;
+		BufferBarrier.size = m_ImageSize;
+
+		vkCmdPipelineBarrier(
+			Cmd,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT,
+			0,
+			0, nullptr,
+			1, &BufferBarrier,
+			0, nullptr);
+
+		Read.Frame = Frame;
+		Read.Pending = true;
+	}
+
+	void FrameCapture::Resolve(uint32 t_FrameInFlight)
+	{
+		CollectFinishedWrites(false);
+
+		Readback& Read = m_Readbacks[t_FrameInFlight];
+		if (!Read.Pending)
+		{
+			return;
+		}
+		Read.Pending = false;
+
+		// Copy out of the staging buffer so that it can be reused by the next frame right away
+		const uint8* Mapped = static_cast<const uint8*>(Read.Staging->m_MappedMem);
+		std::vector<uint8> Pixels(Mapped, Mapped + m_ImageSize);
+
+		char Name[64];
+		if (m_FileFormat == FileFormat::Raw)
+		{
+			snprintf(Name, sizeof(Name), "/Frame_%05u_%ux%u.rgba", Read.Frame, m_Extent.width, m_Extent.height);
+		}
+		else
+		{
+			snprintf(Name, sizeof(Name), "/Frame_%05u.png", Read.Frame);
+		}
+
+		m_Writes.emplace_back(std::async(std::launch::async, &FrameCapture::WriteFile, m_Directory + Name, m_FileFormat, m_Extent, std::move(Pixels)));
+	}
+
+	bool FrameCapture::WriteFile(std::string t_Path, FileFormat t_Format, VkExtent2D t_Extent, std::vector<uint8> t_Pixels)
+	{
+		if (t_Format == FileFormat::Png)
+		{
+			const int Stride = static_cast<int>(t_Extent.width) * 4;
+			return stbi_write_png(t_Path.c_str(), static_cast<int>(t_Extent.width), static_cast<int>(t_Extent.height), 4, t_Pixels.data(), Stride) != 0;
+		}
+
+		FILE* File = fopen(t_Path.c_str(), "wb");
+		if (!File)
+		{
+			return false;
+		}
+
+		const size_t Written = fwrite(t_Pixels.data(), 1, t_Pixels.size(), File);
+		fclose(File);
+		return Written == t_Pixels.size();
+	}
+
+	void FrameCapture::CollectFinishedWrites(bool t_Wait)
+	{
+		for (auto It = m_Writes.begin(); It != m_Writes.end();)
+		{
+			if (!t_Wait && It->wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				++It;
+				continue;
+			}
+
+			if (It->get())
+			{
+				++m_WrittenCount;
+			}
+			else
+			{
+				F_LOG_ERROR("Failed to write a frame capture to {}", m_Directory);
+			}
+			It = m_Writes.erase(It);
+		}
+	}
+}   // namespace Fling
@@ -0,0 +1,185 @@
+#include "pch.h"
+#include "Frustum.h"
+
+namespace Fling
+{
+	void Frustum::Update(const glm::mat4& t_ViewProj)
+	{
+		// Gribb/Hartmann plane extraction. GLM is column major so grab the rows by hand
+		glm::vec4 Rows[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			Rows[i] = glm::vec4(t_ViewProj[0][i], t_ViewProj[1][i], t_ViewProj[2][i], t_ViewProj[3][i]);
+		}
+
+		m_Planes[Left] = Rows[3] + Rows[0];
+		m_Planes[Right] = Rows[3] - Rows[0];
+		m_Planes[Bottom] = Rows[3] + Rows[1];
+		m_Planes[Top] = Rows[3] - Rows[1];
+		// Depth is 0 to 1, so the near plane is just the z row
+		m_Planes[Near] = Rows[2];
+		m_Planes[Far] = Rows[3] - Rows[2];
+
+		for (glm::vec4& CurPlane : m_Planes)
+		{
+			CurPlane /= glm::length(glm::vec3(CurPlane));
+		}
+	}
+
+	bool Frustum::IntersectsSphere(const glm::vec3& t_Center, float t_Radius) const
+	{
+		for (const glm::vec4& CurPlane : m_Planes)
+		{
+			if (glm::dot(glm::vec3(CurPlane), t_Center) + CurPlane.w < -t_Radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Frustum::IntersectsBox(const glm::vec3& t_Center, const glm::vec3& t_Extents) const
+	{
+		for (const glm::vec4& CurPlane : m_Planes)
+		{
+			const glm::vec3 Normal = glm::vec3(CurPlane);
+			const float Dist = glm::dot(Normal, t_Center) + CurPlane.w;
+			// Projected radius of the box onto the plane normal
+			const float Radius = glm::dot(glm::abs(Normal), t_Extents);
+			if (Dist + Radius < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	Containment Frustum::Classify(const AABB& t_Box) const
+	{
+		const glm::vec3 Center = t_Box.GetCenter();
+		const glm::vec3 Extents = t_Box.GetExtents();
+
+		Containment Result = Containment::Inside;
+		for (const glm::vec4& CurPlane : m_Planes)
+		{
+			const glm::vec3 Normal = glm::vec3(CurPlane);
+			const float Dist = glm::dot(Normal, Center) + CurPlane.w;
+			const float Radius = glm::dot(glm::abs(Normal), Extents);
+			if (Dist + Radius < 0.0f)
+			{
+				return Containment::Outside;
+			}
+			else if (Dist - Radius < 0.0f)
+			{
+				Result = Containment::Intersecting;
+			}
+		}
+		return Result;
+	}
+
+	void FrustumCuller::Reset()
+	{
+		m_CenterX.clear();
+		m_CenterY.clear();
+		m_CenterZ.clear();
+		m_ExtentX.clear();
+		m_ExtentY.clear();
+		m_ExtentZ.clear();
+	}
+
+	void FrustumCuller::Reserve(size_t t_Count)
+	{
+		m_CenterX.reserve(t_Count);
+		m_CenterY.reserve(t_Count);
+		m_CenterZ.reserve(t_Count);
+		m_ExtentX.reserve(t_Count);
+		m_ExtentY.reserve(t_Count);
+		m_ExtentZ.reserve(t_Count);
+	}
+
+	uint32 FrustumCuller::Add(const AABB& t_WorldBox)
+	{
+		const glm::vec3 Center = t_WorldBox.GetCenter();
+		const glm::vec3 Extents = t_WorldBox.GetExtents();
+
+		m_CenterX.push_back(Center.x);
+		m_CenterY.push_back(Center.y);
+		m_CenterZ.push_back(Center.z);
+		m_ExtentX.push_back(Extents.x);
+		m_ExtentY.push_back(Extents.y);
+		m_ExtentZ.push_back(Extents.z);
+
+		return GetCount() - 1;
+	}
+
+	uint32 FrustumCuller::Cull(const Frustum& t_Frustum, std::vector<uint32>& t_OutVisible) const
+	{
+		t_OutVisible.clear();
+
+		const uint32 Count = GetCount();
+		uint32 i = 0;
+
+#if FLING_SIMD_SSE
+		// Splat each plane once up front
+		__m128 PlaneX[Frustum::Count], PlaneY[Frustum::Count], PlaneZ[Frustum::Count], PlaneW[Frustum::Count];
+		__m128 AbsX[Frustum::Count], AbsY[Frustum::Count], AbsZ[Frustum::Count];
+		for (uint32 p = 0; p < Frustum::Count; ++p)
+		{
+			const glm::vec4& CurPlane = t_Frustum.m_Planes[p];
+			PlaneX[p] = _mm_set1_ps(CurPlane.x);
+			PlaneY[p] = _mm_set1_ps(CurPlane.y);
+			PlaneZ[p] = _mm_set1_ps(CurPlane.z);
+			PlaneW[p] = _mm_set1_ps(CurPlane.w);
+			AbsX[p] = _mm_set1_ps(glm::abs(CurPlane.x));
+			AbsY[p] = _mm_set1_ps(glm::abs(CurPlane.y));
+			AbsZ[p] = _mm_set1_ps(glm::abs(CurPlane.z));
+		}
+
+		const __m128 Zero = _mm_setzero_ps();
+
+		for (; i + 4 <= Count; i += 4)
+		{
+			const __m128 Cx = _mm_loadu_ps(&m_CenterX[i]);
+			const __m128 Cy = _mm_loadu_ps(&m_CenterY[i]);
+			const __m128 Cz = _mm_loadu_ps(&m_CenterZ[i]);
+			const __m128 Ex = _mm_loadu_ps(&m_ExtentX[i]);
+			const __m128 Ey = _mm_loadu_ps(&m_ExtentY[i]);
+			const __m128 Ez = _mm_loadu_ps(&m_ExtentZ[i]);
+
+			__m128 Inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (uint32 p = 0; p < Frustum::Count; ++p)
+			{
+				__m128 Dist = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(Cx, PlaneX[p]), _mm_mul_ps(Cy, PlaneY[p])),
+					_mm_add_ps(_mm_mul_ps(Cz, PlaneZ[p]), PlaneW[p]));
+
+				__m128 Radius = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(Ex, AbsX[p]), _mm_mul_ps(Ey, AbsY[p])),
+					_mm_mul_ps(Ez, AbsZ[p]));
+
+				Inside = _mm_and_ps(Inside, _mm_cmpge_ps(_mm_add_ps(Dist, Radius), Zero));
+			}
+
+			uint32 Mask = static_cast<uint32>(_mm_movemask_ps(Inside));
+			while (Mask)
+			{
+				t_OutVisible.push_back(i + trailing_zeroes(Mask));
+				Mask &= Mask - 1;
+			}
+		}
+#endif	// FLING_SIMD_SSE
+
+		// Whatever is left over that doesn't fill a full SIMD lane
+		for (; i < Count; ++i)
+		{
+			const glm::vec3 Center(m_CenterX[i], m_CenterY[i], m_CenterZ[i]);
+			const glm::vec3 Extents(m_ExtentX[i], m_ExtentY[i], m_ExtentZ[i]);
+			if (t_Frustum.IntersectsBox(Center, Extents))
+			{
+				t_OutVisible.push_back(i);
+			}
+		}
+
+		return static_cast<uint32>(t_OutVisible.size());
+	}
+}   // namespace Fling
@@ -0,0 +1,41 @@
+#include "pch.h"
+#include "GBufferPacking.h"
+
+namespace Fling
+{
+	namespace GBufferPacking
+	{
+		glm::vec2 SignNotZero(const glm::vec2& t_Value)
+		{
+			return glm::vec2(t_Value.x >= 0.0f ? 1.0f : -1.0f, t_Value.y >= 0.0f ? 1.0f : -1.0f);
+		}
+
+		glm::vec2 EncodeNormal(const glm::vec3& t_Normal)
+		{
+			const glm::vec3 N = t_Normal / (glm::abs(t_Normal.x) + glm::abs(t_Normal.y) + glm::abs(t_Normal.z));
+			if (N.z >= 0.0f)
+			{
+				return glm::vec2(N.x, N.y);
+			}
+			return (1.0f - glm::abs(glm::vec2(N.y, N.x))) * SignNotZero(glm::vec2(N.x, N.y));
+		}
+
+		glm::vec3 DecodeNormal(const glm::vec2& t_Encoded)
+		{
+			glm::vec3 N(t_Encoded.x, t_Encoded.y, 1.0f - glm::abs(t_Encoded.x) - glm::abs(t_Encoded.y));
+			if (N.z < 0.0f)
+			{
+				const glm::vec2 Folded = (1.0f - glm::abs(glm::vec2(N.y, N.x))) * SignNotZero(glm::vec2(N.x, N.y));
+				N.x = Folded.x;
+				N.y = Folded.y;
+			}
+			return glm::normalize(N);
+		}
+
+		glm::vec3 ReconstructPosition(const glm::vec2& t_UV, float t_Depth, const glm::mat4& t_InvViewProj)
+		{
+			const glm::vec4 World = t_InvViewProj * glm::vec4(t_UV * 2.0f - 1.0f, t_Depth, 1.0f);
+			return glm::vec3(World) / World.w;
+		}
+	}   // namespace GBufferPacking
+}   // namespace Fling
@@ -0,0 +1,190 @@
+#include "pch.h"
+#include "GeometryBuffer.h"
+#include "Buffer.h"
+#include "GraphicsHelpers.h"
+
+namespace Fling
+{
+	namespace
+	{
+		constexpr VkBufferUsageFlags VertexUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+		constexpr VkBufferUsageFlags IndexUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+		// Meshes are freed on the main thread, so they wait for the handoff as well as the frames in flight
+		constexpr uint32 RetireFrames = VkConfig::RETIRE_FRAMES;
+	}
+
+	void GeometryBindings::Bind(VkCommandBuffer t_CmdBuf, bool t_PositionsOnly) const
+	{
+		const VkDeviceSize Offsets[1] = { 0 };
+		vkCmdBindVertexBuffers(t_CmdBuf, 0, 1, t_PositionsOnly ? &Positions : &Vertices, Offsets);
+		vkCmdBindIndexBuffer(t_CmdBuf, Indices, 0, GeometryBuffer::IndexType);
+	}
+
+	GeometryBuffer::GeometryBuffer(VertexFormat t_Format, uint32 t_VertexCapacity, uint32 t_IndexCapacity)
+		: m_Format(t_Format)
+		, m_VertexStride(t_Format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex))
+		, m_PositionStride(Vertex::GetPositionStride(t_Format))
+		, m_VertexRanges(std::max(t_VertexCapacity, 1u), RetireFrames)
+		, m_IndexRanges(std::max(t_IndexCapacity, 1u), RetireFrames)
+	{
+		m_Vertices = CreateDeviceBuffer(static_cast<VkDeviceSize>(m_VertexRanges.GetCapacity()) * m_VertexStride, VertexUsage);
+		m_Positions = CreateDeviceBuffer(static_cast<VkDeviceSize>(m_VertexRanges.GetCapacity()) * m_PositionStride, VertexUsage);
+		m_Indices = CreateDeviceBuffer(static_cast<VkDeviceSize>(m_IndexRanges.GetCapacity()) * sizeof(uint32), IndexUsage);
+	}
+
+	GeometryBuffer::~GeometryBuffer()
+	{
+		if (m_VertexRanges.GetUsedSize() > 0)
+		{
+			F_LOG_WARN("Geometry buffer destroyed with {} vertices still allocated", m_VertexRanges.GetUsedSize());
+		}
+	}
+
+	GeometryAllocation GeometryBuffer::Allocate(const void* t_Vertices, const void* t_Positions, uint32 t_VertexCount, const uint32* t_Indices, uint32 t_IndexCount)
+	{
+		GeometryAllocation Result = {};
+		if (t_VertexCount == 0 || t_IndexCount == 0)
+		{
+			return Result;
+		}
+
+		uint32 FirstVertex = m_VertexRanges.Allocate(t_VertexCount);
+		if (FirstVertex == RangeAllocator::InvalidOffset)
+		{
+			GrowVertices(t_VertexCount);
+			FirstVertex = m_VertexRanges.Allocate(t_VertexCount);
+		}
+
+		uint32 FirstIndex = m_IndexRanges.Allocate(t_IndexCount);
+		if (FirstIndex == RangeAllocator::InvalidOffset)
+		{
+			GrowIndices(t_IndexCount);
+			FirstIndex = m_IndexRanges.Allocate(t_IndexCount);
+		}
+		assert(FirstVertex != RangeAllocator::InvalidOffset && FirstIndex != RangeAllocator::InvalidOffset);
+
+		Result.FirstVertex = FirstVertex;
+		Result.VertexCount = t_VertexCount;
+		Result.FirstIndex = FirstIndex;
+		Result.IndexCount = t_IndexCount;
+
+		// One staging buffer and one submit for all three streams
+		const VkDeviceSize VertexSize = static_cast<VkDeviceSize>(t_VertexCount) * m_VertexStride;
+		const VkDeviceSize PositionSize = static_cast<VkDeviceSize>(t_VertexCount) * m_PositionStride;
+		const VkDeviceSize IndexSize = static_cast<VkDeviceSize>(t_IndexCount) * sizeof(uint32);
+
+		Buffer StagingBuffer(VertexSize + PositionSize + IndexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		StagingBuffer.MapMemory();
+		uint8* Staging = static_cast<uint8*>(StagingBuffer.m_MappedMem);
+		memcpy(Staging, t_Vertices, VertexSize);
+		memcpy(Staging + VertexSize, t_Positions, PositionSize);
+		memcpy(Staging + VertexSize + PositionSize, t_Indices, IndexSize);
+		StagingBuffer.UnmapMemory();
+
+		// Nothing that is in flight reads these ranges, they were never allocated or have been retired
+		VkCommandBuffer CmdBuf = GraphicsHelpers::BeginSingleTimeCommands();
+
+		VkBufferCopy Region = {};
+		Region.srcOffset = 0;
+		Region.dstOffset = static_cast<VkDeviceSize>(FirstVertex) * m_VertexStride;
+		Region.size = VertexSize;
+		vkCmdCopyBuffer(CmdBuf, StagingBuffer.GetVkBuffer(), m_Vertices->GetVkBuffer(), 1, &Region);
+
+		Region.srcOffset = VertexSize;
+		Region.dstOffset = static_cast<VkDeviceSize>(FirstVertex) * m_PositionStride;
+		Region.size = PositionSize;
+		vkCmdCopyBuffer(CmdBuf, StagingBuffer.GetVkBuffer(), m_Positions->GetVkBuffer(), 1, &Region);
+
+		Region.srcOffset = VertexSize + PositionSize;
+		Region.dstOffset = static_cast<VkDeviceSize>(FirstIndex) * sizeof(uint32);
+		Region.size = IndexSize;
+		vkCmdCopyBuffer(CmdBuf, StagingBuffer.GetVkBuffer(), m_Indices->GetVkBuffer(), 1, &Region);
+
+		GraphicsHelpers::EndSingleTimeCommands(CmdBuf);
+
+		return Result;
+	}
+
+	void GeometryBuffer::Free(const GeometryAllocation& t_Allocation)
+	{
+		if (!t_Allocation.IsValid())
+		{
+			return;
+		}
+
+		m_VertexRanges.Free(t_Allocation.FirstVertex, t_Allocation.VertexCount);
+		m_IndexRanges.Free(t_Allocation.FirstIndex, t_Allocation.IndexCount);
+	}
+
+	void GeometryBuffer::NextFrame()
+	{
+		++m_Frame;
+		m_VertexRanges.NextFrame();
+		m_IndexRanges.NextFrame();
+
+		size_t Count = 0;
+		for (; Count < m_RetiredBuffers.size(); ++Count)
+		{
+			if (m_RetiredBuffers[Count].ReleaseFrame + RetireFrames > m_Frame)
+			{
+				break;
+			}
+		}
+		m_RetiredBuffers.erase(m_RetiredBuffers.begin(), m_RetiredBuffers.begin() + Count);
+	}
+
+	GeometryBindings GeometryBuffer::GetBindings() const
+	{
+		GeometryBindings Bindings;
+		Bindings.Vertices = m_Vertices->GetVkBuffer();
+		Bindings.Positions = m_Positions->GetVkBuffer();
+		Bindings.Indices = m_Indices->GetVkBuffer();
+		return Bindings;
+	}
+
+	void GeometryBuffer::GrowVertices(uint32 t_Count)
+	{
+		// The new space goes at the end, so that alone has to fit the mesh
+		const uint32 OldCapacity = m_VertexRanges.GetCapacity();
+		uint32 NewCapacity = OldCapacity * 2;
+		while (NewCapacity - OldCapacity < t_Count)
+		{
+			NewCapacity *= 2;
+		}
+
+		F_LOG_TRACE("Growing the geometry vertex buffer from {} to {} vertices", OldCapacity, NewCapacity);
+		GrowBuffer(m_Vertices, static_cast<VkDeviceSize>(NewCapacity) * m_VertexStride, VertexUsage);
+		GrowBuffer(m_Positions, static_cast<VkDeviceSize>(NewCapacity) * m_PositionStride, VertexUsage);
+		m_VertexRanges.Grow(NewCapacity);
+	}
+
+	void GeometryBuffer::GrowIndices(uint32 t_Count)
+	{
+		const uint32 OldCapacity = m_IndexRanges.GetCapacity();
+		uint32 NewCapacity = OldCapacity * 2;
+		while (NewCapacity - OldCapacity < t_Count)
+		{
+			NewCapacity *= 2;
+		}
+
+		F_LOG_TRACE("Growing the geometry index buffer from {} to {} indices", OldCapacity, NewCapacity);
+		GrowBuffer(m_Indices, static_cast<VkDeviceSize>(NewCapacity) * sizeof(uint32), IndexUsage);
+		m_IndexRanges.Grow(NewCapacity);
+	}
+
+	void GeometryBuffer::GrowBuffer(std::unique_ptr<Buffer>& t_Buffer, VkDeviceSize t_NewSize, VkBufferUsageFlags t_Usage)
+	{
+		std::unique_ptr<Buffer> NewBuffer = CreateDeviceBuffer(t_NewSize, t_Usage);
+		Buffer::CopyBuffer(t_Buffer.get(), NewBuffer.get(), t_Buffer->GetSize());
+
+		// Frames that were extracted before this still bind the old one
+		m_RetiredBuffers.push_back({ std::move(t_Buffer), m_Frame });
+		t_Buffer = std::move(NewBuffer);
+	}
+
+	std::unique_ptr<Buffer> GeometryBuffer::CreateDeviceBuffer(VkDeviceSize t_Size, VkBufferUsageFlags t_Usage)
+	{
+		return std::make_unique<Buffer>(t_Size, t_Usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+}   // namespace Fling
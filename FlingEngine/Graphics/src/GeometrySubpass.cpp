@@ -1,5 +1,4 @@
 #include "GeometrySubpass.h"
-#include "FrameBuffer.h"
 #include "CommandBuffer.h"
 #include "PhyscialDevice.h"
 #include "LogicalDevice.h"
@@ -10,9 +9,12 @@
 #include "Model.h"
 #include "Buffer.h"
 #include "OffscreenSubpass.h"
-#include "FirstPersonCamera.h"
+#include "RenderSnapshot.h"
 #include "Components/Transform.h"
 #include "VulkanApp.h"
+#include "Stats.h"
+#include "DebugDraw.h"
+#include "FlingConfig.h"
 
 namespace Fling
 {
@@ -21,14 +23,12 @@ namespace Fling
 		const Swapchain* t_Swap,
 		entt::registry& t_reg,
 		VkRenderPass t_GlobalRenderPass,
-		FirstPersonCamera* t_Cam,
-		FrameBuffer* t_OffscreenDep,
+		const OffscreenSubpass* t_OffscreenDep,
 		std::shared_ptr<Fling::Shader> t_Vert,
 		std::shared_ptr<Fling::Shader> t_Frag)
 		: Subpass(t_Dev, t_Swap, t_Vert, t_Frag)
 		, m_GlobalRenderPass(t_GlobalRenderPass)
-		, m_Camera(t_Cam)
-		, m_OffscreenFrameBuf(t_OffscreenDep)
+		, m_Offscreen(t_OffscreenDep)
 	{
 		assert(m_GlobalRenderPass != VK_NULL_HANDLE);
 
@@ -44,7 +44,7 @@ namespace Fling
 
 		VkDeviceSize bufferSize = sizeof(m_LightingUBO);
 
-		m_LightingUboBuffers.resize(m_SwapChain->GetImageCount());
+		m_LightingUboBuffers.resize(VkConfig::MAX_FRAMES_IN_FLIGHT);
 		for (size_t i = 0; i < m_LightingUboBuffers.size(); i++)
 		{
 			m_LightingUboBuffers[i] = new Buffer(
@@ -57,7 +57,7 @@ namespace Fling
 
 		// Build camera UBO's
 		bufferSize = sizeof(m_CamInfoUBO);
-		m_CameraUboBuffers.resize(m_SwapChain->GetImageCount());
+		m_CameraUboBuffers.resize(VkConfig::MAX_FRAMES_IN_FLIGHT);
 		for (size_t i = 0; i < m_CameraUboBuffers.size(); i++)
 		{
 			m_CameraUboBuffers[i] = new Buffer(
@@ -68,6 +68,20 @@ namespace Fling
 			m_CameraUboBuffers[i]->MapMemory(bufferSize);
 		}
 
+		// Build the clustered light storage buffers
+		const size_t FrameCount = VkConfig::MAX_FRAMES_IN_FLIGHT;
+		m_PointLightBuffers.resize(FrameCount);
+		m_ClusterBuffers.resize(FrameCount);
+		m_LightIndexBuffers.resize(FrameCount);
+		for (size_t i = 0; i < FrameCount; i++)
+		{
+			m_PointLightBuffers[i] = CreateLightBuffer(sizeof(PointLight) * DeferredLightSettings::InitialPointLightCapacity);
+			m_ClusterBuffers[i] = CreateLightBuffer(sizeof(LightClusterRange) * LightClusterGrid::ClusterCount);
+			m_LightIndexBuffers[i] = CreateLightBuffer(sizeof(uint32) * DeferredLightSettings::InitialLightIndexCapacity);
+		}
+
+		m_DrawLightGizmos = FlingConfig::GetBool("Graphics", "DebugDrawLights", true);
+
 		t_reg.on_construct<PointLight>().connect<&GeometrySubpass::OnPointLightAdded>(*this);
 	}
 
@@ -91,30 +105,72 @@ namespace Fling
 		ClearBufferVector(m_LightingUboBuffers);
 		ClearBufferVector(m_QuadUboBuffer);
 		ClearBufferVector(m_CameraUboBuffers);
+		ClearBufferVector(m_PointLightBuffers);
+		ClearBufferVector(m_ClusterBuffers);
+		ClearBufferVector(m_LightIndexBuffers);
 
 		// Clean up any allocated descriptor sets
 	}
 
-	void GeometrySubpass::Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, entt::registry& t_reg, float DeltaTime)
+	void GeometrySubpass::Extract(entt::registry& t_reg, RenderSnapshot& t_Snapshot)
+	{
+		// Directional Lights ----------------
+		t_Snapshot.DirectionalLights.clear();
+		auto DirectionalLightView = t_reg.view<DirectionalLight>();
+		for (auto entity : DirectionalLightView)
+		{
+			if (t_Snapshot.DirectionalLights.size() < DeferredLightSettings::MaxDirectionalLights)
+			{
+				t_Snapshot.DirectionalLights.emplace_back(DirectionalLightView.get(entity));
+			}
+		}
+
+		// Point lights ---------------------
+		t_Snapshot.PointLights.clear();
+		auto PointLightView = t_reg.view<PointLight, Transform>();
+		for (auto entity : PointLightView)
+		{
+			PointLight& Light = PointLightView.get<PointLight>(entity);
+			Transform& Trans = PointLightView.get<Transform>(entity);
+
+			Light.SetPos(glm::vec4(Trans.GetPos(), 1.0f));
+			t_Snapshot.PointLights.emplace_back(Light);
+
+			// A cute little gizmo on each light, drawn in the same batch as every other debug line
+			if (m_DrawLightGizmos)
+			{
+				DebugDraw::Sphere(Trans.GetPos(), 0.1f, glm::vec4(glm::vec3(Light.DiffuseColor), 1.0f));
+			}
+		}
+	}
+
+	void GeometrySubpass::Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot)
 	{
-		UpdateLightingUBO(t_reg, t_ActiveFrameInFlight);
+		UpdateLightingUBO(t_Snapshot, t_ActiveFrameInFlight);
 
 		// Update camera UBO's		
 		{
-			m_CamInfoUBO.Projection = m_Camera->GetProjectionMatrix();
-			m_CamInfoUBO.ModelView = m_Camera->GetViewMatrix();
-			m_CamInfoUBO.CamPos = glm::vec4(m_Camera->GetPosition(), 1.0f);
-			m_CamInfoUBO.Gamma = m_Camera->GetGamma();
-			m_CamInfoUBO.Exposure = m_Camera->GetExposure();
+			m_CamInfoUBO.Projection = t_Snapshot.Projection;
+			m_CamInfoUBO.ModelView = t_Snapshot.View;
+
+			// The G-Buffer was drawn with a flipped Y
+			glm::mat4 GBufferProjection = m_CamInfoUBO.Projection;
+			GBufferProjection[1][1] *= -1.0f;
+			m_CamInfoUBO.InvViewProj = glm::inverse(GBufferProjection * m_CamInfoUBO.ModelView);
+			m_CamInfoUBO.CamPos = glm::vec4(t_Snapshot.CameraPos, 1.0f);
+			m_CamInfoUBO.Gamma = t_Snapshot.Gamma;
+			m_CamInfoUBO.Exposure = t_Snapshot.Exposure;
+			m_CamInfoUBO.GBufferUVScale = m_Offscreen->GetGBufferUVScale();
 
 			memcpy(m_CameraUboBuffers[t_ActiveFrameInFlight]->m_MappedMem, &m_CamInfoUBO, sizeof(m_CamInfoUBO));
 		}
 
-		VkDeviceSize offsets[1] = { 0 };
+		if (!m_GraphicsPipeline->PrepareForDraw())
+		{
+			return;
+		}
 
 		// Final composition as full screen quad
-		VkBuffer vertexBuffers[1] = { m_QuadModel->GetVertexBuffer()->GetVkBuffer() };
-
 		vkCmdBindDescriptorSets(
 			t_CmdBuf.GetHandle(),
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -128,102 +184,94 @@ namespace Fling
 
 		vkCmdBindPipeline(t_CmdBuf.GetHandle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline->GetPipeline());
 
-		vkCmdBindVertexBuffers(t_CmdBuf.GetHandle(), 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(t_CmdBuf.GetHandle(), m_QuadModel->GetIndexBuffer()->GetVkBuffer(), 0, m_QuadModel->GetIndexType());
-		vkCmdDrawIndexed(t_CmdBuf.GetHandle(), m_QuadModel->GetIndexCount(), 1, 0, 0, 1);
+		t_Snapshot.Geometry.Bind(t_CmdBuf.GetHandle());
+		vkCmdDrawIndexed(t_CmdBuf.GetHandle(), m_QuadModel->GetIndexCount(), 1, m_QuadModel->GetFirstIndex(), m_QuadModel->GetVertexOffset(), 1);
 	}
 
 	void GeometrySubpass::CreateDescriptorSets(VkDescriptorPool t_Pool, entt::registry& t_reg)
 	{
-		assert(m_OffscreenFrameBuf);
+		assert(m_Offscreen);
 
 		// We only need to do the actual allocation of sets ONCE
 		if(m_DescPool == VK_NULL_HANDLE)
 		{
 			m_DescPool = t_Pool;
 		
-			size_t ImageCount = m_SwapChain->GetImageCount();
-			m_DescriptorSets.resize(ImageCount);
+			// One set per frame in flight, each pointing at the buffers of that frame
+			const size_t FrameCount = VkConfig::MAX_FRAMES_IN_FLIGHT;
+			m_DescriptorSets.resize(FrameCount);
 
-			std::vector<VkDescriptorSetLayout> layouts(ImageCount, m_GraphicsPipeline->GetDescriptorSetLayout());
+			std::vector<VkDescriptorSetLayout> layouts(FrameCount, m_GraphicsPipeline->GetDescriptorSetLayout());
 			VkDescriptorSetAllocateInfo allocInfo = {};
 			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 			// If we have specified a specific pool then use that, otherwise use the one on the mesh
 			allocInfo.descriptorPool = t_Pool;
-			allocInfo.descriptorSetCount = static_cast<uint32>(ImageCount);
+			allocInfo.descriptorSetCount = static_cast<uint32>(FrameCount);
 			allocInfo.pSetLayouts = layouts.data();
 
 			VK_CHECK_RESULT(vkAllocateDescriptorSets(m_Device->GetVkDevice(), &allocInfo, m_DescriptorSets.data()));
 		}
 
+		// The single pass lighting shader reads the G-Buffer as input attachments, which have no sampler
+		const VkDescriptorType GBufferType = m_Offscreen->IsSinglePass() ?
+			VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT :
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
 		// Write to the sets
 		for (size_t i = 0; i < m_DescriptorSets.size(); ++i)
 		{
 			// Create the image info's for the write sets to reference
 			// that will give us access to the G-Buffer in the shaders
-			VkDescriptorImageInfo texDescriptorPosition =
+			VkDescriptorImageInfo texDescriptorDepth =
 				Initializers::DescriptorImageInfo(
-					m_OffscreenFrameBuf->GetSamplerHandle(),
-					m_OffscreenFrameBuf->GetAttachmentAtIndex(0)->GetViewHandle(),
-					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+					m_Offscreen->GetGBufferSampler(),
+					m_Offscreen->GetGBufferView(GBufferTarget::Depth),
+					VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
 
 			VkDescriptorImageInfo texDescriptorNormal =
 				Initializers::DescriptorImageInfo(
-					m_OffscreenFrameBuf->GetSamplerHandle(),
-					m_OffscreenFrameBuf->GetAttachmentAtIndex(1)->GetViewHandle(),
+					m_Offscreen->GetGBufferSampler(),
+					m_Offscreen->GetGBufferView(GBufferTarget::Normal),
 					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 			VkDescriptorImageInfo texDescriptorAlbedo =
 				Initializers::DescriptorImageInfo(
-					m_OffscreenFrameBuf->GetSamplerHandle(),
-					m_OffscreenFrameBuf->GetAttachmentAtIndex(2)->GetViewHandle(),
-					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-			VkDescriptorImageInfo texDescriptorMetal =
-				Initializers::DescriptorImageInfo(
-					m_OffscreenFrameBuf->GetSamplerHandle(),
-					m_OffscreenFrameBuf->GetAttachmentAtIndex(3)->GetViewHandle(),
+					m_Offscreen->GetGBufferSampler(),
+					m_Offscreen->GetGBufferView(GBufferTarget::Albedo),
 					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-			VkDescriptorImageInfo texDescriptorRough =
+			VkDescriptorImageInfo texDescriptorMaterial =
 				Initializers::DescriptorImageInfo(
-					m_OffscreenFrameBuf->GetSamplerHandle(),
-					m_OffscreenFrameBuf->GetAttachmentAtIndex(4)->GetViewHandle(),
+					m_Offscreen->GetGBufferSampler(),
+					m_Offscreen->GetGBufferView(GBufferTarget::Material),
 					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 			std::vector<VkWriteDescriptorSet> writeDescriptorSets =
 			{
-				// 1 : Position sampler
+				// 1 : Depth sampler, positions are rebuilt from this
 				Initializers::WriteDescriptorSet(
 					m_DescriptorSets[i],
-					VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					GBufferType,
 					1,
-					&texDescriptorPosition),
+					&texDescriptorDepth),
 				// 2 : Normal sampler
 				Initializers::WriteDescriptorSet(
 					m_DescriptorSets[i],
-					VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					GBufferType,
 					2,
 					&texDescriptorNormal),
 				// 3 : Albedo sampler
 				Initializers::WriteDescriptorSet(
 					m_DescriptorSets[i],
-					VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					GBufferType,
 					3,
 					&texDescriptorAlbedo),
-
-				// 4 : Metal sampler
+				// 4 : Metal, roughness, and AO sampler
 				Initializers::WriteDescriptorSet(
 					m_DescriptorSets[i],
-					VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					GBufferType,
 					4,
-					&texDescriptorMetal),
-				// 5 : Roughness sampler
-				Initializers::WriteDescriptorSet(
-					m_DescriptorSets[i],
-					VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-					5,
-					&texDescriptorRough),
+					&texDescriptorMaterial),
 
 				// 6 : Lighting UBO to the fragment shader
 				Initializers::WriteDescriptorSetUniform(
@@ -237,6 +285,25 @@ namespace Fling
 					m_DescriptorSets[i],
 					7
 				),
+
+				// 8 : Point lights
+				Initializers::WriteDescriptorSet(
+					m_DescriptorSets[i],
+					VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					8,
+					&m_PointLightBuffers[i]->GetDescriptor()),
+				// 9 : Light range of each cluster
+				Initializers::WriteDescriptorSet(
+					m_DescriptorSets[i],
+					VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					9,
+					&m_ClusterBuffers[i]->GetDescriptor()),
+				// 10 : Light indices of every cluster
+				Initializers::WriteDescriptorSet(
+					m_DescriptorSets[i],
+					VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					10,
+					&m_LightIndexBuffers[i]->GetDescriptor()),
 			};
 
 			vkUpdateDescriptorSets(m_Device->GetVkDevice(), static_cast<uint32>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
@@ -245,19 +312,6 @@ namespace Fling
 
 	void GeometrySubpass::CreateGraphicsPipeline()
 	{
-		// Use empty vertex descriptions here
-		VkPipelineVertexInputStateCreateInfo emptyInputState = {};
-		emptyInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		emptyInputState.vertexAttributeDescriptionCount = 0;
-		emptyInputState.pVertexAttributeDescriptions = nullptr;
-		emptyInputState.vertexBindingDescriptionCount = 0;
-		emptyInputState.pVertexBindingDescriptions = nullptr;
-
-		m_GraphicsPipeline->m_PipelineCreateInfo.pVertexInputState = {};
-		m_GraphicsPipeline->m_PipelineCreateInfo.pVertexInputState = &emptyInputState;
-		m_GraphicsPipeline->m_VertexInputStateCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
-		m_GraphicsPipeline->m_VertexInputStateCreateInfo.vertexBindingDescriptionCount = 0;
-
 		// Set the rasterization state to counter clockwise and the front bit 
 		// for rendering with a single full screen triangle
 		m_GraphicsPipeline->m_RasterizationState = 
@@ -268,21 +322,22 @@ namespace Fling
 			);
 
 		// Create it otherwise with defaults
+		m_GraphicsPipeline->m_Subpass = m_SubpassIndex;
 		m_GraphicsPipeline->CreateGraphicsPipeline(m_GlobalRenderPass, nullptr);
 	}
 
 	void GeometrySubpass::OnSwapchainResized(entt::registry& t_reg)
 	{
-		//// Update the render pass to have the good swap chain size
-		//m_GlobalRenderPass = VulkanApp::Get().GetGlobalRenderPass();
-
-		//// Recreate graphics pipeline to have that new reference
-		//DestroyGraphicsPipeline();
-		//InitalizeGraphicsPipeline();
-		//CreateGraphicsPipeline();
+		// The global render pass was rebuilt. A compatible one finds the same pipeline in the
+		// cache, anything else is compiled in the background and the lighting is skipped until then
+		m_GlobalRenderPass = VulkanApp::Get().GetGlobalRenderPass();
+		m_GraphicsPipeline->CreateGraphicsPipeline(m_GlobalRenderPass, nullptr, true);
 
-		//// Now create the descriptor sets, which are dependent on the newly updated offscreen frame buffer
-		//CreateDescriptorSets(m_DescPool, t_reg);
+		// The offscreen subpass is resized first and recreates the G-Buffer views, so point the sets at the new ones
+		if (m_DescPool != VK_NULL_HANDLE)
+		{
+			CreateDescriptorSets(m_DescPool, t_reg);
+		}
 	}
 
 	void GeometrySubpass::OnPointLightAdded(entt::entity t_Ent, entt::registry& t_Reg, PointLight& t_Light)
@@ -292,68 +347,102 @@ namespace Fling
 		{
 			t_Reg.assign<Transform>(t_Ent);
 		}
+	}
 
-		Transform& t = t_Reg.get<Transform>(t_Ent);
-		// Make a cute little debug mesh on a point light	
-		t.SetScale(glm::vec3{ 0.1f });
+	void GeometrySubpass::UpdateLightingUBO(const RenderSnapshot& t_Snapshot, uint32 t_ActiveFrame)
+	{
+		// Directional Lights ----------------
+		const std::vector<DirectionalLight>& DirLights = t_Snapshot.DirectionalLights;
+		assert(DirLights.size() <= DeferredLightSettings::MaxDirectionalLights);
+
+		// Copy the dir light info to the buffer
+		if (!DirLights.empty())
+		{
+			memcpy(m_LightingUBO.DirLightBuffer, DirLights.data(), sizeof(DirectionalLight) * DirLights.size());
+		}
+		m_LightingUBO.DirLightCount = static_cast<uint32>(DirLights.size());
 
-#if FLING_DEBUG
-		static std::string PointLightMesh = "Models/sphere.obj";
-		static std::string MaterialPath = "Materials/White.mat";
+		// Point lights ---------------------
+		const std::vector<PointLight>& PointLights = t_Snapshot.PointLights;
 
-		if (!t_Reg.has<MeshRenderer>(t_Ent))
+		m_ViewSpaceLights.clear();
+		for (const PointLight& Light : PointLights)
 		{
-			t_Reg.assign<MeshRenderer>(t_Ent, PointLightMesh, MaterialPath);
+			glm::vec4 ViewPos = t_Snapshot.View * glm::vec4(glm::vec3(Light.GetPos()), 1.0f);
+			ViewPos.w = Light.Range;
+			m_ViewSpaceLights.emplace_back(ViewPos);
 		}
 
-		// Ensure that we have the proper point light mesh on for a nice little gizmo
-		MeshRenderer& m = t_Reg.get<MeshRenderer>(t_Ent);
-		m.LoadModelFromPath(PointLightMesh);
-		m.LoadMaterialFromPath(MaterialPath);
-#endif	// FLING_DEBUG
+		// Assign lights to clusters with the same projection that the G-Buffer was drawn with
+		const VkExtent2D& Extents = m_SwapChain->GetExtents();
+		glm::mat4 Projection = t_Snapshot.Projection;
+		Projection[1][1] *= -1.0f;
+
+		m_LightClusters.SetProjection(Projection, t_Snapshot.NearPlane, t_Snapshot.FarPlane, Extents.width, Extents.height);
+		m_LightClusters.Build(m_ViewSpaceLights.data(), static_cast<uint32>(m_ViewSpaceLights.size()));
+
+		const std::vector<uint32>& LightIndices = m_LightClusters.GetLightIndices();
+		WriteLightBuffer(m_PointLightBuffers, t_ActiveFrame, 8, PointLights.data(), sizeof(PointLight) * PointLights.size());
+		WriteLightBuffer(m_ClusterBuffers, t_ActiveFrame, 9, m_LightClusters.GetClusters().data(), sizeof(LightClusterRange) * LightClusterGrid::ClusterCount);
+		WriteLightBuffer(m_LightIndexBuffers, t_ActiveFrame, 10, LightIndices.data(), sizeof(uint32) * LightIndices.size());
+
+		m_LightingUBO.PointLightCount = static_cast<uint32>(PointLights.size());
+		m_LightingUBO.ClusterCounts = glm::uvec4(LightClusterGrid::CountX, LightClusterGrid::CountY, LightClusterGrid::CountZ, 0);
+		m_LightingUBO.ClusterScale = m_LightClusters.GetClusterScale();
+
+		Stats::Lighting::SetClusterResults(m_LightingUBO.PointLightCount, static_cast<uint32>(LightIndices.size()), m_LightClusters.GetMaxLightsPerCluster());
+
+		// Memcpy to the buffer
+		memcpy(
+			m_LightingUboBuffers[t_ActiveFrame]->m_MappedMem,
+			&m_LightingUBO,
+			sizeof(m_LightingUBO));
 	}
 
-	void GeometrySubpass::UpdateLightingUBO(entt::registry& t_Reg, uint32 t_ActiveFrame)
+	void GeometrySubpass::WriteLightBuffer(std::vector<Buffer*>& t_Buffers, uint32 t_ActiveFrame, uint32 t_Binding, const void* t_Data, VkDeviceSize t_Size)
 	{
-		auto PointLightView = t_Reg.view<PointLight, Transform>();
-		auto DirectionalLightView = t_Reg.view<DirectionalLight>();
+		Buffer*& Buf = t_Buffers[t_ActiveFrame];
+		assert(Buf);
 
-		uint32 CurLightCount = 0;
-		// Directional Lights ----------------
-		for (auto entity : DirectionalLightView)
+		if (t_Size > Buf->GetSize())
 		{
-			if (CurLightCount < DeferredLightSettings::MaxDirectionalLights)
+			// Grow by doubling so that a steadily growing light count doesn't recreate this every frame.
+			// The last frame that used this slot has already finished, so it is safe to replace
+			VkDeviceSize NewSize = Buf->GetSize();
+			while (NewSize < t_Size)
 			{
-				DirectionalLight& Light = DirectionalLightView.get(entity);
-				// Copy the dir light info to the buffer
-				memcpy((m_LightingUBO.DirLightBuffer + (CurLightCount++)), &Light, sizeof(DirectionalLight));
+				NewSize *= 2;
 			}
-		}
-
-		m_LightingUBO.DirLightCount = CurLightCount;
 
-		CurLightCount = 0;
+			delete Buf;
+			Buf = CreateLightBuffer(NewSize);
 
-		// Point lights ---------------------
-		for (auto entity : PointLightView)
-		{
-			if (CurLightCount < DeferredLightSettings::MaxPointLights)
+			if (t_ActiveFrame < m_DescriptorSets.size())
 			{
-				PointLight& Light = PointLightView.get<PointLight>(entity);
-				Transform& Trans = PointLightView.get<Transform>(entity);
+				VkWriteDescriptorSet Write = Initializers::WriteDescriptorSet(
+					m_DescriptorSets[t_ActiveFrame],
+					VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					t_Binding,
+					&Buf->GetDescriptor());
 
-				Light.SetPos(glm::vec4(Trans.GetPos(), 1.0f));
-				// Copy the point light info to the buffer
-				memcpy((m_LightingUBO.PointLightBuffer + (CurLightCount++)), &Light, sizeof(PointLight));
+				vkUpdateDescriptorSets(m_Device->GetVkDevice(), 1, &Write, 0, nullptr);
 			}
 		}
 
-		// Memcpy to the buffer
-		m_LightingUBO.PointLightCount = CurLightCount;
-		
-		memcpy(
-			m_LightingUboBuffers[t_ActiveFrame]->m_MappedMem,
-			&m_LightingUBO,
-			sizeof(m_LightingUBO));
+		if (t_Size > 0)
+		{
+			memcpy(Buf->m_MappedMem, t_Data, static_cast<size_t>(t_Size));
+		}
+	}
+
+	Buffer* GeometrySubpass::CreateLightBuffer(VkDeviceSize t_Size)
+	{
+		Buffer* Buf = new Buffer(
+			t_Size,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		Buf->MapMemory(t_Size);
+		return Buf;
 	}
 }   // namespace Fling
\ No newline at end of file
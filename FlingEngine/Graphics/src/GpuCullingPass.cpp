@@ -0,0 +1,602 @@
+#include "pch.h"
+#include "GpuCullingPass.h"
+#include "LogicalDevice.h"
+#include "CommandBuffer.h"
+#include "GraphicsPipeline.h"
+#include "GraphicsHelpers.h"
+#include "Buffer.h"
+#include "MeshRenderer.h"
+#include "BindlessTextures.h"
+#include "Components/Transform.h"
+#include "FlingConfig.h"
+#include "Stats.h"
+#include "GpuProfiler.h"
+#include "VulkanApp.h"
+
+#include <entt/entity/helper.hpp>
+#include <algorithm>
+
+namespace Fling
+{
+	static_assert(sizeof(DrawIndexedCommand) == sizeof(VkDrawIndexedIndirectCommand), "DrawIndexedCommand must match VkDrawIndexedIndirectCommand");
+
+	GpuCullingPass::GpuCullingPass(
+		const LogicalDevice* t_Dev,
+		entt::registry& t_Reg,
+		BindlessTextures* t_Bindless,
+		std::shared_ptr<Fling::Shader> t_Cull,
+		std::shared_ptr<Fling::Shader> t_Vert,
+		std::shared_ptr<Fling::Shader> t_Frag)
+		: m_Device(t_Dev)
+		, m_Bindless(t_Bindless)
+		, m_CullShader(t_Cull)
+		, m_VertexShader(t_Vert)
+		, m_FragShader(t_Frag)
+	{
+		assert(m_Device && m_Bindless && m_CullShader && m_VertexShader && m_FragShader);
+		assert(IsSupported(m_Device));
+
+		m_Validate = FlingConfig::GetBool("Graphics", "GpuCullingValidation", false);
+		m_ProfileBatches = FlingConfig::GetBool("Graphics", "GpuProfileDrawBuckets", false);
+
+		if (m_Device->SupportsDrawIndirectCount())
+		{
+			m_CmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+				vkGetDeviceProcAddr(m_Device->GetVkDevice(), "vkCmdDrawIndexedIndirectCountKHR"));
+			m_Compact = m_CmdDrawIndexedIndirectCount != nullptr;
+		}
+		F_LOG_TRACE("GPU driven rendering enabled (compact draws: {}, validation: {})", m_Compact, m_Validate);
+
+		t_Reg.on_construct<MeshRenderer>().connect<&GpuCullingPass::OnMeshRendererChanged>(*this);
+		t_Reg.on_replace<MeshRenderer>().connect<&GpuCullingPass::OnMeshRendererChanged>(*this);
+		t_Reg.on_construct<Transform>().connect<&GpuCullingPass::OnTransformAdded>(*this);
+		t_Reg.on_destroy<MeshRenderer>().connect<&GpuCullingPass::OnComponentRemoved>(*this);
+		t_Reg.on_destroy<Transform>().connect<&GpuCullingPass::OnComponentRemoved>(*this);
+
+		std::vector<Shader*> Shaders = { m_VertexShader.get(), m_FragShader.get() };
+		m_GraphicsPipeline = new GraphicsPipeline(
+			Shaders,
+			m_Device->GetVkDevice(),
+			VK_POLYGON_MODE_FILL,
+			GraphicsPipeline::Depth::ReadWrite,
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE);
+		m_GraphicsPipeline->SetPipelineLayout({ m_Bindless->GetSetLayout() }, 0, 0);
+
+		CreateComputePipeline();
+
+		VkDeviceSize CameraSize = sizeof(IndirectCameraUBO);
+		for (FrameResources& Frame : m_Frames)
+		{
+			Frame.m_CameraBuffer = new Buffer(CameraSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			Frame.m_CameraBuffer->MapMemory(CameraSize);
+		}
+	}
+
+	GpuCullingPass::~GpuCullingPass()
+	{
+		VkDevice Device = m_Device->GetVkDevice();
+
+		for (FrameResources& Frame : m_Frames)
+		{
+			ReleaseBuffers(Frame);
+
+			if (Frame.m_CameraBuffer)
+			{
+				delete Frame.m_CameraBuffer;
+				Frame.m_CameraBuffer = nullptr;
+			}
+		}
+
+		vkDestroyPipeline(Device, m_ComputePipeline, nullptr);
+		vkDestroyPipelineLayout(Device, m_ComputePipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(Device, m_ComputeSetLayout, nullptr);
+
+		for (GraphicsPipeline** Pipeline : { &m_GraphicsPipeline, &m_DepthPipeline, &m_PrepassedPipeline })
+		{
+			if (*Pipeline)
+			{
+				delete *Pipeline;
+				*Pipeline = nullptr;
+			}
+		}
+	}
+
+	bool GpuCullingPass::IsSupported(const LogicalDevice* t_Dev)
+	{
+		assert(t_Dev);
+		return t_Dev->SupportsIndirectDraws();
+	}
+
+	void GpuCullingPass::EnableDepthPrepass(std::shared_ptr<Fling::Shader> t_DepthVert)
+	{
+		assert(t_DepthVert && !m_DepthPipeline && !m_PrepassedPipeline);
+
+		// depth_indirect.vert declares the same set 0 as mrt_indirect.vert, so its layout is
+		// defined identically and the graphics set of each frame can be bound to either pipeline
+		m_DepthShader = t_DepthVert;
+
+		std::vector<Shader*> DepthShaders = { m_DepthShader.get() };
+		m_DepthPipeline = new GraphicsPipeline(
+			DepthShaders,
+			m_Device->GetVkDevice(),
+			VK_POLYGON_MODE_FILL,
+			GraphicsPipeline::Depth::ReadWrite,
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE);
+		m_DepthPipeline->SetPipelineLayout({}, 0, 0);
+		m_DepthPipeline->UsePositionStream();
+
+		std::vector<Shader*> Shaders = { m_VertexShader.get(), m_FragShader.get() };
+		m_PrepassedPipeline = new GraphicsPipeline(
+			Shaders,
+			m_Device->GetVkDevice(),
+			VK_POLYGON_MODE_FILL,
+			GraphicsPipeline::Depth::Read,
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE);
+		m_PrepassedPipeline->SetPipelineLayout({ m_Bindless->GetSetLayout() }, 0, 0);
+	}
+
+	void GpuCullingPass::CreateComputePipeline()
+	{
+		VkDevice Device = m_Device->GetVkDevice();
+
+		std::vector<Shader*> Shaders = { m_CullShader.get() };
+		m_ComputeSetLayout = Shader::CreateSetLayout(Device, Shaders);
+		m_ComputePipelineLayout = Shader::CreatePipelineLayout(Device, m_ComputeSetLayout, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(GpuCullConstants));
+
+		VkComputePipelineCreateInfo CreateInfo = {};
+		CreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		CreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		CreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		CreateInfo.stage.module = m_CullShader->GetShaderModule();
+		CreateInfo.stage.pName = "main";
+		CreateInfo.layout = m_ComputePipelineLayout;
+
+		VK_CHECK_RESULT(vkCreateComputePipelines(Device, VK_NULL_HANDLE, 1, &CreateInfo, nullptr, &m_ComputePipeline));
+	}
+
+	void GpuCullingPass::RecordCull(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrame, entt::registry& t_Reg, const std::vector<entt::entity>& t_Changed, const Frustum& t_Frustum, const IndirectCameraUBO& t_Camera, const LodSelector& t_Lods)
+	{
+		assert(t_ActiveFrame < m_Frames.size());
+		FrameResources& Frame = m_Frames[t_ActiveFrame];
+
+		// The last dispatch of this frame has finished by now, so check it before anything is changed.
+		// If something moved since then the CPU copy no longer matches what was culled, so skip it
+		if (m_Validate && Frame.m_HasResults && !m_LayoutDirty && Frame.m_PendingObjects.empty())
+		{
+			ValidateResults(Frame);
+		}
+
+		if (m_LayoutDirty)
+		{
+			RebuildObjects(t_Reg);
+		}
+		else
+		{
+			// Keep the CPU copy up to date and remember the change for every frame,
+			// each object buffer gets it the next time that its frame is recorded
+			for (entt::entity Ent : t_Changed)
+			{
+				auto It = m_ObjectIndices.find(Ent);
+				if (It == m_ObjectIndices.end() || !t_Reg.valid(Ent))
+				{
+					continue;
+				}
+
+				m_DrawList.GetObjects()[It->second].World = t_Reg.get<Transform>(Ent).GetWorldMat();
+				for (FrameResources& Other : m_Frames)
+				{
+					Other.m_PendingObjects.emplace_back(It->second);
+				}
+			}
+		}
+
+		// This frame's buffers are from before the objects were rebuilt. Nothing that is in
+		// flight uses them anymore, so they can be replaced without waiting on the device
+		if (Frame.m_LayoutVersion != m_LayoutVersion)
+		{
+			ReleaseBuffers(Frame);
+			CreateBuffers(Frame);
+			CreateDescriptorSets(Frame);
+			Frame.m_LayoutVersion = m_LayoutVersion;
+			Frame.m_PendingObjects.clear();
+		}
+
+		// Only the objects that changed need to be uploaded
+		if (Frame.m_ObjectBuffer)
+		{
+			const std::vector<GpuObjectData>& Objects = m_DrawList.GetObjects();
+			GpuObjectData* MappedObjects = static_cast<GpuObjectData*>(Frame.m_ObjectBuffer->m_MappedMem);
+			for (uint32 Index : Frame.m_PendingObjects)
+			{
+				MappedObjects[Index] = Objects[Index];
+			}
+		}
+		Frame.m_PendingObjects.clear();
+
+		memcpy(Frame.m_CameraBuffer->m_MappedMem, &t_Camera, sizeof(IndirectCameraUBO));
+
+		const uint32 ObjectCount = m_DrawList.GetObjectCount();
+		if (ObjectCount == 0)
+		{
+			Frame.m_HasResults = false;
+			return;
+		}
+
+		VkCommandBuffer Cmd = t_CmdBuf.GetHandle();
+
+		if (m_Compact)
+		{
+			vkCmdFillBuffer(Cmd, Frame.m_CountBuffer->GetVkBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+			VkMemoryBarrier ClearBarrier = {};
+			ClearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			ClearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			ClearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(Cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &ClearBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		GpuCullConstants Constants = {};
+		m_DrawList.GetCullConstants(t_Frustum, m_Compact, t_Lods, Constants);
+
+		vkCmdBindPipeline(Cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputePipeline);
+		vkCmdBindDescriptorSets(Cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputePipelineLayout, 0, 1, &Frame.m_ComputeSet, 0, nullptr);
+		vkCmdPushConstants(Cmd, m_ComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GpuCullConstants), &Constants);
+
+		const uint32 GroupSize = glm::max(m_CullShader->GetLocalSizeX(), 1u);
+		vkCmdDispatch(Cmd, (ObjectCount + GroupSize - 1) / GroupSize, 1, 1);
+
+		// The indirect draws (and the host if we are validating) need to see the commands
+		VkMemoryBarrier CullBarrier = {};
+		CullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		CullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		CullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | (m_Validate ? VK_ACCESS_HOST_READ_BIT : 0);
+		vkCmdPipelineBarrier(
+			Cmd,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | (m_Validate ? VK_PIPELINE_STAGE_HOST_BIT : 0),
+			0, 1, &CullBarrier, 0, nullptr, 0, nullptr);
+
+		Frame.m_Frustum = t_Frustum;
+		Frame.m_HasResults = true;
+	}
+
+	void GpuCullingPass::RecordDraws(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrame, const GeometryBindings& t_Geometry, GBufferDrawMode t_Mode)
+	{
+		if (m_DrawList.GetObjectCount() == 0)
+		{
+			return;
+		}
+
+		assert(t_ActiveFrame < m_Frames.size());
+		const FrameResources& Frame = m_Frames[t_ActiveFrame];
+
+		const bool DepthOnly = t_Mode == GBufferDrawMode::DepthOnly;
+		GraphicsPipeline* Pipeline =
+			DepthOnly ? m_DepthPipeline :
+			t_Mode == GBufferDrawMode::AfterPrepass ? m_PrepassedPipeline :
+			m_GraphicsPipeline;
+		assert(Pipeline);
+
+		VkCommandBuffer Cmd = t_CmdBuf.GetHandle();
+		vkCmdBindPipeline(Cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline->GetPipeline());
+
+		// The depth pipeline doesn't sample anything, so it has no bindless set
+		VkDescriptorSet Sets[2] = { Frame.m_GraphicsSet, m_Bindless->GetSet() };
+		vkCmdBindDescriptorSets(Cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline->GetPipelineLayout(), 0, DepthOnly ? 1 : 2, Sets, 0, nullptr);
+
+		// Every batch draws out of the same buffers, the commands have the offsets of each model
+		t_Geometry.Bind(Cmd, DepthOnly);
+
+		const uint32 Stride = sizeof(DrawIndexedCommand);
+		const std::vector<IndirectBatch>& Batches = m_DrawList.GetBatches();
+		GpuProfiler* Profiler = m_ProfileBatches && !DepthOnly ? VulkanApp::Get().GetGpuProfiler() : nullptr;
+
+		// Object i writes command i and culled ones get no instances, so without compaction
+		// the batches are one contiguous array and can go in a single call
+		if (!m_Compact && !Profiler)
+		{
+			vkCmdDrawIndexedIndirect(Cmd, Frame.m_CommandBuffer->GetVkBuffer(), 0, m_DrawList.GetObjectCount(), Stride);
+			return;
+		}
+
+		for (uint32 i = 0; i < m_DrawList.GetBatchCount(); ++i)
+		{
+			const IndirectBatch& Batch = Batches[i];
+
+			char ScopeName[32] = {};
+			if (Profiler)
+			{
+				snprintf(ScopeName, sizeof(ScopeName), "Batch %u", i);
+			}
+			GpuProfiler::Scope Scope(Profiler, t_CmdBuf, ScopeName);
+
+			const VkDeviceSize CommandOffset = static_cast<VkDeviceSize>(Batch.FirstCommand) * Stride;
+			if (m_Compact)
+			{
+				m_CmdDrawIndexedIndirectCount(
+					Cmd,
+					Frame.m_CommandBuffer->GetVkBuffer(), CommandOffset,
+					Frame.m_CountBuffer->GetVkBuffer(), i * sizeof(uint32),
+					Batch.CommandCount, Stride);
+			}
+			else
+			{
+				vkCmdDrawIndexedIndirect(Cmd, Frame.m_CommandBuffer->GetVkBuffer(), CommandOffset, Batch.CommandCount, Stride);
+			}
+		}
+	}
+
+	void GpuCullingPass::CleanUp(entt::registry& t_Reg)
+	{
+		t_Reg.on_construct<MeshRenderer>().disconnect<&GpuCullingPass::OnMeshRendererChanged>(*this);
+		t_Reg.on_replace<MeshRenderer>().disconnect<&GpuCullingPass::OnMeshRendererChanged>(*this);
+		t_Reg.on_construct<Transform>().disconnect<&GpuCullingPass::OnTransformAdded>(*this);
+		t_Reg.on_destroy<MeshRenderer>().disconnect<&GpuCullingPass::OnComponentRemoved>(*this);
+		t_Reg.on_destroy<Transform>().disconnect<&GpuCullingPass::OnComponentRemoved>(*this);
+
+		m_DrawList.Clear();
+		m_Batches.clear();
+		m_ObjectIndices.clear();
+		m_ObjectEntities.clear();
+	}
+
+	void GpuCullingPass::RebuildObjects(entt::registry& t_Reg)
+	{
+		struct DrawableEntity
+		{
+			entt::entity m_Entity;
+			Model* m_Model;
+			MaterialTextureSlots m_Textures;
+		};
+
+		// Group everything by model so that each batch is one indirect draw
+		std::vector<DrawableEntity> Drawables;
+		auto DrawableView = t_Reg.view<entt::tag<"Default"_hs>, Transform, MeshRenderer>();
+		for (entt::entity Ent : DrawableView)
+		{
+			MeshRenderer& MeshRend = DrawableView.get<MeshRenderer>(Ent);
+			if (MeshRend.m_Model)
+			{
+				Drawables.push_back({ Ent, MeshRend.m_Model, MeshRend.m_TextureSlots });
+			}
+		}
+
+		std::sort(Drawables.begin(), Drawables.end(), [](const DrawableEntity& A, const DrawableEntity& B)
+		{
+			return std::less<Model*>()(A.m_Model, B.m_Model);
+		});
+
+		m_DrawList.Clear();
+		m_Batches.clear();
+		m_ObjectIndices.clear();
+		m_ObjectEntities.clear();
+
+		for (const DrawableEntity& Drawable : Drawables)
+		{
+			if (m_Batches.empty() || m_Batches.back().m_Model != Drawable.m_Model)
+			{
+				m_DrawList.BeginBatch();
+				m_Batches.push_back({ Drawable.m_Model });
+
+				// cull.comp picks one of these for each visible object
+				for (const MeshLod& Lod : Drawable.m_Model->GetLods())
+				{
+					GpuLodData LodData = {};
+					LodData.FirstIndex = Drawable.m_Model->GetFirstIndex() + Lod.FirstIndex;
+					LodData.IndexCount = Lod.IndexCount;
+					LodData.Error = Lod.Error;
+					m_DrawList.AddLod(LodData);
+				}
+			}
+
+			const MeshLod& FullDetail = Drawable.m_Model->GetLod(0);
+
+			GpuObjectData Object = {};
+			Object.World = t_Reg.get<Transform>(Drawable.m_Entity).GetWorldMat();
+			Object.BoundsCenter = Drawable.m_Model->GetDecodeCenter();
+			Object.BoundsExtents = Drawable.m_Model->GetDecodeExtents();
+			Object.FirstIndex = Drawable.m_Model->GetFirstIndex() + FullDetail.FirstIndex;
+			Object.IndexCount = FullDetail.IndexCount;
+			Object.VertexOffset = Drawable.m_Model->GetVertexOffset();
+			Object.Textures = Drawable.m_Textures;
+			m_ObjectIndices[Drawable.m_Entity] = m_DrawList.AddObject(Object);
+			m_ObjectEntities.push_back(Drawable.m_Entity);
+		}
+
+		// The other frames in flight may still be drawing from their buffers, so each one is
+		// replaced in RecordCull once that frame comes around again
+		for (FrameResources& Frame : m_Frames)
+		{
+			Frame.m_PendingObjects.clear();
+			Frame.m_HasResults = false;
+		}
+
+		++m_LayoutVersion;
+		m_LayoutDirty = false;
+	}
+
+	void GpuCullingPass::CreateBuffers(FrameResources& t_Frame)
+	{
+		if (m_DrawList.GetObjectCount() == 0)
+		{
+			return;
+		}
+
+		const VkMemoryPropertyFlags HostFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		// The results only need to be in host memory if we are going to read them back
+		const VkMemoryPropertyFlags ResultFlags = m_Validate ? HostFlags : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+		const std::vector<GpuObjectData>& Objects = m_DrawList.GetObjects();
+		const VkDeviceSize ObjectSize = sizeof(GpuObjectData) * Objects.size();
+		const VkDeviceSize CommandSize = sizeof(DrawIndexedCommand) * Objects.size();
+
+		const std::vector<IndirectBatch>& Batches = m_DrawList.GetBatches();
+		const VkDeviceSize BatchSize = sizeof(IndirectBatch) * Batches.size();
+		t_Frame.m_BatchBuffer = new Buffer(BatchSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, HostFlags);
+		t_Frame.m_BatchBuffer->MapMemory(BatchSize);
+		memcpy(t_Frame.m_BatchBuffer->m_MappedMem, Batches.data(), BatchSize);
+		t_Frame.m_BatchBuffer->UnmapMemory();
+
+		// A storage buffer can't be empty, so models without any levels still get one entry that nothing reads
+		const std::vector<GpuLodData>& Lods = m_DrawList.GetLods();
+		const VkDeviceSize LodSize = sizeof(GpuLodData) * std::max<size_t>(Lods.size(), 1);
+		t_Frame.m_LodBuffer = new Buffer(LodSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, HostFlags);
+		t_Frame.m_LodBuffer->MapMemory(LodSize);
+		memset(t_Frame.m_LodBuffer->m_MappedMem, 0, LodSize);
+		memcpy(t_Frame.m_LodBuffer->m_MappedMem, Lods.data(), sizeof(GpuLodData) * Lods.size());
+		t_Frame.m_LodBuffer->UnmapMemory();
+
+		const VkDeviceSize LodLevelSize = sizeof(uint32) * Objects.size();
+		t_Frame.m_LodLevelBuffer = new Buffer(LodLevelSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, HostFlags);
+		t_Frame.m_LodLevelBuffer->MapMemory(LodLevelSize);
+		memset(t_Frame.m_LodLevelBuffer->m_MappedMem, 0, LodLevelSize);
+		t_Frame.m_LodLevelBuffer->UnmapMemory();
+
+		const VkDeviceSize CountSize = sizeof(uint32) * Batches.size();
+
+		t_Frame.m_ObjectBuffer = new Buffer(ObjectSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, HostFlags);
+		t_Frame.m_ObjectBuffer->MapMemory(ObjectSize);
+		memcpy(t_Frame.m_ObjectBuffer->m_MappedMem, Objects.data(), ObjectSize);
+
+		t_Frame.m_CommandBuffer = new Buffer(CommandSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, ResultFlags);
+
+		t_Frame.m_CountBuffer = new Buffer(
+			CountSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			ResultFlags);
+
+		if (m_Validate)
+		{
+			t_Frame.m_CommandBuffer->MapMemory(CommandSize);
+			t_Frame.m_CountBuffer->MapMemory(CountSize);
+		}
+	}
+
+	void GpuCullingPass::CreateDescriptorSets(FrameResources& t_Frame)
+	{
+		VkDevice Device = m_Device->GetVkDevice();
+
+		const uint32 BatchCount = m_DrawList.GetBatchCount();
+		if (BatchCount == 0)
+		{
+			return;
+		}
+
+		// One set for the G-Buffer and one for the cull shader. The textures are all in the
+		// bindless set, so batches don't need their own
+		std::vector<VkDescriptorPoolSize> PoolSizes =
+		{
+			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	1),
+			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,	7)
+		};
+
+		VkDescriptorPoolCreateInfo PoolInfo = {};
+		PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		PoolInfo.poolSizeCount = static_cast<uint32>(PoolSizes.size());
+		PoolInfo.pPoolSizes = PoolSizes.data();
+		PoolInfo.maxSets = 2;
+		VK_CHECK_RESULT(vkCreateDescriptorPool(Device, &PoolInfo, nullptr, &t_Frame.m_DescriptorPool));
+
+		VkDescriptorSetLayout GraphicsLayout = m_GraphicsPipeline->GetDescriptorSetLayout();
+
+		// Cull shader ------
+		VkDescriptorSetAllocateInfo ComputeAlloc = Initializers::DescriptorSetAllocateInfo(t_Frame.m_DescriptorPool, &m_ComputeSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(Device, &ComputeAlloc, &t_Frame.m_ComputeSet));
+
+		std::vector<VkWriteDescriptorSet> ComputeWrites =
+		{
+			// 0: Objects
+			Initializers::WriteDescriptorSet(t_Frame.m_ComputeSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &t_Frame.m_ObjectBuffer->GetDescriptor()),
+			// 1: Draw commands
+			Initializers::WriteDescriptorSet(t_Frame.m_ComputeSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &t_Frame.m_CommandBuffer->GetDescriptor()),
+			// 2: Batches
+			Initializers::WriteDescriptorSet(t_Frame.m_ComputeSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &t_Frame.m_BatchBuffer->GetDescriptor()),
+			// 3: Draw counts
+			Initializers::WriteDescriptorSet(t_Frame.m_ComputeSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &t_Frame.m_CountBuffer->GetDescriptor()),
+			// 4: Levels of detail of each batch
+			Initializers::WriteDescriptorSet(t_Frame.m_ComputeSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &t_Frame.m_LodBuffer->GetDescriptor()),
+			// 5: Level of each object
+			Initializers::WriteDescriptorSet(t_Frame.m_ComputeSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &t_Frame.m_LodLevelBuffer->GetDescriptor())
+		};
+		vkUpdateDescriptorSets(Device, static_cast<uint32>(ComputeWrites.size()), ComputeWrites.data(), 0, nullptr);
+
+		// G-Buffer ------
+		VkDescriptorSetAllocateInfo AllocInfo = Initializers::DescriptorSetAllocateInfo(t_Frame.m_DescriptorPool, &GraphicsLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(Device, &AllocInfo, &t_Frame.m_GraphicsSet));
+
+		std::vector<VkWriteDescriptorSet> Writes =
+		{
+			// 0: Camera UBO
+			Initializers::WriteDescriptorSetUniform(t_Frame.m_CameraBuffer, t_Frame.m_GraphicsSet, 0),
+			// 5: Objects, which have the texture slots
+			Initializers::WriteDescriptorSet(t_Frame.m_GraphicsSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &t_Frame.m_ObjectBuffer->GetDescriptor())
+		};
+		vkUpdateDescriptorSets(Device, static_cast<uint32>(Writes.size()), Writes.data(), 0, nullptr);
+	}
+
+	void GpuCullingPass::ReleaseBuffers(FrameResources& t_Frame)
+	{
+		for (Buffer** Buf : { &t_Frame.m_BatchBuffer, &t_Frame.m_LodBuffer, &t_Frame.m_LodLevelBuffer, &t_Frame.m_ObjectBuffer, &t_Frame.m_CommandBuffer, &t_Frame.m_CountBuffer })
+		{
+			if (*Buf)
+			{
+				delete *Buf;
+				*Buf = nullptr;
+			}
+		}
+
+		// Frees the sets too
+		if (t_Frame.m_DescriptorPool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(m_Device->GetVkDevice(), t_Frame.m_DescriptorPool, nullptr);
+			t_Frame.m_DescriptorPool = VK_NULL_HANDLE;
+		}
+		t_Frame.m_ComputeSet = VK_NULL_HANDLE;
+		t_Frame.m_GraphicsSet = VK_NULL_HANDLE;
+	}
+
+	void GpuCullingPass::ValidateResults(const FrameResources& t_Frame)
+	{
+		const DrawIndexedCommand* GpuCommands = static_cast<const DrawIndexedCommand*>(t_Frame.m_CommandBuffer->m_MappedMem);
+		const uint32* GpuCounts = m_Compact ? static_cast<const uint32*>(t_Frame.m_CountBuffer->m_MappedMem) : nullptr;
+		m_DrawList.GatherVisibleObjects(GpuCommands, GpuCounts, m_GpuVisible);
+
+		m_DrawList.Cull(t_Frame.m_Frustum, m_Compact, m_ReferenceCommands, m_ReferenceCounts);
+		m_DrawList.GatherVisibleObjects(m_ReferenceCommands.data(), m_Compact ? m_ReferenceCounts.data() : nullptr, m_CpuVisible);
+
+		if (m_GpuVisible != m_CpuVisible)
+		{
+			F_LOG_WARN("GPU culling does not match the CPU reference! GPU visible: {} CPU visible: {}", m_GpuVisible.size(), m_CpuVisible.size());
+		}
+
+		const uint32 Visible = static_cast<uint32>(m_GpuVisible.size());
+		Stats::Culling::SetFrustumCullResults(Visible, m_DrawList.GetObjectCount() - Visible);
+
+		// Only what the GPU actually drew, culled objects don't pick a level
+		uint32 Triangles = 0;
+		uint32 FullDetailTriangles = 0;
+		m_DrawList.CountTriangles(GpuCommands, GpuCounts, Triangles, FullDetailTriangles);
+		Stats::Lod::SetSelectionResults(Triangles, FullDetailTriangles);
+	}
+
+	void GpuCullingPass::OnMeshRendererChanged(entt::entity t_Ent, entt::registry& t_Reg, MeshRenderer& t_MeshRend)
+	{
+		m_LayoutDirty = true;
+	}
+
+	void GpuCullingPass::OnTransformAdded(entt::entity t_Ent, entt::registry& t_Reg, Transform& t_Trans)
+	{
+		m_LayoutDirty = true;
+	}
+
+	void GpuCullingPass::OnComponentRemoved(entt::entity t_Ent, entt::registry& t_Reg)
+	{
+		m_LayoutDirty = true;
+	}
+}   // namespace Fling
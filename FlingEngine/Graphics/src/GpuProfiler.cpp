@@ -0,0 +1,277 @@
+#include "pch.h"
+#include "GpuProfiler.h"
+#include "CommandBuffer.h"
+#include "LogicalDevice.h"
+#include "PhyscialDevice.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace Fling
+{
+	GpuProfiler::GpuProfiler(const LogicalDevice* t_Dev, VkCommandPool t_Pool)
+		: m_Device(t_Dev)
+	{
+		assert(m_Device);
+		const PhysicalDevice* PhysDev = m_Device->GetPhysicalDevice();
+		assert(PhysDev);
+
+		// Not every queue can write timestamps, and the ones that can may not use all 64 bits
+		uint32 FamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(PhysDev->GetVkPhysicalDevice(), &FamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> Families(FamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(PhysDev->GetVkPhysicalDevice(), &FamilyCount, Families.data());
+
+		const uint32 ValidBits = Families[m_Device->GetGraphicsFamily()].timestampValidBits;
+		m_ValidBitMask = ValidBits >= 64 ? ~0ULL : ((1ULL << ValidBits) - 1ULL);
+		m_NanosecondsPerTick = PhysDev->GetDeviceProps().limits.timestampPeriod;
+
+		if (!IsSupported())
+		{
+			F_LOG_WARN("The graphics queue doesn't support timestamps, GPU timings won't be available");
+			return;
+		}
+
+		m_FrameNameId = GetNameId("Frame");
+
+		VkQueryPoolCreateInfo PoolInfo = {};
+		PoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		PoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		PoolInfo.queryCount = QueriesPerFrame;
+
+		for (FrameQueries& Frame : m_Frames)
+		{
+			VK_CHECK_RESULT(vkCreateQueryPool(m_Device->GetVkDevice(), &PoolInfo, nullptr, &Frame.Pool));
+			Frame.StartCmdBuf = new CommandBuffer(m_Device, t_Pool);
+			Frame.Scopes.reserve(MaxScopes);
+		}
+	}
+
+	GpuProfiler::~GpuProfiler()
+	{
+		for (FrameQueries& Frame : m_Frames)
+		{
+			if (Frame.Pool != VK_NULL_HANDLE)
+			{
+				vkDestroyQueryPool(m_Device->GetVkDevice(), Frame.Pool, nullptr);
+				Frame.Pool = VK_NULL_HANDLE;
+			}
+
+			if (Frame.StartCmdBuf)
+			{
+				delete Frame.StartCmdBuf;
+				Frame.StartCmdBuf = nullptr;
+			}
+		}
+	}
+
+	void GpuProfiler::BeginFrame(uint32 t_FrameInFlight)
+	{
+		if (!IsSupported())
+		{
+			return;
+		}
+
+		assert(t_FrameInFlight < m_Frames.size());
+		FrameQueries& Frame = m_Frames[t_FrameInFlight];
+
+		// The fence of this frame was waited on, so the queries are done and this won't block
+		if (Frame.Pending)
+		{
+			Resolve(Frame);
+		}
+
+		m_ActiveFrame = t_FrameInFlight;
+		m_OpenDepth = 0;
+		Frame.Scopes.clear();
+
+		// Queries have to be reset outside of a render pass before they are written again
+		Frame.StartCmdBuf->Begin();
+		vkCmdResetQueryPool(Frame.StartCmdBuf->GetHandle(), Frame.Pool, 0, QueriesPerFrame);
+		vkCmdWriteTimestamp(Frame.StartCmdBuf->GetHandle(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, Frame.Pool, 0);
+		Frame.StartCmdBuf->End();
+
+		Frame.Pending = true;
+	}
+
+	void GpuProfiler::EndFrame(CommandBuffer& t_CmdBuf)
+	{
+		if (!IsSupported())
+		{
+			return;
+		}
+
+		vkCmdWriteTimestamp(t_CmdBuf.GetHandle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_Frames[m_ActiveFrame].Pool, 1);
+	}
+
+	uint32 GpuProfiler::BeginScope(CommandBuffer& t_CmdBuf, const char* t_Name)
+	{
+		FrameQueries& Frame = m_Frames[m_ActiveFrame];
+		if (!IsSupported() || !Frame.Pending)
+		{
+			return InvalidScope;
+		}
+
+		if (Frame.Scopes.size() >= MaxScopes)
+		{
+			if (!m_WarnedOverflow)
+			{
+				F_LOG_WARN("More than {} GPU profiler scopes in a frame, the rest are dropped", MaxScopes);
+				m_WarnedOverflow = true;
+			}
+			return InvalidScope;
+		}
+
+		const uint32 Index = static_cast<uint32>(Frame.Scopes.size());
+		Frame.Scopes.push_back({ GetNameId(t_Name), m_OpenDepth++ });
+
+		vkCmdWriteTimestamp(t_CmdBuf.GetHandle(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, Frame.Pool, 2 + Index * 2);
+		return Index;
+	}
+
+	void GpuProfiler::EndScope(CommandBuffer& t_CmdBuf, uint32 t_Scope)
+	{
+		if (t_Scope == InvalidScope)
+		{
+			return;
+		}
+
+		assert(m_OpenDepth > 0);
+		--m_OpenDepth;
+
+		vkCmdWriteTimestamp(t_CmdBuf.GetHandle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_Frames[m_ActiveFrame].Pool, 3 + t_Scope * 2);
+	}
+
+	uint32 GpuProfiler::GetNameId(const char* t_Name)
+	{
+		assert(t_Name);
+		auto It = m_NameIds.find(t_Name);
+		if (It != m_NameIds.end())
+		{
+			return It->second;
+		}
+
+		std::lock_guard<std::mutex> Lock(m_TraceMutex);
+		const uint32 Id = static_cast<uint32>(m_Names.size());
+		m_Names.emplace_back(t_Name);
+		m_NameIds.emplace(m_Names.back(), Id);
+		m_AverageMilliseconds.push_back(0.0f);
+		return Id;
+	}
+
+	void GpuProfiler::Resolve(FrameQueries& t_Frame)
+	{
+		t_Frame.Pending = false;
+
+		const uint32 QueryCount = 2 + static_cast<uint32>(t_Frame.Scopes.size()) * 2;
+		std::array<uint64, QueriesPerFrame> Results;
+
+		// No wait flag, a frame that isn't complete (like one that was never submitted) is skipped
+		VkResult Res = vkGetQueryPoolResults(
+			m_Device->GetVkDevice(), t_Frame.Pool,
+			0, QueryCount,
+			sizeof(uint64) * QueryCount, Results.data(), sizeof(uint64),
+			VK_QUERY_RESULT_64_BIT);
+
+		if (Res != VK_SUCCESS)
+		{
+			return;
+		}
+
+		if (!m_HasTraceBase)
+		{
+			m_TraceBase = Results[0];
+			m_HasTraceBase = true;
+		}
+
+		auto ToMicroseconds = [this](uint64 t_Ticks)
+		{
+			return TicksToMilliseconds(m_TraceBase, t_Ticks, m_ValidBitMask, m_NanosecondsPerTick) * 1000.0;
+		};
+
+		const float FrameTime = static_cast<float>(TicksToMilliseconds(Results[0], Results[1], m_ValidBitMask, m_NanosecondsPerTick));
+		m_AverageFrameTime = m_AverageFrameTime > 0.0f ? m_AverageFrameTime + (FrameTime - m_AverageFrameTime) * AverageWeight : FrameTime;
+		m_LastFrameTime = FrameTime;
+		++m_ResolvedFrameCount;
+
+		std::lock_guard<std::mutex> Lock(m_TraceMutex);
+		m_Trace.push_back({ m_FrameNameId, 0, true, ToMicroseconds(Results[0]), FrameTime * 1000.0 });
+
+		m_LastTimings.clear();
+		for (size_t i = 0; i < t_Frame.Scopes.size(); ++i)
+		{
+			const ScopeRecord& Record = t_Frame.Scopes[i];
+			const uint64 Begin = Results[2 + i * 2];
+			const uint64 End = Results[3 + i * 2];
+			const float Milliseconds = static_cast<float>(TicksToMilliseconds(Begin, End, m_ValidBitMask, m_NanosecondsPerTick));
+
+			float& Average = m_AverageMilliseconds[Record.NameId];
+			Average = Average > 0.0f ? Average + (Milliseconds - Average) * AverageWeight : Milliseconds;
+
+			Stats::GpuScopeTiming Timing = {};
+			Timing.Name = m_Names[Record.NameId].c_str();
+			Timing.Depth = Record.Depth;
+			Timing.Milliseconds = Milliseconds;
+			Timing.AverageMilliseconds = Average;
+			m_LastTimings.push_back(Timing);
+
+			m_Trace.push_back({ Record.NameId, Record.Depth + 1, false, ToMicroseconds(Begin), Milliseconds * 1000.0 });
+		}
+
+		// Drop the oldest frame, including its scopes
+		if (++m_TraceFrames > TraceFrameCount)
+		{
+			m_Trace.pop_front();
+			while (!m_Trace.empty() && !m_Trace.front().IsFrame)
+			{
+				m_Trace.pop_front();
+			}
+			--m_TraceFrames;
+		}
+
+		Stats::Gpu::SetFrameResults(FrameTime, m_AverageFrameTime, m_LastTimings);
+	}
+
+	float GpuProfiler::GetLastScopeTime(const char* t_Name) const
+	{
+		assert(t_Name);
+		for (const Stats::GpuScopeTiming& Timing : m_LastTimings)
+		{
+			if (std::strcmp(Timing.Name, t_Name) == 0)
+			{
+				return Timing.Milliseconds;
+			}
+		}
+		return 0.0f;
+	}
+
+	bool GpuProfiler::ExportTrace(const std::string& t_Path) const
+	{
+		FILE* File = fopen(t_Path.c_str(), "w");
+		if (!File)
+		{
+			F_LOG_ERROR("Failed to open {} to write the GPU trace", t_Path);
+			return false;
+		}
+
+		std::lock_guard<std::mutex> Lock(m_TraceMutex);
+
+		// Complete ("X") events on one track, nested scopes show up under the frame that they are in
+		fprintf(File, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		for (size_t i = 0; i < m_Trace.size(); ++i)
+		{
+			const TraceEvent& Event = m_Trace[i];
+			fprintf(File, "%s{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}",
+				i > 0 ? ",\n" : "",
+				m_Names[Event.NameId].c_str(),
+				Event.Start,
+				Event.Duration,
+				Event.Depth);
+		}
+		fprintf(File, "\n]}\n");
+		fclose(File);
+
+		F_LOG_TRACE("Wrote {} GPU frames to {}", m_TraceFrames, t_Path);
+		return true;
+	}
+}   // namespace Fling
@@ -67,7 +67,8 @@ namespace Fling
 			LogicalDevice* Dev = VulkanApp::Get().GetLogicalDevice();
 			assert(Dev);
             VkDevice Device = Dev->GetVkDevice();
-            const VkCommandPool& CommandPool = VulkanApp::Get().GetCommandPool();
+            // Not the draw pool, the render thread may be recording from that one
+            const VkCommandPool& CommandPool = VulkanApp::Get().GetSingleTimeCommandPool();
 
             VkCommandBufferAllocateInfo allocInfo = {};
             allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -91,7 +92,7 @@ namespace Fling
 			LogicalDevice* Dev = VulkanApp::Get().GetLogicalDevice();
 			assert(Dev);
             VkDevice Device = Dev->GetVkDevice();
-            VkCommandPool CmdPool = VulkanApp::Get().GetCommandPool();
+            VkCommandPool CmdPool = VulkanApp::Get().GetSingleTimeCommandPool();
             VkQueue GraphicsQueue = Dev->GetGraphicsQueue();
 
             vkEndCommandBuffer(t_CommandBuffer);
@@ -101,8 +102,11 @@ namespace Fling
             submitInfo.commandBufferCount = 1;
             submitInfo.pCommandBuffers = &t_CommandBuffer;
 
-            vkQueueSubmit(GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-            vkQueueWaitIdle(GraphicsQueue);
+            {
+                std::lock_guard<std::mutex> Lock(VulkanApp::Get().GetQueueMutex());
+                vkQueueSubmit(GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+                vkQueueWaitIdle(GraphicsQueue);
+            }
 
             vkFreeCommandBuffers(Device, CmdPool, 1, &t_CommandBuffer);
         }
@@ -424,20 +428,6 @@ namespace Fling
 
         }
 
-        void CreatePipelineCache(VkPipelineCache& t_PipelineCache)
-        {
-			LogicalDevice* Dev = VulkanApp::Get().GetLogicalDevice();
-			assert(Dev);
-			VkDevice Device = Dev->GetVkDevice();
-
-            VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
-            pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-            if (vkCreatePipelineCache(Device, &pipelineCacheCreateInfo, nullptr, &t_PipelineCache) != VK_SUCCESS)
-            {
-                F_LOG_FATAL("Failed to create pipeline cache");
-            }
-        }
-
         void TransitionImageLayout(
             VkImage t_Image, 
             VkFormat t_Format, 
@@ -1,5 +1,8 @@
 #include "GraphicsPipeline.h"
 #include "GraphicsHelpers.h"
+#include "Model.h"
+#include "PipelineCache.h"
+#include "VulkanApp.h"
 
 namespace Fling
 {
@@ -27,6 +30,23 @@ namespace Fling
 		CreateAttributes(nullptr);
     }
 
+    void GraphicsPipeline::SetPipelineLayout(const std::vector<VkDescriptorSetLayout>& t_ExtraSetLayouts, VkShaderStageFlags t_PushConstantStages, uint32 t_PushConstantSize)
+    {
+        assert(m_Pipeline == VK_NULL_HANDLE && !m_HasPendingPipeline);
+
+        vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+        m_PipelineLayout = Shader::CreatePipelineLayout(m_Device, m_DescriptorSetLayout, t_PushConstantStages, t_PushConstantSize, t_ExtraSetLayouts);
+    }
+
+    void GraphicsPipeline::UsePositionStream()
+    {
+        assert(m_Pipeline == VK_NULL_HANDLE && !m_HasPendingPipeline);
+
+        const VertexFormat Format = Model::GetVertexFormat();
+        m_VertexBindings = { Vertex::GetPositionBindingDescription(Format) };
+        m_VertexAttributes = { Vertex::GetPositionAttributeDescription(Format) };
+    }
+
     void GraphicsPipeline::BindGraphicsPipeline(const VkCommandBuffer& t_CommandBuffer)
     {
         vkCmdBindPipeline(t_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
@@ -91,15 +111,20 @@ namespace Fling
         m_ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         m_ViewportState.viewportCount = 1;
         m_ViewportState.scissorCount = 1;
+
+        // Vertex Input
+        // Every model has the same vertex format, so every pipeline can use it
+        const VertexFormat Format = Model::GetVertexFormat();
+        m_VertexBindings = { Vertex::GetBindingDescription(Format) };
+        m_VertexAttributes = Vertex::GetAttributeDescriptions(Format);
     }
 
-    void GraphicsPipeline::CreateGraphicsPipeline(VkRenderPass& t_RenderPass, Multisampler* t_Sampler)
+    void GraphicsPipeline::CreateGraphicsPipeline(VkRenderPass& t_RenderPass, Multisampler* t_Sampler, bool t_Async)
     {
-        // Pipeline Cache
-        GraphicsHelpers::CreatePipelineCache(m_PipelineCache);
+        PipelineCache* Cache = VulkanApp::Get().GetPipelineCache();
+        assert(Cache);
 
-        // Shader stages 
-        std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+        GraphicsPipelineDesc Desc = {};
 
         for (Shader* shader : m_Shaders)
         {
@@ -108,51 +133,83 @@ namespace Fling
             createInfo.module = shader->GetShaderModule();
             createInfo.stage = shader->GetStage();
             createInfo.pName = "main";
-            createInfo.flags = 0;
-            createInfo.pNext = nullptr;
-            createInfo.pSpecializationInfo = nullptr;
-            shaderStages.push_back(createInfo);
+            Desc.Stages.push_back(createInfo);
+        }
+
+        Desc.VertexBindings = m_VertexBindings;
+        Desc.VertexAttributes = m_VertexAttributes;
+        Desc.InputAssembly = m_InputAssemblyState;
+        Desc.Rasterization = m_RasterizationState;
+        Desc.Multisample = m_MultisampleState;
+        Desc.DepthStencil = m_DepthStencilState;
+        Desc.ColorBlend = m_ColorBlendState;
+        Desc.BlendAttachments = m_ColorBlendAttachmentStates;
+        Desc.Viewport = m_ViewportState;
+        Desc.DynamicStates.assign(m_DynamicState.pDynamicStates, m_DynamicState.pDynamicStates + m_DynamicState.dynamicStateCount);
+        Desc.Layout = m_PipelineLayout;
+        Desc.RenderPass = t_RenderPass;
+        Desc.Subpass = m_Subpass;
+
+        PipelineKey Key = Cache->MakeKey(Desc);
+        const uint64 RenderPassHash = Cache->GetRenderPassHash(t_RenderPass);
+
+        if (!t_Async)
+        {
+            m_Pipeline = Cache->GetOrCreate(Key, Desc);
+            m_RenderPassHash = RenderPassHash;
+            m_HasPendingPipeline = false;
+
+            if (m_Pipeline == VK_NULL_HANDLE)
+            {
+                F_LOG_FATAL("Failed to create graphics pipeline");
+            }
+            return;
         }
 
-        // Vertex Input 
-        VkVertexInputBindingDescription BindingDescription = Vertex::GetBindingDescription();
-        std::array<VkVertexInputAttributeDescription, 5> AttributeDescriptions = Vertex::GetAttributeDescriptions();
-
-        m_VertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        m_VertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
-        m_VertexInputStateCreateInfo.pVertexBindingDescriptions = &BindingDescription;
-        m_VertexInputStateCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32>(AttributeDescriptions.size());
-        m_VertexInputStateCreateInfo.pVertexAttributeDescriptions = AttributeDescriptions.data();
-
-
-        // Create graphics pipeline ------------------------
-        m_PipelineCreateInfo = {};
-        m_PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        m_PipelineCreateInfo.stageCount = static_cast<uint32>(shaderStages.size());
-        m_PipelineCreateInfo.pStages = shaderStages.data();
-        m_PipelineCreateInfo.pVertexInputState = &m_VertexInputStateCreateInfo;
-        m_PipelineCreateInfo.pInputAssemblyState = &m_InputAssemblyState;
-        m_PipelineCreateInfo.pViewportState = &m_ViewportState;
-        m_PipelineCreateInfo.pRasterizationState = &m_RasterizationState;
-        m_PipelineCreateInfo.pMultisampleState = &m_MultisampleState;
-        m_PipelineCreateInfo.pDepthStencilState = &m_DepthStencilState;
-        m_PipelineCreateInfo.pDynamicState = &m_DynamicState;
-        m_PipelineCreateInfo.pColorBlendState = &m_ColorBlendState;
-        m_PipelineCreateInfo.layout = m_PipelineLayout;
-        m_PipelineCreateInfo.renderPass = t_RenderPass;
-        m_PipelineCreateInfo.subpass = 0;
-
-        if (vkCreateGraphicsPipelines(m_Device, m_PipelineCache, 1, &m_PipelineCreateInfo, nullptr, &m_Pipeline) != VK_SUCCESS)
+        VkPipeline Ready = Cache->Request(Key, Desc);
+        if (Ready != VK_NULL_HANDLE)
         {
-            F_LOG_FATAL("Failed to create graphics pipeline");
+            m_Pipeline = Ready;
+            m_RenderPassHash = RenderPassHash;
+            m_HasPendingPipeline = false;
+            return;
         }
+
+        // The old pipeline can keep drawing until the new one is ready, unless the render pass changed
+        if (RenderPassHash != m_RenderPassHash)
+        {
+            m_Pipeline = VK_NULL_HANDLE;
+            m_RenderPassHash = RenderPassHash;
+        }
+
+        m_PendingKey = std::move(Key);
+        m_HasPendingPipeline = true;
+    }
+
+    bool GraphicsPipeline::PrepareForDraw()
+    {
+        if (m_HasPendingPipeline)
+        {
+            VkPipeline Ready = VulkanApp::Get().GetPipelineCache()->Find(m_PendingKey);
+            if (Ready != VK_NULL_HANDLE)
+            {
+                m_Pipeline = Ready;
+                m_HasPendingPipeline = false;
+            }
+        }
+
+        return m_Pipeline != VK_NULL_HANDLE;
     }
 
     GraphicsPipeline::~GraphicsPipeline()
     {
+        // The cache is already gone if the pipeline outlived the renderer, it destroyed the pipelines then
+        if (PipelineCache* Cache = VulkanApp::Get().GetPipelineCache())
+        {
+            Cache->ReleaseLayout(m_PipelineLayout);
+        }
+
         vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
-        vkDestroyPipeline(m_Device, m_Pipeline, nullptr);
         vkDestroyDescriptorSetLayout(m_Device, m_DescriptorSetLayout, nullptr);
-        vkDestroyPipelineCache(m_Device, m_PipelineCache, nullptr);
     }
-}
\ No newline at end of file
+}
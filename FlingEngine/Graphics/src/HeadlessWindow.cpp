@@ -0,0 +1,30 @@
+#include "pch.h"
+#include "HeadlessWindow.h"
+#include "FlingVulkan.h"
+
+namespace Fling
+{
+	HeadlessWindow::HeadlessWindow(const WindowProps& t_Props, uint32 t_FrameCount)
+		: m_Width(t_Props.m_Width)
+		, m_Height(t_Props.m_Height)
+		, m_FrameLimit(t_FrameCount)
+	{
+		assert(m_Width > 0 && m_Height > 0);
+		F_LOG_TRACE("Running headless at {}x{}", m_Width, m_Height);
+	}
+
+	void HeadlessWindow::CreateSurface(void* t_GraphicsInstance, void* t_SurfData)
+	{
+		*static_cast<VkSurfaceKHR*>(t_SurfData) = VK_NULL_HANDLE;
+	}
+
+	void HeadlessWindow::Update()
+	{
+		++m_FramesUpdated;
+	}
+
+	int HeadlessWindow::ShouldClose()
+	{
+		return m_FrameLimit > 0 && m_FramesUpdated >= m_FrameLimit;
+	}
+}   // namespace Fling
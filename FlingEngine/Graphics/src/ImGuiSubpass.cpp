@@ -8,15 +8,19 @@
 #include "MeshRenderer.h"
 #include "SwapChain.h"
 #include "UniformBufferObject.h"
-#include "FirstPersonCamera.h"
+#include "RenderSnapshot.h"
 #include "FlingVulkan.h"
 #include "BaseEditor.h"
+#include "DebugDraw.h"
+#include "VulkanApp.h"
 
 #include <imgui.h>
 #include <algorithm>
 
 namespace Fling
 {
+	static_assert(sizeof(ImDrawIdx) == sizeof(uint16), "The UI index buffer is bound as 16 bit");
+
 	ImGuiSubpass::ImGuiSubpass(
 		const LogicalDevice* t_Dev,
 		const Swapchain* t_Swap,
@@ -68,33 +72,76 @@ namespace Fling
 		vkDestroyDescriptorSetLayout(logicalDevice, m_descriptorSetLayout, nullptr);
 	}
 
-	void ImGuiSubpass::Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, entt::registry& t_reg, float DeltaTime)
+	void ImGuiSubpass::Extract(entt::registry& t_reg, RenderSnapshot& t_Snapshot)
 	{
 		ImGui::NewFrame();
 
 		if (m_Editor)
 		{
-			m_Editor->Draw(t_reg, DeltaTime);
+			m_Editor->Draw(t_reg, t_Snapshot.DeltaTime);
 		}
 
+		DrawDebugText(t_Snapshot);
+
 		ImGui::Render();
 
-		UpdateUniforms();
+		CopyDrawData(t_Snapshot.Ui);
+	}
 
-		BuildCommandBuffer(t_CmdBuf.GetHandle());
+	void ImGuiSubpass::Draw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot)
+	{
+		UpdateUniforms(t_Snapshot.Ui, t_ActiveFrameInFlight);
+
+		BuildCommandBuffer(t_CmdBuf.GetHandle(), t_Snapshot.Ui, t_ActiveFrameInFlight);
 	}
 
-	void ImGuiSubpass::BuildCommandBuffer(VkCommandBuffer t_commandBuffer)
+	void ImGuiSubpass::CopyDrawData(UiDrawSnapshot& t_Ui)
 	{
-		ImGuiIO& io = ImGui::GetIO();
+		ImDrawData* imDrawData = ImGui::GetDrawData();
 
+		t_Ui.DisplaySize = glm::vec2(ImGui::GetIO().DisplaySize.x, ImGui::GetIO().DisplaySize.y);
+		t_Ui.Vertices.resize(imDrawData->TotalVtxCount * sizeof(ImDrawVert));
+		t_Ui.Indices.resize(imDrawData->TotalIdxCount);
+		t_Ui.Commands.clear();
+
+		uint8* vtxDst = t_Ui.Vertices.data();
+		ImDrawIdx* idxDst = t_Ui.Indices.data();
+		int32 vertexOffset = 0;
+		uint32 indexOffset = 0;
+
+		// Every draw list goes into one vertex and index buffer, so the commands are offset by the lists before them
+		for (int32 i = 0; i < imDrawData->CmdListsCount; ++i)
+		{
+			const ImDrawList* cmd_list = imDrawData->CmdLists[i];
+			memcpy(vtxDst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+			memcpy(idxDst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+			vtxDst += cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+			idxDst += cmd_list->IdxBuffer.Size;
 
+			for (int32 j = 0; j < cmd_list->CmdBuffer.Size; ++j)
+			{
+				const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[j];
+
+				UiDrawSnapshot::Command& Cmd = t_Ui.Commands.emplace_back();
+				Cmd.ClipRect = glm::vec4(pcmd->ClipRect.x, pcmd->ClipRect.y, pcmd->ClipRect.z, pcmd->ClipRect.w);
+				Cmd.ElemCount = pcmd->ElemCount;
+				Cmd.FirstIndex = indexOffset;
+				Cmd.VertexOffset = vertexOffset;
+				indexOffset += pcmd->ElemCount;
+			}
+
+			vertexOffset += cmd_list->VtxBuffer.Size;
+		}
+	}
+
+	void ImGuiSubpass::BuildCommandBuffer(VkCommandBuffer t_commandBuffer, const UiDrawSnapshot& t_Ui, uint32 t_ActiveFrameInFlight)
+	{
 		vkCmdBindDescriptorSets(t_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
 		vkCmdBindPipeline(t_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeLine);
 
 		//for minimizing screen 
-		float displayWidth = ImGui::GetIO().DisplaySize.x ? ImGui::GetIO().DisplaySize.x : .0001f;
-		float displayHeight = ImGui::GetIO().DisplaySize.y ? ImGui::GetIO().DisplaySize.y : .0001f;
+		float displayWidth = t_Ui.DisplaySize.x ? t_Ui.DisplaySize.x : .0001f;
+		float displayHeight = t_Ui.DisplaySize.y ? t_Ui.DisplaySize.y : .0001f;
 
 		VkViewport viewport = Initializers::Viewport(
 			displayWidth,
@@ -104,7 +151,7 @@ namespace Fling
 		vkCmdSetViewport(t_commandBuffer, 0, 1, &viewport);
 
 		//UI scale and translate via push constants
-		pushConstBlock.scale = glm::vec2(2.0f / io.DisplaySize.x, 2.0f / io.DisplaySize.y);
+		pushConstBlock.scale = glm::vec2(2.0f / t_Ui.DisplaySize.x, 2.0f / t_Ui.DisplaySize.y);
 		pushConstBlock.translate = glm::vec2(-1.0f);
 		vkCmdPushConstants(
 			t_commandBuffer,
@@ -115,43 +162,31 @@ namespace Fling
 			&pushConstBlock);
 
 		//Render commands 
-		ImDrawData* imDrawData = ImGui::GetDrawData();
-		uint32 vertexOffset = 0;
-		uint32 indexOffset = 0;
-
-		if (imDrawData->CmdListsCount > 0)
+		if (!t_Ui.Commands.empty())
 		{
 			VkDeviceSize offsets[1] = { 0 };
 			vkCmdBindVertexBuffers(
 				t_commandBuffer,
 				0,
 				1,
-				&m_vertexBuffer->GetVkBuffer(),
+				&m_vertexBuffers[t_ActiveFrameInFlight]->GetVkBuffer(),
 				offsets);
 
 			vkCmdBindIndexBuffer(
 				t_commandBuffer,
-				m_indexBuffer->GetVkBuffer(),
+				m_indexBuffers[t_ActiveFrameInFlight]->GetVkBuffer(),
 				0,
 				VK_INDEX_TYPE_UINT16);
 
-			for (int32 i = 0; i < imDrawData->CmdListsCount; ++i)
+			for (const UiDrawSnapshot::Command& Cmd : t_Ui.Commands)
 			{
-				const ImDrawList* cmd_list = imDrawData->CmdLists[i];
-				for (int32 j = 0; j < cmd_list->CmdBuffer.Size; ++j)
-				{
-					const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[j];
-					VkRect2D scissorRect;
-					scissorRect.offset.x = std::max((int32)(pcmd->ClipRect.x), 0);
-					scissorRect.offset.y = std::max((int32)(pcmd->ClipRect.y), 0);
-					scissorRect.extent.width = (int32)(pcmd->ClipRect.z - pcmd->ClipRect.x);
-					scissorRect.extent.height = (int32)(pcmd->ClipRect.w - pcmd->ClipRect.y);
-					vkCmdSetScissor(t_commandBuffer, 0, 1, &scissorRect);
-					vkCmdDrawIndexed(t_commandBuffer, pcmd->ElemCount, 1, indexOffset, vertexOffset, 0);
-					indexOffset += pcmd->ElemCount;
-				}
-
-				vertexOffset += cmd_list->VtxBuffer.Size;
+				VkRect2D scissorRect;
+				scissorRect.offset.x = std::max((int32)(Cmd.ClipRect.x), 0);
+				scissorRect.offset.y = std::max((int32)(Cmd.ClipRect.y), 0);
+				scissorRect.extent.width = (int32)(Cmd.ClipRect.z - Cmd.ClipRect.x);
+				scissorRect.extent.height = (int32)(Cmd.ClipRect.w - Cmd.ClipRect.y);
+				vkCmdSetScissor(t_commandBuffer, 0, 1, &scissorRect);
+				vkCmdDrawIndexed(t_commandBuffer, Cmd.ElemCount, 1, Cmd.FirstIndex, Cmd.VertexOffset, 0);
 			}
 		}
 	}
@@ -374,6 +409,7 @@ namespace Fling
 
 		VkGraphicsPipelineCreateInfo pipelineCreateInfo =
 			Initializers::PipelineCreateInfo(m_pipelineLayout, m_GlobalRenderPass);
+		pipelineCreateInfo.subpass = m_SubpassIndex;
 
 		pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
 		pipelineCreateInfo.pRasterizationState = &rasterizationState;
@@ -434,57 +470,81 @@ namespace Fling
 
 	void ImGuiSubpass::PrepareResources()
 	{
-		// Create vert and index buffers for use with imgui geometry
-		m_indexBuffer = std::make_unique<Buffer>();
-		m_vertexBuffer = std::make_unique<Buffer>();
+		// Create vert and index buffers for use with imgui geometry, big enough for a typical editor layout
+		for (int32 i = 0; i < VkConfig::MAX_FRAMES_IN_FLIGHT; ++i)
+		{
+			ReserveGeometryBuffer(m_vertexBuffers[i], InitialVertexCapacity * sizeof(ImDrawVert), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+			ReserveGeometryBuffer(m_indexBuffers[i], InitialIndexCapacity * sizeof(ImDrawIdx), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+		}
 	}
-	
-	void ImGuiSubpass::UpdateUniforms()
-	{
-		ImDrawData* imDrawData = ImGui::GetDrawData();
 
-		VkDeviceSize vertexBufferSize = imDrawData->TotalVtxCount * sizeof(ImDrawVert);
-		VkDeviceSize indexBufferSize = imDrawData->TotalIdxCount * sizeof(ImDrawIdx);
-
-		if ((vertexBufferSize == 0) || (indexBufferSize == 0)) 
+	void ImGuiSubpass::ReserveGeometryBuffer(std::unique_ptr<Buffer>& t_Buffer, VkDeviceSize t_Size, VkBufferUsageFlags t_Usage)
+	{
+		if (t_Buffer && t_Buffer->GetSize() >= t_Size)
 		{
 			return;
 		}
 
-		if ((m_vertexBuffer->GetVkBuffer() == VK_NULL_HANDLE) ||
-			(m_vertexCount != imDrawData->TotalVtxCount))
+		VkDeviceSize NewSize = t_Buffer ? t_Buffer->GetSize() : t_Size;
+		while (NewSize < t_Size)
 		{
-			m_vertexBuffer->UnmapMemory();
-			m_vertexBuffer->Release();
-
-			m_vertexBuffer->CreateBuffer(vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, true);
-			m_vertexCount = imDrawData->TotalVtxCount;
-			m_vertexBuffer->MapMemory();
+			NewSize *= 2;
 		}
 
-		if ((m_indexBuffer->GetVkBuffer() == VK_NULL_HANDLE) ||
-			(m_indexCount < imDrawData->TotalIdxCount))
+		// Coherent so that nothing has to be flushed after writing
+		t_Buffer = std::make_unique<Buffer>(NewSize, t_Usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		t_Buffer->MapMemory(NewSize);
+	}
+	
+	void ImGuiSubpass::DrawDebugText(const RenderSnapshot& t_Snapshot)
+	{
+#if WITH_DEBUG_DRAW
+		// The snapshot doesn't have the shapes yet, they are moved into it after every subpass extracted
+		const std::vector<DebugText>& Texts = DebugDraw::GetList().GetTexts();
+		if (Texts.empty())
 		{
-			m_indexBuffer->UnmapMemory();
-			m_indexBuffer->Release();
+			return;
+		}
+
+		// Same projection that the debug lines are drawn with
+		glm::mat4 Projection = t_Snapshot.Projection;
+		Projection[1][1] *= -1.0f;
+		const glm::mat4 ViewProj = Projection * t_Snapshot.View;
+
+		const ImVec2& DisplaySize = ImGui::GetIO().DisplaySize;
+		ImDrawList* DrawList = ImGui::GetBackgroundDrawList();
 
-			m_indexBuffer->CreateBuffer(indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, true);
-			m_indexCount = imDrawData->TotalIdxCount;
-			m_indexBuffer->MapMemory();
+		for (const DebugText& Text : Texts)
+		{
+			glm::vec2 Pixel;
+			if (DebugDrawList::ProjectToScreen(ViewProj, Text.Pos, glm::vec2(DisplaySize.x, DisplaySize.y), Pixel))
+			{
+				DrawList->AddText(ImVec2(Pixel.x, Pixel.y), Text.Color, Text.Text.c_str());
+			}
 		}
+#endif	// WITH_DEBUG_DRAW
+	}
 
-		ImDrawVert* vtxDst = (ImDrawVert*)m_vertexBuffer->m_MappedMem;
-		ImDrawIdx* idxDst = (ImDrawIdx*)m_indexBuffer->m_MappedMem;
+	void ImGuiSubpass::UpdateUniforms(const UiDrawSnapshot& t_Ui, uint32 t_ActiveFrameInFlight)
+	{
+		VkDeviceSize vertexBufferSize = t_Ui.Vertices.size();
+		VkDeviceSize indexBufferSize = t_Ui.Indices.size() * sizeof(ImDrawIdx);
 
-		for (int n = 0; n < imDrawData->CmdListsCount; ++n) {
-			const ImDrawList* cmd_list = imDrawData->CmdLists[n];
-			memcpy(vtxDst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
-			memcpy(idxDst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
-			vtxDst += cmd_list->VtxBuffer.Size;
-			idxDst += cmd_list->IdxBuffer.Size;
+		if ((vertexBufferSize == 0) || (indexBufferSize == 0)) 
+		{
+			return;
 		}
 
-		m_vertexBuffer->Flush(VK_WHOLE_SIZE, 0);
-		m_indexBuffer->Flush(VK_WHOLE_SIZE, 0);
+		// Only touch the buffers of this frame, the other frame in flight may still be drawing with its own.
+		// Its last submission has finished, so replacing them when they are too small is safe too
+		ReserveGeometryBuffer(m_vertexBuffers[t_ActiveFrameInFlight], vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		ReserveGeometryBuffer(m_indexBuffers[t_ActiveFrameInFlight], indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+		Buffer* vertexBuffer = m_vertexBuffers[t_ActiveFrameInFlight].get();
+		Buffer* indexBuffer = m_indexBuffers[t_ActiveFrameInFlight].get();
+
+		// The draw lists were already packed back to back when the snapshot was taken
+		memcpy(vertexBuffer->m_MappedMem, t_Ui.Vertices.data(), static_cast<size_t>(vertexBufferSize));
+		memcpy(indexBuffer->m_MappedMem, t_Ui.Indices.data(), static_cast<size_t>(indexBufferSize));
 	}
 }   // namespace Fling
\ No newline at end of file
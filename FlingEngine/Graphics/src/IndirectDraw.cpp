@@ -0,0 +1,229 @@
+#include "pch.h"
+#include "IndirectDraw.h"
+
+#include <algorithm>
+
+namespace Fling
+{
+	void IndirectDrawList::Clear()
+	{
+		m_Objects.clear();
+		m_Batches.clear();
+		m_Lods.clear();
+	}
+
+	uint32 IndirectDrawList::BeginBatch()
+	{
+		IndirectBatch Batch = {};
+		Batch.FirstCommand = GetObjectCount();
+		Batch.FirstLod = static_cast<uint32>(m_Lods.size());
+		m_Batches.emplace_back(Batch);
+		return GetBatchCount() - 1;
+	}
+
+	uint32 IndirectDrawList::AddObject(GpuObjectData t_Object)
+	{
+		assert(!m_Batches.empty() && "BeginBatch must be called before adding objects");
+
+		t_Object.BatchIndex = GetBatchCount() - 1;
+		m_Batches.back().CommandCount++;
+		m_Objects.emplace_back(t_Object);
+		return GetObjectCount() - 1;
+	}
+
+	void IndirectDrawList::AddLod(const GpuLodData& t_Lod)
+	{
+		assert(!m_Batches.empty() && "BeginBatch must be called before adding levels of detail");
+
+		m_Batches.back().LodCount++;
+		m_Lods.emplace_back(t_Lod);
+	}
+
+	void IndirectDrawList::GetCullConstants(const Frustum& t_Frustum, bool t_Compact, GpuCullConstants& t_OutConstants) const
+	{
+		LodSelector FullDetail;
+		FullDetail.ThresholdPixels = 0.0f;
+		GetCullConstants(t_Frustum, t_Compact, FullDetail, t_OutConstants);
+	}
+
+	void IndirectDrawList::GetCullConstants(const Frustum& t_Frustum, bool t_Compact, const LodSelector& t_Lods, GpuCullConstants& t_OutConstants) const
+	{
+		for (uint32 i = 0; i < Frustum::Count; ++i)
+		{
+			t_OutConstants.Planes[i] = t_Frustum.m_Planes[i];
+		}
+		t_OutConstants.ObjectCount = GetObjectCount();
+		t_OutConstants.Compact = t_Compact ? 1 : 0;
+		t_OutConstants.LodThreshold = t_Lods.ThresholdPixels;
+		t_OutConstants.LodHysteresis = t_Lods.Hysteresis;
+		t_OutConstants.LodCamera = glm::vec4(t_Lods.CameraPos, t_Lods.PixelsPerUnit);
+	}
+
+	void IndirectDrawList::Cull(const Frustum& t_Frustum, bool t_Compact, std::vector<DrawIndexedCommand>& t_OutCommands, std::vector<uint32>& t_OutBatchCounts) const
+	{
+		GpuCullConstants Constants = {};
+		GetCullConstants(t_Frustum, t_Compact, Constants);
+
+		std::vector<uint32> LodLevels;
+		Cull(Constants, LodLevels, t_OutCommands, t_OutBatchCounts);
+	}
+
+	void IndirectDrawList::Cull(const GpuCullConstants& t_Constants, std::vector<uint32>& t_LodLevels, std::vector<DrawIndexedCommand>& t_OutCommands, std::vector<uint32>& t_OutBatchCounts) const
+	{
+		t_OutCommands.assign(m_Objects.size(), DrawIndexedCommand {});
+		t_OutBatchCounts.assign(m_Batches.size(), 0);
+		t_LodLevels.resize(m_Objects.size(), 0);
+
+		Frustum CullFrustum;
+		for (uint32 i = 0; i < Frustum::Count; ++i)
+		{
+			CullFrustum.m_Planes[i] = t_Constants.Planes[i];
+		}
+		const bool Compact = t_Constants.Compact != 0;
+
+		for (uint32 i = 0; i < GetObjectCount(); ++i)
+		{
+			const GpuObjectData& Object = m_Objects[i];
+			const IndirectBatch& Batch = m_Batches[Object.BatchIndex];
+			const bool Visible = IsVisible(Object, CullFrustum);
+
+			DrawIndexedCommand Command = {};
+			Command.IndexCount = Object.IndexCount;
+			Command.InstanceCount = Visible ? 1 : 0;
+			Command.FirstIndex = Object.FirstIndex;
+			Command.VertexOffset = Object.VertexOffset;
+			Command.FirstInstance = i;
+
+			// Culled objects keep the level they had, nothing is drawn with it
+			if (Visible && Batch.LodCount > 0)
+			{
+				t_LodLevels[i] = SelectLod(Object, t_Constants, t_LodLevels[i]);
+				const GpuLodData& Lod = m_Lods[Batch.FirstLod + t_LodLevels[i]];
+				Command.IndexCount = Lod.IndexCount;
+				Command.FirstIndex = Lod.FirstIndex;
+			}
+
+			if (!Compact)
+			{
+				t_OutCommands[i] = Command;
+			}
+			else if (Visible)
+			{
+				// The GPU uses an atomic add here, so the order inside of a batch can be different
+				const uint32 Slot = t_OutBatchCounts[Object.BatchIndex]++;
+				t_OutCommands[Batch.FirstCommand + Slot] = Command;
+			}
+		}
+	}
+
+	void IndirectDrawList::GatherVisibleObjects(const DrawIndexedCommand* t_Commands, const uint32* t_BatchCounts, std::vector<uint32>& t_OutVisible) const
+	{
+		assert(t_Commands);
+		t_OutVisible.clear();
+
+		for (uint32 BatchIndex = 0; BatchIndex < GetBatchCount(); ++BatchIndex)
+		{
+			const IndirectBatch& Batch = m_Batches[BatchIndex];
+			const uint32 Count = t_BatchCounts ? std::min(t_BatchCounts[BatchIndex], Batch.CommandCount) : Batch.CommandCount;
+
+			for (uint32 i = 0; i < Count; ++i)
+			{
+				const DrawIndexedCommand& Command = t_Commands[Batch.FirstCommand + i];
+				if (Command.InstanceCount > 0)
+				{
+					t_OutVisible.emplace_back(Command.FirstInstance);
+				}
+			}
+		}
+
+		std::sort(t_OutVisible.begin(), t_OutVisible.end());
+	}
+
+	void IndirectDrawList::CountTriangles(const DrawIndexedCommand* t_Commands, const uint32* t_BatchCounts, uint32& t_OutTriangles, uint32& t_OutFullDetailTriangles) const
+	{
+		assert(t_Commands);
+		t_OutTriangles = 0;
+		t_OutFullDetailTriangles = 0;
+
+		for (uint32 BatchIndex = 0; BatchIndex < GetBatchCount(); ++BatchIndex)
+		{
+			const IndirectBatch& Batch = m_Batches[BatchIndex];
+			const uint32 Count = t_BatchCounts ? std::min(t_BatchCounts[BatchIndex], Batch.CommandCount) : Batch.CommandCount;
+
+			for (uint32 i = 0; i < Count; ++i)
+			{
+				const DrawIndexedCommand& Command = t_Commands[Batch.FirstCommand + i];
+				if (Command.InstanceCount > 0 && Command.FirstInstance < GetObjectCount())
+				{
+					t_OutTriangles += Command.IndexCount / 3;
+					t_OutFullDetailTriangles += m_Objects[Command.FirstInstance].IndexCount / 3;
+				}
+			}
+		}
+	}
+
+	bool IndirectDrawList::IsVisible(const GpuObjectData& t_Object, const Frustum& t_Frustum)
+	{
+		glm::vec3 Center;
+		glm::vec3 Extents;
+		GetWorldBounds(t_Object, Center, Extents);
+		return t_Frustum.IntersectsBox(Center, Extents);
+	}
+
+	uint32 IndirectDrawList::SelectLod(const GpuObjectData& t_Object, const GpuCullConstants& t_Constants, uint32 t_Current) const
+	{
+		const IndirectBatch& Batch = m_Batches[t_Object.BatchIndex];
+		if (Batch.LodCount <= 1 || t_Constants.LodThreshold <= 0.0f)
+		{
+			return 0;
+		}
+
+		glm::vec3 Center;
+		glm::vec3 Extents;
+		GetWorldBounds(t_Object, Center, Extents);
+
+		// The errors are in model space, so they grow with the largest scale of the object
+		const float ScaleSq = glm::max(
+			glm::dot(glm::vec3(t_Object.World[0]), glm::vec3(t_Object.World[0])),
+			glm::max(glm::dot(glm::vec3(t_Object.World[1]), glm::vec3(t_Object.World[1])), glm::dot(glm::vec3(t_Object.World[2]), glm::vec3(t_Object.World[2]))));
+
+		// Distance to the closest point of the sphere around the box, full detail if the camera is inside of it
+		const float Distance = glm::length(Center - glm::vec3(t_Constants.LodCamera)) - glm::length(Extents);
+		if (Distance <= 0.0f)
+		{
+			return 0;
+		}
+
+		const float ErrorToPixels = glm::sqrt(ScaleSq) * t_Constants.LodCamera.w / Distance;
+		const GpuLodData* Lods = m_Lods.data() + Batch.FirstLod;
+		const uint32 Last = Batch.LodCount - 1;
+		const uint32 Current = std::min(t_Current, Last);
+
+		uint32 Desired = 0;
+		while (Desired < Last && Lods[Desired + 1].Error * ErrorToPixels <= t_Constants.LodThreshold)
+		{
+			++Desired;
+		}
+
+		const float CoarserThreshold = t_Constants.LodThreshold * (1.0f - t_Constants.LodHysteresis);
+		while (Desired > Current && Lods[Desired].Error * ErrorToPixels > CoarserThreshold)
+		{
+			--Desired;
+		}
+
+		return Desired;
+	}
+
+	void IndirectDrawList::GetWorldBounds(const GpuObjectData& t_Object, glm::vec3& t_OutCenter, glm::vec3& t_OutExtents)
+	{
+		// Transform the center and project the extents onto the world axes (Arvo)
+		t_OutCenter = glm::vec3(t_Object.World * glm::vec4(glm::vec3(t_Object.BoundsCenter), 1.0f));
+		const glm::vec3 LocalExtents = glm::vec3(t_Object.BoundsExtents);
+
+		t_OutExtents = glm::vec3(0.0f);
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			t_OutExtents += glm::abs(glm::vec3(t_Object.World[Axis])) * LocalExtents[Axis];
+		}
+	}
+}   // namespace Fling
@@ -5,11 +5,17 @@
 
 namespace Fling
 {
-    Instance::Instance()
+    Instance::Instance(bool t_Headless)
+        : m_Headless(t_Headless)
     {
         m_EnableValidationLayers = FlingConfig::GetBool("Vulkan", "EnableValidationLayers", false);
 		F_LOG_TRACE("[Renderer] m_EnableValidationLayers is {}", (m_EnableValidationLayers ? "TRUE" : "FALSE"));
 
+		if (m_Headless)
+		{
+			m_DeviceExtensions.clear();
+		}
+
         CreateInstance();
 
 #if FLING_DEBUG
@@ -110,11 +116,32 @@ namespace Fling
 
     std::vector<const char*> Instance::GetRequiredExtensions()
 	{
-		uint32 glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions( &glfwExtensionCount );
+		std::vector<const char*> extensions;
+
+		// Headless instances never create a surface, so GLFW doesn't have to be initialized
+		if( !m_Headless )
+		{
+			uint32 glfwExtensionCount = 0;
+			const char** glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions( &glfwExtensionCount );
+			extensions.assign( glfwExtensions, glfwExtensions + glfwExtensionCount );
+		}
 
-		std::vector<const char*> extensions( glfwExtensions, glfwExtensions + glfwExtensionCount );
+		// Needed to query extended device features (descriptor indexing) on a 1.0 instance
+		uint32 availableCount = 0;
+		vkEnumerateInstanceExtensionProperties( nullptr, &availableCount, nullptr );
+		std::vector<VkExtensionProperties> available( availableCount );
+		vkEnumerateInstanceExtensionProperties( nullptr, &availableCount, available.data() );
+
+		for( const VkExtensionProperties& extension : available )
+		{
+			if( strcmp( extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME ) == 0 )
+			{
+				extensions.push_back( VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME );
+				m_SupportsPhysicalDeviceProperties2 = true;
+				break;
+			}
+		}
 
 		if( m_EnableValidationLayers ) 
 		{
@@ -0,0 +1,282 @@
+#include "pch.h"
+#include "LightClusters.h"
+
+namespace Fling
+{
+	void LightClusterGrid::SetProjection(const glm::mat4& t_Projection, float t_Near, float t_Far, uint32 t_Width, uint32 t_Height)
+	{
+		assert(t_Near > 0.0f && t_Far > t_Near);
+
+		if (t_Projection == m_Projection && t_Near == m_Near && t_Far == m_Far && t_Width == m_Width && t_Height == m_Height && !m_MinX.empty())
+		{
+			return;
+		}
+
+		m_Projection = t_Projection;
+		m_Near = t_Near;
+		m_Far = t_Far;
+		m_Width = glm::max(t_Width, 1u);
+		m_Height = glm::max(t_Height, 1u);
+
+		// Round the tile size up so that the last tile covers the edge of the screen
+		const float LogRatio = std::log(m_Far / m_Near);
+		m_ClusterScale.x = std::ceil(static_cast<float>(m_Width) / static_cast<float>(CountX));
+		m_ClusterScale.y = std::ceil(static_cast<float>(m_Height) / static_cast<float>(CountY));
+		m_ClusterScale.z = static_cast<float>(CountZ) / LogRatio;
+		m_ClusterScale.w = -static_cast<float>(CountZ) * std::log(m_Near) / LogRatio;
+
+		m_MinX.resize(ClusterCount);
+		m_MinY.resize(ClusterCount);
+		m_MinZ.resize(ClusterCount);
+		m_MaxX.resize(ClusterCount);
+		m_MaxY.resize(ClusterCount);
+		m_MaxZ.resize(ClusterCount);
+
+		// View space x of a point at depth d is (ndc + P[2][0]) * d / P[0][0], same for y
+		const float ScaleX = m_Projection[0][0];
+		const float ScaleY = m_Projection[1][1];
+		const float OffsetX = m_Projection[2][0];
+		const float OffsetY = m_Projection[2][1];
+
+		for (uint32 z = 0; z < CountZ; ++z)
+		{
+			const float Depths[2] = { GetSliceDepth(z), GetSliceDepth(z + 1) };
+
+			for (uint32 y = 0; y < CountY; ++y)
+			{
+				const float NdcY[2] =
+				{
+					(y * m_ClusterScale.y) / m_Height * 2.0f - 1.0f,
+					((y + 1) * m_ClusterScale.y) / m_Height * 2.0f - 1.0f
+				};
+
+				for (uint32 x = 0; x < CountX; ++x)
+				{
+					const float NdcX[2] =
+					{
+						(x * m_ClusterScale.x) / m_Width * 2.0f - 1.0f,
+						((x + 1) * m_ClusterScale.x) / m_Width * 2.0f - 1.0f
+					};
+
+					// Box around the 8 corners of this cluster
+					AABB Bounds;
+					for (float Depth : Depths)
+					{
+						for (float Nx : NdcX)
+						{
+							for (float Ny : NdcY)
+							{
+								Bounds.Expand(glm::vec3(
+									(Nx + OffsetX) * Depth / ScaleX,
+									(Ny + OffsetY) * Depth / ScaleY,
+									-Depth));
+							}
+						}
+					}
+
+					const uint32 Index = GetClusterIndex(x, y, z);
+					m_MinX[Index] = Bounds.Min.x;
+					m_MinY[Index] = Bounds.Min.y;
+					m_MinZ[Index] = Bounds.Min.z;
+					m_MaxX[Index] = Bounds.Max.x;
+					m_MaxY[Index] = Bounds.Max.y;
+					m_MaxZ[Index] = Bounds.Max.z;
+				}
+			}
+		}
+	}
+
+	void LightClusterGrid::Build(const glm::vec4* t_ViewSpaceLights, uint32 t_Count)
+	{
+		assert(!m_MinX.empty() && "SetProjection must be called before building the clusters");
+
+		m_PairClusters.clear();
+		m_PairLights.clear();
+
+		const float ScaleX = m_Projection[0][0];
+		const float ScaleY = m_Projection[1][1];
+		const float OffsetX = m_Projection[2][0];
+		const float OffsetY = m_Projection[2][1];
+
+		for (uint32 LightIndex = 0; LightIndex < t_Count; ++LightIndex)
+		{
+			const glm::vec4& Light = t_ViewSpaceLights[LightIndex];
+			const float Radius = Light.w;
+			const float Depth = -Light.z;
+
+			if (Radius <= 0.0f || Depth + Radius < m_Near || Depth - Radius > m_Far)
+			{
+				continue;
+			}
+
+			const uint32 FirstSlice = GetSlice(glm::max(Depth - Radius, m_Near));
+			const uint32 LastSlice = GetSlice(glm::min(Depth + Radius, m_Far));
+
+			uint32 FirstX = 0, LastX = CountX - 1;
+			uint32 FirstY = 0, LastY = CountY - 1;
+
+			// Lights that cross the near plane can cover anywhere on screen, otherwise project
+			// the view space box of the sphere. x / d only has extremes at the corners
+			if (Depth - Radius > m_Near)
+			{
+				const float NearDepth = Depth - Radius;
+				const float FarDepth = Depth + Radius;
+
+				float MinNdcX = FLT_MAX, MaxNdcX = -FLT_MAX;
+				float MinNdcY = FLT_MAX, MaxNdcY = -FLT_MAX;
+				for (float D : { NearDepth, FarDepth })
+				{
+					for (float Sign : { -1.0f, 1.0f })
+					{
+						const float Nx = ScaleX * (Light.x + Sign * Radius) / D - OffsetX;
+						const float Ny = ScaleY * (Light.y + Sign * Radius) / D - OffsetY;
+						MinNdcX = glm::min(MinNdcX, Nx);
+						MaxNdcX = glm::max(MaxNdcX, Nx);
+						MinNdcY = glm::min(MinNdcY, Ny);
+						MaxNdcY = glm::max(MaxNdcY, Ny);
+					}
+				}
+
+				if (MaxNdcX < -1.0f || MinNdcX > 1.0f || MaxNdcY < -1.0f || MinNdcY > 1.0f)
+				{
+					continue;
+				}
+
+				FirstX = GetTileX(MinNdcX);
+				LastX = GetTileX(MaxNdcX);
+				FirstY = GetTileY(MinNdcY);
+				LastY = GetTileY(MaxNdcY);
+			}
+
+			for (uint32 z = FirstSlice; z <= LastSlice; ++z)
+			{
+				for (uint32 y = FirstY; y <= LastY; ++y)
+				{
+					TestRow(GetClusterIndex(FirstX, y, z), LastX - FirstX + 1, Light, LightIndex);
+				}
+			}
+		}
+
+		// Counting sort the pairs by cluster into the index list
+		m_Clusters.assign(ClusterCount, LightClusterRange {});
+		for (uint32 Cluster : m_PairClusters)
+		{
+			m_Clusters[Cluster].Count++;
+		}
+
+		uint32 Offset = 0;
+		m_MaxLightsPerCluster = 0;
+		for (LightClusterRange& Range : m_Clusters)
+		{
+			Range.Offset = Offset;
+			Offset += Range.Count;
+			m_MaxLightsPerCluster = glm::max(m_MaxLightsPerCluster, Range.Count);
+			Range.Count = 0;
+		}
+
+		m_LightIndices.resize(m_PairClusters.size());
+		for (size_t i = 0; i < m_PairClusters.size(); ++i)
+		{
+			LightClusterRange& Range = m_Clusters[m_PairClusters[i]];
+			m_LightIndices[Range.Offset + Range.Count++] = m_PairLights[i];
+		}
+	}
+
+	void LightClusterGrid::TestRow(uint32 t_First, uint32 t_Count, const glm::vec4& t_Light, uint32 t_LightIndex)
+	{
+		uint32 i = 0;
+
+#if FLING_SIMD_SSE
+		const __m128 Cx = _mm_set1_ps(t_Light.x);
+		const __m128 Cy = _mm_set1_ps(t_Light.y);
+		const __m128 Cz = _mm_set1_ps(t_Light.z);
+		const __m128 RadiusSq = _mm_set1_ps(t_Light.w * t_Light.w);
+		const __m128 Zero = _mm_setzero_ps();
+
+		for (; i + 4 <= t_Count; i += 4)
+		{
+			const uint32 Index = t_First + i;
+
+			// Distance from the center to the box along each axis, 0 if inside
+			const __m128 Dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_MinX[Index]), Cx), _mm_sub_ps(Cx, _mm_loadu_ps(&m_MaxX[Index]))), Zero);
+			const __m128 Dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_MinY[Index]), Cy), _mm_sub_ps(Cy, _mm_loadu_ps(&m_MaxY[Index]))), Zero);
+			const __m128 Dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_MinZ[Index]), Cz), _mm_sub_ps(Cz, _mm_loadu_ps(&m_MaxZ[Index]))), Zero);
+
+			const __m128 DistSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Dx, Dx), _mm_mul_ps(Dy, Dy)), _mm_mul_ps(Dz, Dz));
+
+			uint32 Mask = static_cast<uint32>(_mm_movemask_ps(_mm_cmple_ps(DistSq, RadiusSq)));
+			while (Mask)
+			{
+				m_PairClusters.push_back(Index + trailing_zeroes(Mask));
+				m_PairLights.push_back(t_LightIndex);
+				Mask &= Mask - 1;
+			}
+		}
+#endif	// FLING_SIMD_SSE
+
+		// Whatever is left over that doesn't fill a full SIMD lane
+		const glm::vec3 Center(t_Light);
+		for (; i < t_Count; ++i)
+		{
+			const uint32 Index = t_First + i;
+			if (SphereIntersectsBox(Center, t_Light.w, glm::vec3(m_MinX[Index], m_MinY[Index], m_MinZ[Index]), glm::vec3(m_MaxX[Index], m_MaxY[Index], m_MaxZ[Index])))
+			{
+				m_PairClusters.push_back(Index);
+				m_PairLights.push_back(t_LightIndex);
+			}
+		}
+	}
+
+	uint32 LightClusterGrid::GetSlice(float t_ViewDepth) const
+	{
+		if (t_ViewDepth <= m_Near)
+		{
+			return 0;
+		}
+
+		const float Slice = std::floor(std::log(t_ViewDepth) * m_ClusterScale.z + m_ClusterScale.w);
+		return static_cast<uint32>(glm::clamp(Slice, 0.0f, static_cast<float>(CountZ - 1)));
+	}
+
+	uint32 LightClusterGrid::GetClusterAt(const glm::vec3& t_ViewPos) const
+	{
+		const float Depth = glm::max(-t_ViewPos.z, m_Near);
+		const float NdcX = m_Projection[0][0] * t_ViewPos.x / Depth - m_Projection[2][0];
+		const float NdcY = m_Projection[1][1] * t_ViewPos.y / Depth - m_Projection[2][1];
+
+		return GetClusterIndex(GetTileX(NdcX), GetTileY(NdcY), GetSlice(Depth));
+	}
+
+	AABB LightClusterGrid::GetClusterBounds(uint32 t_Cluster) const
+	{
+		assert(t_Cluster < m_MinX.size());
+
+		AABB Bounds;
+		Bounds.Min = glm::vec3(m_MinX[t_Cluster], m_MinY[t_Cluster], m_MinZ[t_Cluster]);
+		Bounds.Max = glm::vec3(m_MaxX[t_Cluster], m_MaxY[t_Cluster], m_MaxZ[t_Cluster]);
+		return Bounds;
+	}
+
+	bool LightClusterGrid::SphereIntersectsBox(const glm::vec3& t_Center, float t_Radius, const glm::vec3& t_Min, const glm::vec3& t_Max)
+	{
+		const glm::vec3 Delta = glm::max(glm::max(t_Min - t_Center, t_Center - t_Max), glm::vec3(0.0f));
+		return glm::dot(Delta, Delta) <= t_Radius * t_Radius;
+	}
+
+	float LightClusterGrid::GetSliceDepth(uint32 t_Slice) const
+	{
+		return m_Near * std::pow(m_Far / m_Near, static_cast<float>(t_Slice) / static_cast<float>(CountZ));
+	}
+
+	uint32 LightClusterGrid::GetTileX(float t_Ndc) const
+	{
+		const float Pixel = (t_Ndc * 0.5f + 0.5f) * m_Width;
+		return static_cast<uint32>(glm::clamp(std::floor(Pixel / m_ClusterScale.x), 0.0f, static_cast<float>(CountX - 1)));
+	}
+
+	uint32 LightClusterGrid::GetTileY(float t_Ndc) const
+	{
+		const float Pixel = (t_Ndc * 0.5f + 0.5f) * m_Height;
+		return static_cast<uint32>(glm::clamp(std::floor(Pixel / m_ClusterScale.y), 0.0f, static_cast<float>(CountY - 1)));
+	}
+}   // namespace Fling
@@ -38,9 +38,12 @@ namespace Fling
 				m_SupportedQueues |= VK_QUEUE_GRAPHICS_BIT;
 			}
 
-			// Check for presentation support.
-			VkBool32 presentSupport;
-			vkGetPhysicalDeviceSurfaceSupportKHR(m_PhysicalDevice->GetVkPhysicalDevice(), i, m_Surface, &presentSupport);
+			// Check for presentation support. Nothing is presented without a surface
+			VkBool32 presentSupport = VK_FALSE;
+			if (m_Surface != VK_NULL_HANDLE)
+			{
+				vkGetPhysicalDeviceSurfaceSupportKHR(m_PhysicalDevice->GetVkPhysicalDevice(), i, m_Surface, &presentSupport);
+			}
 
 			if (QueueFamilies[i].queueCount > 0 && presentSupport)
 			{
@@ -74,6 +77,12 @@ namespace Fling
 		{
 			F_LOG_FATAL("Failed to find queue family supporting VK_QUEUE_GRAPHICS_BIT");
 		}
+
+		// Headless devices "present" by leaving the image for a readback on the graphics queue
+		if (m_Surface == VK_NULL_HANDLE)
+		{
+			m_PresentFamily = m_GraphicsFamily;
+		}
 	}
 
 	void LogicalDevice::CreateDevice()
@@ -98,6 +107,54 @@ namespace Fling
 		DevicesFeatures.samplerAnisotropy = VK_TRUE;
 		DevicesFeatures.sampleRateShading = VK_TRUE;
 
+		// Optional features for GPU driven rendering. Indirect draws read the object index from firstInstance
+		const VkPhysicalDeviceFeatures& Supported = m_PhysicalDevice->GetDeivceFeatures();
+		m_SupportsIndirectDraws = Supported.multiDrawIndirect && Supported.drawIndirectFirstInstance;
+		DevicesFeatures.multiDrawIndirect = Supported.multiDrawIndirect;
+		DevicesFeatures.drawIndirectFirstInstance = Supported.drawIndirectFirstInstance;
+
+		// Counting shaded fragments for the overdraw stats
+		m_SupportsPipelineStatistics = Supported.pipelineStatisticsQuery;
+		DevicesFeatures.pipelineStatisticsQuery = Supported.pipelineStatisticsQuery;
+
+		m_EnabledExtensions = m_Instance->GetEnabledExtensions();
+		if (m_PhysicalDevice->IsExtensionSupported(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+		{
+			m_EnabledExtensions.emplace_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+			m_SupportsDrawIndirectCount = true;
+		}
+
+		// Bindless textures: one big partially bound array of samplers that is indexed per material
+		// and written to while it is in use. Indexing has to be non uniform for the indirect draws
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT IndexingFeatures = {};
+		IndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		if (m_PhysicalDevice->HasDescriptorIndexing() && m_PhysicalDevice->IsExtensionSupported(VK_KHR_MAINTENANCE3_EXTENSION_NAME))
+		{
+			const VkPhysicalDeviceDescriptorIndexingFeaturesEXT& Indexing = m_PhysicalDevice->GetDescriptorIndexingFeatures();
+			m_SupportsBindlessTextures =
+				Indexing.shaderSampledImageArrayNonUniformIndexing &&
+				Indexing.runtimeDescriptorArray &&
+				Indexing.descriptorBindingPartiallyBound &&
+				Indexing.descriptorBindingSampledImageUpdateAfterBind &&
+				Indexing.descriptorBindingUpdateUnusedWhilePending;
+		}
+
+		if (m_SupportsBindlessTextures)
+		{
+			IndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+			IndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+			IndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+			IndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			IndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+			m_EnabledExtensions.emplace_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+			m_EnabledExtensions.emplace_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+			const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& Limits = m_PhysicalDevice->GetDescriptorIndexingProperties();
+			m_MaxBindlessTextures = std::min(
+				Limits.maxDescriptorSetUpdateAfterBindSampledImages,
+				std::min(Limits.maxPerStageDescriptorUpdateAfterBindSampledImages, Limits.maxPerStageDescriptorUpdateAfterBindSamplers));
+		}
 
         // Device creation 
         VkDeviceCreateInfo CreateInfo = {};
@@ -105,10 +162,11 @@ namespace Fling
         CreateInfo.queueCreateInfoCount = static_cast<uint32>(QueueCreateInfos.size());
         CreateInfo.pQueueCreateInfos = QueueCreateInfos.data();
         CreateInfo.pEnabledFeatures = &DevicesFeatures;
+        CreateInfo.pNext = m_SupportsBindlessTextures ? &IndexingFeatures : nullptr;
 
         // Set the enabled extensions
-        CreateInfo.enabledExtensionCount = static_cast<uint32>(m_Instance->GetEnabledExtensions().size());
-        CreateInfo.ppEnabledExtensionNames = m_Instance->GetEnabledExtensions().data();
+        CreateInfo.enabledExtensionCount = static_cast<uint32>(m_EnabledExtensions.size());
+        CreateInfo.ppEnabledExtensionNames = m_EnabledExtensions.data();
 
         if( m_Instance->IsValidationEnabled() ) 
         {
@@ -29,10 +29,13 @@ namespace Fling
 
 	void MeshRenderer::Release()
 	{
-		if (m_UniformBuffer)
+		for (Buffer*& UniformBuffer : m_UniformBuffers)
 		{
-			delete m_UniformBuffer;
-			m_UniformBuffer = nullptr;
+			if (UniformBuffer)
+			{
+				delete UniformBuffer;
+				UniformBuffer = nullptr;
+			}
 		}
 	}
 
@@ -0,0 +1,435 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+#include "Vertex.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace Fling
+{
+	namespace
+	{
+		constexpr uint32 InvalidIndex = ~0U;
+
+		/** Sum of squared distances to a set of planes, each weighted by the area of the triangle it came from */
+		struct Quadric
+		{
+			double XX = 0.0, XY = 0.0, XZ = 0.0, YY = 0.0, YZ = 0.0, ZZ = 0.0;
+			double X = 0.0, Y = 0.0, Z = 0.0;
+			double D = 0.0;
+			double Weight = 0.0;
+
+			void AddPlane(const glm::dvec3& t_Normal, double t_Dist, double t_Weight)
+			{
+				XX += t_Normal.x * t_Normal.x * t_Weight;
+				XY += t_Normal.x * t_Normal.y * t_Weight;
+				XZ += t_Normal.x * t_Normal.z * t_Weight;
+				YY += t_Normal.y * t_Normal.y * t_Weight;
+				YZ += t_Normal.y * t_Normal.z * t_Weight;
+				ZZ += t_Normal.z * t_Normal.z * t_Weight;
+				X += t_Normal.x * t_Dist * t_Weight;
+				Y += t_Normal.y * t_Dist * t_Weight;
+				Z += t_Normal.z * t_Dist * t_Weight;
+				D += t_Dist * t_Dist * t_Weight;
+				Weight += t_Weight;
+			}
+
+			Quadric operator+(const Quadric& t_Other) const
+			{
+				Quadric Result = *this;
+				Result.XX += t_Other.XX; Result.XY += t_Other.XY; Result.XZ += t_Other.XZ;
+				Result.YY += t_Other.YY; Result.YZ += t_Other.YZ; Result.ZZ += t_Other.ZZ;
+				Result.X += t_Other.X; Result.Y += t_Other.Y; Result.Z += t_Other.Z;
+				Result.D += t_Other.D;
+				Result.Weight += t_Other.Weight;
+				return Result;
+			}
+
+			/** Mean squared distance from the point to the planes */
+			double Error(const glm::dvec3& t_P) const
+			{
+				const double Sum =
+					XX * t_P.x * t_P.x + YY * t_P.y * t_P.y + ZZ * t_P.z * t_P.z +
+					2.0 * (XY * t_P.x * t_P.y + XZ * t_P.x * t_P.z + YZ * t_P.y * t_P.z) +
+					2.0 * (X * t_P.x + Y * t_P.y + Z * t_P.z) +
+					D;
+
+				return Weight > 0.0 ? std::max(Sum, 0.0) / Weight : 0.0;
+			}
+		};
+
+		/** Move vertex From onto To */
+		struct EdgeCollapse
+		{
+			uint32 From;
+			uint32 To;
+			double Cost;
+		};
+
+		uint64 EdgeKey(uint32 t_A, uint32 t_B)
+		{
+			return t_A < t_B ? (static_cast<uint64>(t_A) << 32) | t_B : (static_cast<uint64>(t_B) << 32) | t_A;
+		}
+	}
+
+	std::vector<uint32> MeshSimplifier::Simplify(
+		const Vertex* t_Verts,
+		uint32 t_VertCount,
+		const uint32* t_Indices,
+		uint32 t_IndexCount,
+		uint32 t_TargetIndexCount,
+		float t_MaxError,
+		float* t_OutError)
+	{
+		assert(t_IndexCount % 3 == 0);
+
+		std::vector<uint32> Indices(t_Indices, t_Indices + t_IndexCount);
+		if (t_OutError)
+		{
+			*t_OutError = 0.0f;
+		}
+
+		if (t_IndexCount <= t_TargetIndexCount)
+		{
+			return Indices;
+		}
+
+		auto PositionOf = [t_Verts](uint32 t_Index) { return glm::dvec3(t_Verts[t_Index].Pos); };
+
+		// Vertices with the same position are simplified as one, the first of them in sorted order stands in for the rest
+		std::vector<uint32> Sorted(t_VertCount);
+		std::iota(Sorted.begin(), Sorted.end(), 0);
+		std::sort(Sorted.begin(), Sorted.end(), [t_Verts](uint32 A, uint32 B)
+		{
+			const glm::vec3& PA = t_Verts[A].Pos;
+			const glm::vec3& PB = t_Verts[B].Pos;
+			return PA.x != PB.x ? PA.x < PB.x : (PA.y != PB.y ? PA.y < PB.y : PA.z < PB.z);
+		});
+
+		std::vector<uint32> PosId(t_VertCount);
+		for (uint32 i = 0; i < t_VertCount; ++i)
+		{
+			const bool SameAsLast = i > 0 && t_Verts[Sorted[i]].Pos == t_Verts[Sorted[i - 1]].Pos;
+			PosId[Sorted[i]] = SameAsLast ? PosId[Sorted[i - 1]] : Sorted[i];
+		}
+
+		// Attribute seams, more than one vertex at a position is used
+		std::vector<uint8> Locked(t_VertCount, 0);
+		std::vector<uint32> FirstUser(t_VertCount, InvalidIndex);
+		for (uint32 Index : Indices)
+		{
+			uint32& User = FirstUser[PosId[Index]];
+			if (User == InvalidIndex)
+			{
+				User = Index;
+			}
+			else if (User != Index)
+			{
+				Locked[PosId[Index]] = 1;
+			}
+		}
+
+		// Open borders and non manifold edges, anything that doesn't have exactly two triangles
+		std::vector<uint64> Edges;
+		Edges.reserve(Indices.size());
+		for (size_t i = 0; i < Indices.size(); i += 3)
+		{
+			for (uint32 e = 0; e < 3; ++e)
+			{
+				const uint32 A = PosId[Indices[i + e]];
+				const uint32 B = PosId[Indices[i + (e + 1) % 3]];
+				if (A != B)
+				{
+					Edges.emplace_back(EdgeKey(A, B));
+				}
+			}
+		}
+
+		std::sort(Edges.begin(), Edges.end());
+		for (size_t i = 0; i < Edges.size();)
+		{
+			size_t End = i + 1;
+			while (End < Edges.size() && Edges[End] == Edges[i])
+			{
+				++End;
+			}
+
+			if (End - i != 2)
+			{
+				Locked[static_cast<uint32>(Edges[i] >> 32)] = 1;
+				Locked[static_cast<uint32>(Edges[i] & 0xffffffffULL)] = 1;
+			}
+			i = End;
+		}
+
+		std::vector<Quadric> Quadrics(t_VertCount);
+		for (size_t i = 0; i < Indices.size(); i += 3)
+		{
+			const glm::dvec3 P0 = PositionOf(Indices[i + 0]);
+			const glm::dvec3 P1 = PositionOf(Indices[i + 1]);
+			const glm::dvec3 P2 = PositionOf(Indices[i + 2]);
+
+			glm::dvec3 Normal = glm::cross(P1 - P0, P2 - P0);
+			const double DoubleArea = glm::length(Normal);
+			if (DoubleArea <= 0.0)
+			{
+				continue;
+			}
+
+			Normal /= DoubleArea;
+			const double Dist = -glm::dot(Normal, P0);
+			for (uint32 c = 0; c < 3; ++c)
+			{
+				Quadrics[PosId[Indices[i + c]]].AddPlane(Normal, Dist, DoubleArea * 0.5);
+			}
+		}
+
+		const double MaxCost = static_cast<double>(t_MaxError) * static_cast<double>(t_MaxError);
+		double AppliedCost = 0.0;
+
+		std::vector<uint32> TriStart(t_VertCount + 1);
+		std::vector<uint32> TriList;
+		std::vector<EdgeCollapse> Collapses;
+		std::vector<uint8> Touched(t_VertCount);
+		std::vector<uint8> Removed;
+
+		// Collapse the cheapest edges that don't share a vertex each pass, then rebuild the adjacency
+		while (Indices.size() > t_TargetIndexCount)
+		{
+			const uint32 TriCount = static_cast<uint32>(Indices.size() / 3);
+
+			// Triangles around each vertex. Unlocked vertices are the only ones at their position, so this is all of them
+			std::fill(TriStart.begin(), TriStart.end(), 0);
+			for (uint32 Index : Indices)
+			{
+				++TriStart[Index + 1];
+			}
+			std::partial_sum(TriStart.begin(), TriStart.end(), TriStart.begin());
+
+			TriList.resize(Indices.size());
+			std::vector<uint32> Fill(TriStart.begin(), TriStart.end() - 1);
+			for (uint32 i = 0; i < static_cast<uint32>(Indices.size()); ++i)
+			{
+				TriList[Fill[Indices[i]]++] = i / 3;
+			}
+
+			Collapses.clear();
+			for (uint32 i = 0; i < static_cast<uint32>(Indices.size()); ++i)
+			{
+				const uint32 A = Indices[i];
+				const uint32 B = Indices[i - i % 3 + (i + 1) % 3];
+				const uint32 PA = PosId[A];
+				const uint32 PB = PosId[B];
+				if (PA == PB)
+				{
+					continue;
+				}
+
+				const Quadric Merged = Quadrics[PA] + Quadrics[PB];
+				if (!Locked[PA])
+				{
+					Collapses.push_back({ A, B, Merged.Error(PositionOf(B)) });
+				}
+				if (!Locked[PB])
+				{
+					Collapses.push_back({ B, A, Merged.Error(PositionOf(A)) });
+				}
+			}
+
+			std::sort(Collapses.begin(), Collapses.end(), [](const EdgeCollapse& A, const EdgeCollapse& B) { return A.Cost < B.Cost; });
+
+			std::fill(Touched.begin(), Touched.end(), 0);
+			Removed.assign(TriCount, 0);
+
+			uint32 LiveIndexCount = static_cast<uint32>(Indices.size());
+			uint32 AppliedCount = 0;
+
+			for (const EdgeCollapse& Collapse : Collapses)
+			{
+				if (Collapse.Cost > MaxCost || LiveIndexCount <= t_TargetIndexCount)
+				{
+					break;
+				}
+
+				const uint32 From = PosId[Collapse.From];
+				const uint32 To = PosId[Collapse.To];
+				if (Touched[From] || Touched[To])
+				{
+					continue;
+				}
+
+				// Triangles that keep existing must not flip over
+				const glm::dvec3 NewPos = PositionOf(Collapse.To);
+				bool Flips = false;
+				for (uint32 t = TriStart[Collapse.From]; t < TriStart[Collapse.From + 1] && !Flips; ++t)
+				{
+					const uint32* Tri = &Indices[TriList[t] * 3];
+					if (PosId[Tri[0]] == To || PosId[Tri[1]] == To || PosId[Tri[2]] == To)
+					{
+						continue;
+					}
+
+					glm::dvec3 P[3] = { PositionOf(Tri[0]), PositionOf(Tri[1]), PositionOf(Tri[2]) };
+					const glm::dvec3 Before = glm::cross(P[1] - P[0], P[2] - P[0]);
+					for (glm::dvec3& Corner : P)
+					{
+						if (Corner == PositionOf(Collapse.From))
+						{
+							Corner = NewPos;
+						}
+					}
+					const glm::dvec3 After = glm::cross(P[1] - P[0], P[2] - P[0]);
+					Flips = glm::dot(Before, After) <= 0.0;
+				}
+
+				if (Flips)
+				{
+					continue;
+				}
+
+				for (uint32 t = TriStart[Collapse.From]; t < TriStart[Collapse.From + 1]; ++t)
+				{
+					const uint32 Tri = TriList[t];
+					uint32* Corners = &Indices[Tri * 3];
+					if (PosId[Corners[0]] == To || PosId[Corners[1]] == To || PosId[Corners[2]] == To)
+					{
+						Removed[Tri] = 1;
+						LiveIndexCount -= 3;
+					}
+					else
+					{
+						std::replace(Corners, Corners + 3, Collapse.From, Collapse.To);
+					}
+
+					for (uint32 c = 0; c < 3; ++c)
+					{
+						Touched[PosId[Corners[c]]] = 1;
+					}
+				}
+
+				Touched[From] = 1;
+				Quadrics[To] = Quadrics[To] + Quadrics[From];
+				AppliedCost = std::max(AppliedCost, Collapse.Cost);
+				++AppliedCount;
+			}
+
+			if (AppliedCount == 0)
+			{
+				break;
+			}
+
+			uint32 Write = 0;
+			for (uint32 Tri = 0; Tri < TriCount; ++Tri)
+			{
+				if (!Removed[Tri])
+				{
+					Indices[Write++] = Indices[Tri * 3 + 0];
+					Indices[Write++] = Indices[Tri * 3 + 1];
+					Indices[Write++] = Indices[Tri * 3 + 2];
+				}
+			}
+			Indices.resize(Write);
+		}
+
+		if (t_OutError)
+		{
+			*t_OutError = static_cast<float>(std::sqrt(AppliedCost));
+		}
+
+		return Indices;
+	}
+
+	std::vector<MeshLod> MeshSimplifier::BuildLodChain(const std::vector<Vertex>& t_Verts, std::vector<uint32>& t_Indices, const LodChainSettings& t_Settings)
+	{
+		std::vector<MeshLod> Lods;
+
+		MeshLod Full = {};
+		Full.IndexCount = static_cast<uint32>(t_Indices.size());
+		Lods.emplace_back(Full);
+
+		if (t_Verts.empty() || t_Indices.empty())
+		{
+			return Lods;
+		}
+
+		const AABB Bounds = AABB::FromVertices(t_Verts.data(), t_Verts.size());
+		const float MaxError = t_Settings.MaxError * BoundingSphere::FromVertices(Bounds, t_Verts.data(), t_Verts.size()).Radius;
+
+		// Every level starts from the full detail mesh, so its error is measured against the real surface
+		const std::vector<uint32> Source = t_Indices;
+
+		for (uint32 Level = 1; Level < t_Settings.MaxLevels; ++Level)
+		{
+			const MeshLod Previous = Lods.back();
+			const uint32 Target = static_cast<uint32>(static_cast<float>(Previous.IndexCount) * t_Settings.Reduction) / 3 * 3;
+			if (Target / 3 < t_Settings.MinTriangles)
+			{
+				break;
+			}
+
+			float Error = 0.0f;
+			std::vector<uint32> Simplified = Simplify(
+				t_Verts.data(), static_cast<uint32>(t_Verts.size()),
+				Source.data(), static_cast<uint32>(Source.size()),
+				Target, MaxError, &Error);
+
+			// The error limit stopped it before it got halfway there, not worth another level
+			if (Simplified.size() > (Previous.IndexCount + Target) / 2)
+			{
+				break;
+			}
+
+			MeshLod Lod = {};
+			Lod.FirstIndex = static_cast<uint32>(t_Indices.size());
+			Lod.IndexCount = static_cast<uint32>(Simplified.size());
+			Lod.Error = std::max(Error, Previous.Error);
+			Lods.emplace_back(Lod);
+
+			t_Indices.insert(t_Indices.end(), Simplified.begin(), Simplified.end());
+		}
+
+		return Lods;
+	}
+
+	float LodSelector::ProjectionScale(const glm::mat4& t_Projection, uint32 t_ScreenHeight)
+	{
+		// [1][1] is 1 / tan(fov / 2), the sign depends on which way y is flipped
+		return std::abs(t_Projection[1][1]) * 0.5f * static_cast<float>(t_ScreenHeight);
+	}
+
+	uint32 LodSelector::Select(const std::vector<MeshLod>& t_Lods, const BoundingSphere& t_LocalSphere, const glm::mat4& t_World, uint32 t_Current) const
+	{
+		if (t_Lods.size() <= 1 || ThresholdPixels <= 0.0f)
+		{
+			return 0;
+		}
+
+		const BoundingSphere WorldSphere = t_LocalSphere.Transformed(t_World);
+		const float Scale = t_LocalSphere.Radius > 0.0f ? WorldSphere.Radius / t_LocalSphere.Radius : 1.0f;
+
+		// Distance to the closest point that the mesh can have, full detail if the camera is inside of it
+		const float Distance = glm::length(WorldSphere.Center - CameraPos) - WorldSphere.Radius;
+		if (Distance <= 0.0f)
+		{
+			return 0;
+		}
+
+		const float ErrorToPixels = Scale * PixelsPerUnit / Distance;
+		const uint32 Last = static_cast<uint32>(t_Lods.size()) - 1;
+		const uint32 Current = std::min(t_Current, Last);
+
+		uint32 Desired = 0;
+		while (Desired < Last && t_Lods[Desired + 1].Error * ErrorToPixels <= ThresholdPixels)
+		{
+			++Desired;
+		}
+
+		const float CoarserThreshold = ThresholdPixels * (1.0f - Hysteresis);
+		while (Desired > Current && t_Lods[Desired].Error * ErrorToPixels > CoarserThreshold)
+		{
+			--Desired;
+		}
+
+		return Desired;
+	}
+}   // namespace Fling
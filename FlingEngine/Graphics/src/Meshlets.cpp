@@ -0,0 +1,304 @@
+#include "pch.h"
+#include "Meshlets.h"
+#include "Frustum.h"
+#include "Vertex.h"
+
+#include <algorithm>
+
+namespace Fling
+{
+	namespace
+	{
+		constexpr uint32 InvalidTriangle = ~0U;
+
+		/** Normals that spread further than this from the axis can't be culled well anyway, about 84 degrees */
+		constexpr float MinConeDot = 0.1f;
+
+		/** Fill in the bounding sphere and normal cone of a meshlet from its triangles */
+		void CalculateBounds(const std::vector<Vertex>& t_Verts, const uint32* t_Indices, Meshlet& t_Meshlet)
+		{
+			AABB Box;
+			for (uint32 i = 0; i < t_Meshlet.IndexCount; ++i)
+			{
+				Box.Expand(t_Verts[t_Indices[i]].Pos);
+			}
+
+			t_Meshlet.Bounds.Center = Box.GetCenter();
+			float MaxDistSq = 0.0f;
+			for (uint32 i = 0; i < t_Meshlet.IndexCount; ++i)
+			{
+				const glm::vec3 Offset = t_Verts[t_Indices[i]].Pos - t_Meshlet.Bounds.Center;
+				MaxDistSq = glm::max(MaxDistSq, glm::dot(Offset, Offset));
+			}
+			t_Meshlet.Bounds.Radius = glm::sqrt(MaxDistSq);
+
+			// Face normals from the winding, that is what the rasterizer culls by
+			std::vector<glm::vec3> Normals;
+			Normals.reserve(t_Meshlet.IndexCount / 3);
+			glm::vec3 Sum(0.0f);
+			for (uint32 i = 0; i + 2 < t_Meshlet.IndexCount; i += 3)
+			{
+				const glm::vec3& A = t_Verts[t_Indices[i]].Pos;
+				const glm::vec3& B = t_Verts[t_Indices[i + 1]].Pos;
+				const glm::vec3& C = t_Verts[t_Indices[i + 2]].Pos;
+				const glm::vec3 Normal = glm::cross(B - A, C - A);
+				const float Length = glm::length(Normal);
+				if (Length > 0.0f)
+				{
+					Normals.push_back(Normal / Length);
+					Sum += Normals.back();
+				}
+			}
+
+			t_Meshlet.ConeCutoff = 1.0f;
+			const float SumLength = glm::length(Sum);
+			if (Normals.empty() || SumLength <= 0.0f)
+			{
+				return;
+			}
+
+			t_Meshlet.ConeAxis = Sum / SumLength;
+			float MinDot = 1.0f;
+			for (const glm::vec3& Normal : Normals)
+			{
+				MinDot = glm::min(MinDot, glm::dot(Normal, t_Meshlet.ConeAxis));
+			}
+
+			if (MinDot >= MinConeDot)
+			{
+				t_Meshlet.ConeCutoff = glm::sqrt(1.0f - MinDot * MinDot);
+			}
+		}
+	}
+
+	std::vector<Meshlet> MeshletBuilder::Build(const std::vector<Vertex>& t_Verts, std::vector<uint32>& t_Indices, uint32 t_FirstIndex, uint32 t_IndexCount)
+	{
+		assert(t_FirstIndex + t_IndexCount <= t_Indices.size());
+
+		std::vector<Meshlet> Meshlets;
+		const uint32 TriCount = t_IndexCount / 3;
+		if (TriCount == 0)
+		{
+			return Meshlets;
+		}
+
+		const uint32* Tris = t_Indices.data() + t_FirstIndex;
+		const uint32 VertCount = static_cast<uint32>(t_Verts.size());
+
+		// Triangles around each vertex
+		std::vector<uint32> AdjacencyOffsets(VertCount + 1, 0);
+		for (uint32 i = 0; i < TriCount * 3; ++i)
+		{
+			++AdjacencyOffsets[Tris[i] + 1];
+		}
+		for (uint32 v = 0; v < VertCount; ++v)
+		{
+			AdjacencyOffsets[v + 1] += AdjacencyOffsets[v];
+		}
+
+		std::vector<uint32> Adjacency(TriCount * 3);
+		std::vector<uint32> Cursor(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+		for (uint32 t = 0; t < TriCount; ++t)
+		{
+			for (uint32 c = 0; c < 3; ++c)
+			{
+				Adjacency[Cursor[Tris[t * 3 + c]]++] = t;
+			}
+		}
+
+		std::vector<bool> Emitted(TriCount, false);
+		std::vector<uint32> Reordered;
+		Reordered.reserve(TriCount * 3);
+
+		// Meshlet that each vertex was last added to, so checking if it is new is one lookup
+		std::vector<uint32> VertexMeshlet(VertCount, ~0U);
+		std::vector<uint32> MeshletVerts;
+		MeshletVerts.reserve(MaxVertices);
+
+		uint32 NextSeed = 0;
+		while (true)
+		{
+			const uint32 MeshletIndex = static_cast<uint32>(Meshlets.size());
+			auto NewVertexCount = [&](uint32 t_Tri)
+			{
+				uint32 Count = 0;
+				for (uint32 c = 0; c < 3; ++c)
+				{
+					Count += VertexMeshlet[Tris[t_Tri * 3 + c]] != MeshletIndex ? 1 : 0;
+				}
+				return Count;
+			};
+
+			while (NextSeed < TriCount && Emitted[NextSeed])
+			{
+				++NextSeed;
+			}
+			if (NextSeed == TriCount)
+			{
+				break;
+			}
+
+			Meshlet& Current = Meshlets.emplace_back();
+			Current.FirstIndex = t_FirstIndex + static_cast<uint32>(Reordered.size());
+			MeshletVerts.clear();
+
+			uint32 Tri = NextSeed;
+			uint32 TrianglesAdded = 0;
+			while (Tri != InvalidTriangle)
+			{
+				Emitted[Tri] = true;
+				++TrianglesAdded;
+				for (uint32 c = 0; c < 3; ++c)
+				{
+					const uint32 Vert = Tris[Tri * 3 + c];
+					Reordered.push_back(Vert);
+					if (VertexMeshlet[Vert] != MeshletIndex)
+					{
+						VertexMeshlet[Vert] = MeshletIndex;
+						MeshletVerts.push_back(Vert);
+					}
+				}
+
+				if (TrianglesAdded == MaxTriangles)
+				{
+					break;
+				}
+
+				// Grow over the neighbour that adds the fewest vertices, so meshlets stay compact
+				uint32 Best = InvalidTriangle;
+				uint32 BestNew = 4;
+				for (uint32 Vert : MeshletVerts)
+				{
+					for (uint32 a = AdjacencyOffsets[Vert]; a < AdjacencyOffsets[Vert + 1] && BestNew > 0; ++a)
+					{
+						const uint32 Neighbour = Adjacency[a];
+						if (Emitted[Neighbour])
+						{
+							continue;
+						}
+
+						const uint32 New = NewVertexCount(Neighbour);
+						if (New < BestNew)
+						{
+							Best = Neighbour;
+							BestNew = New;
+						}
+					}
+				}
+
+				// Nothing connected is left, the next triangle in index order is usually close by
+				if (Best == InvalidTriangle)
+				{
+					while (NextSeed < TriCount && Emitted[NextSeed])
+					{
+						++NextSeed;
+					}
+					if (NextSeed < TriCount)
+					{
+						Best = NextSeed;
+						BestNew = NewVertexCount(Best);
+					}
+				}
+
+				if (Best == InvalidTriangle || MeshletVerts.size() + BestNew > MaxVertices)
+				{
+					break;
+				}
+				Tri = Best;
+			}
+
+			Current.IndexCount = t_FirstIndex + static_cast<uint32>(Reordered.size()) - Current.FirstIndex;
+			Current.VertexCount = static_cast<uint32>(MeshletVerts.size());
+		}
+
+		std::copy(Reordered.begin(), Reordered.end(), t_Indices.begin() + t_FirstIndex);
+
+		for (Meshlet& Current : Meshlets)
+		{
+			CalculateBounds(t_Verts, t_Indices.data() + Current.FirstIndex, Current);
+		}
+
+		return Meshlets;
+	}
+
+	bool MeshletBuilder::IsBackFacing(const Meshlet& t_Meshlet, const glm::vec3& t_LocalCameraPos)
+	{
+		// Every normal is within the cone, so if the view direction is far enough past 90 degrees
+		// from the axis for the whole sphere, no triangle can face the camera
+		const glm::vec3 ToCenter = t_Meshlet.Bounds.Center - t_LocalCameraPos;
+		return glm::dot(ToCenter, t_Meshlet.ConeAxis) >= t_Meshlet.ConeCutoff * glm::length(ToCenter) + t_Meshlet.Bounds.Radius;
+	}
+
+	void MeshletBuilder::Cull(
+		const Meshlet* t_Meshlets,
+		uint32 t_Count,
+		const glm::mat4& t_World,
+		const glm::vec3& t_CameraPos,
+		const Frustum& t_Frustum,
+		uint32 t_MaxRanges,
+		std::vector<IndexRange>& t_OutRanges,
+		MeshletCullStats& t_Stats)
+	{
+		t_OutRanges.clear();
+
+		// Which side a triangle faces doesn't change with an affine transform, so the cone test
+		// can happen in model space. Mirrored transforms flip the winding, those skip it
+		const glm::vec3 LocalCameraPos = glm::vec3(glm::inverse(t_World) * glm::vec4(t_CameraPos, 1.0f));
+		const bool bConeTest = glm::determinant(glm::mat3(t_World)) > 0.0f;
+
+		uint32 Triangles = 0;
+		for (uint32 i = 0; i < t_Count; ++i)
+		{
+			const Meshlet& Cluster = t_Meshlets[i];
+			Triangles += Cluster.IndexCount / 3;
+
+			const BoundingSphere WorldBounds = Cluster.Bounds.Transformed(t_World);
+			if (!t_Frustum.IntersectsSphere(WorldBounds.Center, WorldBounds.Radius) ||
+				(bConeTest && IsBackFacing(Cluster, LocalCameraPos)))
+			{
+				++t_Stats.CulledClusters;
+				continue;
+			}
+
+			// Meshlets of a LOD are back to back, so neighbours that both survive are one range
+			if (!t_OutRanges.empty() && t_OutRanges.back().FirstIndex + t_OutRanges.back().IndexCount == Cluster.FirstIndex)
+			{
+				t_OutRanges.back().IndexCount += Cluster.IndexCount;
+			}
+			else
+			{
+				t_OutRanges.push_back({ Cluster.FirstIndex, Cluster.IndexCount });
+			}
+		}
+
+		// Fill in the smallest gaps until there are few enough draws
+		while (t_MaxRanges > 0 && t_OutRanges.size() > t_MaxRanges)
+		{
+			size_t Smallest = 0;
+			uint32 SmallestGap = ~0U;
+			for (size_t r = 0; r + 1 < t_OutRanges.size(); ++r)
+			{
+				const uint32 Gap = t_OutRanges[r + 1].FirstIndex - (t_OutRanges[r].FirstIndex + t_OutRanges[r].IndexCount);
+				if (Gap < SmallestGap)
+				{
+					Smallest = r;
+					SmallestGap = Gap;
+				}
+			}
+
+			IndexRange& Merged = t_OutRanges[Smallest];
+			Merged.IndexCount = t_OutRanges[Smallest + 1].FirstIndex + t_OutRanges[Smallest + 1].IndexCount - Merged.FirstIndex;
+			t_OutRanges.erase(t_OutRanges.begin() + Smallest + 1);
+		}
+
+		uint32 Drawn = 0;
+		for (const IndexRange& Range : t_OutRanges)
+		{
+			Drawn += Range.IndexCount / 3;
+		}
+
+		t_Stats.Clusters += t_Count;
+		t_Stats.Triangles += Triangles;
+		t_Stats.CulledTriangles += Triangles - Drawn;
+	}
+}   // namespace Fling
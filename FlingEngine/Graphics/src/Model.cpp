@@ -4,6 +4,8 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 #include "ResourceManager.h"
+#include "FlingConfig.h"
+#include "VulkanApp.h"
 
 namespace Fling
 {
@@ -84,16 +86,20 @@ namespace Fling
 	{
 		m_Verts = t_Verts;
 		m_Indices = t_Indecies;
+		m_Lods.push_back({ 0, static_cast<uint32>(m_Indices.size()), 0.0f });
 
 		CalculateVertexTangents(m_Verts.data(), static_cast<uint32>(m_Verts.size()), m_Indices.data(), static_cast<uint32>(m_Indices.size()));
-		CreateBuffers();
+		CalculateBounds();
+		UploadGeometry();
 	}
 
 	Model::~Model()
 	{
-		// #TODO Make the buffer allocations from a pool allocator instead of new's and deletes
-		delete m_VertexBuffer;
-		delete m_IndexBuffer;
+		// Models that outlive the renderer have nothing to give back
+		if (GeometryBuffer* Geometry = VulkanApp::Get().GetGeometryBuffer())
+		{
+			Geometry->Free(m_Geometry);
+		}
 	}
 
 	void Model::LoadModel()
@@ -113,6 +119,12 @@ namespace Fling
 			return;
 		}
 
+		// Obj files index every attribute separately, so share the vertices that are the same in all of them.
+		// Otherwise every triangle would be on its own and there would be nothing to simplify
+		auto VertexHash = [](const Vertex& t_Vert) { return std::hash<Vertex>()(t_Vert) ^ (std::hash<glm::vec3>()(t_Vert.Normal) << 1); };
+		auto VertexEqual = [](const Vertex& A, const Vertex& B) { return A == B && A.Normal == B.Normal; };
+		std::unordered_map<Vertex, uint32, decltype(VertexHash), decltype(VertexEqual)> UniqueVerts(0, VertexHash, VertexEqual);
+
 		// Parse all shapes to get the verts and indecies of this object
 		for (const tinyobj::shape_t& shape : shapes)
 		{
@@ -141,37 +153,127 @@ namespace Fling
 
 				vertex.Color = { 1.0f, 1.0f, 1.0f };
 
-				m_Verts.push_back(vertex);
-				m_Indices.push_back(m_Indices.size());
+				auto It = UniqueVerts.find(vertex);
+				if (It == UniqueVerts.end())
+				{
+					It = UniqueVerts.emplace(vertex, static_cast<uint32>(m_Verts.size())).first;
+					m_Verts.push_back(vertex);
+				}
+				m_Indices.push_back(It->second);
 			}
 		}
 
 		// Calculate our tangent vectors for this model
 		CalculateVertexTangents(m_Verts.data(), static_cast<uint32>(m_Verts.size()), m_Indices.data(), static_cast<uint32>(m_Indices.size()));
 
-		CreateBuffers();
+		CalculateBounds();
+		GenerateLods();
+		GenerateMeshlets();
+		UploadGeometry();
 	}
 
-	void Model::CreateBuffers()
+	VertexFormat Model::GetVertexFormat()
 	{
-		// Create vertex buffer
-		VkDeviceSize VertBufferSize = sizeof(m_Verts[0]) * m_Verts.size();
-		// We use a staging buffer to get to a more optimial memory layout for the GPU
-		Buffer VertexStagingBuffer(VertBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Verts.data());
-		m_VertexBuffer = new Buffer(VertBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		Buffer::CopyBuffer(&VertexStagingBuffer, m_VertexBuffer, VertBufferSize);
-
-		// Create Index buffer
-		VkDeviceSize IndexBufferSize = sizeof(m_Indices[0]) * GetIndexCount();
-		Buffer IndexStagingBuffer(IndexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Indices.data());
-		m_IndexBuffer = new Buffer(IndexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		Buffer::CopyBuffer(&IndexStagingBuffer, m_IndexBuffer, IndexBufferSize);
+		static const VertexFormat Format = [] ()
+		{
+			const std::string Name = FlingConfig::GetString("Graphics", "VertexFormat", "Compact");
+			if (Name == "Full")
+			{
+				return VertexFormat::Full;
+			}
+			if (Name != "Compact")
+			{
+				F_LOG_WARN("Unknown vertex format {}, using Compact", Name);
+			}
+			return VertexFormat::Compact;
+		}();
+
+		return Format;
+	}
+
+	glm::mat4 Model::GetDecodeMatrix() const
+	{
+		if (m_VertexFormat != VertexFormat::Compact)
+		{
+			return glm::mat4(1.0f);
+		}
+
+		// UNORM 0 is the min corner of the bounds and 1 is the max corner
+		const glm::vec3 Extents = m_BoundingBox.GetExtents();
+		return glm::scale(glm::translate(glm::mat4(1.0f), m_BoundingBox.GetCenter() - Extents), Extents * 2.0f);
+	}
+
+	void Model::UploadGeometry()
+	{
+		GeometryBuffer* Geometry = VulkanApp::Get().GetGeometryBuffer();
+		assert(Geometry);
+
+		m_VertexFormat = Geometry->GetVertexFormat();
+		const bool bCompact = m_VertexFormat == VertexFormat::Compact;
+
+		// The CPU side keeps the full vertices for picking, occlusion and LODs, only the GPU gets the compact ones
+		std::vector<CompactVertex> CompactVerts;
+		if (bCompact)
+		{
+			CompactVerts.reserve(m_Verts.size());
+			for (const Vertex& Vert : m_Verts)
+			{
+				CompactVerts.push_back(CompactVertex::Pack(Vert, m_BoundingBox));
+			}
+		}
+
+		// Create the position only stream, in the same format as the positions of the vertices
+		m_Positions.resize(m_Verts.size());
+		std::vector<uint16> CompactPositions;
+		for (size_t i = 0; i < m_Verts.size(); ++i)
+		{
+			m_Positions[i] = m_Verts[i].Pos;
+			if (bCompact)
+			{
+				CompactPositions.insert(CompactPositions.end(), std::begin(CompactVerts[i].Pos), std::end(CompactVerts[i].Pos));
+			}
+		}
+
+		const void* VertData = bCompact ? static_cast<const void*>(CompactVerts.data()) : static_cast<const void*>(m_Verts.data());
+		const void* PositionData = bCompact ? static_cast<const void*>(CompactPositions.data()) : static_cast<const void*>(m_Positions.data());
+		m_Geometry = Geometry->Allocate(VertData, PositionData, static_cast<uint32>(m_Verts.size()), m_Indices.data(), static_cast<uint32>(m_Indices.size()));
+	}
+
+	void Model::CalculateBounds()
+	{
+		m_BoundingBox = AABB::FromVertices(m_Verts.data(), m_Verts.size());
+		m_BoundingSphere = BoundingSphere::FromVertices(m_BoundingBox, m_Verts.data(), m_Verts.size());
+	}
+
+	void Model::GenerateLods()
+	{
+		LodChainSettings Settings;
+		Settings.MaxLevels = static_cast<uint32>(glm::max(FlingConfig::GetInt("Graphics", "LodLevels", 4), 1));
+		Settings.Reduction = glm::clamp(FlingConfig::GetFloat("Graphics", "LodReduction", 0.5f), 0.05f, 0.95f);
+		Settings.MaxError = FlingConfig::GetFloat("Graphics", "LodMaxError", 0.05f);
+
+		m_Lods = MeshSimplifier::BuildLodChain(m_Verts, m_Indices, Settings);
+		if (m_Lods.size() > 1)
+		{
+			F_LOG_TRACE("{} has {} LODs, {} to {} triangles", GetGuidString(), m_Lods.size(), m_Lods.front().IndexCount / 3, m_Lods.back().IndexCount / 3);
+		}
+	}
+
+	void Model::GenerateMeshlets()
+	{
+		for (MeshLod& Lod : m_Lods)
+		{
+			std::vector<Meshlet> LodMeshlets = MeshletBuilder::Build(m_Verts, m_Indices, Lod.FirstIndex, Lod.IndexCount);
+			Lod.FirstMeshlet = static_cast<uint32>(m_Meshlets.size());
+			Lod.MeshletCount = static_cast<uint32>(LodMeshlets.size());
+			m_Meshlets.insert(m_Meshlets.end(), LodMeshlets.begin(), LodMeshlets.end());
+		}
 	}
 
 	void Model::CalculateVertexTangents(Vertex* verts, uint32 numVerts, uint32* indices, uint32 numIndices)
 	{
 		// Calculate tangents one whole triangle at a time
-		for ( size_t i = 0; i < numVerts;)
+		for ( size_t i = 0; i < numIndices;)
 		{
 			// Grab indices and vertices of first triangle
 			uint32 i1 = indices [ i++ ];
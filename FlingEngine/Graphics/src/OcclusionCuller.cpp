@@ -0,0 +1,374 @@
+#include "pch.h"
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+
+namespace Fling
+{
+	OcclusionCuller::OcclusionCuller(uint32 t_WorkerCount)
+		: m_Depth(Width * Height, 1.0f)
+		, m_BlockDepth(BlocksX * BlocksY, 1.0f)
+	{
+		for (uint32 i = 0; i < t_WorkerCount; ++i)
+		{
+			m_Workers.emplace_back(&OcclusionCuller::WorkerLoop, this);
+		}
+	}
+
+	OcclusionCuller::~OcclusionCuller()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			m_ShuttingDown = true;
+		}
+		m_WorkAvailable.notify_all();
+
+		for (std::thread& Worker : m_Workers)
+		{
+			Worker.join();
+		}
+	}
+
+	void OcclusionCuller::BeginFrame(const glm::mat4& t_ViewProj)
+	{
+		m_ViewProj = t_ViewProj;
+		m_Occluders.clear();
+		m_Triangles.clear();
+	}
+
+	void OcclusionCuller::AddOccluder(const glm::vec3* t_Positions, const uint32* t_Indices, uint32 t_IndexCount, const glm::mat4& t_World)
+	{
+		assert(t_Positions && t_Indices && t_IndexCount % 3 == 0);
+		m_Occluders.push_back({ t_Positions, t_Indices, t_IndexCount, t_World });
+	}
+
+	void OcclusionCuller::Rasterize()
+	{
+		// Transform and set up every triangle once, the bands only read them
+		for (const Occluder& Occ : m_Occluders)
+		{
+			const glm::mat4 ToClip = m_ViewProj * Occ.World;
+			for (uint32 i = 0; i < Occ.IndexCount; i += 3)
+			{
+				const glm::vec4 Clip[3] =
+				{
+					ToClip * glm::vec4(Occ.Positions[Occ.Indices[i + 0]], 1.0f),
+					ToClip * glm::vec4(Occ.Positions[Occ.Indices[i + 1]], 1.0f),
+					ToClip * glm::vec4(Occ.Positions[Occ.Indices[i + 2]], 1.0f)
+				};
+				SetupTriangle(Clip);
+			}
+		}
+
+		m_BandsLeft = BandCount;
+		m_NextBand = 0;
+
+		if (!m_Workers.empty())
+		{
+			{
+				std::lock_guard<std::mutex> Lock(m_Mutex);
+				++m_Generation;
+			}
+			m_WorkAvailable.notify_all();
+		}
+
+		RasterizeBands();
+
+		if (!m_Workers.empty())
+		{
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			m_WorkDone.wait(Lock, [this]() { return m_BandsLeft == 0; });
+		}
+	}
+
+	void OcclusionCuller::SetupTriangle(const glm::vec4 t_Clip[3])
+	{
+		// Clip against the near plane (z = 0), which leaves at most a quad
+		glm::vec4 Poly[4];
+		uint32 PolyCount = 0;
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			const glm::vec4& Cur = t_Clip[i];
+			const glm::vec4& Next = t_Clip[(i + 1) % 3];
+
+			if (Cur.z >= 0.0f)
+			{
+				Poly[PolyCount++] = Cur;
+			}
+
+			if ((Cur.z >= 0.0f) != (Next.z >= 0.0f))
+			{
+				const float T = Cur.z / (Cur.z - Next.z);
+				Poly[PolyCount++] = Cur + (Next - Cur) * T;
+			}
+		}
+
+		if (PolyCount < 3)
+		{
+			return;
+		}
+
+		glm::vec3 Screen[4];
+		for (uint32 i = 0; i < PolyCount; ++i)
+		{
+			const float InvW = 1.0f / glm::max(Poly[i].w, 1e-6f);
+			Screen[i].x = (Poly[i].x * InvW * 0.5f + 0.5f) * static_cast<float>(Width);
+			Screen[i].y = (Poly[i].y * InvW * 0.5f + 0.5f) * static_cast<float>(Height);
+			Screen[i].z = Poly[i].z * InvW;
+		}
+
+		AddScreenTriangle(Screen[0], Screen[1], Screen[2]);
+		if (PolyCount == 4)
+		{
+			AddScreenTriangle(Screen[0], Screen[2], Screen[3]);
+		}
+	}
+
+	void OcclusionCuller::AddScreenTriangle(const glm::vec3& t_A, const glm::vec3& t_B, const glm::vec3& t_C)
+	{
+		// Both sides are drawn, so flip anything clockwise to keep the inside of the edges positive
+		glm::vec3 V0 = t_A;
+		glm::vec3 V1 = t_B;
+		glm::vec3 V2 = t_C;
+		float Area = (V1.x - V0.x) * (V2.y - V0.y) - (V1.y - V0.y) * (V2.x - V0.x);
+		if (Area < 0.0f)
+		{
+			std::swap(V1, V2);
+			Area = -Area;
+		}
+
+		if (Area < 1e-6f)
+		{
+			return;
+		}
+
+		ScreenTriangle Tri = {};
+		Tri.MinX = glm::max(static_cast<int32>(std::floor(glm::min(V0.x, glm::min(V1.x, V2.x)))), 0);
+		Tri.MinY = glm::max(static_cast<int32>(std::floor(glm::min(V0.y, glm::min(V1.y, V2.y)))), 0);
+		Tri.MaxX = glm::min(static_cast<int32>(std::ceil(glm::max(V0.x, glm::max(V1.x, V2.x)))), static_cast<int32>(Width) - 1);
+		Tri.MaxY = glm::min(static_cast<int32>(std::ceil(glm::max(V0.y, glm::max(V1.y, V2.y)))), static_cast<int32>(Height) - 1);
+		if (Tri.MinX > Tri.MaxX || Tri.MinY > Tri.MaxY)
+		{
+			return;
+		}
+
+		const glm::vec3 Verts[3] = { V0, V1, V2 };
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			const glm::vec3& From = Verts[i];
+			const glm::vec3& To = Verts[(i + 1) % 3];
+			Tri.EdgeA[i] = From.y - To.y;
+			Tri.EdgeB[i] = To.x - From.x;
+
+			// Both triangles on an edge use the same end of it, so one gets exactly the negated edge function
+			// of the other and a pixel center on the edge belongs to only one of them. Otherwise meshes would crack
+			const bool FromFirst = From.x < To.x || (From.x == To.x && From.y < To.y);
+			const glm::vec3& Origin = FromFirst ? From : To;
+			Tri.EdgeC[i] = -(Tri.EdgeA[i] * Origin.x + Tri.EdgeB[i] * Origin.y);
+			Tri.EdgeInclusive[i] = Tri.EdgeA[i] > 0.0f || (Tri.EdgeA[i] == 0.0f && Tri.EdgeB[i] < 0.0f);
+		}
+
+		// Depth is linear in screen space after the divide
+		Tri.DepthDx = ((V1.z - V0.z) * (V2.y - V0.y) - (V2.z - V0.z) * (V1.y - V0.y)) / Area;
+		Tri.DepthDy = ((V2.z - V0.z) * (V1.x - V0.x) - (V1.z - V0.z) * (V2.x - V0.x)) / Area;
+
+		// Sample at the pixel center but use the farthest depth that the pixel could have,
+		// so an occluder never ends up closer than it really is
+		Tri.Depth = V0.z - Tri.DepthDx * V0.x - Tri.DepthDy * V0.y + 0.5f * (glm::abs(Tri.DepthDx) + glm::abs(Tri.DepthDy));
+
+		m_Triangles.push_back(Tri);
+	}
+
+	void OcclusionCuller::RasterizeBands()
+	{
+		for (;;)
+		{
+			const uint32 Band = m_NextBand.fetch_add(1);
+			if (Band >= BandCount)
+			{
+				return;
+			}
+
+			RasterizeBand(Band);
+
+			if (m_BandsLeft.fetch_sub(1) == 1)
+			{
+				std::lock_guard<std::mutex> Lock(m_Mutex);
+				m_WorkDone.notify_all();
+			}
+		}
+	}
+
+	void OcclusionCuller::RasterizeBand(uint32 t_Band)
+	{
+		const int32 BandMinY = static_cast<int32>(t_Band * BlockSize);
+		const int32 BandMaxY = BandMinY + static_cast<int32>(BlockSize) - 1;
+
+		float* BandDepth = &m_Depth[BandMinY * Width];
+		std::fill(BandDepth, BandDepth + Width * BlockSize, 1.0f);
+
+		for (const ScreenTriangle& Tri : m_Triangles)
+		{
+			if (Tri.MaxY < BandMinY || Tri.MinY > BandMaxY)
+			{
+				continue;
+			}
+
+			const int32 MinY = glm::max(Tri.MinY, BandMinY);
+			const int32 MaxY = glm::min(Tri.MaxY, BandMaxY);
+
+			// Rows are processed 4 pixels at a time, Width is a multiple of 4 so this never runs off the end
+			const int32 MinX = Tri.MinX & ~3;
+
+			for (int32 y = MinY; y <= MaxY; ++y)
+			{
+				const float Py = static_cast<float>(y) + 0.5f;
+				const float Row0 = Tri.EdgeB[0] * Py + Tri.EdgeC[0];
+				const float Row1 = Tri.EdgeB[1] * Py + Tri.EdgeC[1];
+				const float Row2 = Tri.EdgeB[2] * Py + Tri.EdgeC[2];
+				const float RowDepth = Tri.Depth + Tri.DepthDy * Py;
+				float* Dst = &m_Depth[y * Width];
+
+#if FLING_SIMD_SSE
+				const __m128 Offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+				const __m128 A0 = _mm_set1_ps(Tri.EdgeA[0]);
+				const __m128 A1 = _mm_set1_ps(Tri.EdgeA[1]);
+				const __m128 A2 = _mm_set1_ps(Tri.EdgeA[2]);
+				const __m128 R0 = _mm_set1_ps(Row0);
+				const __m128 R1 = _mm_set1_ps(Row1);
+				const __m128 R2 = _mm_set1_ps(Row2);
+				const __m128 Dx = _mm_set1_ps(Tri.DepthDx);
+				const __m128 RowZ = _mm_set1_ps(RowDepth);
+				const __m128 Zero = _mm_setzero_ps();
+				const __m128 Inclusive0 = _mm_castsi128_ps(_mm_set1_epi32(Tri.EdgeInclusive[0] ? -1 : 0));
+				const __m128 Inclusive1 = _mm_castsi128_ps(_mm_set1_epi32(Tri.EdgeInclusive[1] ? -1 : 0));
+				const __m128 Inclusive2 = _mm_castsi128_ps(_mm_set1_epi32(Tri.EdgeInclusive[2] ? -1 : 0));
+
+				for (int32 x = MinX; x <= Tri.MaxX; x += 4)
+				{
+					const __m128 Px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), Offsets);
+
+					const __m128 E0 = _mm_add_ps(_mm_mul_ps(A0, Px), R0);
+					const __m128 E1 = _mm_add_ps(_mm_mul_ps(A1, Px), R1);
+					const __m128 E2 = _mm_add_ps(_mm_mul_ps(A2, Px), R2);
+
+					__m128 Inside = _mm_or_ps(_mm_cmpgt_ps(E0, Zero), _mm_and_ps(_mm_cmpeq_ps(E0, Zero), Inclusive0));
+					Inside = _mm_and_ps(Inside, _mm_or_ps(_mm_cmpgt_ps(E1, Zero), _mm_and_ps(_mm_cmpeq_ps(E1, Zero), Inclusive1)));
+					Inside = _mm_and_ps(Inside, _mm_or_ps(_mm_cmpgt_ps(E2, Zero), _mm_and_ps(_mm_cmpeq_ps(E2, Zero), Inclusive2)));
+					if (_mm_movemask_ps(Inside) == 0)
+					{
+						continue;
+					}
+
+					const __m128 Z = _mm_add_ps(_mm_mul_ps(Dx, Px), RowZ);
+					const __m128 Old = _mm_loadu_ps(Dst + x);
+					const __m128 New = _mm_or_ps(_mm_and_ps(Inside, _mm_min_ps(Old, Z)), _mm_andnot_ps(Inside, Old));
+					_mm_storeu_ps(Dst + x, New);
+				}
+#else
+				const auto IsInside = [&Tri](uint32 t_Edge, float t_Value)
+				{
+					return t_Value > 0.0f || (t_Value == 0.0f && Tri.EdgeInclusive[t_Edge]);
+				};
+
+				for (int32 x = MinX; x <= Tri.MaxX; ++x)
+				{
+					const float Px = static_cast<float>(x) + 0.5f;
+					if (IsInside(0, Tri.EdgeA[0] * Px + Row0) && IsInside(1, Tri.EdgeA[1] * Px + Row1) && IsInside(2, Tri.EdgeA[2] * Px + Row2))
+					{
+						Dst[x] = glm::min(Dst[x], Tri.DepthDx * Px + RowDepth);
+					}
+				}
+#endif	// FLING_SIMD_SSE
+			}
+		}
+
+		// This band is exactly one row of blocks
+		for (uint32 Block = 0; Block < BlocksX; ++Block)
+		{
+			float Farthest = 0.0f;
+			for (uint32 y = 0; y < BlockSize; ++y)
+			{
+				const float* Row = BandDepth + y * Width + Block * BlockSize;
+				for (uint32 x = 0; x < BlockSize; ++x)
+				{
+					Farthest = glm::max(Farthest, Row[x]);
+				}
+			}
+			m_BlockDepth[t_Band * BlocksX + Block] = Farthest;
+		}
+	}
+
+	void OcclusionCuller::WorkerLoop()
+	{
+		uint64 SeenGeneration = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> Lock(m_Mutex);
+				m_WorkAvailable.wait(Lock, [&]() { return m_ShuttingDown || m_Generation != SeenGeneration; });
+				if (m_ShuttingDown)
+				{
+					return;
+				}
+				SeenGeneration = m_Generation;
+			}
+
+			RasterizeBands();
+		}
+	}
+
+	bool OcclusionCuller::IsVisible(const AABB& t_WorldBox) const
+	{
+		glm::vec2 ScreenMin(FLT_MAX);
+		glm::vec2 ScreenMax(-FLT_MAX);
+		float Nearest = FLT_MAX;
+
+		for (uint32 i = 0; i < 8; ++i)
+		{
+			const glm::vec3 Corner(
+				(i & 1) ? t_WorldBox.Max.x : t_WorldBox.Min.x,
+				(i & 2) ? t_WorldBox.Max.y : t_WorldBox.Min.y,
+				(i & 4) ? t_WorldBox.Max.z : t_WorldBox.Min.z);
+
+			const glm::vec4 Clip = m_ViewProj * glm::vec4(Corner, 1.0f);
+			if (Clip.z < 0.0f)
+			{
+				return true;
+			}
+
+			const float InvW = 1.0f / Clip.w;
+			const glm::vec2 Screen(
+				(Clip.x * InvW * 0.5f + 0.5f) * static_cast<float>(Width),
+				(Clip.y * InvW * 0.5f + 0.5f) * static_cast<float>(Height));
+
+			ScreenMin = glm::min(ScreenMin, Screen);
+			ScreenMax = glm::max(ScreenMax, Screen);
+			Nearest = glm::min(Nearest, Clip.z * InvW);
+		}
+
+		// Off screen is the frustum's call, not ours
+		if (ScreenMax.x < 0.0f || ScreenMax.y < 0.0f || ScreenMin.x >= static_cast<float>(Width) || ScreenMin.y >= static_cast<float>(Height))
+		{
+			return true;
+		}
+
+		const uint32 BlockMinX = static_cast<uint32>(glm::max(ScreenMin.x, 0.0f)) / BlockSize;
+		const uint32 BlockMinY = static_cast<uint32>(glm::max(ScreenMin.y, 0.0f)) / BlockSize;
+		const uint32 BlockMaxX = glm::min(static_cast<uint32>(ScreenMax.x) / BlockSize, BlocksX - 1);
+		const uint32 BlockMaxY = glm::min(static_cast<uint32>(ScreenMax.y) / BlockSize, BlocksY - 1);
+
+		for (uint32 y = BlockMinY; y <= BlockMaxY; ++y)
+		{
+			for (uint32 x = BlockMinX; x <= BlockMaxX; ++x)
+			{
+				if (Nearest <= m_BlockDepth[y * BlocksX + x])
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+}   // namespace Fling
@@ -1,5 +1,4 @@
 #include "OffscreenSubpass.h"
-#include "FrameBuffer.h"
 #include "CommandBuffer.h"
 #include "PhyscialDevice.h"
 #include "LogicalDevice.h"
@@ -10,6 +9,18 @@
 #include "UniformBufferObject.h"
 #include "FirstPersonCamera.h"
 #include "FlingVulkan.h"
+#include "Stats.h"
+#include "GpuCullingPass.h"
+#include "VulkanApp.h"
+#include "GraphicsPipeline.h"
+#include "Buffer.h"
+#include "GpuProfiler.h"
+#include "FlingConfig.h"
+#include "DebugDraw.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
 
 namespace Fling
 {
@@ -17,39 +28,118 @@ namespace Fling
 		const LogicalDevice* t_Dev,
 		const Swapchain* t_Swap,
 		entt::registry& t_reg,
-		FirstPersonCamera* t_Cam,
 		std::shared_ptr<Fling::Shader> t_Vert,
-		std::shared_ptr<Fling::Shader> t_Frag)
+		std::shared_ptr<Fling::Shader> t_Frag,
+		VkRenderPass t_SinglePassRenderPass)
 		: Subpass(t_Dev, t_Swap, t_Vert, t_Frag)
-		, m_Camera(t_Cam)
+		, m_RenderGraph(t_Dev)
+		, m_SinglePassRenderPass(t_SinglePassRenderPass)
+		, m_SceneBVH(t_reg)
 	{
 		t_reg.on_construct<MeshRenderer>().connect<&OffscreenSubpass::OnMeshRendererAdded>(*this);
+		t_reg.on_replace<MeshRenderer>().connect<&OffscreenSubpass::OnMeshRendererReplaced>(*this);
+		t_reg.on_destroy<MeshRenderer>().connect<&OffscreenSubpass::OnMeshRendererDestroyed>(*this);
 
-		// Set the clear values for the G Buffer
-		m_ClearValues.resize(6);
-		m_ClearValues[0].color = m_ClearValues[1].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-		m_ClearValues[2].color = m_ClearValues[3].color = m_ClearValues[4].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-		m_ClearValues[5].depthStencil = { 1.0f, 0 };
+		// Every mesh is drawn with the camera in set 0 and all of the material textures in set 1,
+		// so the sets are bound once per pass and only the push constants change per mesh
+		m_Bindless = std::make_unique<BindlessTextures>(m_Device);
+		m_GraphicsPipeline->SetPipelineLayout({ m_Bindless->GetSetLayout() }, VK_SHADER_STAGE_VERTEX_BIT, sizeof(OffscreenPushConstants));
 
-		// Build offscreen semaphores -------
-		m_OffscreenSemaphores.resize(VkConfig::MAX_FRAMES_IN_FLIGHT);
-		for (int32 i = 0; i < VkConfig::MAX_FRAMES_IN_FLIGHT; i++)
+		m_LodSelector.ThresholdPixels = FlingConfig::GetFloat("Graphics", "LodErrorPixels", 1.0f);
+		m_LodSelector.Hysteresis = glm::clamp(FlingConfig::GetFloat("Graphics", "LodHysteresis", 0.25f), 0.0f, 1.0f);
+
+		m_MeshletCulling = FlingConfig::GetBool("Graphics", "MeshletCulling", false);
+		m_MeshletMaxDraws = static_cast<uint32>(glm::max(FlingConfig::GetInt("Graphics", "MeshletMaxDraws", 8), 1));
+
+		if (FlingConfig::GetBool("Graphics", "DrawSorting", false))
+		{
+			const int32 Threads = FlingConfig::GetInt("Graphics", "DrawSortThreads", 2);
+			m_DrawSorter = std::make_unique<DrawSorter>(static_cast<uint32>(Threads > 0 ? Threads : 0));
+		}
+
+		if (FlingConfig::GetBool("Graphics", "DynamicResolution", false))
+		{
+			// Input attachments are read at the same pixel that is shaded, so they can't be scaled
+			if (IsSinglePass())
+			{
+				F_LOG_WARN("Dynamic resolution doesn't work with SinglePassDeferred, rendering at full resolution");
+			}
+			else
+			{
+				DynamicResolutionSettings Settings = {};
+				Settings.TargetMilliseconds = FlingConfig::GetFloat("Graphics", "DynamicResolutionTargetMs", Settings.TargetMilliseconds);
+				Settings.MinScale = FlingConfig::GetFloat("Graphics", "DynamicResolutionMinScale", Settings.MinScale);
+				Settings.MaxScale = FlingConfig::GetFloat("Graphics", "DynamicResolutionMaxScale", Settings.MaxScale);
+				Settings.Headroom = FlingConfig::GetFloat("Graphics", "DynamicResolutionHeadroom", Settings.Headroom);
+				m_DynamicResolution = std::make_unique<DynamicResolution>(Settings);
+			}
+		}
+
+		if (FlingConfig::GetBool("Graphics", "OcclusionCulling", false))
 		{
-			m_OffscreenSemaphores[i] = GraphicsHelpers::CreateSemaphore(m_Device->GetVkDevice());
+			const int32 Threads = FlingConfig::GetInt("Graphics", "OcclusionThreads", 2);
+			m_OcclusionCuller = std::make_unique<OcclusionCuller>(static_cast<uint32>(Threads > 0 ? Threads : 0));
+			m_OccluderScreenSize = FlingConfig::GetFloat("Graphics", "OcclusionOccluderSize", 0.25f);
+			m_MaxOccluders = static_cast<uint32>(glm::max(FlingConfig::GetInt("Graphics", "OcclusionMaxOccluders", 16), 0));
 		}
 
-		GraphicsHelpers::CreateCommandPool(&m_CommandPool, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+		DepthPrepassSettings PrepassSettings = {};
+		PrepassSettings.Mode = DepthPrepassSelector::ParseMode(FlingConfig::GetString("Graphics", "DepthPrepass", "Off"));
+		if (PrepassSettings.Mode != DepthPrepassMode::Off)
+		{
+			// The global render pass has no subpass for it
+			if (IsSinglePass())
+			{
+				F_LOG_WARN("The depth prepass doesn't work with SinglePassDeferred, drawing the G-Buffer without it");
+			}
+			else
+			{
+				PrepassSettings.SampleFrames = static_cast<uint32>(glm::max(FlingConfig::GetInt("Graphics", "DepthPrepassSampleFrames", 16), 1));
+				PrepassSettings.RetestFrames = static_cast<uint32>(glm::max(FlingConfig::GetInt("Graphics", "DepthPrepassRetestFrames", 600), 1));
+				m_DepthPrepass = std::make_unique<DepthPrepassSelector>(PrepassSettings);
+			}
+		}
 
-		// Build offscreen command buffers
-		m_OffscreenCmdBufs.resize(m_SwapChain->GetImageCount());
-		for (size_t i = 0; i < m_OffscreenCmdBufs.size(); ++i)
+		if (FlingConfig::GetBool("Graphics", "OverdrawStats", false))
 		{
-			m_OffscreenCmdBufs[i] = new Fling::CommandBuffer(m_Device, m_CommandPool);
-			assert(m_OffscreenCmdBufs[i] != nullptr);
+			if (OverdrawCounter::IsSupported(m_Device))
+			{
+				m_OverdrawCounter = std::make_unique<OverdrawCounter>(m_Device);
+			}
+			else
+			{
+				F_LOG_WARN("Overdraw stats need pipelineStatisticsQuery, which this device doesn't support");
+			}
+		}
+
+		m_DrawBounds = FlingConfig::GetBool("Graphics", "DebugDrawBounds", false);
+
+		// In single pass mode the G-Buffer is recorded into the swap chain command buffer,
+		// so there is no extra submission to wait on
+		if (!IsSinglePass())
+		{
+			// Build offscreen semaphores -------
+			m_OffscreenSemaphores.resize(VkConfig::MAX_FRAMES_IN_FLIGHT);
+			for (int32 i = 0; i < VkConfig::MAX_FRAMES_IN_FLIGHT; i++)
+			{
+				m_OffscreenSemaphores[i] = GraphicsHelpers::CreateSemaphore(m_Device->GetVkDevice());
+			}
+
+			GraphicsHelpers::CreateCommandPool(&m_CommandPool, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+
+			// Build offscreen command buffers, one per frame in flight like the semaphores
+			m_OffscreenCmdBufs.resize(VkConfig::MAX_FRAMES_IN_FLIGHT);
+			for (size_t i = 0; i < m_OffscreenCmdBufs.size(); ++i)
+			{
+				m_OffscreenCmdBufs[i] = new Fling::CommandBuffer(m_Device, m_CommandPool);
+				assert(m_OffscreenCmdBufs[i] != nullptr);
+			}
 		}
 
 		// Tell the Vulkan app that the draw command buffers need to WAIT on this offscreen semaphore
 		PrepareAttachments();
+
+		CreateCameraDescriptorSets();
 	}
 
 	OffscreenSubpass::~OffscreenSubpass()
@@ -71,241 +161,679 @@ namespace Fling
 		}
 		m_OffscreenCmdBufs.clear();
 
-		vkDestroyCommandPool(m_Device->GetVkDevice(), m_CommandPool, nullptr);
+		if (m_CommandPool != VK_NULL_HANDLE)
+		{
+			vkDestroyCommandPool(m_Device->GetVkDevice(), m_CommandPool, nullptr);
+			m_CommandPool = VK_NULL_HANDLE;
+		}
 
-		if (m_OffscreenFrameBuf)
+		if (m_GBufferSampler != VK_NULL_HANDLE)
 		{
-			delete m_OffscreenFrameBuf;
-			m_OffscreenFrameBuf = nullptr;
+			vkDestroySampler(m_Device->GetVkDevice(), m_GBufferSampler, nullptr);
+			m_GBufferSampler = VK_NULL_HANDLE;
+		}
+
+		for (Buffer*& CameraBuffer : m_CameraBuffers)
+		{
+			if (CameraBuffer)
+			{
+				delete CameraBuffer;
+				CameraBuffer = nullptr;
+			}
+		}
+
+		for (GraphicsPipeline** Pipeline : { &m_DepthPipeline, &m_PrepassedPipeline })
+		{
+			if (*Pipeline)
+			{
+				delete *Pipeline;
+				*Pipeline = nullptr;
+			}
+		}
+	}
+
+	VkFormat OffscreenSubpass::GetGBufferFormat(const PhysicalDevice* t_Dev, GBufferTarget t_Target)
+	{
+		assert(t_Dev);
+
+		switch (t_Target)
+		{
+		case GBufferTarget::Normal:
+		{
+			// SNORM keeps the most precision but isn't a required color attachment format,
+			// both store -1 to 1 so the shaders don't care
+			const bool HasSnormNormals =
+				t_Dev->GetFormatProperties(VK_FORMAT_R16G16_SNORM).optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT;
+			return HasSnormNormals ? VK_FORMAT_R16G16_SNORM : VK_FORMAT_R16G16_SFLOAT;
+		}
+		case GBufferTarget::Albedo:
+		case GBufferTarget::Material:
+			return VK_FORMAT_R8G8B8A8_UNORM;
+		case GBufferTarget::Depth:
+		{
+			VkFormat DepthFormat = VK_FORMAT_UNDEFINED;
+			t_Dev->GetSupportedDepthFormat(&DepthFormat);
+			return DepthFormat;
+		}
+		default:
+			assert(!"Invalid G-Buffer target");
+			return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	VkImageView OffscreenSubpass::GetGBufferView(GBufferTarget t_Target) const
+	{
+		// The single pass targets are attachments of the swap chain frame buffers
+		if (IsSinglePass())
+		{
+			return VulkanApp::Get().GetGBufferAttachmentView(t_Target);
+		}
+
+		return m_RenderGraph.GetImageView(m_GBuffer[static_cast<size_t>(t_Target)]);
+	}
+
+	void OffscreenSubpass::Extract(entt::registry& t_reg, RenderSnapshot& t_Snapshot)
+	{
+		// Slots released at least VkConfig::RETIRE_FRAMES snapshots ago are no longer read by the GPU
+		m_Bindless->NextFrame();
+
+		// Invert the project value to match the proper coordinate space compared to OpenGL
+		glm::mat4 Projection = t_Snapshot.Projection;
+		Projection[1][1] *= -1.0f;
+
+		m_CullViewProj = Projection * t_Snapshot.View;
+		m_Frustum.Update(m_CullViewProj);
+		m_SceneBVH.Update(t_reg);
+
+		if (m_DynamicResolution)
+		{
+			UpdateRenderScale();
+		}
+
+		// LOD errors and occluder sizes are in the pixels that are actually rendered
+		t_Snapshot.RenderExtent = GetRenderExtent();
+		Stats::Resolution::SetRenderResolution(m_DynamicResolution ? m_DynamicResolution->GetScale() : 1.0f, t_Snapshot.RenderExtent.width, t_Snapshot.RenderExtent.height);
+
+		m_LodSelector.CameraPos = t_Snapshot.CameraPos;
+		m_LodSelector.PixelsPerUnit = LodSelector::ProjectionScale(Projection, t_Snapshot.RenderExtent.height);
+
+		// The GPU driven path culls and picks LODs while it records
+		t_Snapshot.MeshDraws.clear();
+		if (!m_GpuCulling)
+		{
+			// Culled once here so that the prepass and the G-Buffer draw the same meshes
+			GatherVisibleMeshes(t_reg, t_Snapshot.MeshDraws);
+			if (m_DrawSorter)
+			{
+				SortDraws(t_Snapshot.MeshDraws, t_Snapshot.CameraPos, t_Snapshot.FarPlane);
+			}
+		}
+	}
+
+	void OffscreenSubpass::PrepareDraw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot)
+	{
+		// Otherwise this happens in the offscreen command buffer
+		if (IsSinglePass())
+		{
+			BeginFrame(t_CmdBuf, t_ActiveFrameInFlight, t_Snapshot);
 		}
 	}
 
 	void OffscreenSubpass::Draw(
 		CommandBuffer& t_CmdBuf, 
-		uint32 t_ActiveSwapImage, 
-		entt::registry& t_reg, 
-		float DeltaTime)
+		uint32 t_ActiveFrameInFlight, 
+		const RenderSnapshot& t_Snapshot)
 	{
 		assert(m_GraphicsPipeline);
+
+		if (IsSinglePass())
+		{
+			if (m_OverdrawCounter)
+			{
+				m_OverdrawCounter->Begin(t_CmdBuf);
+			}
+
+			DrawGBuffer(t_CmdBuf, t_ActiveFrameInFlight, GBufferDrawMode::NoPrepass, t_Snapshot);
+
+			if (m_OverdrawCounter)
+			{
+				m_OverdrawCounter->End(t_CmdBuf);
+			}
+
+			// Lighting and everything after it read the G-Buffer in the next subpass
+			t_CmdBuf.NextSubpass();
+			return;
+		}
+
 		// Don't use the given command buffer, instead build the OFFSCREEN command buffer
-		CommandBuffer* OffscreenCmdBuf = m_OffscreenCmdBufs[t_ActiveSwapImage];
+		CommandBuffer* OffscreenCmdBuf = m_OffscreenCmdBufs[t_ActiveFrameInFlight];
 		assert(OffscreenCmdBuf);
 
-		// Set viewport and scissors to the offscreen frame buffer
-		VkViewport viewport = Initializers::Viewport(
-			static_cast<float>(m_OffscreenFrameBuf->GetWidth()), 
-			static_cast<float>(m_OffscreenFrameBuf->GetHeight()),
-			0.0f, 1.0f
-		);
+		OffscreenCmdBuf->Begin();
+
+		BeginFrame(*OffscreenCmdBuf, t_ActiveFrameInFlight, t_Snapshot);
+
+		{
+			GpuProfiler::Scope Scope(VulkanApp::Get().GetGpuProfiler(), *OffscreenCmdBuf, "GBuffer");
+			RenderGraphContext Context = { *OffscreenCmdBuf, t_ActiveFrameInFlight, t_Snapshot };
+			m_RenderGraph.Execute(Context);
+		}
+
+		OffscreenCmdBuf->End();
+	}
+
+	void OffscreenSubpass::BeginFrame(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot)
+	{
+		m_CurrentUBO = {};
+		// Invert the project value to match the proper coordinate space compared to OpenGL
+		m_CurrentUBO.Projection = t_Snapshot.Projection;
+		m_CurrentUBO.Projection[1][1] *= -1.0f;
+		m_CurrentUBO.View = t_Snapshot.View;
+		memcpy(m_CameraBuffers[t_ActiveFrameInFlight]->m_MappedMem, &m_CurrentUBO, sizeof(OffscreenUBO));
+
+		// The scale was picked when the snapshot was taken
+		if (m_DynamicResolution)
+		{
+			m_RenderGraph.SetRenderArea(t_Snapshot.RenderExtent);
+		}
+
+		if (m_DepthPrepass)
+		{
+			UpdateDepthPrepass();
+		}
+
+		// Queries are reset outside of the render pass, like the cull dispatch
+		if (m_OverdrawCounter)
+		{
+			const uint64 Pixels = static_cast<uint64>(t_Snapshot.RenderExtent.width) * t_Snapshot.RenderExtent.height;
+			m_OverdrawCounter->BeginFrame(t_CmdBuf, t_ActiveFrameInFlight, Pixels, IsDepthPrepassEnabled());
+		}
+
+		// The cull dispatch has to happen before the render pass starts
+		if (m_GpuCulling)
+		{
+			assert(t_Snapshot.Registry && "GPU driven rendering has to be recorded on the main thread");
+
+			IndirectCameraUBO CameraUBO = { m_CurrentUBO.Projection, m_CurrentUBO.View };
+			GpuProfiler::Scope Scope(VulkanApp::Get().GetGpuProfiler(), t_CmdBuf, "GPU Culling");
+			m_GpuCulling->RecordCull(t_CmdBuf, t_ActiveFrameInFlight, *t_Snapshot.Registry, m_SceneBVH.GetChangedEntities(), m_Frustum, CameraUBO, m_LodSelector);
+		}
+	}
+
+	void OffscreenSubpass::DrawGBuffer(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, GBufferDrawMode t_Mode, const RenderSnapshot& t_Snapshot)
+	{
+		if (m_GpuCulling)
+		{
+			m_GpuCulling->RecordDraws(t_CmdBuf, t_ActiveFrameInFlight, t_Snapshot.Geometry, t_Mode);
+		}
+		else
+		{
+			DrawVisibleMeshes(t_CmdBuf, t_ActiveFrameInFlight, t_Mode, t_Snapshot);
+		}
+	}
+
+	void OffscreenSubpass::BuildRenderGraph()
+	{
+		const PhysicalDevice* PhysDevice = m_Device->GetPhysicalDevice();
+		assert(PhysDevice);
+
+		// Four targets (3 color, 1 depth), 16 bytes per pixel. World positions are
+		// rebuilt from depth in the lighting pass so they don't need their own target
+		RenderGraphTextureDesc Desc = {};
+
+		// (World space) Normals, octahedral encoded
+		Desc.Format = GetGBufferFormat(PhysDevice, GBufferTarget::Normal);
+		m_GBuffer[static_cast<size_t>(GBufferTarget::Normal)] = m_RenderGraph.CreateTexture("GBuffer Normal", Desc);
+
+		// Albedo (color)
+		Desc.Format = GetGBufferFormat(PhysDevice, GBufferTarget::Albedo);
+		m_GBuffer[static_cast<size_t>(GBufferTarget::Albedo)] = m_RenderGraph.CreateTexture("GBuffer Albedo", Desc);
+
+		// Metal, roughness, and AO
+		Desc.Format = GetGBufferFormat(PhysDevice, GBufferTarget::Material);
+		m_GBuffer[static_cast<size_t>(GBufferTarget::Material)] = m_RenderGraph.CreateTexture("GBuffer Material", Desc);
+
+		// Depth, sampled by the lighting pass to get the world position
+		Desc.Format = GetGBufferFormat(PhysDevice, GBufferTarget::Depth);
+		m_GBuffer[static_cast<size_t>(GBufferTarget::Depth)] = m_RenderGraph.CreateTexture("GBuffer Depth", Desc);
+
+		// Only part of the targets is drawn to with dynamic resolution
+		auto SetRenderArea = [this](CommandBuffer& t_CmdBuf)
+		{
+			const VkExtent2D Extent = m_RenderGraph.GetRenderArea();
+			VkViewport viewport = Initializers::Viewport(static_cast<float>(Extent.width), static_cast<float>(Extent.height), 0.0f, 1.0f);
+			VkRect2D scissor = Initializers::Rect2D(Extent.width, Extent.height, /** offsetX */ 0, /** offsetY */ 0);
+
+			t_CmdBuf.SetViewport(0, { viewport });
+			t_CmdBuf.SetScissor(0, { scissor });
+		};
 
-		VkRect2D scissor = Initializers::Rect2D(
-			m_OffscreenFrameBuf->GetWidth(),
-			m_OffscreenFrameBuf->GetHeight(),
-			/** offsetX */ 0,
-			/** offsetY */ 0
+		// The prepass stays in the graph when Auto turns it off, it only clears depth then
+		if (m_DepthPrepass)
+		{
+			m_DepthPrepassPass = m_RenderGraph.AddPass("Depth Prepass",
+				[&](RenderGraph::PassBuilder& t_Builder)
+				{
+					t_Builder.Write(m_GBuffer[static_cast<size_t>(GBufferTarget::Depth)], RenderGraphUsage::DepthAttachment);
+				},
+				[this, SetRenderArea](const RenderGraphContext& t_Context)
+				{
+					if (!IsDepthPrepassEnabled())
+					{
+						return;
+					}
+
+					SetRenderArea(t_Context.CmdBuf);
+					DrawGBuffer(t_Context.CmdBuf, t_Context.ActiveFrame, GBufferDrawMode::DepthOnly, t_Context.Snapshot);
+				}
+			);
+		}
+
+		m_GBufferPass = m_RenderGraph.AddPass("GBuffer",
+			[&](RenderGraph::PassBuilder& t_Builder)
+			{
+				t_Builder.Write(m_GBuffer[static_cast<size_t>(GBufferTarget::Normal)], RenderGraphUsage::ColorAttachment);
+				t_Builder.Write(m_GBuffer[static_cast<size_t>(GBufferTarget::Albedo)], RenderGraphUsage::ColorAttachment);
+				t_Builder.Write(m_GBuffer[static_cast<size_t>(GBufferTarget::Material)], RenderGraphUsage::ColorAttachment);
+				t_Builder.Write(m_GBuffer[static_cast<size_t>(GBufferTarget::Depth)], RenderGraphUsage::DepthAttachment,
+					m_DepthPrepass ? RenderGraphLoad::Load : RenderGraphLoad::Clear);
+			},
+			[this, SetRenderArea](const RenderGraphContext& t_Context)
+			{
+				SetRenderArea(t_Context.CmdBuf);
+
+				if (m_OverdrawCounter)
+				{
+					m_OverdrawCounter->Begin(t_Context.CmdBuf);
+				}
+
+				DrawGBuffer(t_Context.CmdBuf, t_Context.ActiveFrame, IsDepthPrepassEnabled() ? GBufferDrawMode::AfterPrepass : GBufferDrawMode::NoPrepass, t_Context.Snapshot);
+
+				if (m_OverdrawCounter)
+				{
+					m_OverdrawCounter->End(t_Context.CmdBuf);
+				}
+			}
 		);
 
-		OffscreenCmdBuf->Begin();
-		OffscreenCmdBuf->BeginRenderPass(*m_OffscreenFrameBuf, m_ClearValues);
+		// The lighting pass samples every target after the graph is done with them
+		for (RenderGraphTexture Tex : m_GBuffer)
+		{
+			m_RenderGraph.ExportTexture(Tex, RenderGraphUsage::Sampled);
+		}
 
-		OffscreenCmdBuf->SetViewport(0, { viewport });
-		OffscreenCmdBuf->SetScissor(0, { scissor });
+		m_RenderGraph.Compile();
+	}
 
-		vkCmdBindPipeline(OffscreenCmdBuf->GetHandle(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline->GetPipeline());
+	void OffscreenSubpass::GatherVisibleMeshes(entt::registry& t_reg, std::vector<MeshDraw>& t_OutDraws)
+	{
+		// Find what is visible this frame ---------
+		m_SceneBVH.QueryFrustum(m_Frustum, m_VisibleEntities, m_IntersectingEntities);
 
-		VkDeviceSize offsets[1] = { 0 };
+		// Anything the BVH found crossing the frustum gets tested again on its tight bounds
+		m_FrustumCuller.Reset();
+		m_FrustumCuller.Reserve(m_IntersectingEntities.size());
+		for (entt::entity Ent : m_IntersectingEntities)
+		{
+			m_FrustumCuller.Add(t_reg.get<SpatialProxy>(Ent).m_WorldBounds);
+		}
 
-		OffscreenUBO CurrentUBO = {};
-		// Invert the project value to match the proper coordinate space compared to OpenGL
-		CurrentUBO.Projection = m_Camera->GetProjectionMatrix();
-		CurrentUBO.Projection[1][1] *= -1.0f;
-		CurrentUBO.View = m_Camera->GetViewMatrix();	
+		m_FrustumCuller.Cull(m_Frustum, m_VisibleIndices);
+		for (uint32 Index : m_VisibleIndices)
+		{
+			m_VisibleEntities.emplace_back(m_IntersectingEntities[Index]);
+		}
 
-		// #TODO This is where a lot of the cost of our engine loop comes from
-		// We can improve this by doing some kind of dirty bit tracking to only
-		// update the UBO's on MeshRenders if they have changed
-		auto RenderGroup = t_reg.group<Transform>(entt::get<MeshRenderer, entt::tag<"Default"_hs>>);
+		const uint32 OcclusionCulled = m_OcclusionCuller ? CullOccluded(t_reg) : 0;
 
-		RenderGroup.less([&](entt::entity ent, Transform& t_trans, MeshRenderer& t_MeshRend)
+		uint32 Triangles = 0;
+		uint32 FullDetailTriangles = 0;
+		uint32 VisibleCount = 0;
+		MeshletCullStats MeshletStats;
+		for (entt::entity Ent : m_VisibleEntities)
 		{
+			if (!t_reg.has<entt::tag<"Default"_hs>>(Ent))
+			{
+				continue;
+			}
+
+			// The SceneBVH keeps the world matrix up to date for anything in the tree
+			Transform& t_trans = t_reg.get<Transform>(Ent);
+			MeshRenderer& t_MeshRend = t_reg.get<MeshRenderer>(Ent);
 			Fling::Model* Model = t_MeshRend.m_Model;
 			if (!Model)
 			{
-				return;
+				continue;
 			}
 
-			// UPDATE UNIFORM BUF of the mesh --------
-			
-			Transform::CalculateWorldMatrix(t_trans);
-			CurrentUBO.Model = t_trans.GetWorldMatrix();
-			CurrentUBO.ObjPos = t_trans.GetPos();
+			if (m_DrawBounds)
+			{
+				DebugDraw::Box(t_reg.get<SpatialProxy>(Ent).m_WorldBounds, glm::vec4(0.0f, 1.0f, 0.0f, 0.5f));
+			}
 
-			// Memcpy to the buffer
-			Buffer* buf = t_MeshRend.m_UniformBuffer;
-			memcpy(
-				buf->m_MappedMem, 
-				&CurrentUBO,
-				buf->GetSize()
-			);
+			MeshDraw Draw = {};
+			Draw.Constants.Model = t_trans.GetWorldMat();
+			Draw.Constants.Textures = t_MeshRend.m_TextureSlots;
+			Draw.Constants.BoundsCenter = Model->GetDecodeCenter();
+			Draw.Constants.BoundsExtents = Model->GetDecodeExtents();
+			Draw.Model = Model;
+			Draw.VertexOffset = Model->GetVertexOffset();
 
-			// Bind the descriptor set for rendering a mesh using the dynamic offset
-			vkCmdBindDescriptorSets(
-				OffscreenCmdBuf->GetHandle(),
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				m_GraphicsPipeline->GetPipelineLayout(),
-				0,
-				1,
-				&t_MeshRend.m_DescriptorSet,
-				0,
-				nullptr);
-
-			VkBuffer vertexBuffers[1] = { Model->GetVertexBuffer()->GetVkBuffer() };
-			// Render the mesh
-			vkCmdBindVertexBuffers(OffscreenCmdBuf->GetHandle(), 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(OffscreenCmdBuf->GetHandle(), Model->GetIndexBuffer()->GetVkBuffer(), 0, Model->GetIndexType());
-			vkCmdDrawIndexed(OffscreenCmdBuf->GetHandle(), Model->GetIndexCount(), 1, 0, 0, 0);
-		});
+			// Picked once per frame, so the prepass and the G-Buffer always draw the same level
+			t_MeshRend.m_LodLevel = m_LodSelector.Select(Model->GetLods(), Model->GetBoundingSphere(), Draw.Constants.Model, t_MeshRend.m_LodLevel);
+			const MeshLod& Lod = Model->GetLod(t_MeshRend.m_LodLevel);
 
-		OffscreenCmdBuf->EndRenderPass();
+			++VisibleCount;
+			Triangles += Lod.IndexCount / 3;
+			FullDetailTriangles += Model->GetIndexCount() / 3;
 
-		OffscreenCmdBuf->End();
+			// A single meshlet is already covered by the mesh's own bounds
+			if (!m_MeshletCulling || Lod.MeshletCount < 2)
+			{
+				Draw.FirstIndex = Model->GetFirstIndex() + Lod.FirstIndex;
+				Draw.IndexCount = Lod.IndexCount;
+				t_OutDraws.emplace_back(Draw);
+				continue;
+			}
+
+			// Draw whatever faces the camera and is on screen, in as few ranges as it takes
+			MeshletBuilder::Cull(
+				Model->GetMeshlets().data() + Lod.FirstMeshlet,
+				Lod.MeshletCount,
+				Draw.Constants.Model,
+				m_LodSelector.CameraPos,
+				m_Frustum,
+				m_MeshletMaxDraws,
+				m_MeshletRanges,
+				MeshletStats);
+
+			for (const IndexRange& Range : m_MeshletRanges)
+			{
+				Draw.FirstIndex = Model->GetFirstIndex() + Range.FirstIndex;
+				Draw.IndexCount = Range.IndexCount;
+				t_OutDraws.emplace_back(Draw);
+			}
+		}
+
+		const uint32 TotalCount = static_cast<uint32>(t_reg.view<entt::tag<"Default"_hs>>().size());
+		const uint32 Considered = VisibleCount + OcclusionCulled;
+		Stats::Culling::SetFrustumCullResults(VisibleCount, TotalCount > Considered ? TotalCount - Considered : 0);
+		Stats::Culling::SetOcclusionCullResults(OcclusionCulled, m_OcclusionCuller ? m_OcclusionCuller->GetOccluderCount() : 0);
+		Stats::Lod::SetSelectionResults(Triangles, FullDetailTriangles);
+		Stats::Meshlets::SetCullResults(MeshletStats.Clusters, MeshletStats.CulledClusters, MeshletStats.Triangles, MeshletStats.CulledTriangles);
+	}
+
+	void OffscreenSubpass::DrawVisibleMeshes(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, GBufferDrawMode t_Mode, const RenderSnapshot& t_Snapshot)
+	{
+		const bool DepthOnly = t_Mode == GBufferDrawMode::DepthOnly;
+		GraphicsPipeline* Pipeline =
+			DepthOnly ? m_DepthPipeline :
+			t_Mode == GBufferDrawMode::AfterPrepass ? m_PrepassedPipeline :
+			m_GraphicsPipeline;
+		assert(Pipeline);
+
+		VkCommandBuffer Cmd = t_CmdBuf.GetHandle();
+		VkPipelineLayout Layout = Pipeline->GetPipelineLayout();
+		vkCmdBindPipeline(Cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline->GetPipeline());
+
+		// The camera and every texture, see the constructor. The depth pipeline only has the camera
+		VkDescriptorSet Sets[2] = { m_CameraSets[t_ActiveFrameInFlight], m_Bindless->GetSet() };
+		vkCmdBindDescriptorSets(Cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, Layout, 0, DepthOnly ? 1 : 2, Sets, 0, nullptr);
+
+		// Every mesh is in the same buffers, the prepass only reads the positions
+		t_Snapshot.Geometry.Bind(Cmd, DepthOnly);
+
+		// Pipeline, sets and geometry
+		uint32 StateChanges = 3;
+		uint32 Skipped = 0;
+
+		// Push constants are pushed in three parts, and only the parts that changed since the last draw.
+		// The meshlet ranges of a mesh share all of them, and sorted draws of a material share its textures
+		const OffscreenPushConstants* Last = nullptr;
+		for (const MeshDraw& Draw : t_Snapshot.MeshDraws)
+		{
+			const OffscreenPushConstants& Constants = Draw.Constants;
+			if (!Last || memcmp(&Last->Model, &Constants.Model, sizeof(Constants.Model)) != 0)
+			{
+				vkCmdPushConstants(Cmd, Layout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(OffscreenPushConstants, Model), sizeof(Constants.Model), &Constants.Model);
+				++StateChanges;
+			}
+			else
+			{
+				++Skipped;
+			}
+
+			if (!Last || memcmp(&Last->Textures, &Constants.Textures, sizeof(Constants.Textures)) != 0)
+			{
+				vkCmdPushConstants(Cmd, Layout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(OffscreenPushConstants, Textures), sizeof(Constants.Textures), &Constants.Textures);
+				++StateChanges;
+			}
+			else
+			{
+				++Skipped;
+			}
+
+			// The decode bounds are one per model and next to each other
+			if (!Last || memcmp(&Last->BoundsCenter, &Constants.BoundsCenter, sizeof(glm::vec4) * 2) != 0)
+			{
+				vkCmdPushConstants(Cmd, Layout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(OffscreenPushConstants, BoundsCenter), sizeof(glm::vec4) * 2, &Constants.BoundsCenter);
+				++StateChanges;
+			}
+			else
+			{
+				++Skipped;
+			}
+
+			Last = &Constants;
+			vkCmdDrawIndexed(Cmd, Draw.IndexCount, 1, Draw.FirstIndex, Draw.VertexOffset, 0);
+		}
+
+		// The prepass draws the same list, the G-Buffer pass is the one that is always there
+		if (!DepthOnly)
+		{
+			Stats::Draws::SetRecordResults(static_cast<uint32>(t_Snapshot.MeshDraws.size()), StateChanges, Skipped);
+		}
 	}
 
-	void OffscreenSubpass::CreateMeshDescriptorSet(MeshRenderer& t_MeshRend)
+	void OffscreenSubpass::SortDraws(std::vector<MeshDraw>& t_Draws, const glm::vec3& t_CameraPos, float t_FarPlane)
 	{
-		// Only allocate new descriptor sets if there are none
-		// Some may exist if entt decides to re-use the component
-		if (t_MeshRend.m_DescriptorSet == VK_NULL_HANDLE)
+		assert(m_DrawSorter);
+
+		// Everything the CPU path gathers is opaque and drawn with the pipeline of the pass
+		const uint32 Pass = 0;
+		const uint32 Pipeline = 0;
+		const float InvFarPlane = t_FarPlane > 0.0f ? 1.0f / t_FarPlane : 0.0f;
+
+		m_DrawKeys.resize(t_Draws.size());
+		for (size_t i = 0; i < t_Draws.size(); ++i)
 		{
-			VkDescriptorSetLayout layout = m_GraphicsPipeline->GetDescriptorSetLayout();
-			VkDescriptorSetAllocateInfo allocInfo = {};
-			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-			// If we have specified a specific pool then use that, otherwise use the one on the mesh
-			allocInfo.descriptorPool = m_DescriptorPool;
-			allocInfo.descriptorSetCount = 1;
-			allocInfo.pSetLayouts = &layout;
+			const MeshDraw& Draw = t_Draws[i];
+			const MaterialTextureSlots& Textures = Draw.Constants.Textures;
+			const uint32 Material = Textures.Albedo * 73856093u ^ Textures.Normal * 19349663u ^ Textures.Metal * 83492791u ^ Textures.Roughness * 2654435761u;
+
+			// A model's place in the geometry buffer is unique while it is alive
+			const uint32 Mesh = Draw.Model->GetFirstIndex();
 
-			VK_CHECK_RESULT(vkAllocateDescriptorSets(m_Device->GetVkDevice(), &allocInfo, &t_MeshRend.m_DescriptorSet));
+			const glm::vec3 Center = Draw.Model->GetBoundingSphere().Transformed(Draw.Constants.Model).Center;
+			m_DrawKeys[i] = DrawSortKey::Make(Pass, Pipeline, Material, Mesh, glm::length(Center - t_CameraPos) * InvFarPlane);
 		}
 
-		// Ensure that we have a material to try and sample from
-		if (t_MeshRend.m_Material == nullptr)
+		m_DrawSorter->Sort(m_DrawKeys, m_DrawOrder);
+
+		m_SortedDraws.resize(t_Draws.size());
+		for (size_t i = 0; i < t_Draws.size(); ++i)
 		{
-			t_MeshRend.m_Material = Material::GetDefaultMat().get();
+			m_SortedDraws[i] = t_Draws[m_DrawOrder[i]];
 		}
-		
-		std::vector<VkWriteDescriptorSet> writeDescriptorSets =
-		{
-			// 0: UBO
-			Initializers::WriteDescriptorSetUniform(
-				t_MeshRend.m_UniformBuffer,
-				t_MeshRend.m_DescriptorSet,
-				0
-			),
-			// 1: Color map 
-			Initializers::WriteDescriptorSetImage(
-				t_MeshRend.m_Material->GetPBRTextures().m_AlbedoTexture,
-				t_MeshRend.m_DescriptorSet,
-				1),
-			// 2: Normal map
-			Initializers::WriteDescriptorSetImage(
-				t_MeshRend.m_Material->GetPBRTextures().m_NormalTexture,
-				t_MeshRend.m_DescriptorSet,
-				2),
-			// 3: Metal map
-			Initializers::WriteDescriptorSetImage(
-				t_MeshRend.m_Material->GetPBRTextures().m_MetalTexture,
-				t_MeshRend.m_DescriptorSet,
-				3),
-			// 4: Roughness map
-			Initializers::WriteDescriptorSetImage(
-				t_MeshRend.m_Material->GetPBRTextures().m_RoughnessTexture,
-				t_MeshRend.m_DescriptorSet,
-				4)
-			// Any other PBR textures or other samplers go HERE and you add to the MRT shader
-		};
 
-		vkUpdateDescriptorSets(m_Device->GetVkDevice(), static_cast<uint32>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+		// The snapshot keeps this frame's order and the old memory is reused next time
+		t_Draws.swap(m_SortedDraws);
 	}
 
-	void OffscreenSubpass::BuildOffscreenCommandBuffer(entt::registry& t_reg, uint32 t_ActiveFrameInFlight)
+	uint32 OffscreenSubpass::CullOccluded(entt::registry& t_reg)
 	{
+		m_OcclusionCuller->BeginFrame(m_CullViewProj);
 
+		// Pick occluders out of what is already visible, big on screen first
+		const float ScreenHeight = static_cast<float>(GetRenderExtent().height);
+		m_OccluderCandidates.clear();
+		for (entt::entity Ent : m_VisibleEntities)
+		{
+			if (!t_reg.has<entt::tag<"Default"_hs>>(Ent))
+			{
+				continue;
+			}
+
+			const Fling::Model* Model = t_reg.get<MeshRenderer>(Ent).m_Model;
+			if (!Model || Model->GetLods().empty())
+			{
+				continue;
+			}
+
+			float Size = FLT_MAX;
+			if (!t_reg.has<entt::tag<"Occluder"_hs>>(Ent))
+			{
+				const BoundingSphere Sphere = Model->GetBoundingSphere().Transformed(t_reg.get<Transform>(Ent).GetWorldMat());
+				const float Distance = glm::length(Sphere.Center - m_LodSelector.CameraPos);
+
+				// The camera being inside of it counts as covering the whole screen
+				Size = Distance > Sphere.Radius ? 2.0f * Sphere.Radius * m_LodSelector.PixelsPerUnit / (Distance * ScreenHeight) : 1.0f;
+				if (Size < m_OccluderScreenSize)
+				{
+					continue;
+				}
+			}
+
+			m_OccluderCandidates.emplace_back(Size, Ent);
+		}
+
+		std::sort(m_OccluderCandidates.begin(), m_OccluderCandidates.end(), std::greater<std::pair<float, entt::entity>>());
+		if (m_OccluderCandidates.size() > m_MaxOccluders)
+		{
+			m_OccluderCandidates.resize(m_MaxOccluders);
+		}
+
+		// The coarsest LOD is plenty for a buffer this small
+		for (const std::pair<float, entt::entity>& Candidate : m_OccluderCandidates)
+		{
+			const Fling::Model* Model = t_reg.get<MeshRenderer>(Candidate.second).m_Model;
+			const MeshLod& Lod = Model->GetLods().back();
+			m_OcclusionCuller->AddOccluder(
+				Model->GetPositions().data(),
+				Model->GetIndices().data() + Lod.FirstIndex,
+				Lod.IndexCount,
+				t_reg.get<Transform>(Candidate.second).GetWorldMat());
+		}
+
+		if (m_OccluderCandidates.empty())
+		{
+			return 0;
+		}
+
+		m_OcclusionCuller->Rasterize();
+
+		uint32 Culled = 0;
+		auto Hidden = std::remove_if(m_VisibleEntities.begin(), m_VisibleEntities.end(), [&](entt::entity t_Ent)
+		{
+			if (!t_reg.has<entt::tag<"Default"_hs>>(t_Ent) || m_OcclusionCuller->IsVisible(t_reg.get<SpatialProxy>(t_Ent).m_WorldBounds))
+			{
+				return false;
+			}
+			++Culled;
+			return true;
+		});
+		m_VisibleEntities.erase(Hidden, m_VisibleEntities.end());
+
+		return Culled;
 	}
 
-	void OffscreenSubpass::PrepareAttachments()
+	void OffscreenSubpass::CreateCameraDescriptorSets()
 	{
-		assert(m_OffscreenFrameBuf == nullptr);
+		VkDescriptorSetLayout Layout = m_GraphicsPipeline->GetDescriptorSetLayout();
+		const VkDeviceSize CameraSize = sizeof(OffscreenUBO);
 
-		VkExtent2D Extents = m_SwapChain->GetExtents();
+		for (int32 i = 0; i < VkConfig::MAX_FRAMES_IN_FLIGHT; ++i)
+		{
+			m_CameraBuffers[i] = new Buffer(CameraSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			m_CameraBuffers[i]->MapMemory(CameraSize);
 
-		m_OffscreenFrameBuf = new FrameBuffer(m_Device, Extents.width, Extents.height);
+			VkDescriptorSetAllocateInfo AllocInfo = Initializers::DescriptorSetAllocateInfo(m_DescriptorPool, &Layout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(m_Device->GetVkDevice(), &AllocInfo, &m_CameraSets[i]));
 
-		AttachmentCreateInfo attachmentInfo = {};
+			// 0: Camera UBO
+			VkWriteDescriptorSet Write = Initializers::WriteDescriptorSetUniform(m_CameraBuffers[i], m_CameraSets[i], 0);
+			vkUpdateDescriptorSets(m_Device->GetVkDevice(), 1, &Write, 0, nullptr);
+		}
+	}
 
-		// Four attachments (3 color, 1 depth)
-		attachmentInfo.Width = Extents.width;
-		attachmentInfo.Height = Extents.height;
-		attachmentInfo.LayerCount = 1;
-		attachmentInfo.Usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	void OffscreenSubpass::AcquireTextureSlots(MeshRenderer& t_MeshRend)
+	{
+		// Ensure that we have a material to try and sample from
+		if (t_MeshRend.m_Material == nullptr)
+		{
+			t_MeshRend.m_Material = Material::GetDefaultMat().get();
+		}
 
-		// Color attachments
+		t_MeshRend.m_TextureSlots = m_Bindless->AcquireMaterial(t_MeshRend.m_Material);
+		t_MeshRend.m_TextureSlotsMaterial = t_MeshRend.m_Material;
+	}
 
-		// Attachment 0: (World space) Positions
-		attachmentInfo.Format = VK_FORMAT_R16G16B16A16_SFLOAT;
-		m_OffscreenFrameBuf->AddAttachment(attachmentInfo);
+	void OffscreenSubpass::ReleaseTextureSlots(MeshRenderer& t_MeshRend)
+	{
+		if (t_MeshRend.m_TextureSlotsMaterial && m_Bindless)
+		{
+			m_Bindless->ReleaseMaterial(t_MeshRend.m_TextureSlotsMaterial, t_MeshRend.m_TextureSlots);
+		}
 
-		// Attachment 1: (World space) Normals
-		attachmentInfo.Format = VK_FORMAT_R16G16B16A16_SFLOAT;
-		m_OffscreenFrameBuf->AddAttachment(attachmentInfo);
+		t_MeshRend.m_TextureSlotsMaterial = nullptr;
+	}
 
-		// Attachment 2: Albedo (color)
-		attachmentInfo.Format = VK_FORMAT_R8G8B8A8_UNORM;
-		m_OffscreenFrameBuf->AddAttachment(attachmentInfo);
+	void OffscreenSubpass::BuildOffscreenCommandBuffer(entt::registry& t_reg, uint32 t_ActiveFrameInFlight)
+	{
 
-		// Attachment 3: Metal
-		attachmentInfo.Format = VK_FORMAT_R8G8B8A8_UNORM;
-		m_OffscreenFrameBuf->AddAttachment(attachmentInfo);
+	}
 
-		// Attachment 4: Roughness
-		attachmentInfo.Format = VK_FORMAT_R8G8B8A8_UNORM;
-		m_OffscreenFrameBuf->AddAttachment(attachmentInfo);
+	void OffscreenSubpass::PrepareAttachments()
+	{
+		assert(m_GBufferSampler == VK_NULL_HANDLE);
 
-		// Depth attachment
-		// Find a suitable depth format
-		VkFormat attDepthFormat;
-		const PhysicalDevice* PhysDevice = m_Device->GetPhysicalDevice();
-		assert(PhysDevice);
+		// The global render pass owns the G-Buffer attachments in single pass mode
+		if (!IsSinglePass())
+		{
+			BuildRenderGraph();
+			m_RenderGraph.Realize(GetGBufferExtent());
+
+			// Create sampler to sample from the G-Buffer targets
+			VkSamplerCreateInfo samplerInfo = Initializers::SamplerCreateInfo();
+			samplerInfo.magFilter = VK_FILTER_NEAREST;
+			samplerInfo.minFilter = VK_FILTER_NEAREST;
+			samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+			samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+			samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+			samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+			samplerInfo.mipLodBias = 0.0f;
+			samplerInfo.maxAnisotropy = 1.0f;
+			samplerInfo.minLod = 0.0f;
+			samplerInfo.maxLod = 1.0f;
+			samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+			VK_CHECK_RESULT(vkCreateSampler(m_Device->GetVkDevice(), &samplerInfo, nullptr, &m_GBufferSampler));
+			F_LOG_TRACE("Offscreen render pass created...");
+		}
 
-		PhysDevice->GetSupportedDepthFormat(&attDepthFormat);
-		
-		// Attachment 3: Depth
-		attachmentInfo.Format = attDepthFormat;
-		attachmentInfo.Usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-		m_OffscreenFrameBuf->AddAttachment(attachmentInfo);
-
-		// Create sampler to sample from the color attachments
-		VK_CHECK_RESULT(m_OffscreenFrameBuf->CreateSampler(VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE));
-		VK_CHECK_RESULT(m_OffscreenFrameBuf->CreateRenderPass());
-		F_LOG_TRACE("Offscreen render pass created...");
-
-		// Create the descriptor pool for off screen things
-		uint32 DescriptorCount = 2000 * m_SwapChain->GetImageViewCount();
-
-		static std::vector<VkDescriptorPoolSize> poolSizes =
-		{
-			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 		DescriptorCount),
-			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 			DescriptorCount),
-			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_SAMPLER, 				DescriptorCount),
-			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, DescriptorCount),
-			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 		DescriptorCount)
+		// Create the descriptor pool for off screen things. Only the camera has a set per frame in flight,
+		// the material textures are all in the bindless set
+		const uint32 MaxSets = VkConfig::MAX_FRAMES_IN_FLIGHT;
+
+		std::vector<VkDescriptorPoolSize> poolSizes =
+		{
+			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MaxSets)
 		};
 
 		VkDescriptorPoolCreateInfo poolInfo = {};
 		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		poolInfo.poolSizeCount = static_cast<uint32>(poolSizes.size());
 		poolInfo.pPoolSizes = poolSizes.data();
-		poolInfo.maxSets = to_u32(1000 * m_SwapChain->GetImageViewCount());
+		poolInfo.maxSets = MaxSets;
 
 		if (vkCreateDescriptorPool(m_Device->GetVkDevice(), &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS)
 		{
@@ -315,11 +843,40 @@ namespace Fling
 
 	void OffscreenSubpass::CreateGraphicsPipeline()
 	{
-		assert(m_OffscreenFrameBuf);
-		VkRenderPass RenderPass = m_OffscreenFrameBuf->GetRenderPassHandle();
+		// Subpass 0 of the global render pass, or the render pass of the G-Buffer graph pass
+		VkRenderPass RenderPass = IsSinglePass() ? m_SinglePassRenderPass : m_RenderGraph.GetRenderPass(m_GBufferPass);
 		assert(RenderPass != VK_NULL_HANDLE);
 
-		m_GraphicsPipeline->m_RasterizationState =
+		CreateGBufferPipeline(m_GraphicsPipeline, RenderPass);
+
+		if (m_GpuCulling)
+		{
+			CreateGBufferPipeline(m_GpuCulling->GetGraphicsPipeline(), RenderPass);
+		}
+
+		if (m_DepthPrepass)
+		{
+			assert(m_DepthPipeline && m_PrepassedPipeline && "EnableDepthPrepass must be called before the pipelines are created");
+
+			VkRenderPass PrepassRenderPass = m_RenderGraph.GetRenderPass(m_DepthPrepassPass);
+			assert(PrepassRenderPass != VK_NULL_HANDLE);
+
+			CreateDepthPipeline(m_DepthPipeline, PrepassRenderPass);
+			CreateGBufferPipeline(m_PrepassedPipeline, RenderPass, true);
+
+			if (m_GpuCulling)
+			{
+				CreateDepthPipeline(m_GpuCulling->GetDepthPipeline(), PrepassRenderPass);
+				CreateGBufferPipeline(m_GpuCulling->GetPrepassedPipeline(), RenderPass, true);
+			}
+		}
+	}
+
+	void OffscreenSubpass::CreateGBufferPipeline(GraphicsPipeline* t_Pipeline, VkRenderPass t_RenderPass, bool t_AfterPrepass)
+	{
+		assert(t_Pipeline);
+
+		t_Pipeline->m_RasterizationState =
 			Initializers::PipelineRasterizationStateCreateInfo(
 				VK_POLYGON_MODE_FILL,
 				VK_CULL_MODE_BACK_BIT,
@@ -330,23 +887,28 @@ namespace Fling
 		// Blend attachment states required for all color attachments
 		// This is important, as color write mask will otherwise be 0x0 and you
 		// won't see anything rendered to the attachment
-		m_GraphicsPipeline->m_ColorBlendAttachmentStates = 
+		t_Pipeline->m_ColorBlendAttachmentStates = 
 		{
-			Initializers::PipelineColorBlendAttachmentState(0xf, VK_FALSE),
-			Initializers::PipelineColorBlendAttachmentState(0xf, VK_FALSE),
 			Initializers::PipelineColorBlendAttachmentState(0xf, VK_FALSE),
 			Initializers::PipelineColorBlendAttachmentState(0xf, VK_FALSE),
 			Initializers::PipelineColorBlendAttachmentState(0xf, VK_FALSE)
 		};
 
-		m_GraphicsPipeline->m_ColorBlendState.attachmentCount =
-			static_cast<uint32_t>(m_GraphicsPipeline->m_ColorBlendAttachmentStates.size());
+		t_Pipeline->m_ColorBlendState.attachmentCount =
+			static_cast<uint32_t>(t_Pipeline->m_ColorBlendAttachmentStates.size());
 
-		m_GraphicsPipeline->m_ColorBlendState.pAttachments = 
-			m_GraphicsPipeline->m_ColorBlendAttachmentStates.data();
+		t_Pipeline->m_ColorBlendState.pAttachments = 
+			t_Pipeline->m_ColorBlendAttachmentStates.data();
 
-		m_GraphicsPipeline->m_MultisampleState =
+		t_Pipeline->m_MultisampleState =
 			Initializers::PipelineMultiSampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
+
+		// Only the closest fragment of each pixel that the prepass found is shaded. The pipeline
+		// was made with Depth::Read so nothing is written
+		if (t_AfterPrepass)
+		{
+			t_Pipeline->m_DepthStencilState.depthCompareOp = VK_COMPARE_OP_EQUAL;
+		}
 		
 		std::vector<VkDynamicState> dynamicStateEnables = 
 		{
@@ -354,28 +916,80 @@ namespace Fling
 			VK_DYNAMIC_STATE_SCISSOR
 		};
 
-		m_GraphicsPipeline->m_DynamicState =
+		t_Pipeline->m_DynamicState =
 			Initializers::PipelineDynamicStateCreateInfo(
 				dynamicStateEnables.data(), 
 				dynamicStateEnables.size(), 
 				0);
 
-		m_GraphicsPipeline->CreateGraphicsPipeline(RenderPass, nullptr);
+		t_Pipeline->CreateGraphicsPipeline(t_RenderPass, nullptr);
+	}
+
+	void OffscreenSubpass::CreateDepthPipeline(GraphicsPipeline* t_Pipeline, VkRenderPass t_RenderPass)
+	{
+		assert(t_Pipeline);
+
+		// Has to rasterize exactly like the G-Buffer pipeline, or the EQUAL test misses
+		t_Pipeline->m_RasterizationState =
+			Initializers::PipelineRasterizationStateCreateInfo(
+				VK_POLYGON_MODE_FILL,
+				VK_CULL_MODE_BACK_BIT,
+				VK_FRONT_FACE_COUNTER_CLOCKWISE
+			);
+
+		// No color attachments and no fragment shader
+		t_Pipeline->m_ColorBlendAttachmentStates.clear();
+		t_Pipeline->m_ColorBlendState.attachmentCount = 0;
+		t_Pipeline->m_ColorBlendState.pAttachments = nullptr;
+
+		t_Pipeline->m_MultisampleState =
+			Initializers::PipelineMultiSampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
+
+		std::vector<VkDynamicState> dynamicStateEnables =
+		{
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR
+		};
+
+		t_Pipeline->m_DynamicState =
+			Initializers::PipelineDynamicStateCreateInfo(
+				dynamicStateEnables.data(),
+				dynamicStateEnables.size(),
+				0);
+
+		t_Pipeline->CreateGraphicsPipeline(t_RenderPass, nullptr);
 	}
 
 	void OffscreenSubpass::GatherPresentDependencies(std::vector<CommandBuffer*>& t_CmdBuffs, std::vector<VkSemaphore>& t_Deps, uint32 t_ActiveFrameIndex, uint32 t_CurrentFrameInFlight)
 	{
-		t_CmdBuffs.emplace_back(m_OffscreenCmdBufs[t_ActiveFrameIndex]);
+		if (IsSinglePass())
+		{
+			return;
+		}
+
+		t_CmdBuffs.emplace_back(m_OffscreenCmdBufs[t_CurrentFrameInFlight]);
 		t_Deps.emplace_back(m_OffscreenSemaphores[t_CurrentFrameInFlight]);
 	}
 
 	void OffscreenSubpass::CleanUp(entt::registry& t_reg)
 	{
 		assert(m_Device != nullptr);
+
+		m_SceneBVH.Shutdown(t_reg);
+
+		if (m_GpuCulling)
+		{
+			m_GpuCulling->CleanUp(t_reg);
+		}
+
+		t_reg.on_construct<MeshRenderer>().disconnect<&OffscreenSubpass::OnMeshRendererAdded>(*this);
+		t_reg.on_replace<MeshRenderer>().disconnect<&OffscreenSubpass::OnMeshRendererReplaced>(*this);
+		t_reg.on_destroy<MeshRenderer>().disconnect<&OffscreenSubpass::OnMeshRendererDestroyed>(*this);
 		
 		t_reg.view<MeshRenderer>().each([](MeshRenderer& t_Mesh)
 		{
 			t_Mesh.Release();
+			t_Mesh.m_TextureSlotsMaterial = nullptr;
 		});
 
 		if (m_DescriptorPool != VK_NULL_HANDLE)
@@ -383,14 +997,146 @@ namespace Fling
 			vkDestroyDescriptorPool(m_Device->GetVkDevice(), m_DescriptorPool, nullptr);
 			m_DescriptorPool = VK_NULL_HANDLE;
 		}
+
+		m_Bindless.reset();
 	}
 
 	void OffscreenSubpass::OnSwapchainResized(entt::registry& t_reg)
 	{
-		const VkExtent2D NewSize = m_SwapChain->GetExtents();
-		if (m_OffscreenFrameBuf)
+		// The Vulkan app recreates the single pass attachments with the swap chain
+		if (IsSinglePass())
 		{
-			m_OffscreenFrameBuf->ResizeAndRecreate(NewSize.width, NewSize.height);
+			return;
+		}
+
+		// Render passes are kept, so the G-Buffer pipelines stay valid
+		m_RenderGraph.Resize(GetGBufferExtent());
+	}
+
+	VkExtent2D OffscreenSubpass::GetGBufferExtent() const
+	{
+		return m_DynamicResolution ? m_DynamicResolution->GetAllocatedExtent(m_SwapChain->GetExtents()) : m_SwapChain->GetExtents();
+	}
+
+	glm::vec4 OffscreenSubpass::GetGBufferUVScale() const
+	{
+		const VkExtent2D& Extent = m_RenderGraph.GetExtent();
+		if (IsSinglePass() || Extent.width == 0 || Extent.height == 0)
+		{
+			return glm::vec4(1.0f);
+		}
+
+		// Stop half a texel short of the edge so nothing outside of the rendered area is read
+		const VkExtent2D Area = m_RenderGraph.GetRenderArea();
+		const glm::vec2 Size(static_cast<float>(Extent.width), static_cast<float>(Extent.height));
+		const glm::vec2 Rendered(static_cast<float>(Area.width), static_cast<float>(Area.height));
+		return glm::vec4(Rendered / Size, (Rendered - 0.5f) / Size);
+	}
+
+	void OffscreenSubpass::UpdateRenderScale()
+	{
+		GpuProfiler* Profiler = VulkanApp::Get().GetGpuProfiler();
+		if (!Profiler)
+		{
+			// Without frame times the scale stays at the max
+			if (!m_WarnedNoFrameTimes)
+			{
+				F_LOG_WARN("Dynamic resolution needs Graphics.GpuProfiler to measure frames, rendering at the max scale");
+				m_WarnedNoFrameTimes = true;
+			}
+		}
+		else if (Profiler->GetResolvedFrameCount() != m_ResolvedGpuFrames)
+		{
+			m_ResolvedGpuFrames = Profiler->GetResolvedFrameCount();
+			m_DynamicResolution->AddFrameTime(Profiler->GetLastFrameTime());
+		}
+	}
+
+	VkExtent2D OffscreenSubpass::GetRenderExtent() const
+	{
+		return m_DynamicResolution ? m_DynamicResolution->GetRenderExtent(m_SwapChain->GetExtents()) : m_SwapChain->GetExtents();
+	}
+
+	void OffscreenSubpass::EnableGpuCulling(std::unique_ptr<GpuCullingPass> t_GpuCulling)
+	{
+		assert(t_GpuCulling);
+		m_GpuCulling = std::move(t_GpuCulling);
+	}
+
+	void OffscreenSubpass::EnableDepthPrepass(std::shared_ptr<Fling::Shader> t_DepthVert, std::shared_ptr<Fling::Shader> t_IndirectDepthVert)
+	{
+		assert(UsesDepthPrepass() && t_DepthVert);
+		assert(!m_DepthPipeline && !m_PrepassedPipeline);
+
+		// depth.vert declares the same set 0 as mrt.vert, so its layout is defined identically
+		// and the camera sets can be bound to either pipeline
+		m_DepthShader = t_DepthVert;
+		std::vector<Shader*> DepthShaders = { m_DepthShader.get() };
+		m_DepthPipeline = new GraphicsPipeline(
+			DepthShaders,
+			m_Device->GetVkDevice(),
+			VK_POLYGON_MODE_FILL,
+			GraphicsPipeline::Depth::ReadWrite,
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE);
+		m_DepthPipeline->SetPipelineLayout({}, VK_SHADER_STAGE_VERTEX_BIT, sizeof(OffscreenPushConstants));
+		m_DepthPipeline->UsePositionStream();
+
+		std::vector<Shader*> Shaders = { m_VertexShader.get(), m_FragShader.get() };
+		m_PrepassedPipeline = new GraphicsPipeline(
+			Shaders,
+			m_Device->GetVkDevice(),
+			VK_POLYGON_MODE_FILL,
+			GraphicsPipeline::Depth::Read,
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE);
+		m_PrepassedPipeline->SetPipelineLayout({ m_Bindless->GetSetLayout() }, VK_SHADER_STAGE_VERTEX_BIT, sizeof(OffscreenPushConstants));
+
+		if (m_GpuCulling)
+		{
+			assert(t_IndirectDepthVert);
+			m_GpuCulling->EnableDepthPrepass(t_IndirectDepthVert);
+		}
+	}
+
+	void OffscreenSubpass::UpdateDepthPrepass()
+	{
+		// On and Off never change, so there is nothing to measure
+		if (m_DepthPrepass->GetSettings().Mode != DepthPrepassMode::Auto)
+		{
+			return;
+		}
+
+		GpuProfiler* Profiler = VulkanApp::Get().GetGpuProfiler();
+		if (!Profiler)
+		{
+			if (!m_WarnedNoPrepassTimes)
+			{
+				F_LOG_WARN("Graphics.DepthPrepass=Auto needs Graphics.GpuProfiler to time the G-Buffer, keeping the prepass off");
+				m_WarnedNoPrepassTimes = true;
+			}
+			return;
+		}
+
+		if (Profiler->GetResolvedFrameCount() == m_PrepassResolvedGpuFrames)
+		{
+			return;
+		}
+		m_PrepassResolvedGpuFrames = Profiler->GetResolvedFrameCount();
+
+		// The G-Buffer scope has the prepass in it too. Per pixel so that dynamic resolution doesn't skew it
+		const VkExtent2D Extent = IsSinglePass() ? m_SwapChain->GetExtents() : m_RenderGraph.GetRenderArea();
+		const float Pixels = static_cast<float>(Extent.width) * static_cast<float>(Extent.height);
+		if (Pixels <= 0.0f)
+		{
+			return;
+		}
+
+		if (m_DepthPrepass->AddFrameCost(Profiler->GetLastScopeTime("GBuffer") * 1000000.0f / Pixels))
+		{
+			F_LOG_TRACE("Depth prepass {}", m_DepthPrepass->IsEnabled() ? "on" : "off");
 		}
 	}
 
@@ -403,20 +1149,21 @@ namespace Fling
 
 		t_Reg.assign<entt::tag<"Default"_hs >>(t_Ent);
 
-		// Initialize and map the UBO of each mesh renderer
-		if (t_MeshRend.m_UniformBuffer == nullptr)
+		AcquireTextureSlots(t_MeshRend);
+	}
+
+	void OffscreenSubpass::OnMeshRendererReplaced(entt::entity t_Ent, entt::registry& t_Reg, MeshRenderer& t_MeshRend)
+	{
+		ReleaseTextureSlots(t_Reg.get<MeshRenderer>(t_Ent));
+
+		if (t_Reg.has<entt::tag<"Default"_hs>>(t_Ent))
 		{
-			VkDeviceSize bufferSize = sizeof(OffscreenUBO);
-			t_MeshRend.m_UniformBuffer = new Buffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-			t_MeshRend.m_UniformBuffer->MapMemory(bufferSize);
+			AcquireTextureSlots(t_MeshRend);
 		}
-		
-		// I would love to create some descriptor sets here		
-		CreateMeshDescriptorSet(t_MeshRend);
 	}
 
-	void OffscreenSubpass::OnMeshRendererDestroyed(entt::registry& t_Reg, MeshRenderer& t_MeshRend)
+	void OffscreenSubpass::OnMeshRendererDestroyed(entt::entity t_Ent, entt::registry& t_Reg)
 	{
-		//t_MeshRend.Release();
+		ReleaseTextureSlots(t_Reg.get<MeshRenderer>(t_Ent));
 	}
 }   // namespace Fling
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "pch.h"
+#include "OverdrawCounter.h"
+#include "CommandBuffer.h"
+#include "LogicalDevice.h"
+#include "Stats.h"
+
+namespace Fling
+{
+	OverdrawCounter::OverdrawCounter(const LogicalDevice* t_Dev)
+		: m_Device(t_Dev)
+	{
+		assert(m_Device && IsSupported(m_Device));
+
+		VkQueryPoolCreateInfo PoolInfo = {};
+		PoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		PoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		PoolInfo.queryCount = 1;
+		PoolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+		for (FrameQuery& Frame : m_Frames)
+		{
+			VK_CHECK_RESULT(vkCreateQueryPool(m_Device->GetVkDevice(), &PoolInfo, nullptr, &Frame.Pool));
+		}
+	}
+
+	OverdrawCounter::~OverdrawCounter()
+	{
+		for (FrameQuery& Frame : m_Frames)
+		{
+			if (Frame.Pool != VK_NULL_HANDLE)
+			{
+				vkDestroyQueryPool(m_Device->GetVkDevice(), Frame.Pool, nullptr);
+				Frame.Pool = VK_NULL_HANDLE;
+			}
+		}
+	}
+
+	bool OverdrawCounter::IsSupported(const LogicalDevice* t_Dev)
+	{
+		return t_Dev && t_Dev->SupportsPipelineStatistics();
+	}
+
+	void OverdrawCounter::BeginFrame(CommandBuffer& t_CmdBuf, uint32 t_FrameInFlight, uint64 t_Pixels, bool t_Prepass)
+	{
+		assert(t_FrameInFlight < m_Frames.size());
+		FrameQuery& Frame = m_Frames[t_FrameInFlight];
+
+		if (Frame.Pending)
+		{
+			Frame.Pending = false;
+
+			// No wait flag, a frame that never finished is skipped
+			uint64 Fragments = 0;
+			VkResult Res = vkGetQueryPoolResults(
+				m_Device->GetVkDevice(), Frame.Pool,
+				0, 1,
+				sizeof(uint64), &Fragments, sizeof(uint64),
+				VK_QUERY_RESULT_64_BIT);
+
+			if (Res == VK_SUCCESS)
+			{
+				Stats::Overdraw::SetFrameResults(Fragments, Frame.Pixels, Frame.Prepass);
+			}
+		}
+
+		m_ActiveFrame = t_FrameInFlight;
+		Frame.Pixels = t_Pixels;
+		Frame.Prepass = t_Prepass;
+
+		vkCmdResetQueryPool(t_CmdBuf.GetHandle(), Frame.Pool, 0, 1);
+	}
+
+	void OverdrawCounter::Begin(CommandBuffer& t_CmdBuf)
+	{
+		vkCmdBeginQuery(t_CmdBuf.GetHandle(), m_Frames[m_ActiveFrame].Pool, 0, 0);
+	}
+
+	void OverdrawCounter::End(CommandBuffer& t_CmdBuf)
+	{
+		FrameQuery& Frame = m_Frames[m_ActiveFrame];
+		vkCmdEndQuery(t_CmdBuf.GetHandle(), Frame.Pool, 0);
+		Frame.Pending = true;
+	}
+}   // namespace Fling
@@ -35,10 +35,45 @@ namespace Fling
 		vkGetPhysicalDeviceProperties(m_PhysicalDevice, &m_DeviceProperties);
 		vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &m_DeviceFeatures);
 		vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &m_MemoryProperties);
+
+		QueryDescriptorIndexing();
 		
 		LogPhysicalDeviceInfo();
     }
 
+	void PhysicalDevice::QueryDescriptorIndexing()
+	{
+		if (!m_Instance->SupportsPhysicalDeviceProperties2() || !IsExtensionSupported(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+		{
+			return;
+		}
+
+		VkInstance Inst = m_Instance->GetRawVkInstance();
+		auto GetFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(vkGetInstanceProcAddr(Inst, "vkGetPhysicalDeviceFeatures2KHR"));
+		auto GetProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(vkGetInstanceProcAddr(Inst, "vkGetPhysicalDeviceProperties2KHR"));
+		if (!GetFeatures2 || !GetProperties2)
+		{
+			return;
+		}
+
+		m_DescriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		VkPhysicalDeviceFeatures2KHR Features = {};
+		Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+		Features.pNext = &m_DescriptorIndexingFeatures;
+		GetFeatures2(m_PhysicalDevice, &Features);
+
+		m_DescriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+		VkPhysicalDeviceProperties2KHR Properties = {};
+		Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+		Properties.pNext = &m_DescriptorIndexingProperties;
+		GetProperties2(m_PhysicalDevice, &Properties);
+
+		// Nothing else is chained on to these
+		m_DescriptorIndexingFeatures.pNext = nullptr;
+		m_DescriptorIndexingProperties.pNext = nullptr;
+		m_HasDescriptorIndexing = true;
+	}
+
 	VkFormatProperties PhysicalDevice::GetFormatProperties(VkFormat t_Form) const
 	{
 		assert(m_PhysicalDevice != VK_NULL_HANDLE);
@@ -47,6 +82,25 @@ namespace Fling
 		return formatProperties;
 	}
 
+	bool PhysicalDevice::IsExtensionSupported(const char* t_Extension) const
+	{
+		assert(m_PhysicalDevice != VK_NULL_HANDLE && t_Extension);
+
+		uint32 ExtensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &ExtensionCount, nullptr);
+		std::vector<VkExtensionProperties> Extensions(ExtensionCount);
+		vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &ExtensionCount, Extensions.data());
+
+		for (const VkExtensionProperties& Extension : Extensions)
+		{
+			if (strcmp(t_Extension, Extension.extensionName) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	const char* PhysicalDevice::GetDeviceType(VkPhysicalDeviceProperties t_Props)
 	{
 		switch (static_cast<uint32>(t_Props.deviceType))
@@ -161,6 +215,18 @@ namespace Fling
 		return false;
 	}
 
+	bool PhysicalDevice::HasMemoryType(VkMemoryPropertyFlags t_Props) const
+	{
+		for (uint32 i = 0; i < m_MemoryProperties.memoryTypeCount; ++i)
+		{
+			if ((m_MemoryProperties.memoryTypes[i].propertyFlags & t_Props) == t_Props)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	VkPhysicalDevice PhysicalDevice::ChooseBestPhyscialDevice(std::vector<VkPhysicalDevice>& t_AvailableDevices)
 	{
 		std::multimap<int32, VkPhysicalDevice> SortedDevices;
@@ -195,23 +261,23 @@ namespace Fling
 				{
 					return 0;
 				}
+			}
 
-				// Obtain the device features and properties of the current device being rated
-				VkPhysicalDeviceProperties physicalDeviceProperties;
-				VkPhysicalDeviceFeatures physicalDeviceFeatures;
-				vkGetPhysicalDeviceProperties(t_Device, &physicalDeviceProperties);
-				vkGetPhysicalDeviceFeatures(t_Device, &physicalDeviceFeatures);
+			// Obtain the device features and properties of the current device being rated
+			VkPhysicalDeviceProperties physicalDeviceProperties;
+			VkPhysicalDeviceFeatures physicalDeviceFeatures;
+			vkGetPhysicalDeviceProperties(t_Device, &physicalDeviceProperties);
+			vkGetPhysicalDeviceFeatures(t_Device, &physicalDeviceFeatures);
 
-				// Adds a large score boost for discrete GPUs (dedicated graphics cards).
-				if (physicalDeviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-				{
-					Score += 1000;
-				}
-
-				// Gives a higher score to devices with a higher maximum texture size.
-				Score += physicalDeviceProperties.limits.maxImageDimension2D;
+			// Adds a large score boost for discrete GPUs (dedicated graphics cards).
+			if (physicalDeviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+			{
+				Score += 1000;
 			}
 
+			// Gives a higher score to devices with a higher maximum texture size.
+			Score += physicalDeviceProperties.limits.maxImageDimension2D;
+
 			return Score;
 		};
 
@@ -0,0 +1,385 @@
+#include "pch.h"
+#include "PipelineCache.h"
+#include "LogicalDevice.h"
+#include "Stats.h"
+
+#include <cstring>
+
+namespace Fling
+{
+	PipelineCache::PipelineCache(const LogicalDevice* t_Dev, uint32 t_WorkerCount)
+		: m_Device(t_Dev)
+	{
+		assert(m_Device);
+
+		VkPipelineCacheCreateInfo CacheInfo = {};
+		CacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		VK_CHECK_RESULT(vkCreatePipelineCache(m_Device->GetVkDevice(), &CacheInfo, nullptr, &m_VkCache));
+
+		for (uint32 i = 0; i < t_WorkerCount; ++i)
+		{
+			m_Workers.emplace_back(&PipelineCache::WorkerLoop, this);
+		}
+
+		F_LOG_TRACE("Pipeline cache created with {} compile threads", t_WorkerCount);
+	}
+
+	PipelineCache::~PipelineCache()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			m_ShuttingDown = true;
+		}
+		m_WorkAvailable.notify_all();
+
+		for (std::thread& Worker : m_Workers)
+		{
+			Worker.join();
+		}
+
+		VkDevice Device = m_Device->GetVkDevice();
+		for (auto& Pair : m_Entries)
+		{
+			if (Pair.second.Pipeline != VK_NULL_HANDLE)
+			{
+				vkDestroyPipeline(Device, Pair.second.Pipeline, nullptr);
+			}
+		}
+		m_Entries.clear();
+
+		vkDestroyPipelineCache(Device, m_VkCache, nullptr);
+	}
+
+	void PipelineCache::RegisterRenderPass(VkRenderPass t_RenderPass, const VkRenderPassCreateInfo& t_Info)
+	{
+		// Render passes are compatible if their attachments have the same formats and sample
+		// counts and their subpasses reference them the same way. Layouts and load ops don't matter
+		PipelineKey Key;
+		Key.Add(t_Info.attachmentCount);
+		for (uint32 i = 0; i < t_Info.attachmentCount; ++i)
+		{
+			Key.Add(t_Info.pAttachments[i].format);
+			Key.Add(t_Info.pAttachments[i].samples);
+		}
+
+		const auto AddRefs = [&Key](const VkAttachmentReference* t_Refs, uint32 t_Count)
+		{
+			Key.Add(t_Refs ? t_Count : 0u);
+			for (uint32 i = 0; t_Refs && i < t_Count; ++i)
+			{
+				Key.Add(t_Refs[i].attachment);
+			}
+		};
+
+		Key.Add(t_Info.subpassCount);
+		for (uint32 i = 0; i < t_Info.subpassCount; ++i)
+		{
+			const VkSubpassDescription& Subpass = t_Info.pSubpasses[i];
+			Key.Add(Subpass.pipelineBindPoint);
+			AddRefs(Subpass.pInputAttachments, Subpass.inputAttachmentCount);
+			AddRefs(Subpass.pColorAttachments, Subpass.colorAttachmentCount);
+			AddRefs(Subpass.pResolveAttachments, Subpass.colorAttachmentCount);
+			AddRefs(Subpass.pDepthStencilAttachment, 1);
+		}
+
+		m_RenderPassHashes[t_RenderPass] = Key.GetHash();
+	}
+
+	void PipelineCache::UnregisterRenderPass(VkRenderPass t_RenderPass)
+	{
+		m_RenderPassHashes.erase(t_RenderPass);
+	}
+
+	uint64 PipelineCache::GetRenderPassHash(VkRenderPass t_RenderPass) const
+	{
+		auto It = m_RenderPassHashes.find(t_RenderPass);
+		if (It != m_RenderPassHashes.end())
+		{
+			return It->second;
+		}
+
+		PipelineKey Key;
+		Key.Add(t_RenderPass);
+		return Key.GetHash();
+	}
+
+	PipelineKey PipelineCache::MakeKey(const GraphicsPipelineDesc& t_Desc) const
+	{
+		assert(t_Desc.Viewport.pViewports == nullptr && t_Desc.Viewport.pScissors == nullptr);
+
+		PipelineKey Key;
+
+		Key.Add(static_cast<uint32>(t_Desc.Stages.size()));
+		for (const VkPipelineShaderStageCreateInfo& Stage : t_Desc.Stages)
+		{
+			assert(Stage.pSpecializationInfo == nullptr);
+			Key.Add(Stage.stage);
+			Key.Add(Stage.module);
+			Key.AddArray(Stage.pName, std::strlen(Stage.pName));
+		}
+
+		Key.AddArray(t_Desc.VertexBindings.data(), t_Desc.VertexBindings.size());
+		Key.AddArray(t_Desc.VertexAttributes.data(), t_Desc.VertexAttributes.size());
+
+		const VkPipelineInputAssemblyStateCreateInfo& Assembly = t_Desc.InputAssembly;
+		Key.Add(Assembly.topology);
+		Key.Add(Assembly.primitiveRestartEnable);
+
+		const VkPipelineRasterizationStateCreateInfo& Raster = t_Desc.Rasterization;
+		Key.Add(Raster.depthClampEnable);
+		Key.Add(Raster.rasterizerDiscardEnable);
+		Key.Add(Raster.polygonMode);
+		Key.Add(Raster.cullMode);
+		Key.Add(Raster.frontFace);
+		Key.Add(Raster.depthBiasEnable);
+		Key.Add(Raster.depthBiasConstantFactor);
+		Key.Add(Raster.depthBiasClamp);
+		Key.Add(Raster.depthBiasSlopeFactor);
+		Key.Add(Raster.lineWidth);
+
+		const VkPipelineMultisampleStateCreateInfo& Multisample = t_Desc.Multisample;
+		Key.Add(Multisample.rasterizationSamples);
+		Key.Add(Multisample.sampleShadingEnable);
+		Key.Add(Multisample.minSampleShading);
+		Key.Add(Multisample.alphaToCoverageEnable);
+		Key.Add(Multisample.alphaToOneEnable);
+
+		const VkPipelineDepthStencilStateCreateInfo& Depth = t_Desc.DepthStencil;
+		Key.Add(Depth.depthTestEnable);
+		Key.Add(Depth.depthWriteEnable);
+		Key.Add(Depth.depthCompareOp);
+		Key.Add(Depth.depthBoundsTestEnable);
+		Key.Add(Depth.stencilTestEnable);
+		Key.Add(Depth.front);
+		Key.Add(Depth.back);
+		Key.Add(Depth.minDepthBounds);
+		Key.Add(Depth.maxDepthBounds);
+
+		Key.Add(t_Desc.ColorBlend.logicOpEnable);
+		Key.Add(t_Desc.ColorBlend.logicOp);
+		Key.Add(t_Desc.ColorBlend.blendConstants);
+		Key.AddArray(t_Desc.BlendAttachments.data(), t_Desc.BlendAttachments.size());
+
+		Key.Add(t_Desc.Viewport.viewportCount);
+		Key.Add(t_Desc.Viewport.scissorCount);
+		Key.AddArray(t_Desc.DynamicStates.data(), t_Desc.DynamicStates.size());
+
+		Key.Add(t_Desc.Layout);
+		Key.Add(GetRenderPassHash(t_Desc.RenderPass));
+		Key.Add(t_Desc.Subpass);
+
+		return Key;
+	}
+
+	VkPipeline PipelineCache::GetOrCreate(const PipelineKey& t_Key, const GraphicsPipelineDesc& t_Desc)
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+
+		auto It = m_Entries.find(t_Key);
+		if (It == m_Entries.end())
+		{
+			Entry& NewEntry = m_Entries[t_Key];
+			NewEntry.Layout = t_Desc.Layout;
+			NewEntry.State = Status::Compiling;
+			return CompileEntry(Lock, t_Key, t_Desc);
+		}
+
+		Entry& Existing = It->second;
+		if (Existing.State == Status::Queued)
+		{
+			// Nobody has started on it yet, so compile it here instead of waiting on the queue
+			std::unique_ptr<GraphicsPipelineDesc> Desc = std::move(Existing.Desc);
+			Existing.State = Status::Compiling;
+			return CompileEntry(Lock, t_Key, *Desc);
+		}
+
+		if (Existing.State == Status::Compiling)
+		{
+			m_WorkDone.wait(Lock, [&Existing]() { return Existing.State != Status::Compiling; });
+		}
+		else if (Existing.State == Status::Ready)
+		{
+			++m_HitCount;
+		}
+
+		return Existing.Pipeline;
+	}
+
+	VkPipeline PipelineCache::Request(const PipelineKey& t_Key, const GraphicsPipelineDesc& t_Desc)
+	{
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+
+			auto It = m_Entries.find(t_Key);
+			if (It != m_Entries.end())
+			{
+				if (It->second.State == Status::Ready)
+				{
+					++m_HitCount;
+				}
+				return It->second.Pipeline;
+			}
+
+			Entry& NewEntry = m_Entries[t_Key];
+			NewEntry.Layout = t_Desc.Layout;
+			NewEntry.State = Status::Queued;
+			NewEntry.Desc = std::make_unique<GraphicsPipelineDesc>(t_Desc);
+			m_Queue.push_back(t_Key);
+		}
+
+		m_WorkAvailable.notify_one();
+		return VK_NULL_HANDLE;
+	}
+
+	VkPipeline PipelineCache::Find(const PipelineKey& t_Key)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		auto It = m_Entries.find(t_Key);
+		return It != m_Entries.end() ? It->second.Pipeline : VK_NULL_HANDLE;
+	}
+
+	void PipelineCache::ReleaseLayout(VkPipelineLayout t_Layout)
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+
+		// A worker could be writing its result into one of the entries
+		m_WorkDone.wait(Lock, [this, t_Layout]()
+		{
+			for (const auto& Pair : m_Entries)
+			{
+				if (Pair.second.Layout == t_Layout && Pair.second.State == Status::Compiling)
+				{
+					return false;
+				}
+			}
+			return true;
+		});
+
+		// Queued keys of erased entries are skipped by the workers
+		VkDevice Device = m_Device->GetVkDevice();
+		for (auto It = m_Entries.begin(); It != m_Entries.end();)
+		{
+			if (It->second.Layout != t_Layout)
+			{
+				++It;
+				continue;
+			}
+
+			if (It->second.Pipeline != VK_NULL_HANDLE)
+			{
+				vkDestroyPipeline(Device, It->second.Pipeline, nullptr);
+			}
+			It = m_Entries.erase(It);
+		}
+	}
+
+	void PipelineCache::UpdateStats()
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		uint32 Ready = 0;
+		uint32 Pending = 0;
+		for (const auto& Pair : m_Entries)
+		{
+			if (Pair.second.State == Status::Ready)
+			{
+				++Ready;
+			}
+			else if (Pair.second.State != Status::Failed)
+			{
+				++Pending;
+			}
+		}
+
+		Stats::Pipelines::SetCacheResults(Ready, Pending, m_HitCount, m_CompileCount);
+	}
+
+	void PipelineCache::WorkerLoop()
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+
+		while (true)
+		{
+			m_WorkAvailable.wait(Lock, [this]() { return m_ShuttingDown || !m_Queue.empty(); });
+			if (m_ShuttingDown)
+			{
+				return;
+			}
+
+			PipelineKey Key = std::move(m_Queue.front());
+			m_Queue.pop_front();
+
+			// Released, or taken by GetOrCreate while it was waiting in the queue
+			auto It = m_Entries.find(Key);
+			if (It == m_Entries.end() || It->second.State != Status::Queued)
+			{
+				continue;
+			}
+
+			std::unique_ptr<GraphicsPipelineDesc> Desc = std::move(It->second.Desc);
+			It->second.State = Status::Compiling;
+			CompileEntry(Lock, Key, *Desc);
+		}
+	}
+
+	VkPipeline PipelineCache::CompileEntry(std::unique_lock<std::mutex>& t_Lock, const PipelineKey& t_Key, const GraphicsPipelineDesc& t_Desc)
+	{
+		t_Lock.unlock();
+		VkPipeline Pipeline = Compile(t_Desc);
+		t_Lock.lock();
+
+		// Compiling entries can't be erased, ReleaseLayout waits for them
+		Entry& Done = m_Entries[t_Key];
+		Done.Pipeline = Pipeline;
+		Done.State = Pipeline != VK_NULL_HANDLE ? Status::Ready : Status::Failed;
+		++m_CompileCount;
+
+		m_WorkDone.notify_all();
+		return Pipeline;
+	}
+
+	VkPipeline PipelineCache::Compile(const GraphicsPipelineDesc& t_Desc) const
+	{
+		VkPipelineVertexInputStateCreateInfo VertexInput = {};
+		VertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		VertexInput.vertexBindingDescriptionCount = static_cast<uint32>(t_Desc.VertexBindings.size());
+		VertexInput.pVertexBindingDescriptions = t_Desc.VertexBindings.data();
+		VertexInput.vertexAttributeDescriptionCount = static_cast<uint32>(t_Desc.VertexAttributes.size());
+		VertexInput.pVertexAttributeDescriptions = t_Desc.VertexAttributes.data();
+
+		VkPipelineColorBlendStateCreateInfo ColorBlend = t_Desc.ColorBlend;
+		ColorBlend.attachmentCount = static_cast<uint32>(t_Desc.BlendAttachments.size());
+		ColorBlend.pAttachments = t_Desc.BlendAttachments.data();
+
+		VkPipelineDynamicStateCreateInfo Dynamic = {};
+		Dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		Dynamic.dynamicStateCount = static_cast<uint32>(t_Desc.DynamicStates.size());
+		Dynamic.pDynamicStates = t_Desc.DynamicStates.data();
+
+		VkGraphicsPipelineCreateInfo CreateInfo = {};
+		CreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		CreateInfo.stageCount = static_cast<uint32>(t_Desc.Stages.size());
+		CreateInfo.pStages = t_Desc.Stages.data();
+		CreateInfo.pVertexInputState = &VertexInput;
+		CreateInfo.pInputAssemblyState = &t_Desc.InputAssembly;
+		CreateInfo.pViewportState = &t_Desc.Viewport;
+		CreateInfo.pRasterizationState = &t_Desc.Rasterization;
+		CreateInfo.pMultisampleState = &t_Desc.Multisample;
+		CreateInfo.pDepthStencilState = &t_Desc.DepthStencil;
+		CreateInfo.pColorBlendState = &ColorBlend;
+		CreateInfo.pDynamicState = &Dynamic;
+		CreateInfo.layout = t_Desc.Layout;
+		CreateInfo.renderPass = t_Desc.RenderPass;
+		CreateInfo.subpass = t_Desc.Subpass;
+
+		VkPipeline Pipeline = VK_NULL_HANDLE;
+		if (vkCreateGraphicsPipelines(m_Device->GetVkDevice(), m_VkCache, 1, &CreateInfo, nullptr, &Pipeline) != VK_SUCCESS)
+		{
+			F_LOG_ERROR("Failed to create graphics pipeline");
+			return VK_NULL_HANDLE;
+		}
+
+		return Pipeline;
+	}
+}   // namespace Fling
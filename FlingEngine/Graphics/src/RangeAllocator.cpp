@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "RangeAllocator.h"
+
+namespace Fling
+{
+	RangeAllocator::RangeAllocator(uint32 t_Capacity, uint32 t_RetireFrames)
+		: m_Capacity(t_Capacity)
+		, m_FreeSize(0)
+		, m_RetireFrames(t_RetireFrames)
+	{
+		AddFreeRange(0, t_Capacity);
+	}
+
+	uint32 RangeAllocator::Allocate(uint32 t_Size)
+	{
+		assert(t_Size > 0);
+
+		for (auto It = m_FreeRanges.begin(); It != m_FreeRanges.end(); ++It)
+		{
+			if (It->second < t_Size)
+			{
+				continue;
+			}
+
+			// Take it from the front, so what is left keeps its place in the list
+			const uint32 Offset = It->first;
+			const uint32 Remaining = It->second - t_Size;
+			m_FreeRanges.erase(It);
+			if (Remaining > 0)
+			{
+				m_FreeRanges.emplace(Offset + t_Size, Remaining);
+			}
+
+			m_FreeSize -= t_Size;
+			return Offset;
+		}
+
+		return InvalidOffset;
+	}
+
+	void RangeAllocator::Free(uint32 t_Offset, uint32 t_Size)
+	{
+		assert(t_Size > 0 && t_Offset + t_Size <= m_Capacity);
+		m_Retired.push_back({ t_Offset, t_Size, m_Frame });
+	}
+
+	void RangeAllocator::NextFrame()
+	{
+		++m_Frame;
+
+		size_t Count = 0;
+		for (; Count < m_Retired.size(); ++Count)
+		{
+			const RetiredRange& Retired = m_Retired[Count];
+			if (Retired.ReleaseFrame + m_RetireFrames > m_Frame)
+			{
+				// Freed in order, so everything after this is newer
+				break;
+			}
+
+			AddFreeRange(Retired.Offset, Retired.Size);
+		}
+
+		m_Retired.erase(m_Retired.begin(), m_Retired.begin() + Count);
+	}
+
+	void RangeAllocator::Grow(uint32 t_NewCapacity)
+	{
+		assert(t_NewCapacity >= m_Capacity);
+
+		const uint32 OldCapacity = m_Capacity;
+		m_Capacity = t_NewCapacity;
+		AddFreeRange(OldCapacity, t_NewCapacity - OldCapacity);
+	}
+
+	uint32 RangeAllocator::GetLargestFreeRange() const
+	{
+		uint32 Largest = 0;
+		for (const auto& Range : m_FreeRanges)
+		{
+			Largest = Range.second > Largest ? Range.second : Largest;
+		}
+		return Largest;
+	}
+
+	void RangeAllocator::AddFreeRange(uint32 t_Offset, uint32 t_Size)
+	{
+		if (t_Size == 0)
+		{
+			return;
+		}
+
+		m_FreeSize += t_Size;
+
+		uint32 Offset = t_Offset;
+		uint32 Size = t_Size;
+
+		// Merge with the range after it
+		auto Next = m_FreeRanges.lower_bound(Offset);
+		assert(Next == m_FreeRanges.end() || Next->first >= Offset + Size);
+		if (Next != m_FreeRanges.end() && Next->first == Offset + Size)
+		{
+			Size += Next->second;
+			Next = m_FreeRanges.erase(Next);
+		}
+
+		// And the one before it
+		if (Next != m_FreeRanges.begin())
+		{
+			auto Prev = std::prev(Next);
+			assert(Prev->first + Prev->second <= Offset);
+			if (Prev->first + Prev->second == Offset)
+			{
+				Prev->second += Size;
+				return;
+			}
+		}
+
+		m_FreeRanges.emplace_hint(Next, Offset, Size);
+	}
+}   // namespace Fling
@@ -0,0 +1,822 @@
+#include "pch.h"
+#include "RenderGraph.h"
+#include "LogicalDevice.h"
+#include "PhyscialDevice.h"
+#include "CommandBuffer.h"
+#include "GraphicsHelpers.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <map>
+
+namespace Fling
+{
+	namespace
+	{
+		constexpr VkAccessFlags WriteAccess =
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_SHADER_WRITE_BIT |
+			VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		constexpr VkPipelineStageFlags DepthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+		bool IsDepthFormat(VkFormat t_Format)
+		{
+			switch (t_Format)
+			{
+			case VK_FORMAT_D16_UNORM:
+			case VK_FORMAT_X8_D24_UNORM_PACK32:
+			case VK_FORMAT_D32_SFLOAT:
+			case VK_FORMAT_D16_UNORM_S8_UINT:
+			case VK_FORMAT_D24_UNORM_S8_UINT:
+			case VK_FORMAT_D32_SFLOAT_S8_UINT:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		bool IsAttachment(RenderGraphUsage t_Usage)
+		{
+			return t_Usage != RenderGraphUsage::Sampled;
+		}
+
+		VkImageUsageFlags GetImageUsage(RenderGraphUsage t_Usage)
+		{
+			switch (t_Usage)
+			{
+			case RenderGraphUsage::ColorAttachment:	return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+			case RenderGraphUsage::DepthAttachment:
+			case RenderGraphUsage::DepthReadOnly:	return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+			case RenderGraphUsage::Sampled:			return VK_IMAGE_USAGE_SAMPLED_BIT;
+			}
+			return 0;
+		}
+
+		/** The state that a texture has to be in for a pass to use it */
+		RenderGraphState GetUsageState(RenderGraphUsage t_Usage, bool t_Write, RenderGraphLoad t_Load, VkFormat t_Format)
+		{
+			RenderGraphState State = {};
+			switch (t_Usage)
+			{
+			case RenderGraphUsage::ColorAttachment:
+				State.Layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				State.Stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+				State.Access = t_Write ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0;
+				if (!t_Write || t_Load == RenderGraphLoad::Load)
+				{
+					State.Access |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+				}
+				break;
+			case RenderGraphUsage::DepthAttachment:
+				State.Layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				State.Stages = DepthStages;
+				State.Access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (t_Write ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0);
+				break;
+			case RenderGraphUsage::DepthReadOnly:
+				State.Layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+				State.Stages = DepthStages;
+				State.Access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+				break;
+			case RenderGraphUsage::Sampled:
+				// Depth has to stay in a depth layout to be sampled
+				State.Layout = IsDepthFormat(t_Format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				State.Stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+				State.Access = VK_ACCESS_SHADER_READ_BIT;
+				break;
+			}
+			return State;
+		}
+
+		VkAttachmentLoadOp GetLoadOp(RenderGraphLoad t_Load)
+		{
+			switch (t_Load)
+			{
+			case RenderGraphLoad::Clear:	return VK_ATTACHMENT_LOAD_OP_CLEAR;
+			case RenderGraphLoad::Load:		return VK_ATTACHMENT_LOAD_OP_LOAD;
+			case RenderGraphLoad::DontCare:	return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			}
+			return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		}
+
+		VkDeviceSize AlignUp(VkDeviceSize t_Value, VkDeviceSize t_Alignment)
+		{
+			return (t_Value + t_Alignment - 1) / t_Alignment * t_Alignment;
+		}
+
+		bool LifetimesOverlap(uint32 t_FirstA, uint32 t_LastA, uint32 t_FirstB, uint32 t_LastB)
+		{
+			return t_FirstA <= t_LastB && t_FirstB <= t_LastA;
+		}
+	}
+
+	// PassBuilder ------------------------------------
+
+	void RenderGraph::PassBuilder::Read(RenderGraphTexture t_Tex, RenderGraphUsage t_Usage)
+	{
+		assert(t_Usage != RenderGraphUsage::DepthAttachment && "Read depth with DepthReadOnly");
+		m_Graph.AddAccess(m_Pass, { t_Tex, t_Usage, RenderGraphLoad::Load, false });
+	}
+
+	void RenderGraph::PassBuilder::Write(RenderGraphTexture t_Tex, RenderGraphUsage t_Usage, RenderGraphLoad t_Load)
+	{
+		assert((t_Usage == RenderGraphUsage::ColorAttachment || t_Usage == RenderGraphUsage::DepthAttachment) && "Only attachments can be written to");
+		m_Graph.AddAccess(m_Pass, { t_Tex, t_Usage, t_Load, true });
+	}
+
+	void RenderGraph::PassBuilder::SetSideEffects()
+	{
+		m_Graph.m_Passes[m_Pass].bSideEffects = true;
+	}
+
+	// RenderGraph ------------------------------------
+
+	RenderGraph::RenderGraph(const LogicalDevice* t_Dev)
+		: m_Device(t_Dev)
+	{
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		Release();
+
+		for (PassNode& Pass : m_Passes)
+		{
+			if (Pass.RenderPass != VK_NULL_HANDLE)
+			{
+				vkDestroyRenderPass(m_Device->GetVkDevice(), Pass.RenderPass, nullptr);
+				Pass.RenderPass = VK_NULL_HANDLE;
+			}
+		}
+	}
+
+	RenderGraphTexture RenderGraph::CreateTexture(const std::string& t_Name, const RenderGraphTextureDesc& t_Desc)
+	{
+		assert(t_Desc.Format != VK_FORMAT_UNDEFINED);
+
+		TextureNode Node = {};
+		Node.Name = t_Name;
+		Node.Desc = t_Desc;
+		m_Textures.emplace_back(Node);
+		m_Compiled = false;
+		return static_cast<RenderGraphTexture>(m_Textures.size() - 1);
+	}
+
+	void RenderGraph::ExportTexture(RenderGraphTexture t_Tex, RenderGraphUsage t_FinalUsage)
+	{
+		assert(t_Tex < m_Textures.size());
+		m_Textures[t_Tex].bExported = true;
+		m_Textures[t_Tex].ExportUsage = t_FinalUsage;
+		m_Compiled = false;
+	}
+
+	uint32 RenderGraph::AddPass(const std::string& t_Name, const std::function<void(PassBuilder&)>& t_Setup, RenderGraphExecute t_Execute)
+	{
+		// Render passes are created for the passes that exist when the graph is realized
+		assert(m_Heaps.empty() && "Passes can't be added to a realized graph");
+
+		uint32 Index = static_cast<uint32>(m_Passes.size());
+		m_Passes.emplace_back();
+		m_Passes.back().Name = t_Name;
+		m_Passes.back().Execute = std::move(t_Execute);
+
+		PassBuilder Builder(*this, Index);
+		t_Setup(Builder);
+
+		m_Compiled = false;
+		return Index;
+	}
+
+	void RenderGraph::AddAccess(uint32 t_Pass, const TextureAccess& t_Access)
+	{
+		assert(t_Access.Texture < m_Textures.size());
+
+		std::vector<TextureAccess>& Accesses = m_Passes[t_Pass].Accesses;
+		assert(std::none_of(Accesses.begin(), Accesses.end(), [&](const TextureAccess& A) { return A.Texture == t_Access.Texture; })
+			&& "A pass can only use a texture once");
+
+		Accesses.emplace_back(t_Access);
+	}
+
+	void RenderGraph::Compile()
+	{
+		// Walk backwards from the exported textures to find which passes are needed
+		std::vector<bool> Needed(m_Textures.size(), false);
+		for (size_t i = 0; i < m_Textures.size(); ++i)
+		{
+			Needed[i] = m_Textures[i].bExported;
+		}
+
+		for (size_t p = m_Passes.size(); p-- > 0;)
+		{
+			PassNode& Pass = m_Passes[p];
+			Pass.bCulled = !Pass.bSideEffects && std::none_of(Pass.Accesses.begin(), Pass.Accesses.end(),
+				[&](const TextureAccess& A) { return A.bWrite && Needed[A.Texture]; });
+
+			if (Pass.bCulled)
+			{
+				continue;
+			}
+
+			// Anything this pass overwrites isn't needed from earlier passes, anything it reads is
+			for (const TextureAccess& Access : Pass.Accesses)
+			{
+				if (Access.bWrite && Access.Load != RenderGraphLoad::Load)
+				{
+					Needed[Access.Texture] = false;
+				}
+			}
+			for (const TextureAccess& Access : Pass.Accesses)
+			{
+				if (!Access.bWrite || Access.Load == RenderGraphLoad::Load)
+				{
+					Needed[Access.Texture] = true;
+				}
+			}
+		}
+
+		m_ExecutionOrder.clear();
+		for (uint32 p = 0; p < m_Passes.size(); ++p)
+		{
+			if (!m_Passes[p].bCulled)
+			{
+				m_ExecutionOrder.emplace_back(p);
+			}
+		}
+
+		// Lifetimes and usage of every texture
+		for (TextureNode& Tex : m_Textures)
+		{
+			Tex.FirstPass = InvalidIndex;
+			Tex.LastPass = InvalidIndex;
+			Tex.Usage = Tex.bExported ? GetImageUsage(Tex.ExportUsage) : 0;
+		}
+
+		for (uint32 Order = 0; Order < m_ExecutionOrder.size(); ++Order)
+		{
+			PassNode& Pass = m_Passes[m_ExecutionOrder[Order]];
+			Pass.Attachments.clear();
+			Pass.ClearValues.clear();
+
+			for (const TextureAccess& Access : Pass.Accesses)
+			{
+				TextureNode& Tex = m_Textures[Access.Texture];
+				Tex.FirstPass = std::min(Tex.FirstPass, Order);
+				Tex.LastPass = (Tex.LastPass == InvalidIndex) ? Order : std::max(Tex.LastPass, Order);
+				Tex.Usage |= GetImageUsage(Access.Usage);
+			}
+
+			// Color attachments come first so that their indices match the shader outputs
+			for (int Depth = 0; Depth < 2; ++Depth)
+			{
+				for (const TextureAccess& Access : Pass.Accesses)
+				{
+					if (IsAttachment(Access.Usage) && (Access.Usage != RenderGraphUsage::ColorAttachment) == (Depth == 1))
+					{
+						VkClearValue Clear = {};
+						if (Depth == 1)
+						{
+							Clear.depthStencil = { 1.0f, 0 };
+						}
+						Pass.Attachments.emplace_back(Access.Texture);
+						Pass.ClearValues.emplace_back(Clear);
+					}
+				}
+			}
+		}
+
+		const uint32 LastOrder = m_ExecutionOrder.empty() ? 0 : static_cast<uint32>(m_ExecutionOrder.size() - 1);
+		for (TextureNode& Tex : m_Textures)
+		{
+			if (Tex.bExported)
+			{
+				Tex.FirstPass = (Tex.FirstPass == InvalidIndex) ? 0 : Tex.FirstPass;
+				Tex.LastPass = LastOrder;
+			}
+		}
+
+		PlanBarriers();
+		m_Compiled = true;
+
+		Stats::RenderGraph::SetCompileResults(
+			static_cast<uint32>(m_ExecutionOrder.size()),
+			static_cast<uint32>(m_Passes.size() - m_ExecutionOrder.size()),
+			m_BarrierCount,
+			m_SkippedBarrierCount
+		);
+	}
+
+	void RenderGraph::PlanBarriers()
+	{
+		m_BarrierCount = 0;
+		m_SkippedBarrierCount = 0;
+		m_ExportBarriers.clear();
+
+		// State of each texture at the end of the graph, which is where the last frame left it
+		for (TextureNode& Tex : m_Textures)
+		{
+			Tex.FinalState = {};
+		}
+		for (uint32 PassIndex : m_ExecutionOrder)
+		{
+			for (const TextureAccess& Access : m_Passes[PassIndex].Accesses)
+			{
+				TextureNode& Tex = m_Textures[Access.Texture];
+				Tex.FinalState = GetUsageState(Access.Usage, Access.bWrite, Access.Load, Tex.Desc.Format);
+			}
+		}
+
+		std::vector<RenderGraphState> Current(m_Textures.size());
+		for (size_t i = 0; i < m_Textures.size(); ++i)
+		{
+			TextureNode& Tex = m_Textures[i];
+			if (Tex.bExported)
+			{
+				Tex.FinalState = GetUsageState(Tex.ExportUsage, false, RenderGraphLoad::Load, Tex.Desc.Format);
+			}
+
+			// Contents don't survive between frames, but the last frame's work still has to finish
+			Current[i] = Tex.FinalState;
+			Current[i].Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			Current[i].Access &= WriteAccess;
+		}
+
+		auto Transition = [&](RenderGraphTexture t_Tex, const RenderGraphState& t_Next, std::vector<RenderGraphBarrier>& t_Out)
+		{
+			RenderGraphState& Prev = Current[t_Tex];
+			const bool bHazard = ((Prev.Access | t_Next.Access) & WriteAccess) != 0;
+			if (!bHazard && Prev.Layout == t_Next.Layout)
+			{
+				// Read after read. A later write has to wait for both
+				Prev.Stages |= t_Next.Stages;
+				Prev.Access |= t_Next.Access;
+				++m_SkippedBarrierCount;
+				return;
+			}
+
+			t_Out.push_back({ t_Tex, Prev, t_Next });
+			Prev = t_Next;
+			++m_BarrierCount;
+		};
+
+		for (uint32 PassIndex : m_ExecutionOrder)
+		{
+			PassNode& Pass = m_Passes[PassIndex];
+			Pass.Barriers.clear();
+			for (const TextureAccess& Access : Pass.Accesses)
+			{
+				Transition(Access.Texture, GetUsageState(Access.Usage, Access.bWrite, Access.Load, m_Textures[Access.Texture].Desc.Format), Pass.Barriers);
+			}
+			UpdatePassStages(Pass);
+		}
+
+		for (RenderGraphTexture i = 0; i < m_Textures.size(); ++i)
+		{
+			if (m_Textures[i].bExported)
+			{
+				Transition(i, m_Textures[i].FinalState, m_ExportBarriers);
+			}
+		}
+		UpdateExportStages();
+	}
+
+	void RenderGraph::UpdatePassStages(PassNode& t_Pass)
+	{
+		t_Pass.SrcStages = 0;
+		t_Pass.DstStages = 0;
+		for (const RenderGraphBarrier& Barrier : t_Pass.Barriers)
+		{
+			t_Pass.SrcStages |= Barrier.Before.Stages;
+			t_Pass.DstStages |= Barrier.After.Stages;
+		}
+	}
+
+	void RenderGraph::UpdateExportStages()
+	{
+		m_ExportSrcStages = 0;
+		m_ExportDstStages = 0;
+		for (const RenderGraphBarrier& Barrier : m_ExportBarriers)
+		{
+			m_ExportSrcStages |= Barrier.Before.Stages;
+			m_ExportDstStages |= Barrier.After.Stages;
+		}
+	}
+
+	VkDeviceSize RenderGraph::PlaceAllocations(std::vector<RenderGraphAllocation>& t_Allocations)
+	{
+		std::vector<size_t> Order(t_Allocations.size());
+		for (size_t i = 0; i < Order.size(); ++i)
+		{
+			Order[i] = i;
+		}
+		std::stable_sort(Order.begin(), Order.end(), [&](size_t A, size_t B) { return t_Allocations[A].Size > t_Allocations[B].Size; });
+
+		std::vector<const RenderGraphAllocation*> Placed;
+		std::vector<const RenderGraphAllocation*> Conflicts;
+		VkDeviceSize HeapSize = 0;
+
+		for (size_t Index : Order)
+		{
+			RenderGraphAllocation& Alloc = t_Allocations[Index];
+			assert(Alloc.Alignment > 0);
+
+			// Only allocations that are alive at the same time are in the way
+			Conflicts.clear();
+			for (const RenderGraphAllocation* Other : Placed)
+			{
+				if (LifetimesOverlap(Alloc.FirstPass, Alloc.LastPass, Other->FirstPass, Other->LastPass))
+				{
+					Conflicts.emplace_back(Other);
+				}
+			}
+			std::sort(Conflicts.begin(), Conflicts.end(), [](const RenderGraphAllocation* A, const RenderGraphAllocation* B) { return A->Offset < B->Offset; });
+
+			// Take the lowest gap that fits
+			VkDeviceSize Offset = 0;
+			for (const RenderGraphAllocation* Other : Conflicts)
+			{
+				if (AlignUp(Offset, Alloc.Alignment) + Alloc.Size <= Other->Offset)
+				{
+					break;
+				}
+				Offset = std::max(Offset, Other->Offset + Other->Size);
+			}
+
+			Alloc.Offset = AlignUp(Offset, Alloc.Alignment);
+			HeapSize = std::max(HeapSize, Alloc.Offset + Alloc.Size);
+			Placed.emplace_back(&Alloc);
+		}
+
+		return HeapSize;
+	}
+
+	void RenderGraph::Realize(VkExtent2D t_Extent)
+	{
+		assert(m_Device);
+		assert(m_Compiled && "Compile the graph before realizing it");
+		assert(m_Heaps.empty() && "Release the graph before realizing it again");
+
+		m_Extent = t_Extent;
+		VkDevice Device = m_Device->GetVkDevice();
+
+		// Create every texture that a pass uses and group them by the memory types they allow
+		std::map<uint32, std::vector<RenderGraphTexture>> Groups;
+		m_UnaliasedTextureMemory = 0;
+
+		for (RenderGraphTexture i = 0; i < m_Textures.size(); ++i)
+		{
+			TextureNode& Tex = m_Textures[i];
+			if (Tex.FirstPass == InvalidIndex)
+			{
+				continue;
+			}
+
+			VkImageCreateInfo ImageInfo = {};
+			ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			ImageInfo.imageType = VK_IMAGE_TYPE_2D;
+			ImageInfo.extent.width = Tex.Desc.Width ? Tex.Desc.Width : t_Extent.width;
+			ImageInfo.extent.height = Tex.Desc.Height ? Tex.Desc.Height : t_Extent.height;
+			ImageInfo.extent.depth = 1;
+			ImageInfo.mipLevels = 1;
+			ImageInfo.arrayLayers = 1;
+			ImageInfo.format = Tex.Desc.Format;
+			ImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			ImageInfo.usage = Tex.Usage;
+			ImageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VK_CHECK_RESULT(vkCreateImage(Device, &ImageInfo, nullptr, &Tex.Image));
+
+			VkMemoryRequirements MemReqs = {};
+			vkGetImageMemoryRequirements(Device, Tex.Image, &MemReqs);
+			Tex.Size = MemReqs.size;
+			Tex.Alignment = MemReqs.alignment;
+			m_UnaliasedTextureMemory += MemReqs.size;
+
+			Groups[MemReqs.memoryTypeBits].emplace_back(i);
+		}
+
+		// Place each group in its own heap
+		m_TextureMemory = 0;
+		std::vector<RenderGraphAllocation> Allocations;
+		for (const auto& Group : Groups)
+		{
+			Allocations.clear();
+			for (RenderGraphTexture i : Group.second)
+			{
+				RenderGraphAllocation Alloc = {};
+				Alloc.Size = m_Textures[i].Size;
+				Alloc.Alignment = m_Textures[i].Alignment;
+				Alloc.FirstPass = m_Textures[i].FirstPass;
+				Alloc.LastPass = m_Textures[i].LastPass;
+				Allocations.emplace_back(Alloc);
+			}
+
+			VkMemoryAllocateInfo AllocInfo = Initializers::MemoryAllocateInfo();
+			AllocInfo.allocationSize = PlaceAllocations(Allocations);
+			AllocInfo.memoryTypeIndex = GraphicsHelpers::FindMemoryType(
+				m_Device->GetPhysicalDevice()->GetVkPhysicalDevice(),
+				Group.first,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			);
+
+			VkDeviceMemory Heap = VK_NULL_HANDLE;
+			VK_CHECK_RESULT(vkAllocateMemory(Device, &AllocInfo, nullptr, &Heap));
+			m_TextureMemory += AllocInfo.allocationSize;
+
+			const uint32 HeapIndex = static_cast<uint32>(m_Heaps.size());
+			m_Heaps.emplace_back(Heap);
+
+			for (size_t a = 0; a < Group.second.size(); ++a)
+			{
+				TextureNode& Tex = m_Textures[Group.second[a]];
+				Tex.Heap = HeapIndex;
+				Tex.Offset = Allocations[a].Offset;
+				VK_CHECK_RESULT(vkBindImageMemory(Device, Tex.Image, Heap, Tex.Offset));
+
+				VkImageViewCreateInfo ViewInfo = Initializers::ImageViewCreateInfo();
+				ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				ViewInfo.format = Tex.Desc.Format;
+				ViewInfo.subresourceRange = {};
+				// Views of depth/stencil images can only have one aspect to be sampled
+				ViewInfo.subresourceRange.aspectMask = IsDepthFormat(Tex.Desc.Format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+				ViewInfo.subresourceRange.levelCount = 1;
+				ViewInfo.subresourceRange.layerCount = 1;
+				ViewInfo.image = Tex.Image;
+				VK_CHECK_RESULT(vkCreateImageView(Device, &ViewInfo, nullptr, &Tex.View));
+			}
+		}
+
+		PlanBarriers();
+		AddAliasingBarriers();
+
+		for (uint32 PassIndex : m_ExecutionOrder)
+		{
+			PassNode& Pass = m_Passes[PassIndex];
+			if (Pass.Attachments.empty())
+			{
+				continue;
+			}
+
+			if (Pass.RenderPass == VK_NULL_HANDLE)
+			{
+				CreateRenderPass(Pass);
+			}
+
+			std::vector<VkImageView> Views;
+			for (RenderGraphTexture Tex : Pass.Attachments)
+			{
+				Views.emplace_back(m_Textures[Tex].View);
+			}
+
+			const TextureNode& First = m_Textures[Pass.Attachments[0]];
+			Pass.Extent.width = First.Desc.Width ? First.Desc.Width : t_Extent.width;
+			Pass.Extent.height = First.Desc.Height ? First.Desc.Height : t_Extent.height;
+			Pass.bExtentSized = First.Desc.Width == 0 && First.Desc.Height == 0;
+
+			VkFramebufferCreateInfo FrameBufInfo = {};
+			FrameBufInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			FrameBufInfo.renderPass = Pass.RenderPass;
+			FrameBufInfo.attachmentCount = static_cast<uint32>(Views.size());
+			FrameBufInfo.pAttachments = Views.data();
+			FrameBufInfo.width = Pass.Extent.width;
+			FrameBufInfo.height = Pass.Extent.height;
+			FrameBufInfo.layers = 1;
+			VK_CHECK_RESULT(vkCreateFramebuffer(Device, &FrameBufInfo, nullptr, &Pass.FrameBuffer));
+		}
+
+		Stats::RenderGraph::SetMemoryResults(m_TextureMemory, m_UnaliasedTextureMemory);
+		F_LOG_TRACE("Render graph realized: {} passes, {} KB of render targets ({} KB without aliasing)",
+			m_ExecutionOrder.size(), m_TextureMemory / 1024, m_UnaliasedTextureMemory / 1024);
+	}
+
+	void RenderGraph::AddAliasingBarriers()
+	{
+		// The first barrier of a texture discards its contents, so it only has to wait for
+		// whatever last used the memory under it. Earlier in this frame or in the last one.
+		for (uint32 PassIndex : m_ExecutionOrder)
+		{
+			PassNode& Pass = m_Passes[PassIndex];
+			for (RenderGraphBarrier& Barrier : Pass.Barriers)
+			{
+				if (Barrier.Before.Layout != VK_IMAGE_LAYOUT_UNDEFINED)
+				{
+					continue;
+				}
+
+				const TextureNode& Tex = m_Textures[Barrier.Texture];
+				for (const TextureNode& Other : m_Textures)
+				{
+					if (&Other == &Tex || Other.Heap != Tex.Heap || Other.Image == VK_NULL_HANDLE)
+					{
+						continue;
+					}
+
+					if (Other.Offset < Tex.Offset + Tex.Size && Tex.Offset < Other.Offset + Other.Size)
+					{
+						Barrier.Before.Stages |= Other.FinalState.Stages;
+						Barrier.Before.Access |= Other.FinalState.Access & WriteAccess;
+					}
+				}
+			}
+			UpdatePassStages(Pass);
+		}
+	}
+
+	void RenderGraph::CreateRenderPass(PassNode& t_Pass)
+	{
+		std::vector<VkAttachmentDescription> Descriptions;
+		std::vector<VkAttachmentReference> ColorRefs;
+		VkAttachmentReference DepthRef = {};
+		bool bHasDepth = false;
+
+		const uint32 Order = static_cast<uint32>(std::find(m_ExecutionOrder.begin(), m_ExecutionOrder.end(),
+			static_cast<uint32>(&t_Pass - m_Passes.data())) - m_ExecutionOrder.begin());
+
+		for (RenderGraphTexture TexIndex : t_Pass.Attachments)
+		{
+			const TextureNode& Tex = m_Textures[TexIndex];
+			const TextureAccess& Access = *std::find_if(t_Pass.Accesses.begin(), t_Pass.Accesses.end(),
+				[&](const TextureAccess& A) { return A.Texture == TexIndex; });
+
+			const RenderGraphState State = GetUsageState(Access.Usage, Access.bWrite, Access.Load, Tex.Desc.Format);
+
+			// Nothing reads this after the pass, so the tile memory never has to be written out
+			const bool bStore = Tex.bExported || Tex.LastPass > Order;
+
+			VkAttachmentDescription Desc = {};
+			Desc.format = Tex.Desc.Format;
+			Desc.samples = VK_SAMPLE_COUNT_1_BIT;
+			Desc.loadOp = Access.bWrite ? GetLoadOp(Access.Load) : VK_ATTACHMENT_LOAD_OP_LOAD;
+			Desc.storeOp = bStore ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			Desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			Desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			// The graph does every layout transition with its own barriers
+			Desc.initialLayout = State.Layout;
+			Desc.finalLayout = State.Layout;
+
+			VkAttachmentReference Ref = { static_cast<uint32>(Descriptions.size()), State.Layout };
+			if (Access.Usage == RenderGraphUsage::ColorAttachment)
+			{
+				ColorRefs.emplace_back(Ref);
+			}
+			else
+			{
+				assert(!bHasDepth && "A pass can only have one depth attachment");
+				DepthRef = Ref;
+				bHasDepth = true;
+			}
+			Descriptions.emplace_back(Desc);
+		}
+
+		VkSubpassDescription Subpass = {};
+		Subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		Subpass.colorAttachmentCount = static_cast<uint32>(ColorRefs.size());
+		Subpass.pColorAttachments = ColorRefs.data();
+		Subpass.pDepthStencilAttachment = bHasDepth ? &DepthRef : nullptr;
+
+		VkRenderPassCreateInfo RenderPassInfo = {};
+		RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		RenderPassInfo.attachmentCount = static_cast<uint32>(Descriptions.size());
+		RenderPassInfo.pAttachments = Descriptions.data();
+		RenderPassInfo.subpassCount = 1;
+		RenderPassInfo.pSubpasses = &Subpass;
+
+		VK_CHECK_RESULT(vkCreateRenderPass(m_Device->GetVkDevice(), &RenderPassInfo, nullptr, &t_Pass.RenderPass));
+	}
+
+	void RenderGraph::Resize(VkExtent2D t_Extent)
+	{
+		Release();
+		Realize(t_Extent);
+	}
+
+	VkExtent2D RenderGraph::GetRenderArea() const
+	{
+		if (m_RenderArea.width == 0 || m_RenderArea.height == 0)
+		{
+			return m_Extent;
+		}
+
+		VkExtent2D Area = {};
+		Area.width = std::min(m_RenderArea.width, m_Extent.width);
+		Area.height = std::min(m_RenderArea.height, m_Extent.height);
+		return Area;
+	}
+
+	void RenderGraph::Execute(const RenderGraphContext& t_Context)
+	{
+		assert(!m_Heaps.empty() || m_ExecutionOrder.empty());
+
+		VkCommandBuffer Cmd = t_Context.CmdBuf.GetHandle();
+		for (uint32 PassIndex : m_ExecutionOrder)
+		{
+			PassNode& Pass = m_Passes[PassIndex];
+			RecordBarriers(Cmd, Pass.Barriers, Pass.SrcStages, Pass.DstStages);
+
+			if (Pass.RenderPass != VK_NULL_HANDLE)
+			{
+				t_Context.CmdBuf.BeginRenderPass(Pass.RenderPass, Pass.FrameBuffer, Pass.bExtentSized ? GetRenderArea() : Pass.Extent, Pass.ClearValues);
+			}
+
+			if (Pass.Execute)
+			{
+				Pass.Execute(t_Context);
+			}
+
+			if (Pass.RenderPass != VK_NULL_HANDLE)
+			{
+				t_Context.CmdBuf.EndRenderPass();
+			}
+		}
+
+		RecordBarriers(Cmd, m_ExportBarriers, m_ExportSrcStages, m_ExportDstStages);
+	}
+
+	void RenderGraph::RecordBarriers(VkCommandBuffer t_Cmd, const std::vector<RenderGraphBarrier>& t_Barriers, VkPipelineStageFlags t_Src, VkPipelineStageFlags t_Dst)
+	{
+		if (t_Barriers.empty())
+		{
+			return;
+		}
+
+		m_ImageBarriers.clear();
+		for (const RenderGraphBarrier& Barrier : t_Barriers)
+		{
+			VkImageMemoryBarrier ImageBarrier = {};
+			ImageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			ImageBarrier.srcAccessMask = Barrier.Before.Access & WriteAccess;
+			ImageBarrier.dstAccessMask = Barrier.After.Access;
+			ImageBarrier.oldLayout = Barrier.Before.Layout;
+			ImageBarrier.newLayout = Barrier.After.Layout;
+			ImageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			ImageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			ImageBarrier.image = m_Textures[Barrier.Texture].Image;
+			ImageBarrier.subresourceRange.aspectMask = GetAspectMask(Barrier.Texture);
+			ImageBarrier.subresourceRange.levelCount = 1;
+			ImageBarrier.subresourceRange.layerCount = 1;
+			m_ImageBarriers.emplace_back(ImageBarrier);
+		}
+
+		vkCmdPipelineBarrier(
+			t_Cmd,
+			t_Src ? t_Src : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			t_Dst ? t_Dst : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			static_cast<uint32>(m_ImageBarriers.size()), m_ImageBarriers.data()
+		);
+	}
+
+	VkImageAspectFlags RenderGraph::GetAspectMask(RenderGraphTexture t_Tex) const
+	{
+		VkFormat Format = m_Textures[t_Tex].Desc.Format;
+		if (!IsDepthFormat(Format))
+		{
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+		return GraphicsHelpers::HasStencilComponent(Format) ? (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT) : VK_IMAGE_ASPECT_DEPTH_BIT;
+	}
+
+	void RenderGraph::Release()
+	{
+		if (!m_Device)
+		{
+			return;
+		}
+
+		VkDevice Device = m_Device->GetVkDevice();
+		for (PassNode& Pass : m_Passes)
+		{
+			if (Pass.FrameBuffer != VK_NULL_HANDLE)
+			{
+				vkDestroyFramebuffer(Device, Pass.FrameBuffer, nullptr);
+				Pass.FrameBuffer = VK_NULL_HANDLE;
+			}
+		}
+
+		for (TextureNode& Tex : m_Textures)
+		{
+			if (Tex.View != VK_NULL_HANDLE)
+			{
+				vkDestroyImageView(Device, Tex.View, nullptr);
+				Tex.View = VK_NULL_HANDLE;
+			}
+			if (Tex.Image != VK_NULL_HANDLE)
+			{
+				vkDestroyImage(Device, Tex.Image, nullptr);
+				Tex.Image = VK_NULL_HANDLE;
+			}
+			Tex.Heap = InvalidIndex;
+		}
+
+		for (VkDeviceMemory Heap : m_Heaps)
+		{
+			vkFreeMemory(Device, Heap, nullptr);
+		}
+		m_Heaps.clear();
+	}
+}   // namespace Fling
@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "RenderHandoff.h"
+
+namespace Fling
+{
+	uint32 RenderHandoff::BeginWrite()
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		m_SlotChanged.wait(Lock, [this]() { return m_Slots[m_NextWrite] == SlotState::Free; });
+
+		const uint32 Slot = m_NextWrite;
+		m_Slots[Slot] = SlotState::Writing;
+		m_NextWrite = (m_NextWrite + 1) % SlotCount;
+		return Slot;
+	}
+
+	void RenderHandoff::Submit(uint32 t_Slot)
+	{
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			assert(t_Slot < SlotCount && m_Slots[t_Slot] == SlotState::Writing);
+			m_Slots[t_Slot] = SlotState::Submitted;
+		}
+		m_SlotChanged.notify_all();
+	}
+
+	bool RenderHandoff::BeginRead(uint32& t_OutSlot)
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		m_SlotChanged.wait(Lock, [this]() { return m_Slots[m_NextRead] == SlotState::Submitted || m_Stopped; });
+
+		if (m_Slots[m_NextRead] != SlotState::Submitted)
+		{
+			return false;
+		}
+
+		t_OutSlot = m_NextRead;
+		m_Slots[t_OutSlot] = SlotState::Reading;
+		m_NextRead = (m_NextRead + 1) % SlotCount;
+		return true;
+	}
+
+	void RenderHandoff::EndRead(uint32 t_Slot)
+	{
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			assert(t_Slot < SlotCount && m_Slots[t_Slot] == SlotState::Reading);
+			m_Slots[t_Slot] = SlotState::Free;
+		}
+		m_SlotChanged.notify_all();
+	}
+
+	void RenderHandoff::WaitIdle()
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		m_SlotChanged.wait(Lock, [this]()
+		{
+			for (SlotState State : m_Slots)
+			{
+				if (State == SlotState::Submitted || State == SlotState::Reading)
+				{
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	void RenderHandoff::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			m_Stopped = true;
+		}
+		m_SlotChanged.notify_all();
+	}
+
+	uint32 RenderHandoff::GetPendingCount() const
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		uint32 Count = 0;
+		for (SlotState State : m_Slots)
+		{
+			if (State == SlotState::Submitted || State == SlotState::Reading)
+			{
+				++Count;
+			}
+		}
+		return Count;
+	}
+}   // namespace Fling
@@ -5,6 +5,8 @@
 #include "SwapChain.h"
 #include "FrameBuffer.h"
 #include "MeshRenderer.h"
+#include "GpuProfiler.h"
+#include "VulkanApp.h"
 
 namespace Fling
 {
@@ -38,18 +40,38 @@ namespace Fling
 		m_Subpasses.clear();
 	}
 
-	void RenderPipeline::Draw(CommandBuffer& t_CmdBuf, VkFramebuffer t_PresentFrameBuf, uint32 t_ActiveFrameInFlight, entt::registry& t_Reg, float DeltaTime)
+	void RenderPipeline::Extract(entt::registry& t_Reg, RenderSnapshot& t_Snapshot)
+	{
+		for (const auto& subpass : m_Subpasses)
+		{
+			subpass->Extract(t_Reg, t_Snapshot);
+		}
+	}
+
+	void RenderPipeline::PrepareDraw(CommandBuffer& t_CmdBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot)
+	{
+		for (const auto& subpass : m_Subpasses)
+		{
+			subpass->PrepareDraw(t_CmdBuf, t_ActiveFrameInFlight, t_Snapshot);
+		}
+	}
+
+	void RenderPipeline::Draw(CommandBuffer& t_CmdBuf, VkFramebuffer t_PresentFrameBuf, uint32 t_ActiveFrameInFlight, const RenderSnapshot& t_Snapshot)
 	{
 		assert(!m_Subpasses.empty() && "Render pipeline should contain at least one sub-pass");
 
+		GpuProfiler* Profiler = VulkanApp::Get().GetGpuProfiler();
+
 		for (size_t i = 0; i < m_Subpasses.size(); ++i)
 		{
+			const char* ProfileName = m_Subpasses[i]->GetProfileName();
+			GpuProfiler::Scope Scope(ProfileName ? Profiler : nullptr, t_CmdBuf, ProfileName);
+
 			// Build the subpasses for the active frame in flight	
 			m_Subpasses[i]->Draw(
 				t_CmdBuf, 
 				t_ActiveFrameInFlight, 
-				t_Reg,
-				DeltaTime
+				t_Snapshot
 			);
 		}
 	}
@@ -89,7 +111,8 @@ namespace Fling
 	void RenderPipeline::CreateDescriptors(entt::registry& t_Reg)
 	{
 		// Create the descriptor pool for us to use -------
-		const uint32 SwapImageCount = static_cast<uint32>(m_SwapChain->GetImageCount());
+		// Subpasses allocate their per frame sets from here, one for each frame in flight
+		const uint32 MaxSets = static_cast<uint32>(VkConfig::MAX_FRAMES_IN_FLIGHT * m_Subpasses.size());
 		uint32 DescriptorCount = 1024;
 
 		std::vector<VkDescriptorPoolSize> poolSizes =
@@ -98,14 +121,15 @@ namespace Fling
 			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, DescriptorCount),
 			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_SAMPLER, DescriptorCount),
 			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, DescriptorCount),
-			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DescriptorCount)
+			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DescriptorCount),
+			Initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, DescriptorCount)
 		};
 
 		VkDescriptorPoolCreateInfo poolInfo = {};
 		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		poolInfo.poolSizeCount = static_cast<uint32>(poolSizes.size());
 		poolInfo.pPoolSizes = poolSizes.data();
-		poolInfo.maxSets = SwapImageCount;
+		poolInfo.maxSets = MaxSets;
 
 		VK_CHECK_RESULT(vkCreateDescriptorPool(m_Device->GetVkDevice(), &poolInfo, nullptr, &m_DescriptorPool));
 
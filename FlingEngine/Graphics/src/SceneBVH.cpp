@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "SceneBVH.h"
+#include "Components/Transform.h"
+#include "MeshRenderer.h"
+
+namespace Fling
+{
+	namespace
+	{
+		/** Rebuild the tree once this many leaves have been (re)inserted since the last rebuild */
+		constexpr uint32 MinRebuildInsertCount = 64;
+
+		FORCEINLINE uint32 EntityToUserData(entt::entity t_Ent) { return static_cast<uint32>(t_Ent); }
+		FORCEINLINE entt::entity UserDataToEntity(uint32 t_Data) { return static_cast<entt::entity>(t_Data); }
+	}
+
+	SceneBVH::SceneBVH(entt::registry& t_Reg)
+	{
+		t_Reg.on_construct<MeshRenderer>().connect<&SceneBVH::OnMeshRendererAdded>(*this);
+		t_Reg.on_construct<Transform>().connect<&SceneBVH::OnTransformAdded>(*this);
+		t_Reg.on_replace<MeshRenderer>().connect<&SceneBVH::OnMeshRendererReplaced>(*this);
+		t_Reg.on_replace<Transform>().connect<&SceneBVH::OnTransformReplaced>(*this);
+		t_Reg.on_destroy<MeshRenderer>().connect<&SceneBVH::OnComponentRemoved>(*this);
+		t_Reg.on_destroy<Transform>().connect<&SceneBVH::OnComponentRemoved>(*this);
+		t_Reg.on_destroy<SpatialProxy>().connect<&SceneBVH::OnProxyRemoved>(*this);
+
+		// Pick up anything that was created before we started listening
+		auto ExistingView = t_Reg.view<Transform, MeshRenderer>();
+		for (entt::entity Ent : ExistingView)
+		{
+			TryAddProxy(Ent, t_Reg);
+		}
+	}
+
+	void SceneBVH::Shutdown(entt::registry& t_Reg)
+	{
+		t_Reg.on_construct<MeshRenderer>().disconnect<&SceneBVH::OnMeshRendererAdded>(*this);
+		t_Reg.on_construct<Transform>().disconnect<&SceneBVH::OnTransformAdded>(*this);
+		t_Reg.on_replace<MeshRenderer>().disconnect<&SceneBVH::OnMeshRendererReplaced>(*this);
+		t_Reg.on_replace<Transform>().disconnect<&SceneBVH::OnTransformReplaced>(*this);
+		t_Reg.on_destroy<MeshRenderer>().disconnect<&SceneBVH::OnComponentRemoved>(*this);
+		t_Reg.on_destroy<Transform>().disconnect<&SceneBVH::OnComponentRemoved>(*this);
+		t_Reg.on_destroy<SpatialProxy>().disconnect<&SceneBVH::OnProxyRemoved>(*this);
+
+		t_Reg.reset<SpatialProxy>();
+		m_Tree.Clear();
+	}
+
+	void SceneBVH::Update(entt::registry& t_Reg)
+	{
+		// Only the entities that actually moved need to touch the tree
+		Transform::UpdateDirtyWorldMatrices(t_Reg, m_ChangedEntities);
+		m_ChangedEntities.insert(m_ChangedEntities.end(), m_PendingRefits.begin(), m_PendingRefits.end());
+		m_PendingRefits.clear();
+
+		for (entt::entity Ent : m_ChangedEntities)
+		{
+			if (!t_Reg.valid(Ent) || !t_Reg.has<SpatialProxy>(Ent))
+			{
+				continue;
+			}
+
+			SpatialProxy& Proxy = t_Reg.get<SpatialProxy>(Ent);
+			RefreshBounds(t_Reg.get<Transform>(Ent), t_Reg.get<MeshRenderer>(Ent), Proxy);
+			m_Tree.MoveProxy(Proxy.m_ProxyId, Proxy.m_WorldBounds);
+		}
+
+		// Incremental inserts slowly make the tree worse, so every once in a while build it from scratch
+		const uint32 RebuildThreshold = glm::max(MinRebuildInsertCount, m_Tree.GetProxyCount() / 4);
+		if (m_Tree.GetReinsertCount() > RebuildThreshold)
+		{
+			m_Tree.Rebuild();
+		}
+	}
+
+	void SceneBVH::QueryFrustum(const Frustum& t_Frustum, std::vector<entt::entity>& t_OutInside, std::vector<entt::entity>& t_OutIntersecting) const
+	{
+		m_Tree.QueryFrustum(t_Frustum, m_ScratchInside, m_ScratchIntersecting);
+
+		t_OutInside.clear();
+		t_OutInside.reserve(m_ScratchInside.size());
+		for (uint32 Data : m_ScratchInside)
+		{
+			t_OutInside.emplace_back(UserDataToEntity(Data));
+		}
+
+		t_OutIntersecting.clear();
+		t_OutIntersecting.reserve(m_ScratchIntersecting.size());
+		for (uint32 Data : m_ScratchIntersecting)
+		{
+			t_OutIntersecting.emplace_back(UserDataToEntity(Data));
+		}
+	}
+
+	void SceneBVH::QueryAABB(const AABB& t_Box, std::vector<entt::entity>& t_OutEntities) const
+	{
+		m_Tree.QueryAABB(t_Box, m_ScratchInside);
+
+		t_OutEntities.clear();
+		t_OutEntities.reserve(m_ScratchInside.size());
+		for (uint32 Data : m_ScratchInside)
+		{
+			t_OutEntities.emplace_back(UserDataToEntity(Data));
+		}
+	}
+
+	void SceneBVH::OnMeshRendererAdded(entt::entity t_Ent, entt::registry& t_Reg, MeshRenderer& t_MeshRend)
+	{
+		TryAddProxy(t_Ent, t_Reg);
+	}
+
+	void SceneBVH::OnTransformAdded(entt::entity t_Ent, entt::registry& t_Reg, Transform& t_Trans)
+	{
+		TryAddProxy(t_Ent, t_Reg);
+	}
+
+	void SceneBVH::OnMeshRendererReplaced(entt::entity t_Ent, entt::registry& t_Reg, MeshRenderer& t_MeshRend)
+	{
+		MarkDirty(t_Ent, t_Reg);
+	}
+
+	void SceneBVH::OnTransformReplaced(entt::entity t_Ent, entt::registry& t_Reg, Transform& t_Trans)
+	{
+		MarkDirty(t_Ent, t_Reg);
+	}
+
+	void SceneBVH::OnComponentRemoved(entt::entity t_Ent, entt::registry& t_Reg)
+	{
+		if (t_Reg.has<SpatialProxy>(t_Ent))
+		{
+			t_Reg.remove<SpatialProxy>(t_Ent);
+		}
+	}
+
+	void SceneBVH::OnProxyRemoved(entt::entity t_Ent, entt::registry& t_Reg)
+	{
+		SpatialProxy& Proxy = t_Reg.get<SpatialProxy>(t_Ent);
+		if (Proxy.m_ProxyId != DynamicBVH::NullNode)
+		{
+			m_Tree.DestroyProxy(Proxy.m_ProxyId);
+			Proxy.m_ProxyId = DynamicBVH::NullNode;
+		}
+	}
+
+	void SceneBVH::TryAddProxy(entt::entity t_Ent, entt::registry& t_Reg)
+	{
+		if (!t_Reg.has<Transform>(t_Ent) || !t_Reg.has<MeshRenderer>(t_Ent) || t_Reg.has<SpatialProxy>(t_Ent))
+		{
+			return;
+		}
+
+		// The transform may still be dirty here, so make sure that the bounds start out correct
+		Transform& Trans = t_Reg.get<Transform>(t_Ent);
+		Transform::CalculateWorldMatrix(Trans);
+
+		SpatialProxy& Proxy = t_Reg.assign<SpatialProxy>(t_Ent);
+		RefreshBounds(Trans, t_Reg.get<MeshRenderer>(t_Ent), Proxy);
+		Proxy.m_ProxyId = m_Tree.CreateProxy(Proxy.m_WorldBounds, EntityToUserData(t_Ent));
+	}
+
+	void SceneBVH::MarkDirty(entt::entity t_Ent, entt::registry& t_Reg)
+	{
+		if (!t_Reg.has<SpatialProxy>(t_Ent))
+		{
+			return;
+		}
+
+		SpatialProxy& Proxy = t_Reg.get<SpatialProxy>(t_Ent);
+		if (!Proxy.m_Dirty)
+		{
+			Proxy.m_Dirty = true;
+			m_PendingRefits.emplace_back(t_Ent);
+		}
+	}
+
+	void SceneBVH::RefreshBounds(const Transform& t_Trans, const MeshRenderer& t_MeshRend, SpatialProxy& t_Proxy)
+	{
+		if (t_MeshRend.m_Model)
+		{
+			t_Proxy.m_WorldBounds = t_MeshRend.m_Model->GetBoundingBox().Transformed(t_Trans.GetWorldMat());
+		}
+		else
+		{
+			// Nothing to draw yet, so just track the position
+			t_Proxy.m_WorldBounds = AABB();
+			t_Proxy.m_WorldBounds.Expand(t_Trans.GetPos());
+		}
+
+		t_Proxy.m_Dirty = false;
+	}
+}   // namespace Fling
@@ -13,6 +13,10 @@ namespace Fling
 		uint32_t storageClass{};
 		uint32_t binding{};
 		uint32_t set{};
+		/** SPIR-V 1.0 marks storage buffers as Uniform structs decorated with BufferBlock */
+		bool bufferBlock = false;
+		/** Dimensionality of an image type. Input attachments are SpvDimSubpassData */
+		uint32_t dim{};
 	};
 
     std::shared_ptr<Fling::Shader> Shader::Create(Guid t_ID, LogicalDevice* t_Dev)
@@ -154,6 +158,9 @@ namespace Fling
 					assert(wordCount == 4);
 					ids[id].binding = insn[3];
 					break;
+				case SpvDecorationBufferBlock:
+					ids[id].bufferBlock = true;
+					break;
 				}
 			} break;
 			case SpvOpTypeStruct:
@@ -168,6 +175,12 @@ namespace Fling
 
 				assert(ids[id].opcode == 0);
 				ids[id].opcode = opcode;
+
+				if (opcode == SpvOpTypeImage)
+				{
+					assert(wordCount >= 4);
+					ids[id].dim = insn[3];
+				}
 			} break;
 			case SpvOpTypePointer:
 			{
@@ -204,24 +217,33 @@ namespace Fling
 		{
 			if (id.opcode == SpvOpVariable && (id.storageClass == SpvStorageClassUniform || id.storageClass == SpvStorageClassUniformConstant || id.storageClass == SpvStorageClassStorageBuffer))
 			{
-				assert(id.set == 0);
+				// Other sets are shared between pipelines and given to the pipeline layout by their owner
+				if (id.set != 0)
+				{
+					continue;
+				}
+
 				assert(id.binding < 32);
 				assert(ids[id.typeId].opcode == SpvOpTypePointer);
 
 				assert((m_ResourceMask & (1 << id.binding)) == 0);
 
-				uint32_t typeKind = ids[ids[id.typeId].typeId].opcode;
+				const Id& type = ids[ids[id.typeId].typeId];
+				uint32_t typeKind = type.opcode;
 
 				switch (typeKind)
 				{
 				case SpvOpTypeStruct:
-					//m_ResourceTypes[id.binding] = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-					m_ResourceTypes[id.binding] = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+					m_ResourceTypes[id.binding] = (id.storageClass == SpvStorageClassStorageBuffer || type.bufferBlock) ?
+						VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : 
+						VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 
 					m_ResourceMask |= 1 << id.binding;
 					break;
 				case SpvOpTypeImage:
-					m_ResourceTypes[id.binding] = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+					m_ResourceTypes[id.binding] = (type.dim == SpvDimSubpassData) ?
+						VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT :
+						VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
 					m_ResourceMask |= 1 << id.binding;
 					break;
 				case SpvOpTypeSampler:
@@ -323,11 +345,14 @@ namespace Fling
 		return setLayout;
 	}
 
-	VkPipelineLayout Shader::CreatePipelineLayout(VkDevice t_Dev, VkDescriptorSetLayout t_SetLayout, VkShaderStageFlags t_PushConstantStages, size_t t_PushConstantSize)
+	VkPipelineLayout Shader::CreatePipelineLayout(VkDevice t_Dev, VkDescriptorSetLayout t_SetLayout, VkShaderStageFlags t_PushConstantStages, size_t t_PushConstantSize, const std::vector<VkDescriptorSetLayout>& t_ExtraSetLayouts)
 	{
+		std::vector<VkDescriptorSetLayout> setLayouts = { t_SetLayout };
+		setLayouts.insert(setLayouts.end(), t_ExtraSetLayouts.begin(), t_ExtraSetLayouts.end());
+
 		VkPipelineLayoutCreateInfo createInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
-		createInfo.setLayoutCount = 1;
-		createInfo.pSetLayouts = &t_SetLayout;
+		createInfo.setLayoutCount = static_cast<uint32>(setLayouts.size());
+		createInfo.pSetLayouts = setLayouts.data();
 
 		VkPushConstantRange pushConstantRange = {};
 
@@ -3,6 +3,7 @@
 #include "LogicalDevice.h"
 #include "PhyscialDevice.h"
 #include "FlingWindow.h"
+#include "GraphicsHelpers.h"
 
 namespace Fling
 {
@@ -12,7 +13,7 @@ namespace Fling
 		, m_PhysicalDevice(t_PhysDev)
 		, m_Surface(t_Surface)
 	{
-		assert(m_Device && m_PhysicalDevice && m_Surface);
+		assert(m_Device && m_PhysicalDevice);
 		Recreate(m_Extents);
 	}
 
@@ -29,7 +30,14 @@ namespace Fling
 			m_Extents = { t_Extent };
 		}
 
-		CreateResources();
+		if (IsHeadless())
+		{
+			CreateHeadlessResources();
+		}
+		else
+		{
+			CreateResources();
+		}
 		CreateImageViews();
 	}
 	
@@ -50,7 +58,17 @@ namespace Fling
 		if (m_SwapChain != VK_NULL_HANDLE)
 		{
 			vkDestroySwapchainKHR(Device, m_SwapChain, nullptr);
+			m_SwapChain = VK_NULL_HANDLE;
+		}
+
+		// Headless images are ours to destroy
+		for (size_t i = 0; i < m_HeadlessMemory.size(); ++i)
+		{
+			vkDestroyImage(Device, m_Images[i], nullptr);
+			vkFreeMemory(Device, m_HeadlessMemory[i], nullptr);
 		}
+		m_HeadlessMemory.clear();
+		m_ImageViews.clear();
 	}
 
 	SwapChainSupportDetails Swapchain::QuerySwapChainSupport()
@@ -151,6 +169,34 @@ namespace Fling
 		vkGetSwapchainImagesKHR(m_Device->GetVkDevice(), m_SwapChain, &ImageCount, m_Images.data());
 	}
 
+	void Swapchain::CreateHeadlessResources()
+	{
+		assert(m_Device);
+
+		// Nothing waits on a present, so one image per frame in flight is always free once its fence is
+		m_ImageFormat = HeadlessFormat;
+		m_PresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+		m_Images.resize(VkConfig::MAX_FRAMES_IN_FLIGHT);
+		m_HeadlessMemory.resize(VkConfig::MAX_FRAMES_IN_FLIGHT);
+
+		for (size_t i = 0; i < m_Images.size(); ++i)
+		{
+			GraphicsHelpers::CreateVkImage(
+				m_Device->GetVkDevice(),
+				m_Extents.width,
+				m_Extents.height,
+				m_ImageFormat,
+				VK_IMAGE_TILING_OPTIMAL,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				m_Images[i],
+				m_HeadlessMemory[i]
+			);
+		}
+
+		m_ActiveImageIndex = 0;
+	}
+
 	void Swapchain::CreateImageViews()
 	{
 		assert(m_Device);
@@ -220,6 +266,13 @@ namespace Fling
 	{
 		assert(m_Device);
 
+		// Images are used in the same order as frames in flight, so they are never still being rendered to
+		if (IsHeadless())
+		{
+			m_ActiveImageIndex = (m_ActiveImageIndex + 1) % static_cast<uint32>(m_Images.size());
+			return VK_SUCCESS;
+		}
+
 		VkDevice Device = m_Device->GetVkDevice();
 		VkResult iRes = vkAcquireNextImageKHR(
 			Device, 
@@ -234,6 +287,11 @@ namespace Fling
 
 	VkResult Swapchain::QueuePresent(const VkQueue& t_PresentQueue, const VkSemaphore& t_WaitSemaphore)
 	{
+		if (IsHeadless())
+		{
+			return VK_SUCCESS;
+		}
+
 		VkPresentInfoKHR presentInfo = {};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "TextureSlots.h"
+
+namespace Fling
+{
+	TextureSlotAllocator::TextureSlotAllocator(uint32 t_Capacity, uint32 t_RetireFrames)
+		: m_Capacity(t_Capacity)
+		, m_RetireFrames(t_RetireFrames)
+	{
+	}
+
+	uint32 TextureSlotAllocator::Acquire(Texture* t_Tex, bool& t_OutIsNew)
+	{
+		assert(t_Tex);
+		t_OutIsNew = false;
+
+		// Textures that are still waiting to retire keep their slot and its contents
+		auto It = m_Entries.find(t_Tex);
+		if (It != m_Entries.end())
+		{
+			++It->second.RefCount;
+			return It->second.Slot;
+		}
+
+		uint32 Slot = InvalidSlot;
+		if (!m_FreeSlots.empty())
+		{
+			Slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+		}
+		else if (m_NextSlot < m_Capacity)
+		{
+			Slot = m_NextSlot++;
+		}
+		else
+		{
+			return InvalidSlot;
+		}
+
+		Entry& NewEntry = m_Entries[t_Tex];
+		NewEntry.Slot = Slot;
+		NewEntry.RefCount = 1;
+		t_OutIsNew = true;
+		return Slot;
+	}
+
+	void TextureSlotAllocator::Release(Texture* t_Tex)
+	{
+		auto It = m_Entries.find(t_Tex);
+		if (It == m_Entries.end() || It->second.RefCount == 0)
+		{
+			assert(!"Releasing a texture that was never acquired");
+			return;
+		}
+
+		if (--It->second.RefCount == 0)
+		{
+			It->second.ReleaseFrame = m_Frame;
+			m_Retired.push_back({ t_Tex, m_Frame });
+		}
+	}
+
+	void TextureSlotAllocator::NextFrame()
+	{
+		++m_Frame;
+
+		size_t Count = 0;
+		for (; Count < m_Retired.size(); ++Count)
+		{
+			const RetiredSlot& Retired = m_Retired[Count];
+			if (Retired.ReleaseFrame + m_RetireFrames > m_Frame)
+			{
+				// Released in order, so everything after this is newer
+				break;
+			}
+
+			// Skip textures that were acquired again, or released again after this
+			auto It = m_Entries.find(Retired.Tex);
+			if (It != m_Entries.end() && It->second.RefCount == 0 && It->second.ReleaseFrame == Retired.ReleaseFrame)
+			{
+				m_FreeSlots.emplace_back(It->second.Slot);
+				m_Entries.erase(It);
+			}
+		}
+
+		m_Retired.erase(m_Retired.begin(), m_Retired.begin() + Count);
+	}
+
+	uint32 TextureSlotAllocator::GetSlot(const Texture* t_Tex) const
+	{
+		auto It = m_Entries.find(t_Tex);
+		return It != m_Entries.end() ? It->second.Slot : InvalidSlot;
+	}
+}   // namespace Fling
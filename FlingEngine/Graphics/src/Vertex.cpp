@@ -0,0 +1,147 @@
+#include "pch.h"
+#include "Vertex.h"
+#include "BoundingVolume.h"
+#include "GBufferPacking.h"
+
+#include <glm/gtc/packing.hpp>
+
+namespace Fling
+{
+	VkVertexInputBindingDescription Vertex::GetBindingDescription(VertexFormat t_Format)
+	{
+		VkVertexInputBindingDescription bindingDescription = {};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = t_Format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> Vertex::GetAttributeDescriptions(VertexFormat t_Format)
+	{
+		if (t_Format == VertexFormat::Full)
+		{
+			const std::array<VkVertexInputAttributeDescription, 5> Full = GetFullAttributeDescriptions();
+			return std::vector<VkVertexInputAttributeDescription>(Full.begin(), Full.end());
+		}
+
+		// Same locations as the full vertex, without the color at 1
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(4);
+
+		attributeDescriptions[0].binding = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+		attributeDescriptions[0].offset = offsetof(CompactVertex, Pos);
+
+		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].location = 2;
+		attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+		attributeDescriptions[1].offset = offsetof(CompactVertex, Tangent);
+
+		attributeDescriptions[2].binding = 0;
+		attributeDescriptions[2].location = 3;
+		attributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+		attributeDescriptions[2].offset = offsetof(CompactVertex, Normal);
+
+		attributeDescriptions[3].binding = 0;
+		attributeDescriptions[3].location = 4;
+		attributeDescriptions[3].format = VK_FORMAT_R16G16_SFLOAT;
+		attributeDescriptions[3].offset = offsetof(CompactVertex, TexCoord);
+
+		return attributeDescriptions;
+	}
+
+	VkVertexInputBindingDescription Vertex::GetPositionBindingDescription(VertexFormat t_Format)
+	{
+		VkVertexInputBindingDescription bindingDescription = {};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = GetPositionStride(t_Format);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	VkVertexInputAttributeDescription Vertex::GetPositionAttributeDescription(VertexFormat t_Format)
+	{
+		VkVertexInputAttributeDescription attributeDescription = {};
+		attributeDescription.binding = 0;
+		attributeDescription.location = 0;
+		attributeDescription.format = t_Format == VertexFormat::Compact ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDescription.offset = 0;
+
+		return attributeDescription;
+	}
+
+	uint32 Vertex::GetPositionStride(VertexFormat t_Format)
+	{
+		return t_Format == VertexFormat::Compact ? sizeof(CompactVertex::Pos) : sizeof(glm::vec3);
+	}
+
+	CompactVertex CompactVertex::Pack(const Vertex& t_Vert, const AABB& t_Bounds)
+	{
+		CompactVertex Result = {};
+
+		// The shader decodes with the center and extents, so quantize with the same values.
+		// A flat axis decodes to the center no matter what is stored
+		const glm::vec3 Center = t_Bounds.GetCenter();
+		const glm::vec3 Extents = t_Bounds.GetExtents();
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			const float Unit = Extents[i] > 0.0f ? (t_Vert.Pos[i] - Center[i]) / (2.0f * Extents[i]) + 0.5f : 0.5f;
+			Result.Pos[i] = glm::packUnorm1x16(Unit);
+		}
+
+		const glm::vec2 Tangent = OctEncode(t_Vert.Tangent);
+		const glm::vec2 Normal = OctEncode(t_Vert.Normal);
+		for (uint32 i = 0; i < 2; ++i)
+		{
+			Result.Tangent[i] = static_cast<int16>(glm::packSnorm1x16(Tangent[i]));
+			Result.Normal[i] = static_cast<int16>(glm::packSnorm1x16(Normal[i]));
+			Result.TexCoord[i] = glm::packHalf1x16(t_Vert.TexCoord[i]);
+		}
+
+		return Result;
+	}
+
+	Vertex CompactVertex::Unpack(const CompactVertex& t_Vert, const AABB& t_Bounds)
+	{
+		Vertex Result = {};
+
+		const glm::vec3 Center = t_Bounds.GetCenter();
+		const glm::vec3 Extents = t_Bounds.GetExtents();
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			Result.Pos[i] = Center[i] + (glm::unpackUnorm1x16(t_Vert.Pos[i]) * 2.0f - 1.0f) * Extents[i];
+		}
+
+		glm::vec2 Tangent;
+		glm::vec2 Normal;
+		for (uint32 i = 0; i < 2; ++i)
+		{
+			Tangent[i] = glm::unpackSnorm1x16(static_cast<uint16>(t_Vert.Tangent[i]));
+			Normal[i] = glm::unpackSnorm1x16(static_cast<uint16>(t_Vert.Normal[i]));
+			Result.TexCoord[i] = glm::unpackHalf1x16(t_Vert.TexCoord[i]);
+		}
+
+		Result.Tangent = OctDecode(Tangent);
+		Result.Normal = OctDecode(Normal);
+		Result.Color = glm::vec3(1.0f);
+		return Result;
+	}
+
+	glm::vec2 CompactVertex::OctEncode(const glm::vec3& t_Dir)
+	{
+		const float Length = glm::abs(t_Dir.x) + glm::abs(t_Dir.y) + glm::abs(t_Dir.z);
+		if (Length <= 0.0f)
+		{
+			return glm::vec2(0.0f);
+		}
+
+		return GBufferPacking::EncodeNormal(t_Dir);
+	}
+
+	glm::vec3 CompactVertex::OctDecode(const glm::vec2& t_Oct)
+	{
+		return GBufferPacking::DecodeNormal(t_Oct);
+	}
+}   // namespace Fling
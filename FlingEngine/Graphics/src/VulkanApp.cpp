@@ -3,8 +3,10 @@
 
 #include "GeometrySubpass.h"
 #include "OffscreenSubpass.h"
+#include "GpuCullingPass.h"
 #include "ImGuiSubpass.h"
 #include "DebugSubpass.h"
+#include "DebugDraw.h"
 
 #include "CommandBuffer.h"
 #include "Instance.h"
@@ -12,11 +14,19 @@
 #include "PhyscialDevice.h"
 #include "SwapChain.h"
 #include "FlingWindow.h"
+#include "HeadlessWindow.h"
 #include "FlingConfig.h"
 #include "FirstPersonCamera.h"
 #include "GraphicsHelpers.h"
 #include "DepthBuffer.h"
+#include "FrameBuffer.h"
 #include "BaseEditor.h"
+#include "PipelineCache.h"
+#include "FrameCapture.h"
+#include "GpuProfiler.h"
+#include "GeometryBuffer.h"
+#include "Model.h"
+#include "Stats.h"
 
 namespace Fling
 {
@@ -24,12 +34,29 @@ namespace Fling
 	{
 		Singleton<VulkanApp>::Init();
 
+		// Has to be known before the global render pass is built
+		m_SinglePassDeferred = (t_Conf & PipelineFlags::DEFERRED) && FlingConfig::GetBool("Graphics", "SinglePassDeferred", false);
+
 		Prepare();
 
 		// #TODO Build VMA allocator
 
 		BuildRenderPipelines(t_Conf, t_Reg, t_Editor);
 
+		// Started last, everything a frame uses has to exist before one can be handed off
+		if (FlingConfig::GetBool("Graphics", "RenderThread", false))
+		{
+			if (m_GpuDrivenRendering)
+			{
+				F_LOG_WARN("Graphics.RenderThread is ignored with GPU driven rendering, it has to read the registry while it records!");
+			}
+			else
+			{
+				m_RenderThread = std::thread(&VulkanApp::RenderThreadLoop, this);
+				F_LOG_TRACE("Rendering on a dedicated thread");
+			}
+		}
+
 		// Set the window icon for this application
 		if (m_CurrentWindow)
 		{
@@ -42,14 +69,17 @@ namespace Fling
 
 	void VulkanApp::Prepare()
 	{
+		m_Headless = FlingConfig::GetBool("Headless", "Enabled", false);
+
 		CreateGameWindow(
 			FlingConfig::GetInt("Engine", "WindowWidth", FLING_DEFAULT_WINDOW_WIDTH),
-			FlingConfig::GetInt("Engine", "WindowHeight", FLING_DEFAULT_WINDOW_WIDTH)
+			FlingConfig::GetInt("Engine", "WindowHeight", FLING_DEFAULT_WINDOW_HEIGHT)
 		);
 
-		m_Instance = new Instance();
+		m_Instance = new Instance(m_Headless);
 		assert(m_Instance);
 
+		// Headless windows leave this null, which makes the swap chain headless as well
 		m_CurrentWindow->CreateSurface(m_Instance->GetRawVkInstance(), &m_Surface);
 
 		m_PhysicalDevice = new PhysicalDevice(m_Instance);
@@ -58,10 +88,41 @@ namespace Fling
 		m_LogicalDevice = new LogicalDevice(m_Instance, m_PhysicalDevice, m_Surface);
 		assert(m_LogicalDevice);
 
+		// Subpasses get their pipelines from here, so it has to exist before any are built
+		int CompileThreads = FlingConfig::GetInt("Graphics", "PipelineCompileThreads", PipelineCache::DefaultWorkerCount);
+		m_PipelineCache = new PipelineCache(m_LogicalDevice, CompileThreads > 0 ? static_cast<uint32>(CompileThreads) : PipelineCache::DefaultWorkerCount);
+
 		m_SwapChain = new Swapchain(ChooseSwapExtent(), m_LogicalDevice, m_PhysicalDevice, m_Surface);
 		assert(m_SwapChain);
 
+		// Headless images never change size, so the capture doesn't have to be rebuilt on resize
+		if (m_SwapChain->IsHeadless())
+		{
+			m_FrameCapture = new FrameCapture(m_LogicalDevice, m_SwapChain->GetExtents(), m_SwapChain->GetImageFormat());
+			if (!m_FrameCapture->IsEnabled())
+			{
+				delete m_FrameCapture;
+				m_FrameCapture = nullptr;
+			}
+		}
+
 		GraphicsHelpers::CreateCommandPool(&m_CommandPool, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+		GraphicsHelpers::CreateCommandPool(&m_SingleTimeCommandPool, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+		// Models upload to this when they load, it only grows if a scene doesn't fit
+		const int VertexCapacity = FlingConfig::GetInt("Graphics", "GeometryVertexCapacity", 1 << 20);
+		const int IndexCapacity = FlingConfig::GetInt("Graphics", "GeometryIndexCapacity", 1 << 22);
+		m_GeometryBuffer = new GeometryBuffer(Model::GetVertexFormat(), static_cast<uint32>(std::max(VertexCapacity, 1)), static_cast<uint32>(std::max(IndexCapacity, 1)));
+
+		if (FlingConfig::GetBool("Graphics", "GpuProfiler", false))
+		{
+			m_GpuProfiler = new GpuProfiler(m_LogicalDevice, m_CommandPool);
+			if (!m_GpuProfiler->IsSupported())
+			{
+				delete m_GpuProfiler;
+				m_GpuProfiler = nullptr;
+			}
+		}
 
 		CreateFrameSyncResources();
 
@@ -75,7 +136,8 @@ namespace Fling
 
 	void VulkanApp::BuildSwapChainResources()
 	{
-		// Default clear values
+		// Default clear values, the single pass G-Buffer attachments clear to 0
+		m_SwapChainClearVals.assign(m_SinglePassDeferred ? 2 + GBufferColorCount : 2, VkClearValue {});
 		m_SwapChainClearVals[0].color = { 0.0f, 0.0f, 0.0f, 0.2F };
 		m_SwapChainClearVals[1].depthStencil = { 1.0f, ~0U };
 
@@ -83,8 +145,8 @@ namespace Fling
 		// This is a sanity check for when we are recreating the swap chain
 		assert(m_DrawCmdBuffers.size() == 0);
 
-		// Build command buffers (one for each swap chain image)
-		for (size_t i = 0; i < m_SwapChain->GetImageViewCount(); ++i)
+		// Build command buffers (one for each frame in flight)
+		for (int32 i = 0; i < VkConfig::MAX_FRAMES_IN_FLIGHT; ++i)
 		{
 			m_DrawCmdBuffers.emplace_back(new CommandBuffer(m_LogicalDevice, m_CommandPool));
 		}
@@ -93,7 +155,20 @@ namespace Fling
 		// The depth buffer can be not-null when we are recreating the swap chain
 		if(m_DepthBuffer == nullptr)
 		{
-			m_DepthBuffer = new DepthBuffer(m_LogicalDevice, VK_SAMPLE_COUNT_1_BIT, m_SwapChain->GetExtents());
+			if (m_SinglePassDeferred)
+			{
+				// The lighting subpass reads depth as an input attachment, it never leaves the render pass
+				m_DepthBuffer = new DepthBuffer(
+					m_LogicalDevice,
+					VK_SAMPLE_COUNT_1_BIT,
+					m_SwapChain->GetExtents(),
+					VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+					GetTransientMemoryProperties());
+			}
+			else
+			{
+				m_DepthBuffer = new DepthBuffer(m_LogicalDevice, VK_SAMPLE_COUNT_1_BIT, m_SwapChain->GetExtents());
+			}
 		}
 		else
 		{
@@ -101,7 +176,15 @@ namespace Fling
 		}
 		assert(m_DepthBuffer);
 
-		BuildGlobalRenderPass();
+		if (m_SinglePassDeferred)
+		{
+			BuildGBufferAttachments();
+			BuildSinglePassRenderPass();
+		}
+		else
+		{
+			BuildGlobalRenderPass();
+		}
 
 		BuildSwapChainFrameBuffer();
 	}	
@@ -118,7 +201,7 @@ namespace Fling
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		colorAttachment.finalLayout = m_SwapChain->GetPresentLayout();
 
 		VkAttachmentDescription depthAttachment = {};
 		depthAttachment.format = DepthBuffer::GetDepthBufferFormat();
@@ -163,7 +246,156 @@ namespace Fling
 		renderPassInfo.pDependencies = &dependency;
 
 		VK_CHECK_RESULT(vkCreateRenderPass(m_LogicalDevice->GetVkDevice(), &renderPassInfo, nullptr, &m_RenderPass));
+		m_PipelineCache->RegisterRenderPass(m_RenderPass, renderPassInfo);
+	}
+
+	void VulkanApp::BuildSinglePassRenderPass()
+	{
+		assert(m_SwapChain && m_DepthBuffer && m_GBufferAttachments.size() == GBufferColorCount);
+
+		// 0: Swap chain image, 1: depth, 2-4: G-Buffer normal, albedo, and material
+		std::array<VkAttachmentDescription, 2 + GBufferColorCount> attachments = {};
+
+		attachments[0].format = m_SwapChain->GetImageFormat();
+		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[0].finalLayout = m_SwapChain->GetPresentLayout();
+
+		// Nothing is stored, tiled GPUs never have to write the G-Buffer out to memory
+		attachments[1].format = m_DepthBuffer->GetFormat();
+		attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		for (uint32 i = 0; i < GBufferColorCount; ++i)
+		{
+			// Clear, don't store, and end up as read only
+			attachments[2 + i] = m_GBufferAttachments[i]->GetDescription();
+		}
+
+		// Subpass 0: Fill the G-Buffer ------
+		std::array<VkAttachmentReference, GBufferColorCount> gbufferRefs = {};
+		for (uint32 i = 0; i < GBufferColorCount; ++i)
+		{
+			gbufferRefs[i] = { 2 + i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		}
+		VkAttachmentReference depthRef = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+		// Subpass 1: Lighting and anything else drawn to the swap chain ------
+		// Input attachment indices match deferred_subpass.frag: depth, normal, albedo, material
+		VkAttachmentReference colorRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		std::array<VkAttachmentReference, 1 + GBufferColorCount> inputRefs = {};
+		inputRefs[0] = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+		for (uint32 i = 0; i < GBufferColorCount; ++i)
+		{
+			inputRefs[1 + i] = { 2 + i, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		}
+
+		std::array<VkSubpassDescription, 2> subpasses = {};
+		subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[0].colorAttachmentCount = static_cast<uint32>(gbufferRefs.size());
+		subpasses[0].pColorAttachments = gbufferRefs.data();
+		subpasses[0].pDepthStencilAttachment = &depthRef;
+
+		// No depth attachment here. Depth is in a read only layout for the lighting to read,
+		// so the pipelines of this subpass (lighting, debug, ImGui) don't depth test
+		subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[1].colorAttachmentCount = 1;
+		subpasses[1].pColorAttachments = &colorRef;
+		subpasses[1].inputAttachmentCount = static_cast<uint32>(inputRefs.size());
+		subpasses[1].pInputAttachments = inputRefs.data();
+
+		std::array<VkSubpassDependency, 2> dependencies = {};
+
+		// The attachments are shared between frames in flight, so wait for the last frame to be done with them
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = m_WaitStages | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[0].dstStageMask = m_WaitStages | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].dstAccessMask =
+			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		// Lighting reads the G-Buffer at the same pixel that wrote it, so this can stay per tile
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = 1;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+		dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = static_cast<uint32>(attachments.size());
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = static_cast<uint32>(subpasses.size());
+		renderPassInfo.pSubpasses = subpasses.data();
+		renderPassInfo.dependencyCount = static_cast<uint32>(dependencies.size());
+		renderPassInfo.pDependencies = dependencies.data();
+
+		VK_CHECK_RESULT(vkCreateRenderPass(m_LogicalDevice->GetVkDevice(), &renderPassInfo, nullptr, &m_RenderPass));
+		m_PipelineCache->RegisterRenderPass(m_RenderPass, renderPassInfo);
+	}
+
+	void VulkanApp::BuildGBufferAttachments()
+	{
+		assert(m_GBufferAttachments.empty());
+
+		const GBufferTarget Targets[GBufferColorCount] = { GBufferTarget::Normal, GBufferTarget::Albedo, GBufferTarget::Material };
+
+		AttachmentCreateInfo CreateInfo = {};
+		CreateInfo.Width = m_SwapChain->GetExtents().width;
+		CreateInfo.Height = m_SwapChain->GetExtents().height;
+		CreateInfo.LayerCount = 1;
+		CreateInfo.Usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		CreateInfo.MemoryProperties = GetTransientMemoryProperties();
+
+		for (GBufferTarget Target : Targets)
+		{
+			CreateInfo.Format = OffscreenSubpass::GetGBufferFormat(m_PhysicalDevice, Target);
+			m_GBufferAttachments.emplace_back(new FrameBufferAttachment(CreateInfo, m_LogicalDevice->GetVkDevice()));
+		}
+	}
+
+	void VulkanApp::CleanupGBufferAttachments()
+	{
+		for (FrameBufferAttachment* Attachment : m_GBufferAttachments)
+		{
+			delete Attachment;
+		}
+		m_GBufferAttachments.clear();
+	}
+
+	VkMemoryPropertyFlags VulkanApp::GetTransientMemoryProperties() const
+	{
+		// Lazily allocated memory is only backed if the GPU actually needs to spill the attachment
+		return m_PhysicalDevice->HasMemoryType(VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) ?
+			VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT :
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	}
+
+	VkImageView VulkanApp::GetGBufferAttachmentView(GBufferTarget t_Target) const
+	{
+		assert(m_SinglePassDeferred);
+
+		if (t_Target == GBufferTarget::Depth)
+		{
+			return m_DepthBuffer->GetVkImageView();
+		}
 
+		const size_t Index = static_cast<size_t>(t_Target);
+		assert(Index < m_GBufferAttachments.size());
+		return m_GBufferAttachments[Index]->GetViewHandle();
 	}
 
 	void VulkanApp::BuildSwapChainFrameBuffer()
@@ -176,22 +408,23 @@ namespace Fling
 		m_SwapChainFrameBuffers.resize(m_SwapChain->GetImageCount());
 		for (uint32 i = 0; i < m_SwapChainFrameBuffers.size(); i++)
 		{
-			VkImageView attachments[2];
+			// Swap chain image, depth, then any G-Buffer attachments of the single pass render pass
+			std::vector<VkImageView> attachments = { ImageViews[i], m_DepthBuffer->GetVkImageView() };
+			for (FrameBufferAttachment* Attachment : m_GBufferAttachments)
+			{
+				attachments.emplace_back(Attachment->GetViewHandle());
+			}
 
 			VkFramebufferCreateInfo frameBufferCreateInfo = {};
 			frameBufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 			frameBufferCreateInfo.pNext = nullptr;
 			frameBufferCreateInfo.renderPass = m_RenderPass;
-			frameBufferCreateInfo.attachmentCount = 2;
-			frameBufferCreateInfo.pAttachments = attachments;
+			frameBufferCreateInfo.attachmentCount = static_cast<uint32>(attachments.size());
+			frameBufferCreateInfo.pAttachments = attachments.data();
 			frameBufferCreateInfo.width = m_SwapChain->GetExtents().width;
 			frameBufferCreateInfo.height = m_SwapChain->GetExtents().height;
 			frameBufferCreateInfo.layers = 1;
 
-			attachments[0] = ImageViews[i];
-
-			// Depth/Stencil attachment is the same for all frame buffers
-			attachments[1] = m_DepthBuffer->GetVkImageView();
 			VK_CHECK_RESULT(vkCreateFramebuffer(m_LogicalDevice->GetVkDevice(), &frameBufferCreateInfo, nullptr, &m_SwapChainFrameBuffers[i]));
 		}
 	}
@@ -222,22 +455,29 @@ namespace Fling
 	void VulkanApp::CreateGameWindow(const uint32 t_width, const uint32 t_height)
 	{
 		WindowProps Props = {};
-		Props.m_Height = t_width;
 		Props.m_Width = t_width;
+		Props.m_Height = t_height;
 
 		// Ensure the window width is valid
 		if (t_width > 0 && t_width < 5000 && t_height > 0 && t_height < 5000)
 		{
-			Props.m_Height = t_width;
+			Props.m_Width = t_width;
 			Props.m_Height = t_height;
 		}
 		else
 		{
 			F_LOG_ERROR("Window Width of {} or height of {} is invalid! Using default values", t_width, t_height);
-			Props.m_Height = FLING_DEFAULT_WINDOW_WIDTH;
+			Props.m_Width = FLING_DEFAULT_WINDOW_WIDTH;
 			Props.m_Height = FLING_DEFAULT_WINDOW_HEIGHT;
 		}
 
+		if (m_Headless)
+		{
+			int FrameCount = FlingConfig::GetInt("Headless", "FrameCount", 0);
+			m_CurrentWindow = new HeadlessWindow(Props, FrameCount > 0 ? static_cast<uint32>(FrameCount) : 0);
+			return;
+		}
+
 		// Get the window title
 		std::string Title = FlingConfig::GetString("Engine", "WindowTitle");
 
@@ -282,6 +522,7 @@ namespace Fling
 	void VulkanApp::CleanupSwapChainResources()
 	{
 		// Global Render pass
+		m_PipelineCache->UnregisterRenderPass(m_RenderPass);
 		vkDestroyRenderPass(m_LogicalDevice->GetVkDevice(), m_RenderPass, nullptr);
 
 		// Frame buffers
@@ -290,6 +531,8 @@ namespace Fling
 			vkDestroyFramebuffer(m_LogicalDevice->GetVkDevice(), m_SwapChainFrameBuffers[i], nullptr);
 		}
 
+		CleanupGBufferAttachments();
+
 		// Clean up command buffers and command pool -------------
 		for (CommandBuffer* CmdBuf : m_DrawCmdBuffers)
 		{
@@ -315,17 +558,52 @@ namespace Fling
 			// These shaders have vertex input and fill in the buffers that the final pass uses
 			std::shared_ptr<Fling::Shader> OffscreenVert = Shader::Create(HS("Shaders/Deferred/mrt_vert.spv"), m_LogicalDevice);
 			std::shared_ptr<Fling::Shader> OffscreenFrag = Shader::Create(HS("Shaders/Deferred/mrt_frag.spv"), m_LogicalDevice);
-			Subpasses.emplace_back(std::make_unique<OffscreenSubpass>(m_LogicalDevice, m_SwapChain, t_Reg, m_Camera, OffscreenVert, OffscreenFrag));
+			// With single pass deferred the G-Buffer is subpass 0 of the global render pass
+			Subpasses.emplace_back(std::make_unique<OffscreenSubpass>(
+				m_LogicalDevice, m_SwapChain, t_Reg, OffscreenVert, OffscreenFrag, m_SinglePassDeferred ? m_RenderPass : VK_NULL_HANDLE)
+			);
 
 			// Create geometry pass ------
 			// These shaders do not have any vertex input and do the final processing to the screen
 			OffscreenSubpass* Offscreen = static_cast<OffscreenSubpass*>(Subpasses[0].get());
 			assert(Offscreen);
-			FrameBuffer* OffscreenBuf = Offscreen->GetOffscreenFrameBuffer();
-			assert(OffscreenBuf);
+
+			// Optionally do the G-Buffer culling with a compute shader and indirect draws
+			std::shared_ptr<Fling::Shader> IndirectDepthVert = nullptr;
+			if (FlingConfig::GetBool("Graphics", "GpuDrivenRendering", false))
+			{
+				if (GpuCullingPass::IsSupported(m_LogicalDevice))
+				{
+					std::shared_ptr<Fling::Shader> CullComp = Shader::Create(HS("Shaders/Deferred/cull_comp.spv"), m_LogicalDevice);
+					std::shared_ptr<Fling::Shader> IndirectVert = Shader::Create(HS("Shaders/Deferred/mrt_indirect_vert.spv"), m_LogicalDevice);
+					Offscreen->EnableGpuCulling(std::make_unique<GpuCullingPass>(m_LogicalDevice, t_Reg, Offscreen->GetBindlessTextures(), CullComp, IndirectVert, OffscreenFrag));
+					m_GpuDrivenRendering = true;
+
+					if (Offscreen->UsesDepthPrepass())
+					{
+						IndirectDepthVert = Shader::Create(HS("Shaders/Deferred/depth_indirect_vert.spv"), m_LogicalDevice);
+					}
+				}
+				else
+				{
+					F_LOG_WARN("GPU driven rendering requested, but the device does not support multiDrawIndirect and drawIndirectFirstInstance!");
+				}
+			}
+
+			// Depth only prepass, set by Graphics.DepthPrepass
+			if (Offscreen->UsesDepthPrepass())
+			{
+				std::shared_ptr<Fling::Shader> DepthVert = Shader::Create(HS("Shaders/Deferred/depth_vert.spv"), m_LogicalDevice);
+				Offscreen->EnableDepthPrepass(DepthVert, IndirectDepthVert);
+			}
+
 			std::shared_ptr<Fling::Shader> GeomVert = Shader::Create(HS("Shaders/Deferred/deferred_vert.spv"), m_LogicalDevice);
-			std::shared_ptr<Fling::Shader> GeomFrag = Shader::Create(HS("Shaders/Deferred/deferred_frag.spv"), m_LogicalDevice);
-			Subpasses.emplace_back(std::make_unique<GeometrySubpass>(m_LogicalDevice, m_SwapChain, t_Reg, m_RenderPass, m_Camera, OffscreenBuf, GeomVert, GeomFrag));
+			// The single pass lighting shader reads the G-Buffer as input attachments instead of sampling it
+			std::shared_ptr<Fling::Shader> GeomFrag = m_SinglePassDeferred ?
+				Shader::Create(HS("Shaders/Deferred/deferred_subpass_frag.spv"), m_LogicalDevice) :
+				Shader::Create(HS("Shaders/Deferred/deferred_frag.spv"), m_LogicalDevice);
+			Subpasses.emplace_back(std::make_unique<GeometrySubpass>(m_LogicalDevice, m_SwapChain, t_Reg, m_RenderPass, Offscreen, GeomVert, GeomFrag));
+			Subpasses.back()->SetSubpassIndex(GetPresentSubpassIndex());
 
 			m_RenderPipelines.emplace_back(
 				new Fling::RenderPipeline(t_Reg, m_LogicalDevice, m_SwapChain, Subpasses)
@@ -343,19 +621,25 @@ namespace Fling
 			// Add a cubemap
 		}
 
-		/*if (t_Conf & PipelineFlags::DEBUG)
+		// After the lighting and before ImGui, so the lines are drawn over the scene and under the UI
+		if (t_Conf & PipelineFlags::DEBUG)
 		{
-			F_LOG_WARN("Build DEBUG render pipeline!");
+#if WITH_DEBUG_DRAW
+			F_LOG_TRACE("Build DEBUG render pipeline!");
 			std::vector<std::unique_ptr<Subpass>> Subpasses = {};
 
 			std::shared_ptr<Fling::Shader> DebugVert = Shader::Create(HS("Shaders/Debug/debug_vert.spv"), m_LogicalDevice);
 			std::shared_ptr<Fling::Shader> DebugFrag = Shader::Create(HS("Shaders/Debug/debug_frag.spv"), m_LogicalDevice);
-			Subpasses.emplace_back(std::make_unique<DebugSubpass>(m_LogicalDevice, m_SwapChain, t_Reg, m_RenderPass, m_Camera, DebugVert, DebugFrag));
+			Subpasses.emplace_back(std::make_unique<DebugSubpass>(m_LogicalDevice, m_SwapChain, m_RenderPass, DebugVert, DebugFrag));
+			Subpasses.back()->SetSubpassIndex(GetPresentSubpassIndex());
 
 			m_RenderPipelines.emplace_back(
 				new Fling::RenderPipeline(t_Reg, m_LogicalDevice, m_SwapChain, Subpasses)
 			);
-		}*/
+#else
+			F_LOG_ERROR("DEBUG requested but debug drawing is compiled out of this build!");
+#endif
+		}
 
 		if (t_Conf & PipelineFlags::IMGUI)
 		{
@@ -367,6 +651,7 @@ namespace Fling
 			Subpasses.emplace_back(std::make_unique<ImGuiSubpass>(
 				m_LogicalDevice, m_SwapChain, t_Reg, m_CurrentWindow, m_RenderPass, t_Editor, ImGuiVert, ImGuiFrag)
 			);
+			Subpasses.back()->SetSubpassIndex(GetPresentSubpassIndex());
 
 			m_RenderPipelines.emplace_back(
 				new Fling::RenderPipeline(t_Reg, m_LogicalDevice, m_SwapChain, Subpasses)
@@ -379,19 +664,108 @@ namespace Fling
 
 	void VulkanApp::Update(float DeltaTime, entt::registry& t_Reg)
 	{
-		// Prepare the frame for submission by waiting for the swap chain
 		m_CurrentWindow->Update();
 		m_Camera->Update(DeltaTime);
 
+		// Swap chain resources are only rebuilt here, never while a frame is being recorded
+		if (bNeedsResizing)
+		{
+			m_Handoff.WaitIdle();
+			bNeedsResizing = false;
+			RecreateFrameResourcesForResize(t_Reg);
+		}
+
+		if (!HasRenderThread())
+		{
+			RenderSnapshot& Snapshot = m_Snapshots[0];
+			Extract(DeltaTime, t_Reg, Snapshot);
+			Render(Snapshot);
+			return;
+		}
+
+		// Only blocks if the render thread hasn't started on the frame that was handed off last time
+		const uint32 Slot = m_Handoff.BeginWrite();
+		Extract(DeltaTime, t_Reg, m_Snapshots[Slot]);
+		m_Handoff.Submit(Slot);
+	}
+
+	void VulkanApp::Extract(float DeltaTime, entt::registry& t_Reg, RenderSnapshot& t_Snapshot)
+	{
+		t_Snapshot.View = m_Camera->GetViewMatrix();
+		t_Snapshot.Projection = m_Camera->GetProjectionMatrix();
+		t_Snapshot.CameraPos = m_Camera->GetPosition();
+		t_Snapshot.NearPlane = m_Camera->GetNearPlane();
+		t_Snapshot.FarPlane = m_Camera->GetFarPlane();
+		t_Snapshot.Gamma = m_Camera->GetGamma();
+		t_Snapshot.Exposure = m_Camera->GetExposure();
+		t_Snapshot.DeltaTime = DeltaTime;
+
+		// Recording on this thread, so the GPU driven path can sync with the registry
+		t_Snapshot.Registry = HasRenderThread() ? nullptr : &t_Reg;
+
+		// Models are loaded and freed on this thread, so the buffers can only change between snapshots
+		m_GeometryBuffer->NextFrame();
+		t_Snapshot.Geometry = m_GeometryBuffer->GetBindings();
+
+		for (RenderPipeline* Pipeline : m_RenderPipelines)
+		{
+			Pipeline->Extract(t_Reg, t_Snapshot);
+		}
+
+#if WITH_DEBUG_DRAW
+		// After the subpasses, they add shapes while extracting. Debug shapes only last for the
+		// frame they were added in, and the list that was swapped out keeps its memory for the next one
+		std::swap(t_Snapshot.DebugShapes, DebugDraw::GetList());
+		DebugDraw::GetList().Clear();
+#endif
+	}
+
+	void VulkanApp::RenderThreadLoop()
+	{
+		uint32 Slot = 0;
+		while (m_Handoff.BeginRead(Slot))
+		{
+			Render(m_Snapshots[Slot]);
+			m_Handoff.EndRead(Slot);
+		}
+	}
+
+	void VulkanApp::StopRenderThread()
+	{
+		if (m_RenderThread.joinable())
+		{
+			m_Handoff.Stop();
+			m_RenderThread.join();
+		}
+	}
+
+	void VulkanApp::Render(const RenderSnapshot& t_Snapshot)
+	{
+		m_PipelineCache->UpdateStats();
+
+		// Wait until the GPU is done with the last frame that used this slot. This is the only
+		// place the CPU waits, so it can record a frame while the GPU works on the one before it
+		const uint32 FrameInFlight = static_cast<uint32>(CurrentFrameIndex);
+		vkWaitForFences(m_LogicalDevice->GetVkDevice(), 1, &m_InFlightFences[FrameInFlight], VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+		// Anything this slot copied back last time is done now
+		if (m_FrameCapture)
+		{
+			m_FrameCapture->Resolve(FrameInFlight);
+		}
+
+		// Nothing signals or waits on presentation without a surface
+		const bool bPresents = !m_SwapChain->IsHeadless();
+
 		// Aquire the active image index
-		VkResult iResult = m_SwapChain->AquireNextImage(m_PresentCompleteSemaphores[CurrentFrameIndex]);
+		VkResult iResult = m_SwapChain->AquireNextImage(m_PresentCompleteSemaphores[FrameInFlight]);
 		uint32  ImageIndex = m_SwapChain->GetActiveImageIndex();
 
-		vkResetFences(m_LogicalDevice->GetVkDevice(), 1, &m_InFlightFences[CurrentFrameIndex]);
-
+		// Don't reset the fence yet, if we bail out here nothing would ever signal it again
 		if (iResult == VK_ERROR_OUT_OF_DATE_KHR)
 		{
 			F_LOG_WARN("Swap chain out of date! ");
+			bNeedsResizing = true;
 			return;
 		}
 		else if (iResult != VK_SUCCESS && iResult != VK_SUBOPTIMAL_KHR)
@@ -399,6 +773,12 @@ namespace Fling
 			F_LOG_FATAL("Failed to acquire swap chain image!");
 		}
 
+		// Reads the timings of the last frame in this slot, the fence above means they are ready
+		if (m_GpuProfiler)
+		{
+			m_GpuProfiler->BeginFrame(FrameInFlight);
+		}
+
 		// Fill this with the render pipelines
 		std::vector<VkSemaphore> SemaphoresToWaitOn = {};
 		std::vector<CommandBuffer*> DependentCmdBufs = {};
@@ -406,18 +786,24 @@ namespace Fling
 		// Vector of command buffers to be sent out with the final swap chain presentation
 		// the swap chain draw buffer is always first
 		std::vector<CommandBuffer*> FinalSubmissionBufs = {};
-		FinalSubmissionBufs.emplace_back(m_DrawCmdBuffers[ImageIndex]);
+		FinalSubmissionBufs.emplace_back(m_DrawCmdBuffers[FrameInFlight]);
 
 		//vkResetCommandPool(m_LogicalDevice->GetVkDevice(), m_CommandPool, 0);
 
 		{
-			// Get the current drawing command buffer associated with the current swap chain image
-			CommandBuffer* CmdBuf = m_DrawCmdBuffers[ImageIndex];
+			// Get the drawing command buffer of this frame in flight and the frame buffer of the acquired image
+			CommandBuffer* CmdBuf = m_DrawCmdBuffers[FrameInFlight];
 			VkFramebuffer FrameBuf = m_SwapChainFrameBuffers[ImageIndex];
 			assert(CmdBuf && FrameBuf != VK_NULL_HANDLE);
 
 			CmdBuf->Begin();
 
+			// Anything that has to be recorded outside of a render pass, like compute dispatches
+			for (RenderPipeline* Pipeline : m_RenderPipelines)
+			{
+				Pipeline->PrepareDraw(*CmdBuf, FrameInFlight, t_Snapshot);
+			}
+
 			// Start a render pass using the global render pass settings
 			VkRenderPassBeginInfo renderPassBeginInfo = Initializers::RenderPassBeginInfo();
 			renderPassBeginInfo.renderPass = m_RenderPass;
@@ -443,11 +829,21 @@ namespace Fling
 			// Build the command buffers of the render pipelines
 			for (RenderPipeline* Pipeline : m_RenderPipelines)
 			{		
-				Pipeline->Draw(*CmdBuf, FrameBuf, ImageIndex, t_Reg, DeltaTime);
+				Pipeline->Draw(*CmdBuf, FrameBuf, FrameInFlight, t_Snapshot);
 			}
 
 			CmdBuf->EndRenderPass();
 
+			if (m_FrameCapture)
+			{
+				m_FrameCapture->Record(*CmdBuf, FrameInFlight, m_SwapChain->GetActiveImage());
+			}
+
+			if (m_GpuProfiler)
+			{
+				m_GpuProfiler->EndFrame(*CmdBuf);
+			}
+
 			// End command buffer recording
 			CmdBuf->End();
 		}
@@ -456,13 +852,16 @@ namespace Fling
 		for (RenderPipeline* Pipeline : m_RenderPipelines)
 		{
 			// Gather the dependencies 
-			Pipeline->GatherPresentDependencies(DependentCmdBufs, SemaphoresToWaitOn, ImageIndex, CurrentFrameIndex);
-			Pipeline->GatherPresentBuffers(FinalSubmissionBufs, ImageIndex);
+			Pipeline->GatherPresentDependencies(DependentCmdBufs, SemaphoresToWaitOn, ImageIndex, FrameInFlight);
+			Pipeline->GatherPresentBuffers(FinalSubmissionBufs, FrameInFlight);
 		}
 
 		// Wait for the color attachment to be done 
 		VkPipelineStageFlags waitStages[] = { m_WaitStages };
 
+		// Single time commands on the main thread submit to the same queue
+		std::unique_lock<std::mutex> QueueLock(m_QueueMutex);
+
 		// Submit any PIPELINE command buffers for work		
 		VkSubmitInfo FinalScreenSubmitInfo = {};
 		FinalScreenSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -477,8 +876,8 @@ namespace Fling
 			OffscreenSubmission.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 			OffscreenSubmission.pWaitDstStageMask = waitStages;
 			// Wait on Present complete
-			OffscreenSubmission.pWaitSemaphores = &m_PresentCompleteSemaphores[CurrentFrameIndex];
-			OffscreenSubmission.waitSemaphoreCount = 1;
+			OffscreenSubmission.pWaitSemaphores = &m_PresentCompleteSemaphores[FrameInFlight];
+			OffscreenSubmission.waitSemaphoreCount = bPresents ? 1 : 0;
 
 			// Signal that the dependent semaphores are done when this is complete
 			OffscreenSubmission.pSignalSemaphores = SemaphoresToWaitOn.data();
@@ -486,6 +885,12 @@ namespace Fling
 
 			// Mark the draw command buffer at this frame for submission
 			std::vector<VkCommandBuffer> submitCommandBuffers = {};
+
+			// The profiler resets its queries in here, so it has to run before anything else in the frame
+			if (m_GpuProfiler)
+			{
+				submitCommandBuffers.emplace_back(m_GpuProfiler->GetFrameStartCommandBuffer(FrameInFlight)->GetHandle());
+			}
 			
 			for (CommandBuffer* Buf : DependentCmdBufs)
 			{
@@ -504,8 +909,13 @@ namespace Fling
 		else
 		{
 			// Track any semaphores that we may need to wait on for the render pipeline
-			FinalScreenSubmitInfo.waitSemaphoreCount = 1;
-			FinalScreenSubmitInfo.pWaitSemaphores = &m_PresentCompleteSemaphores[CurrentFrameIndex];
+			FinalScreenSubmitInfo.waitSemaphoreCount = bPresents ? 1 : 0;
+			FinalScreenSubmitInfo.pWaitSemaphores = &m_PresentCompleteSemaphores[FrameInFlight];
+
+			if (m_GpuProfiler)
+			{
+				FinalSubmissionBufs.insert(FinalSubmissionBufs.begin(), m_GpuProfiler->GetFrameStartCommandBuffer(FrameInFlight));
+			}
 		}
 		
 		// Collect any addition command buffers that we want to submit, but are not dependent on offscreen
@@ -519,23 +929,21 @@ namespace Fling
 		FinalScreenSubmitInfo.commandBufferCount = (uint32)submitCommandBuffers.size();
 
 		// Actually present the swap chain queue. This is always going to be the signal for the final semaphore
-		FinalScreenSubmitInfo.signalSemaphoreCount = 1;
-		FinalScreenSubmitInfo.pSignalSemaphores = &m_RenderFinishedSemaphores[CurrentFrameIndex];
+		FinalScreenSubmitInfo.signalSemaphoreCount = bPresents ? 1 : 0;
+		FinalScreenSubmitInfo.pSignalSemaphores = &m_RenderFinishedSemaphores[FrameInFlight];
 
-		VK_CHECK_RESULT(vkQueueSubmit(m_LogicalDevice->GetGraphicsQueue(), 1, &FinalScreenSubmitInfo, m_InFlightFences[CurrentFrameIndex]));
-		
-		// Finish up the frame by setting the in flight fences to wait -----
-		vkWaitForFences(m_LogicalDevice->GetVkDevice(), 1, &m_InFlightFences[CurrentFrameIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+		// The fence is signaled when this frame is done, and waited on when its slot comes around again
+		vkResetFences(m_LogicalDevice->GetVkDevice(), 1, &m_InFlightFences[FrameInFlight]);
+		VK_CHECK_RESULT(vkQueueSubmit(m_LogicalDevice->GetGraphicsQueue(), 1, &FinalScreenSubmitInfo, m_InFlightFences[FrameInFlight]));
 	
 		// Present the swap chain with the renderer finished semaphore
-		iResult = m_SwapChain->QueuePresent(m_LogicalDevice->GetPresentQueue(), m_RenderFinishedSemaphores[CurrentFrameIndex]);
+		iResult = m_SwapChain->QueuePresent(m_LogicalDevice->GetPresentQueue(), m_RenderFinishedSemaphores[FrameInFlight]);
+		QueueLock.unlock();
 		
-		// Check if the swap chain is out of date and needs to be rebuilt
-		if (iResult == VK_ERROR_OUT_OF_DATE_KHR || iResult == VK_SUBOPTIMAL_KHR || bNeedsResizing)
+		// Check if the swap chain is out of date and needs to be rebuilt. That happens at the start of the next Update
+		if (iResult == VK_ERROR_OUT_OF_DATE_KHR || iResult == VK_SUBOPTIMAL_KHR)
 		{
-			// If result is out of date then signal for resize
-			bNeedsResizing = false;
-			RecreateFrameResourcesForResize(t_Reg);
+			bNeedsResizing = true;
 		}
 		else if (iResult != VK_SUCCESS)
 		{
@@ -550,6 +958,12 @@ namespace Fling
 	{
 		assert(m_CurrentWindow);
 
+		// Without a surface the window decides the size
+		if (m_Surface == VK_NULL_HANDLE)
+		{
+			return { m_CurrentWindow->GetWidth(), m_CurrentWindow->GetHeight() };
+		}
+
 		VkSurfaceCapabilitiesKHR t_Capabilies = {};
 		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_PhysicalDevice->GetVkPhysicalDevice(), m_Surface, &t_Capabilies);
 
@@ -577,9 +991,41 @@ namespace Fling
 	{
 		Singleton<VulkanApp>::Shutdown();
 
+		StopRenderThread();
+
 		// Wait for the device to be ready before shutting down
 		m_LogicalDevice->WaitForIdle();
 
+		// Writes out the last frames that were captured, so it has to go before the swap chain
+		if (m_FrameCapture)
+		{
+			delete m_FrameCapture;
+			m_FrameCapture = nullptr;
+		}
+
+		// Headless runs are how the overdraw of a scene gets measured, so leave the totals in the log
+		if (m_Headless && Stats::Overdraw::GetFrameCount() > 0)
+		{
+			F_LOG_TRACE("Overdraw: {:.2f} fragments per pixel on average over {} frames (last frame {:.2f}, depth prepass {})",
+				Stats::Overdraw::GetAverageRatio(),
+				Stats::Overdraw::GetFrameCount(),
+				Stats::Overdraw::GetRatio(),
+				Stats::Overdraw::WasPrepassEnabled() ? "on" : "off");
+		}
+
+		// Its command buffers come from the command pool, so it goes before that
+		if (m_GpuProfiler)
+		{
+			const std::string TraceFile = FlingConfig::GetString("Graphics", "GpuTraceFile", "");
+			if (!TraceFile.empty())
+			{
+				m_GpuProfiler->ExportTrace(TraceFile);
+			}
+
+			delete m_GpuProfiler;
+			m_GpuProfiler = nullptr;
+		}
+
 		// Cleanup render pipelines (created in BuildRenderPipelines) -----------------
 		for (RenderPipeline* pipeline : m_RenderPipelines)
 		{
@@ -592,6 +1038,13 @@ namespace Fling
 		}
 		m_RenderPipelines.clear();
 
+		// After the pipelines, which can hold on to models. Anything freed after this skips it
+		if (m_GeometryBuffer)
+		{
+			delete m_GeometryBuffer;
+			m_GeometryBuffer = nullptr;
+		}
+
 		for (size_t i = 0; i < m_SwapChainFrameBuffers.size(); i++)
 		{
 			vkDestroyFramebuffer(m_LogicalDevice->GetVkDevice(), m_SwapChainFrameBuffers[i], nullptr);
@@ -599,6 +1052,8 @@ namespace Fling
 
 		vkDestroyRenderPass(m_LogicalDevice->GetVkDevice(), m_RenderPass, nullptr);
 
+		CleanupGBufferAttachments();
+
 		// Camera cleanup ------------
 		if (m_Camera)
 		{
@@ -641,6 +1096,14 @@ namespace Fling
 		m_DrawCmdBuffers.clear();
 
 		vkDestroyCommandPool(m_LogicalDevice->GetVkDevice(), m_CommandPool, nullptr);
+		vkDestroyCommandPool(m_LogicalDevice->GetVkDevice(), m_SingleTimeCommandPool, nullptr);
+
+		// Destroys every pipeline that is still cached, anything released after this skips the cache
+		if (m_PipelineCache)
+		{
+			delete m_PipelineCache;
+			m_PipelineCache = nullptr;
+		}
 
 		// Clean up devices and surface (created in Prepare) --------------
 		if (m_LogicalDevice)
@@ -649,7 +1112,11 @@ namespace Fling
 			m_LogicalDevice = nullptr;
 		}
 
-		vkDestroySurfaceKHR(m_Instance->GetRawVkInstance(), m_Surface, nullptr);
+		if (m_Surface != VK_NULL_HANDLE)
+		{
+			vkDestroySurfaceKHR(m_Instance->GetRawVkInstance(), m_Surface, nullptr);
+			m_Surface = VK_NULL_HANDLE;
+		}
 
 		if (m_PhysicalDevice)
 		{
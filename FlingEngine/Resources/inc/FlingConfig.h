@@ -3,17 +3,20 @@
 #include "Singleton.hpp"
 #include "INIReader.h"
 
+#include <unordered_map>
+
 namespace Fling
 {
     /**
-    * Provide simple access to engine configuration options from an INI file
-    * #TODO Parse command line options as well
+    * Provide simple access to engine configuration options from an INI file.
+    * Options given on the command line as --Section.Key=Value take priority over the file
     */
     class FlingConfig : public Singleton<FlingConfig>
     {
 
     public:
 
+        /** Logs the command line arguments that were ignored, LoadCommandLineOpts runs before the logger exists */
         virtual void Init() override;
 
         virtual void Shutdown() override;
@@ -29,17 +32,19 @@ namespace Fling
 
 		static std::string GetString(const std::string& t_Section, const std::string& t_Key, std::string t_Default = "INVALID") { return FlingConfig::Get().GetStringImpl(t_Section, t_Key, t_Default); }
 
-		static int GetInt(const std::string& t_Section, const std::string& t_Key, const int t_DefaultVal = -1) { return FlingConfig::Get().GetIntImpl(t_Section, t_Key); }
+		static int GetInt(const std::string& t_Section, const std::string& t_Key, const int t_DefaultVal = -1) { return FlingConfig::Get().GetIntImpl(t_Section, t_Key, t_DefaultVal); }
 
-		static bool GetBool(const std::string& t_Section, const std::string& t_Key, const bool t_DefaultVal = false) { return FlingConfig::Get().GetBoolImpl(t_Section, t_Key); }
+		static bool GetBool(const std::string& t_Section, const std::string& t_Key, const bool t_DefaultVal = false) { return FlingConfig::Get().GetBoolImpl(t_Section, t_Key, t_DefaultVal); }
 
-		static float GetFloat(const std::string& t_Section, const std::string& t_Key, const float t_DefaultVal = 0.0f) { return FlingConfig::Get().GetFloatImpl(t_Section, t_Key); }
+		static float GetFloat(const std::string& t_Section, const std::string& t_Key, const float t_DefaultVal = 0.0f) { return FlingConfig::Get().GetFloatImpl(t_Section, t_Key, t_DefaultVal); }
 
-		static double GetDouble(const std::string& t_Section, const std::string& t_Key, const double t_DefaultVal = 0.0) { return FlingConfig::Get().GetDoubleImpl(t_Section, t_Key); }
+		static double GetDouble(const std::string& t_Section, const std::string& t_Key, const double t_DefaultVal = 0.0) { return FlingConfig::Get().GetDoubleImpl(t_Section, t_Key, t_DefaultVal); }
 
         /**
         * Load in the command line options and store them somewhere that is 
-        * globally accessible
+        * globally accessible. Options look like --Section.Key=Value, a flag 
+        * without a value (--Headless.Enabled) is set to true. Safe to call before
+        * the engine starts up, anything that is ignored is only logged in Init
         * 
         * @param argc   Argument count
         * @param argv   Command line args
@@ -52,6 +57,15 @@ namespace Fling
         /** Ini config file reader */
         static INIReader m_IniReader;
 
+        /** Options from the command line keyed by "section.key" in lower case, like the INI reader */
+        static std::unordered_map<std::string, std::string> m_CommandLineOpts;
+
+        /** Warnings about arguments that LoadCommandLineOpts ignored, logged and cleared by Init */
+        static std::vector<std::string> m_IgnoredArgWarnings;
+
+        /** @return Null if the option wasn't given on the command line */
+        const std::string* FindCommandLineOpt(const std::string& t_Section, const std::string& t_Key) const;
+
 		std::string GetStringImpl(const std::string& t_Section, const std::string& t_Key, const std::string& t_Default) const;
 
 		int GetIntImpl(const std::string& t_Section, const std::string& t_Key, const int t_DefaultVal = -1) const;
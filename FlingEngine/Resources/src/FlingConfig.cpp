@@ -1,13 +1,33 @@
 #include "pch.h"
 #include "FlingConfig.h"
 
+#include <algorithm>
+#include <cctype>
+
 namespace Fling
 {
 
     INIReader FlingConfig::m_IniReader;
+    std::unordered_map<std::string, std::string> FlingConfig::m_CommandLineOpts;
+    std::vector<std::string> FlingConfig::m_IgnoredArgWarnings;
+
+    namespace
+    {
+        std::string MakeOptionName(const std::string& t_Section, const std::string& t_Key)
+        {
+            std::string Name = t_Section + "." + t_Key;
+            std::transform(Name.begin(), Name.end(), Name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return Name;
+        }
+    }
 
     void FlingConfig::Init()
     {
+        for (const std::string& Warning : m_IgnoredArgWarnings)
+        {
+            F_LOG_WARN("{}", Warning);
+        }
+        m_IgnoredArgWarnings.clear();
     }
 
     void FlingConfig::Shutdown()
@@ -34,28 +54,70 @@ namespace Fling
         return true;
     }
 
+    const std::string* FlingConfig::FindCommandLineOpt(const std::string& t_Section, const std::string& t_Key) const
+    {
+        if (m_CommandLineOpts.empty())
+        {
+            return nullptr;
+        }
+
+        auto It = m_CommandLineOpts.find(MakeOptionName(t_Section, t_Key));
+        return It != m_CommandLineOpts.end() ? &It->second : nullptr;
+    }
+
     std::string FlingConfig::GetStringImpl(const std::string& t_Section, const std::string& t_Key, const std::string& t_Default) const
     {
+        if (const std::string* Opt = FindCommandLineOpt(t_Section, t_Key))
+        {
+            return *Opt;
+        }
         return m_IniReader.Get(t_Section, t_Key, t_Default);
     }
 
     int FlingConfig::GetIntImpl(const std::string& t_Section, const std::string& t_Key, const int t_DefaultVal/*=-1*/) const
     {
+        if (const std::string* Opt = FindCommandLineOpt(t_Section, t_Key))
+        {
+            // Same parsing as the INI reader, so hex values work here as well
+            char* End = nullptr;
+            long Val = strtol(Opt->c_str(), &End, 0);
+            return End > Opt->c_str() ? static_cast<int>(Val) : t_DefaultVal;
+        }
         return m_IniReader.GetInteger(t_Section, t_Key, t_DefaultVal);
     }
 
     bool FlingConfig::GetBoolImpl(const std::string& t_Section, const std::string& t_Key, const bool t_DefaultVal /* =false */) const
     {
+        if (const std::string* Opt = FindCommandLineOpt(t_Section, t_Key))
+        {
+            std::string Val = *Opt;
+            std::transform(Val.begin(), Val.end(), Val.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            if (Val == "true" || Val == "yes" || Val == "on" || Val == "1")
+            {
+                return true;
+            }
+            else if (Val == "false" || Val == "no" || Val == "off" || Val == "0")
+            {
+                return false;
+            }
+            return t_DefaultVal;
+        }
         return m_IniReader.GetBoolean(t_Section, t_Key, t_DefaultVal);
     }
 
     float FlingConfig::GetFloatImpl(const std::string& t_Section, const std::string& t_Key, const float t_DefaultVal /*=0.0f*/) const
     {
-        return static_cast<float>(m_IniReader.GetReal(t_Section, t_Key, t_DefaultVal));
+        return static_cast<float>(GetDoubleImpl(t_Section, t_Key, t_DefaultVal));
     }
 
     double FlingConfig::GetDoubleImpl(const std::string& t_Section, const std::string& t_Key, const double t_DefaultVal /*= 0.0*/) const
     {
+        if (const std::string* Opt = FindCommandLineOpt(t_Section, t_Key))
+        {
+            char* End = nullptr;
+            double Val = strtod(Opt->c_str(), &End);
+            return End > Opt->c_str() ? Val : t_DefaultVal;
+        }
         return m_IniReader.GetReal(t_Section, t_Key, t_DefaultVal);
     }
 
@@ -65,14 +127,31 @@ namespace Fling
     uint32 FlingConfig::LoadCommandLineOpts(int argc, char* argv[])
     {
         uint32 ArgsLoaded = 0;
-        
-        // TODO: Use regex to try and parse out if things are a key/val etc
 
-        for (int i = 0; i < argc; ++i)
+        // The first argument is the executable
+        for (int i = 1; i < argc; ++i)
         {
-            // Parse out if this is a key or not
-            std::string value = argv[i];
-            (void)(value);
+            std::string Arg = argv[i];
+            if (Arg.size() < 3 || Arg.compare(0, 2, "--") != 0)
+            {
+                // Launchers and IDEs add their own arguments, and the logger doesn't exist yet
+                m_IgnoredArgWarnings.emplace_back("Ignoring command line argument " + Arg + ", options look like --Section.Key=Value");
+                continue;
+            }
+
+            const size_t Equals = Arg.find('=');
+            std::string Name = Arg.substr(2, Equals == std::string::npos ? std::string::npos : Equals - 2);
+            std::string Value = Equals == std::string::npos ? "true" : Arg.substr(Equals + 1);
+
+            const size_t Dot = Name.find('.');
+            if (Dot == std::string::npos || Dot == 0 || Dot == Name.size() - 1)
+            {
+                m_IgnoredArgWarnings.emplace_back("Ignoring command line option " + Arg + ", it needs a section and a key");
+                continue;
+            }
+
+            m_CommandLineOpts[MakeOptionName(Name.substr(0, Dot), Name.substr(Dot + 1))] = Value;
+            ++ArgsLoaded;
         }
 
         return ArgsLoaded;
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "MovingAverage.hpp"
+#include "FlingTypes.h"
+
+#include <vector>
+#include <atomic>
+#include <mutex>
 
 namespace Fling
 {
@@ -22,5 +27,266 @@ namespace Fling
 
             static MovingAverage<float, 100> FPSCounter;
         };
+
+        /** Visibility results of the last frame that was rendered */
+        struct Culling
+        {
+        public:
+            static uint32 GetVisibleCount();
+
+            static uint32 GetFrustumCulledCount();
+
+            /** Objects inside of the frustum that were hidden behind occluders */
+            static uint32 GetOcclusionCulledCount();
+
+            /** Meshes that were rasterized into the occlusion depth buffer */
+            static uint32 GetOccluderCount();
+
+            /** Total number of objects that were considered for drawing */
+            static uint32 GetTotalCount();
+
+            /** Also clears the occlusion results, set those after this */
+            static void SetFrustumCullResults(uint32 t_Visible, uint32 t_Culled);
+
+            static void SetOcclusionCullResults(uint32 t_Culled, uint32 t_Occluders);
+
+		private:
+
+            static uint32 VisibleCount;
+            static uint32 FrustumCulledCount;
+            static uint32 OcclusionCulledCount;
+            static uint32 OccluderCount;
+        };
+
+        /** Clustered light assignment of the last frame that was rendered */
+        struct Lighting
+        {
+        public:
+            static uint32 GetPointLightCount();
+
+            /** Total number of light indices across every cluster */
+            static uint32 GetLightIndexCount();
+
+            static uint32 GetMaxLightsPerCluster();
+
+            static void SetClusterResults(uint32 t_PointLights, uint32 t_LightIndices, uint32 t_MaxPerCluster);
+
+		private:
+
+            static std::atomic<uint32> PointLightCount;
+            static std::atomic<uint32> LightIndexCount;
+            static std::atomic<uint32> MaxLightsPerCluster;
+        };
+
+        /** What the render graph did with its passes and textures the last time it was realized */
+        struct RenderGraph
+        {
+        public:
+            static uint32 GetPassCount();
+
+            static uint32 GetCulledPassCount();
+
+            static uint32 GetBarrierCount();
+
+            /** Barriers that were not needed because a texture was read again in the same layout */
+            static uint32 GetSkippedBarrierCount();
+
+            /** Bytes of render target memory after aliasing */
+            static uint64 GetTextureMemory();
+
+            /** Bytes of render target memory if every texture had its own */
+            static uint64 GetUnaliasedTextureMemory();
+
+            static void SetCompileResults(uint32 t_Passes, uint32 t_Culled, uint32 t_Barriers, uint32 t_Skipped);
+
+            static void SetMemoryResults(uint64 t_Memory, uint64 t_Unaliased);
+
+		private:
+
+            static std::atomic<uint32> PassCount;
+            static std::atomic<uint32> CulledPassCount;
+            static std::atomic<uint32> BarrierCount;
+            static std::atomic<uint32> SkippedBarrierCount;
+            static std::atomic<uint64> TextureMemory;
+            static std::atomic<uint64> UnaliasedTextureMemory;
+        };
+
+        /** Graphics pipelines that have been requested from the pipeline cache */
+        struct Pipelines
+        {
+        public:
+            /** Pipelines that are compiled and ready to draw with */
+            static uint32 GetCachedCount();
+
+            /** Pipelines waiting on or being compiled by a worker thread */
+            static uint32 GetPendingCount();
+
+            /** Requests that found a pipeline that was already compiled */
+            static uint32 GetHitCount();
+
+            static uint32 GetCompileCount();
+
+            static void SetCacheResults(uint32 t_Cached, uint32 t_Pending, uint32 t_Hits, uint32 t_Compiles);
+
+		private:
+
+            static std::atomic<uint32> CachedCount;
+            static std::atomic<uint32> PendingCount;
+            static std::atomic<uint32> HitCount;
+            static std::atomic<uint32> CompileCount;
+        };
+
+        /** Time that one GPU profiler scope took in the last frame that was resolved */
+        struct GpuScopeTiming
+        {
+            /** Owned by the profiler, valid until it is destroyed */
+            const char* Name = nullptr;
+
+            /** How many scopes this one is nested in */
+            uint32 Depth = 0;
+
+            float Milliseconds = 0.0f;
+
+            /** Smoothed over the last frames that had a scope with the same name */
+            float AverageMilliseconds = 0.0f;
+        };
+
+        /** GPU timestamps of the last frame that the profiler read back */
+        struct Gpu
+        {
+        public:
+            /** Milliseconds from the first to the last command of the frame */
+            static float GetFrameTime();
+
+            static float GetAverageFrameTime();
+
+            /** In the order that they were recorded. A copy, the render thread may set new results at any time */
+            static std::vector<GpuScopeTiming> GetScopes();
+
+            static void SetFrameResults(float t_FrameTime, float t_AverageFrameTime, const std::vector<GpuScopeTiming>& t_Scopes);
+
+		private:
+
+            static std::atomic<float> FrameTime;
+            static std::atomic<float> AverageFrameTime;
+            static std::vector<GpuScopeTiming> Scopes;
+            static std::mutex ScopesMutex;
+        };
+
+        /** Triangles of the meshes that a level of detail was picked for in the last frame */
+        struct Lod
+        {
+        public:
+            /** Triangles of the levels that were picked */
+            static uint32 GetTriangleCount();
+
+            /** Triangles that the same meshes have at full detail */
+            static uint32 GetFullDetailTriangleCount();
+
+            static void SetSelectionResults(uint32 t_Triangles, uint32 t_FullDetailTriangles);
+
+		private:
+
+            static uint32 TriangleCount;
+            static uint32 FullDetailTriangleCount;
+        };
+
+        /** Clusters of the visible meshes that were culled on their own in the last frame */
+        struct Meshlets
+        {
+        public:
+            static uint32 GetClusterCount();
+
+            /** Off screen or facing away from the camera */
+            static uint32 GetCulledClusterCount();
+
+            /** Triangles of the levels of detail that were split into clusters */
+            static uint32 GetTriangleCount();
+
+            /** Triangles that weren't drawn because their cluster was culled */
+            static uint32 GetCulledTriangleCount();
+
+            static void SetCullResults(uint32 t_Clusters, uint32 t_CulledClusters, uint32 t_Triangles, uint32 t_CulledTriangles);
+
+		private:
+
+            static uint32 ClusterCount;
+            static uint32 CulledClusterCount;
+            static uint32 TriangleCount;
+            static uint32 CulledTriangleCount;
+        };
+
+        /** How the G-Buffer draws of the last frame were recorded */
+        struct Draws
+        {
+        public:
+            static uint32 GetDrawCount();
+
+            /** Pipeline, descriptor set, vertex buffer and push constant updates that were recorded */
+            static uint32 GetStateChangeCount();
+
+            /** Push constant updates that were skipped because the last draw had the same values */
+            static uint32 GetSkippedStateChangeCount();
+
+            static void SetRecordResults(uint32 t_Draws, uint32 t_StateChanges, uint32 t_Skipped);
+
+		private:
+
+            static std::atomic<uint32> DrawCount;
+            static std::atomic<uint32> StateChangeCount;
+            static std::atomic<uint32> SkippedStateChangeCount;
+        };
+
+        /** Size that the scene was rendered at before the lighting pass scaled it up to the output */
+        struct Resolution
+        {
+        public:
+            /** Fraction of the output size along each axis */
+            static float GetScale();
+
+            static uint32 GetWidth();
+
+            static uint32 GetHeight();
+
+            static void SetRenderResolution(float t_Scale, uint32 t_Width, uint32 t_Height);
+
+		private:
+
+            static float Scale;
+            static uint32 Width;
+            static uint32 Height;
+        };
+
+        /** Fragments that the G-Buffer shaded, read back from a pipeline statistics query */
+        struct Overdraw
+        {
+        public:
+            /** Fragment shader invocations of the G-Buffer draws in the last frame that was read back */
+            static uint64 GetFragmentCount();
+
+            /** Pixels that frame was rendered at */
+            static uint64 GetPixelCount();
+
+            /** Fragments per pixel, 1 means every pixel was shaded once */
+            static float GetRatio();
+
+            /** Ratio over every frame since the start */
+            static float GetAverageRatio();
+
+            static uint64 GetFrameCount();
+
+            /** If the depth prepass was on for that frame */
+            static bool WasPrepassEnabled();
+
+            static void SetFrameResults(uint64 t_Fragments, uint64 t_Pixels, bool t_Prepass);
+
+		private:
+
+            static std::atomic<uint64> FragmentCount;
+            static std::atomic<uint64> PixelCount;
+            static std::atomic<bool> PrepassEnabled;
+            static std::atomic<double> RatioSum;
+            static std::atomic<uint64> FrameCount;
+        };
     }
 }
\ No newline at end of file
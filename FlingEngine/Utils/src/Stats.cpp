@@ -21,5 +21,345 @@ namespace Fling
         {
             FPSCounter.Push(t_DeltaTime);
         }
+
+        uint32 Culling::VisibleCount = 0;
+        uint32 Culling::FrustumCulledCount = 0;
+        uint32 Culling::OcclusionCulledCount = 0;
+        uint32 Culling::OccluderCount = 0;
+
+        uint32 Culling::GetVisibleCount()
+        {
+            return VisibleCount;
+        }
+
+        uint32 Culling::GetFrustumCulledCount()
+        {
+            return FrustumCulledCount;
+        }
+
+        uint32 Culling::GetOcclusionCulledCount()
+        {
+            return OcclusionCulledCount;
+        }
+
+        uint32 Culling::GetOccluderCount()
+        {
+            return OccluderCount;
+        }
+
+        uint32 Culling::GetTotalCount()
+        {
+            return VisibleCount + FrustumCulledCount + OcclusionCulledCount;
+        }
+
+        void Culling::SetFrustumCullResults(uint32 t_Visible, uint32 t_Culled)
+        {
+            VisibleCount = t_Visible;
+            FrustumCulledCount = t_Culled;
+            OcclusionCulledCount = 0;
+            OccluderCount = 0;
+        }
+
+        void Culling::SetOcclusionCullResults(uint32 t_Culled, uint32 t_Occluders)
+        {
+            OcclusionCulledCount = t_Culled;
+            OccluderCount = t_Occluders;
+        }
+
+        std::atomic<uint32> Lighting::PointLightCount { 0 };
+        std::atomic<uint32> Lighting::LightIndexCount { 0 };
+        std::atomic<uint32> Lighting::MaxLightsPerCluster { 0 };
+
+        uint32 Lighting::GetPointLightCount()
+        {
+            return PointLightCount;
+        }
+
+        uint32 Lighting::GetLightIndexCount()
+        {
+            return LightIndexCount;
+        }
+
+        uint32 Lighting::GetMaxLightsPerCluster()
+        {
+            return MaxLightsPerCluster;
+        }
+
+        void Lighting::SetClusterResults(uint32 t_PointLights, uint32 t_LightIndices, uint32 t_MaxPerCluster)
+        {
+            PointLightCount = t_PointLights;
+            LightIndexCount = t_LightIndices;
+            MaxLightsPerCluster = t_MaxPerCluster;
+        }
+    
+
+        std::atomic<uint32> RenderGraph::PassCount { 0 };
+        std::atomic<uint32> RenderGraph::CulledPassCount { 0 };
+        std::atomic<uint32> RenderGraph::BarrierCount { 0 };
+        std::atomic<uint32> RenderGraph::SkippedBarrierCount { 0 };
+        std::atomic<uint64> RenderGraph::TextureMemory { 0 };
+        std::atomic<uint64> RenderGraph::UnaliasedTextureMemory { 0 };
+
+        uint32 RenderGraph::GetPassCount()
+        {
+            return PassCount;
+        }
+
+        uint32 RenderGraph::GetCulledPassCount()
+        {
+            return CulledPassCount;
+        }
+
+        uint32 RenderGraph::GetBarrierCount()
+        {
+            return BarrierCount;
+        }
+
+        uint32 RenderGraph::GetSkippedBarrierCount()
+        {
+            return SkippedBarrierCount;
+        }
+
+        uint64 RenderGraph::GetTextureMemory()
+        {
+            return TextureMemory;
+        }
+
+        uint64 RenderGraph::GetUnaliasedTextureMemory()
+        {
+            return UnaliasedTextureMemory;
+        }
+
+        void RenderGraph::SetCompileResults(uint32 t_Passes, uint32 t_Culled, uint32 t_Barriers, uint32 t_Skipped)
+        {
+            PassCount = t_Passes;
+            CulledPassCount = t_Culled;
+            BarrierCount = t_Barriers;
+            SkippedBarrierCount = t_Skipped;
+        }
+
+        void RenderGraph::SetMemoryResults(uint64 t_Memory, uint64 t_Unaliased)
+        {
+            TextureMemory = t_Memory;
+            UnaliasedTextureMemory = t_Unaliased;
+        }
+
+
+        std::atomic<uint32> Pipelines::CachedCount { 0 };
+        std::atomic<uint32> Pipelines::PendingCount { 0 };
+        std::atomic<uint32> Pipelines::HitCount { 0 };
+        std::atomic<uint32> Pipelines::CompileCount { 0 };
+
+        uint32 Pipelines::GetCachedCount()
+        {
+            return CachedCount;
+        }
+
+        uint32 Pipelines::GetPendingCount()
+        {
+            return PendingCount;
+        }
+
+        uint32 Pipelines::GetHitCount()
+        {
+            return HitCount;
+        }
+
+        uint32 Pipelines::GetCompileCount()
+        {
+            return CompileCount;
+        }
+
+        void Pipelines::SetCacheResults(uint32 t_Cached, uint32 t_Pending, uint32 t_Hits, uint32 t_Compiles)
+        {
+            CachedCount = t_Cached;
+            PendingCount = t_Pending;
+            HitCount = t_Hits;
+            CompileCount = t_Compiles;
+        }
+
+        std::atomic<float> Gpu::FrameTime { 0.0f };
+        std::atomic<float> Gpu::AverageFrameTime { 0.0f };
+        std::vector<GpuScopeTiming> Gpu::Scopes;
+        std::mutex Gpu::ScopesMutex;
+
+        float Gpu::GetFrameTime()
+        {
+            return FrameTime;
+        }
+
+        float Gpu::GetAverageFrameTime()
+        {
+            return AverageFrameTime;
+        }
+
+        std::vector<GpuScopeTiming> Gpu::GetScopes()
+        {
+            std::lock_guard<std::mutex> Lock(ScopesMutex);
+            return Scopes;
+        }
+
+        void Gpu::SetFrameResults(float t_FrameTime, float t_AverageFrameTime, const std::vector<GpuScopeTiming>& t_Scopes)
+        {
+            FrameTime = t_FrameTime;
+            AverageFrameTime = t_AverageFrameTime;
+
+            std::lock_guard<std::mutex> Lock(ScopesMutex);
+            Scopes = t_Scopes;
+        }
+
+        uint32 Lod::TriangleCount = 0;
+        uint32 Lod::FullDetailTriangleCount = 0;
+
+        uint32 Lod::GetTriangleCount()
+        {
+            return TriangleCount;
+        }
+
+        uint32 Lod::GetFullDetailTriangleCount()
+        {
+            return FullDetailTriangleCount;
+        }
+
+        void Lod::SetSelectionResults(uint32 t_Triangles, uint32 t_FullDetailTriangles)
+        {
+            TriangleCount = t_Triangles;
+            FullDetailTriangleCount = t_FullDetailTriangles;
+        }
+
+        uint32 Meshlets::ClusterCount = 0;
+        uint32 Meshlets::CulledClusterCount = 0;
+        uint32 Meshlets::TriangleCount = 0;
+        uint32 Meshlets::CulledTriangleCount = 0;
+
+        uint32 Meshlets::GetClusterCount()
+        {
+            return ClusterCount;
+        }
+
+        uint32 Meshlets::GetCulledClusterCount()
+        {
+            return CulledClusterCount;
+        }
+
+        uint32 Meshlets::GetTriangleCount()
+        {
+            return TriangleCount;
+        }
+
+        uint32 Meshlets::GetCulledTriangleCount()
+        {
+            return CulledTriangleCount;
+        }
+
+        void Meshlets::SetCullResults(uint32 t_Clusters, uint32 t_CulledClusters, uint32 t_Triangles, uint32 t_CulledTriangles)
+        {
+            ClusterCount = t_Clusters;
+            CulledClusterCount = t_CulledClusters;
+            TriangleCount = t_Triangles;
+            CulledTriangleCount = t_CulledTriangles;
+        }
+
+        std::atomic<uint32> Draws::DrawCount { 0 };
+        std::atomic<uint32> Draws::StateChangeCount { 0 };
+        std::atomic<uint32> Draws::SkippedStateChangeCount { 0 };
+
+        uint32 Draws::GetDrawCount()
+        {
+            return DrawCount;
+        }
+
+        uint32 Draws::GetStateChangeCount()
+        {
+            return StateChangeCount;
+        }
+
+        uint32 Draws::GetSkippedStateChangeCount()
+        {
+            return SkippedStateChangeCount;
+        }
+
+        void Draws::SetRecordResults(uint32 t_Draws, uint32 t_StateChanges, uint32 t_Skipped)
+        {
+            DrawCount = t_Draws;
+            StateChangeCount = t_StateChanges;
+            SkippedStateChangeCount = t_Skipped;
+        }
+
+        float Resolution::Scale = 1.0f;
+        uint32 Resolution::Width = 0;
+        uint32 Resolution::Height = 0;
+
+        float Resolution::GetScale()
+        {
+            return Scale;
+        }
+
+        uint32 Resolution::GetWidth()
+        {
+            return Width;
+        }
+
+        uint32 Resolution::GetHeight()
+        {
+            return Height;
+        }
+
+        void Resolution::SetRenderResolution(float t_Scale, uint32 t_Width, uint32 t_Height)
+        {
+            Scale = t_Scale;
+            Width = t_Width;
+            Height = t_Height;
+        }
+
+        std::atomic<uint64> Overdraw::FragmentCount { 0 };
+        std::atomic<uint64> Overdraw::PixelCount { 0 };
+        std::atomic<bool> Overdraw::PrepassEnabled { false };
+        std::atomic<double> Overdraw::RatioSum { 0.0 };
+        std::atomic<uint64> Overdraw::FrameCount { 0 };
+
+        uint64 Overdraw::GetFragmentCount()
+        {
+            return FragmentCount;
+        }
+
+        uint64 Overdraw::GetPixelCount()
+        {
+            return PixelCount;
+        }
+
+        float Overdraw::GetRatio()
+        {
+            return PixelCount > 0 ? static_cast<float>(static_cast<double>(FragmentCount) / static_cast<double>(PixelCount)) : 0.0f;
+        }
+
+        float Overdraw::GetAverageRatio()
+        {
+            return FrameCount > 0 ? static_cast<float>(RatioSum / static_cast<double>(FrameCount)) : 0.0f;
+        }
+
+        uint64 Overdraw::GetFrameCount()
+        {
+            return FrameCount;
+        }
+
+        bool Overdraw::WasPrepassEnabled()
+        {
+            return PrepassEnabled;
+        }
+
+        void Overdraw::SetFrameResults(uint64 t_Fragments, uint64 t_Pixels, bool t_Prepass)
+        {
+            FragmentCount = t_Fragments;
+            PixelCount = t_Pixels;
+            PrepassEnabled = t_Prepass;
+
+            if (t_Pixels > 0)
+            {
+                // Only ever written by the thread that renders, so this doesn't need to be a single atomic add
+                RatioSum = RatioSum + static_cast<double>(t_Fragments) / static_cast<double>(t_Pixels);
+                ++FrameCount;
+            }
+        }
     }
 }
\ No newline at end of file
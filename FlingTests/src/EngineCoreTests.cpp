@@ -5,6 +5,7 @@
 #include "pch.h"
 
 #include "Engine.h"
+#include "Components/Transform.h"
 
 TEST_CASE("Smoke test", "[core]")
 {
@@ -25,4 +26,42 @@ TEST_CASE("Smoke test", "[core]")
         REQUIRE(true);
     }
 
-}
\ No newline at end of file
+}
+
+TEST_CASE("Transform dirty tracking", "[core]")
+{
+    using namespace Fling;
+
+    entt::registry Reg;
+    std::vector<entt::entity> Changed;
+
+    entt::entity Moving = Reg.create();
+    entt::entity Static = Reg.create();
+    Reg.assign<Transform>(Moving);
+    Reg.assign<Transform>(Static).SetPos(glm::vec3(1.0f, 2.0f, 3.0f));
+
+    // Everything starts out dirty
+    Transform::UpdateDirtyWorldMatrices(Reg, Changed);
+    REQUIRE(Changed.size() == 2);
+    REQUIRE(Reg.get<Transform>(Static).GetWorldMat() == Reg.get<Transform>(Static).GetWorldMatrix());
+
+    SECTION("Nothing moved")
+    {
+        Transform::UpdateDirtyWorldMatrices(Reg, Changed);
+        REQUIRE(Changed.empty());
+    }
+
+    SECTION("Setters mark dirty")
+    {
+        Transform& Trans = Reg.get<Transform>(Moving);
+        Trans.SetPos(glm::vec3(5.0f, 0.0f, 0.0f));
+        Trans.SetScale(glm::vec3(2.0f));
+        REQUIRE(Trans.IsDirty());
+
+        Transform::UpdateDirtyWorldMatrices(Reg, Changed);
+        REQUIRE(Changed.size() == 1);
+        REQUIRE(Changed[0] == Moving);
+        REQUIRE_FALSE(Trans.IsDirty());
+        REQUIRE(Trans.GetWorldMat() == Trans.GetWorldMatrix());
+    }
+}
@@ -2,10 +2,2159 @@
 
 #include "pch.h"
 
+#include "Frustum.h"
+#include "DynamicBVH.h"
+#include "IndirectDraw.h"
+#include "LightClusters.h"
+#include "GBufferPacking.h"
+#include "RenderGraph.h"
+#include "TextureSlots.h"
+#include "PipelineKey.h"
+#include "GpuProfiler.h"
+#include "MeshSimplifier.h"
+#include "OcclusionCuller.h"
+#include "DynamicResolution.h"
+#include "DepthPrepass.h"
+#include "Vertex.h"
+#include "DebugDraw.h"
+#include "RenderHandoff.h"
+#include "RangeAllocator.h"
+#include "Meshlets.h"
+#include "DrawSort.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 TEST_CASE("Renderer", "[Renderer]")
 {
     SECTION("Smoke test")
     {
         REQUIRE(true);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Frustum Culling", "[Renderer]")
+{
+    using namespace Fling;
+
+    // Camera at the origin looking down -Z
+    glm::mat4 View = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 Proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    Frustum ViewFrustum(Proj * View);
+
+    AABB UnitBox;
+    UnitBox.Expand(glm::vec3(-1.0f));
+    UnitBox.Expand(glm::vec3(1.0f));
+
+    SECTION("Scalar tests")
+    {
+        REQUIRE(ViewFrustum.IntersectsAABB(UnitBox.Transformed(glm::translate(glm::vec3(0.0f, 0.0f, -10.0f)))));
+        REQUIRE_FALSE(ViewFrustum.IntersectsAABB(UnitBox.Transformed(glm::translate(glm::vec3(0.0f, 0.0f, 10.0f)))));
+        REQUIRE_FALSE(ViewFrustum.IntersectsAABB(UnitBox.Transformed(glm::translate(glm::vec3(0.0f, 0.0f, -200.0f)))));
+        REQUIRE(ViewFrustum.IntersectsSphere(glm::vec3(0.0f, 0.0f, -50.0f), 1.0f));
+        REQUIRE_FALSE(ViewFrustum.IntersectsSphere(glm::vec3(100.0f, 0.0f, -10.0f), 1.0f));
+    }
+
+    SECTION("Culler matches the scalar tests")
+    {
+        FrustumCuller Culler;
+        std::vector<bool> Expected;
+
+        // Enough boxes to fill a few SIMD lanes plus some left overs
+        for (int i = 0; i < 23; ++i)
+        {
+            AABB Box = UnitBox.Transformed(glm::translate(glm::vec3(i * 3.0f - 30.0f, 0.0f, -15.0f + (i % 3) * 10.0f)));
+            Culler.Add(Box);
+            Expected.push_back(ViewFrustum.IntersectsAABB(Box));
+        }
+
+        std::vector<uint32> Visible;
+        uint32 VisibleCount = Culler.Cull(ViewFrustum, Visible);
+        REQUIRE(VisibleCount == Visible.size());
+        REQUIRE(VisibleCount > 0);
+        REQUIRE(VisibleCount < Culler.GetCount());
+
+        std::vector<bool> Actual(Expected.size(), false);
+        for (uint32 Index : Visible)
+        {
+            Actual[Index] = true;
+        }
+        REQUIRE(Actual == Expected);
+    }
+}
+
+namespace
+{
+    Fling::AABB MakeBox(const glm::vec3& t_Center, float t_HalfSize)
+    {
+        Fling::AABB Box;
+        Box.Expand(t_Center - glm::vec3(t_HalfSize));
+        Box.Expand(t_Center + glm::vec3(t_HalfSize));
+        return Box;
+    }
+
+    /** Visible set from the BVH, with the intersecting leaves tested on their tight bounds */
+    std::vector<bool> QueryVisible(const Fling::DynamicBVH& t_Tree, const Fling::Frustum& t_Frustum, const std::vector<Fling::AABB>& t_Boxes)
+    {
+        std::vector<uint32> Inside;
+        std::vector<uint32> Intersecting;
+        t_Tree.QueryFrustum(t_Frustum, Inside, Intersecting);
+
+        std::vector<bool> Visible(t_Boxes.size(), false);
+        for (uint32 Index : Inside)
+        {
+            Visible[Index] = true;
+        }
+        for (uint32 Index : Intersecting)
+        {
+            Visible[Index] = t_Frustum.IntersectsAABB(t_Boxes[Index]);
+        }
+        return Visible;
+    }
+}
+
+TEST_CASE("Dynamic BVH", "[Renderer]")
+{
+    using namespace Fling;
+
+    std::mt19937 Rng(1234);
+    std::uniform_real_distribution<float> Dist(-200.0f, 200.0f);
+
+    glm::mat4 View = glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(50.0f, 0.0f, 50.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 Proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+    Frustum ViewFrustum(Proj * View);
+
+    const uint32 Count = 2000;
+    DynamicBVH Tree;
+    std::vector<AABB> Boxes;
+    std::vector<int32> Proxies;
+    for (uint32 i = 0; i < Count; ++i)
+    {
+        Boxes.emplace_back(MakeBox(glm::vec3(Dist(Rng), Dist(Rng) * 0.1f, Dist(Rng)), 1.0f));
+        Proxies.emplace_back(Tree.CreateProxy(Boxes.back(), i));
+    }
+
+    auto MatchesBruteForce = [&]()
+    {
+        std::vector<bool> Visible = QueryVisible(Tree, ViewFrustum, Boxes);
+        for (uint32 i = 0; i < Count; ++i)
+        {
+            bool Expected = Proxies[i] != DynamicBVH::NullNode && ViewFrustum.IntersectsAABB(Boxes[i]);
+            if (Visible[i] != Expected)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    REQUIRE(Tree.GetProxyCount() == Count);
+    REQUIRE(MatchesBruteForce());
+
+    SECTION("Moving proxies")
+    {
+        for (uint32 i = 0; i < Count; i += 3)
+        {
+            Boxes[i] = MakeBox(glm::vec3(Dist(Rng), 0.0f, Dist(Rng)), 2.0f);
+            Tree.MoveProxy(Proxies[i], Boxes[i]);
+        }
+        REQUIRE(MatchesBruteForce());
+
+        // Small moves should stay inside of the fat box
+        AABB Nudged = Boxes[1];
+        Nudged.Min += glm::vec3(0.01f);
+        Nudged.Max += glm::vec3(0.01f);
+        REQUIRE_FALSE(Tree.MoveProxy(Proxies[1], Nudged));
+    }
+
+    SECTION("Removing proxies")
+    {
+        for (uint32 i = 0; i < Count; i += 2)
+        {
+            Tree.DestroyProxy(Proxies[i]);
+            Proxies[i] = DynamicBVH::NullNode;
+        }
+        REQUIRE(Tree.GetProxyCount() == Count / 2);
+        REQUIRE(MatchesBruteForce());
+    }
+
+    SECTION("Rebuild keeps proxies")
+    {
+        Tree.Rebuild();
+        REQUIRE(Tree.GetReinsertCount() == 0);
+        REQUIRE(Tree.GetProxyCount() == Count);
+        REQUIRE(MatchesBruteForce());
+        // A balanced tree of 2000 leaves should be around 11 deep
+        REQUIRE(Tree.GetHeight() < 16);
+    }
+}
+
+TEST_CASE("Indirect draw culling", "[Renderer]")
+{
+    using namespace Fling;
+
+    std::mt19937 Rng(7);
+    std::uniform_real_distribution<float> Dist(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> ScaleDist(0.5f, 3.0f);
+
+    glm::mat4 View = glm::lookAt(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(20.0f, 0.0f, 20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 Proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 80.0f);
+    Frustum ViewFrustum(Proj * View);
+
+    AABB LocalBox = MakeBox(glm::vec3(0.0f, 1.0f, 0.0f), 1.0f);
+
+    // A few batches of different sizes, like a handful of models and materials
+    IndirectDrawList DrawList;
+    std::vector<bool> Expected;
+    const uint32 BatchSizes[] = { 1, 40, 7, 300, 64 };
+    for (uint32 BatchSize : BatchSizes)
+    {
+        DrawList.BeginBatch();
+        for (uint32 i = 0; i < BatchSize; ++i)
+        {
+            GpuObjectData Object = {};
+            Object.World = glm::translate(glm::vec3(Dist(Rng), 0.0f, Dist(Rng))) * glm::scale(glm::vec3(ScaleDist(Rng)));
+            Object.BoundsCenter = glm::vec4(LocalBox.GetCenter(), 0.0f);
+            Object.BoundsExtents = glm::vec4(LocalBox.GetExtents(), 0.0f);
+            Object.IndexCount = 36;
+            DrawList.AddObject(Object);
+
+            Expected.push_back(ViewFrustum.IntersectsAABB(LocalBox.Transformed(Object.World)));
+        }
+    }
+
+    std::vector<uint32> ExpectedVisible;
+    for (uint32 i = 0; i < Expected.size(); ++i)
+    {
+        if (Expected[i])
+        {
+            ExpectedVisible.push_back(i);
+        }
+    }
+
+    REQUIRE(DrawList.GetObjectCount() == Expected.size());
+    REQUIRE(DrawList.GetBatchCount() == 5);
+    REQUIRE(DrawList.GetObjects()[41].BatchIndex == 2);
+    REQUIRE(!ExpectedVisible.empty());
+    REQUIRE(ExpectedVisible.size() < Expected.size());
+
+    std::vector<DrawIndexedCommand> Commands;
+    std::vector<uint32> Counts;
+    std::vector<uint32> Visible;
+
+    SECTION("One command per object")
+    {
+        DrawList.Cull(ViewFrustum, false, Commands, Counts);
+        REQUIRE(Commands.size() == Expected.size());
+        for (uint32 i = 0; i < Commands.size(); ++i)
+        {
+            REQUIRE(Commands[i].FirstInstance == i);
+            REQUIRE(Commands[i].IndexCount == 36);
+        }
+
+        DrawList.GatherVisibleObjects(Commands.data(), nullptr, Visible);
+        REQUIRE(Visible == ExpectedVisible);
+    }
+
+    SECTION("Compacted commands")
+    {
+        DrawList.Cull(ViewFrustum, true, Commands, Counts);
+        REQUIRE(Counts.size() == DrawList.GetBatchCount());
+
+        // Every visible draw has to be packed in the front of its own batch
+        for (uint32 BatchIndex = 0; BatchIndex < DrawList.GetBatchCount(); ++BatchIndex)
+        {
+            const IndirectBatch& Batch = DrawList.GetBatches()[BatchIndex];
+            REQUIRE(Counts[BatchIndex] <= Batch.CommandCount);
+            for (uint32 i = 0; i < Counts[BatchIndex]; ++i)
+            {
+                const DrawIndexedCommand& Command = Commands[Batch.FirstCommand + i];
+                REQUIRE(Command.InstanceCount == 1);
+                REQUIRE(DrawList.GetObjects()[Command.FirstInstance].BatchIndex == BatchIndex);
+            }
+        }
+
+        DrawList.GatherVisibleObjects(Commands.data(), Counts.data(), Visible);
+        REQUIRE(Visible == ExpectedVisible);
+    }
+}
+
+TEST_CASE("Indirect draw levels of detail", "[Renderer]")
+{
+    using namespace Fling;
+
+    glm::mat4 View = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 Proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    Frustum ViewFrustum(Proj * View);
+
+    LodSelector Selector;
+    Selector.PixelsPerUnit = LodSelector::ProjectionScale(Proj, 720);
+
+    // Same offsets as a model that isn't first in the geometry buffer
+    const uint32 ModelFirstIndex = 600;
+    const std::vector<MeshLod> MeshLods =
+    {
+        { 0, 300, 0.0f },
+        { 300, 120, 0.01f },
+        { 420, 36, 0.1f },
+    };
+
+    AABB LocalBox = MakeBox(glm::vec3(0.0f), 1.0f);
+    BoundingSphere LocalSphere;
+    LocalSphere.Center = LocalBox.GetCenter();
+    LocalSphere.Radius = glm::length(LocalBox.GetExtents());
+
+    IndirectDrawList DrawList;
+    DrawList.BeginBatch();
+    for (const MeshLod& Lod : MeshLods)
+    {
+        GpuLodData LodData = {};
+        LodData.FirstIndex = ModelFirstIndex + Lod.FirstIndex;
+        LodData.IndexCount = Lod.IndexCount;
+        LodData.Error = Lod.Error;
+        DrawList.AddLod(LodData);
+    }
+
+    // A row going away from the camera, and every fourth one behind it. Uniform scales without
+    // rotation, so the sphere around the world box is the one that LodSelector uses
+    std::mt19937 Rng(21);
+    std::uniform_real_distribution<float> ScaleDist(0.5f, 2.0f);
+    for (uint32 i = 0; i < 200; ++i)
+    {
+        const float Depth = (i % 4 == 3 ? -1.0f : 1.0f) * (2.0f + static_cast<float>(i) * 2.0f);
+
+        GpuObjectData Object = {};
+        Object.World = glm::translate(glm::vec3(0.0f, 0.0f, Depth)) * glm::scale(glm::vec3(ScaleDist(Rng)));
+        Object.BoundsCenter = glm::vec4(LocalBox.GetCenter(), 0.0f);
+        Object.BoundsExtents = glm::vec4(LocalBox.GetExtents(), 0.0f);
+        Object.FirstIndex = ModelFirstIndex;
+        Object.IndexCount = MeshLods[0].IndexCount;
+        DrawList.AddObject(Object);
+    }
+
+    REQUIRE(DrawList.GetBatches()[0].LodCount == 3);
+
+    std::vector<DrawIndexedCommand> Commands;
+    std::vector<uint32> Counts;
+
+    SECTION("Only visible objects pick a level")
+    {
+        GpuCullConstants Constants = {};
+        DrawList.GetCullConstants(ViewFrustum, false, Selector, Constants);
+
+        // Start everything at the coarsest level so that the hysteresis matters on the way back
+        std::vector<uint32> Levels(DrawList.GetObjectCount(), 2);
+        DrawList.Cull(Constants, Levels, Commands, Counts);
+
+        uint32 PickedFull = 0;
+        uint32 PickedCoarser = 0;
+        for (uint32 i = 0; i < DrawList.GetObjectCount(); ++i)
+        {
+            const GpuObjectData& Object = DrawList.GetObjects()[i];
+            const DrawIndexedCommand& Command = Commands[i];
+
+            if (Command.InstanceCount == 0)
+            {
+                REQUIRE(Levels[i] == 2);
+                REQUIRE(Command.IndexCount == MeshLods[0].IndexCount);
+                continue;
+            }
+
+            REQUIRE(Levels[i] == Selector.Select(MeshLods, LocalSphere, Object.World, 2));
+            REQUIRE(Command.FirstIndex == ModelFirstIndex + MeshLods[Levels[i]].FirstIndex);
+            REQUIRE(Command.IndexCount == MeshLods[Levels[i]].IndexCount);
+            if (Levels[i] == 0)
+            {
+                ++PickedFull;
+            }
+            else
+            {
+                ++PickedCoarser;
+            }
+        }
+        REQUIRE(PickedFull > 0);
+        REQUIRE(PickedCoarser > 0);
+
+        // Culled objects don't count towards the stats
+        uint32 Triangles = 0;
+        uint32 FullDetailTriangles = 0;
+        DrawList.CountTriangles(Commands.data(), nullptr, Triangles, FullDetailTriangles);
+        REQUIRE(FullDetailTriangles == (PickedFull + PickedCoarser) * MeshLods[0].IndexCount / 3);
+        REQUIRE(Triangles < FullDetailTriangles);
+    }
+
+    SECTION("Compacted commands use the same levels")
+    {
+        GpuCullConstants Constants = {};
+        DrawList.GetCullConstants(ViewFrustum, true, Selector, Constants);
+
+        std::vector<uint32> Levels;
+        DrawList.Cull(Constants, Levels, Commands, Counts);
+        REQUIRE(Levels.size() == DrawList.GetObjectCount());
+
+        REQUIRE(Counts[0] > 0);
+        for (uint32 i = 0; i < Counts[0]; ++i)
+        {
+            const DrawIndexedCommand& Command = Commands[i];
+            REQUIRE(Command.IndexCount == MeshLods[Levels[Command.FirstInstance]].IndexCount);
+        }
+    }
+
+    SECTION("Without a selector everything is full detail")
+    {
+        DrawList.Cull(ViewFrustum, false, Commands, Counts);
+        for (const DrawIndexedCommand& Command : Commands)
+        {
+            REQUIRE(Command.FirstIndex == ModelFirstIndex);
+            REQUIRE(Command.IndexCount == MeshLods[0].IndexCount);
+        }
+    }
+}
+
+TEST_CASE("Clustered lights", "[Renderer]")
+{
+    using namespace Fling;
+
+    const float Near = 0.1f;
+    const float Far = 200.0f;
+    glm::mat4 Proj = glm::perspective(glm::radians(60.0f), 1280.0f / 720.0f, Near, Far);
+    Proj[1][1] *= -1.0f;
+
+    LightClusterGrid Grid;
+    Grid.SetProjection(Proj, Near, Far, 1280, 720);
+
+    std::mt19937 Rng(99);
+    std::uniform_real_distribution<float> Side(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> Depth(-5.0f, 180.0f);
+    std::uniform_real_distribution<float> Range(0.5f, 12.0f);
+    std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+
+    // View space lights, including some behind the camera and some crossing the near plane
+    std::vector<glm::vec4> Lights;
+    for (int i = 0; i < 1003; ++i)
+    {
+        Lights.emplace_back(Side(Rng), Side(Rng) * 0.5f, -Depth(Rng), Range(Rng));
+    }
+    Lights.emplace_back(0.0f, 0.0f, 1.0f, 3.0f);
+
+    Grid.Build(Lights.data(), static_cast<uint32>(Lights.size()));
+
+    const std::vector<LightClusterRange>& Clusters = Grid.GetClusters();
+    const std::vector<uint32>& Indices = Grid.GetLightIndices();
+    REQUIRE(Clusters.size() == LightClusterGrid::ClusterCount);
+
+    auto ClusterHasLight = [&](uint32 t_Cluster, uint32 t_Light)
+    {
+        const LightClusterRange& Range = Clusters[t_Cluster];
+        return std::binary_search(Indices.begin() + Range.Offset, Indices.begin() + Range.Offset + Range.Count, t_Light);
+    };
+
+    SECTION("Index list is packed and sorted")
+    {
+        uint32 Offset = 0;
+        for (const LightClusterRange& Range : Clusters)
+        {
+            REQUIRE(Range.Offset == Offset);
+            REQUIRE(std::is_sorted(Indices.begin() + Range.Offset, Indices.begin() + Range.Offset + Range.Count));
+            REQUIRE(Range.Count <= Grid.GetMaxLightsPerCluster());
+            Offset += Range.Count;
+        }
+        REQUIRE(Offset == Indices.size());
+        REQUIRE(Grid.GetMaxLightsPerCluster() < Lights.size());
+    }
+
+    SECTION("Every light is a real overlap")
+    {
+        for (uint32 Cluster = 0; Cluster < LightClusterGrid::ClusterCount; ++Cluster)
+        {
+            const AABB Bounds = Grid.GetClusterBounds(Cluster);
+            for (uint32 i = 0; i < Clusters[Cluster].Count; ++i)
+            {
+                const glm::vec4& Light = Lights[Indices[Clusters[Cluster].Offset + i]];
+                REQUIRE(LightClusterGrid::SphereIntersectsBox(glm::vec3(Light), Light.w, Bounds.Min, Bounds.Max));
+            }
+        }
+    }
+
+    SECTION("No light is missed by the shader lookup")
+    {
+        // Points inside of each light find that light in the cluster the shader would pick
+        for (uint32 LightIndex = 0; LightIndex < Lights.size(); ++LightIndex)
+        {
+            const glm::vec4& Light = Lights[LightIndex];
+            for (int Sample = 0; Sample < 32; ++Sample)
+            {
+                glm::vec3 Offset(Unit(Rng), Unit(Rng), Unit(Rng));
+                if (glm::length(Offset) > 1.0f)
+                {
+                    continue;
+                }
+
+                const glm::vec3 Point = glm::vec3(Light) + Offset * Light.w * 0.99f;
+                const glm::vec4 Clip = Proj * glm::vec4(Point, 1.0f);
+                const bool OnScreen = Clip.w > Near && Clip.w < Far && glm::abs(Clip.x) < Clip.w && glm::abs(Clip.y) < Clip.w;
+                if (!OnScreen)
+                {
+                    continue;
+                }
+
+                const uint32 Cluster = Grid.GetClusterAt(Point);
+                AABB PointBox;
+                PointBox.Expand(Point - glm::vec3(0.001f));
+                PointBox.Expand(Point + glm::vec3(0.001f));
+                REQUIRE(Grid.GetClusterBounds(Cluster).Overlaps(PointBox));
+                REQUIRE(ClusterHasLight(Cluster, LightIndex));
+            }
+        }
+    }
+}
+
+TEST_CASE("Packed G-Buffer", "[Renderer]")
+{
+    using namespace Fling;
+
+    std::mt19937 Rng(31);
+    std::uniform_real_distribution<float> Dist(-1.0f, 1.0f);
+
+    SECTION("Normals round trip")
+    {
+        // The poles and the folds of the octahedron
+        const glm::vec3 Axes[] =
+        {
+            glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+            glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+            glm::normalize(glm::vec3(-1.0f, -1.0f, -1.0f))
+        };
+        for (const glm::vec3& Axis : Axes)
+        {
+            REQUIRE(glm::dot(GBufferPacking::DecodeNormal(GBufferPacking::EncodeNormal(Axis)), Axis) == Approx(1.0f));
+        }
+
+        for (uint32 i = 0; i < 1000; ++i)
+        {
+            const glm::vec3 Normal = glm::normalize(glm::vec3(Dist(Rng), Dist(Rng), Dist(Rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+            const glm::vec2 Encoded = GBufferPacking::EncodeNormal(Normal);
+            REQUIRE(glm::abs(Encoded.x) <= 1.0f);
+            REQUIRE(glm::abs(Encoded.y) <= 1.0f);
+            REQUIRE(glm::dot(GBufferPacking::DecodeNormal(Encoded), Normal) > 0.999999f);
+
+            // What is left after a trip through the R16G16_SNORM normal target
+            const glm::vec2 Stored = glm::unpackSnorm2x16(glm::packSnorm2x16(Encoded));
+            REQUIRE(glm::dot(GBufferPacking::DecodeNormal(Stored), Normal) > 0.99999f);
+        }
+    }
+
+    SECTION("Positions from depth")
+    {
+        const glm::vec3 Eye(3.0f, 2.0f, 10.0f);
+        const glm::mat4 View = glm::lookAt(Eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 Proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+        Proj[1][1] *= -1.0f;
+        const glm::mat4 ViewProj = Proj * View;
+        const glm::mat4 InvViewProj = glm::inverse(ViewProj);
+
+        // What the G-Buffer pass would have written for a point
+        auto Project = [&ViewProj](const glm::vec3& t_Point, glm::vec2& t_OutUV, float& t_OutDepth)
+        {
+            const glm::vec4 Clip = ViewProj * glm::vec4(t_Point, 1.0f);
+            const glm::vec3 Ndc = glm::vec3(Clip) / Clip.w;
+            t_OutUV = glm::vec2(Ndc) * 0.5f + 0.5f;
+            t_OutDepth = Ndc.z;
+        };
+
+        glm::vec2 UV;
+        float Depth;
+
+        // Y is flipped, so something above the view direction is in the top half of the screen
+        Project(glm::vec3(0.0f, 3.0f, 0.0f), UV, Depth);
+        REQUIRE(UV.y < 0.5f);
+
+        const glm::vec3 Forward = glm::normalize(-Eye);
+        for (uint32 i = 0; i < 1000; ++i)
+        {
+            const float Distance = 1.0f + (Dist(Rng) * 0.5f + 0.5f) * 49.0f;
+            const glm::vec3 Point = Eye + Forward * Distance + glm::vec3(Dist(Rng), Dist(Rng), Dist(Rng)) * Distance * 0.3f;
+            Project(Point, UV, Depth);
+            REQUIRE(Depth > 0.0f);
+            REQUIRE(Depth < 1.0f);
+
+            const glm::vec3 Rebuilt = GBufferPacking::ReconstructPosition(UV, Depth, InvViewProj);
+            REQUIRE(glm::length(Rebuilt - Point) <= Distance * 1e-3f);
+        }
+    }
+}
+
+TEST_CASE("Render graph", "[Renderer]")
+{
+    using namespace Fling;
+
+    // Only compiled, so it never needs a device
+    RenderGraph Graph(nullptr);
+
+    RenderGraphTextureDesc Color = {};
+    Color.Format = VK_FORMAT_R8G8B8A8_UNORM;
+    RenderGraphTextureDesc Depth = {};
+    Depth.Format = VK_FORMAT_D32_SFLOAT;
+
+    RenderGraphTexture Albedo = Graph.CreateTexture("Albedo", Color);
+    RenderGraphTexture SceneDepth = Graph.CreateTexture("Depth", Depth);
+    RenderGraphTexture Hdr = Graph.CreateTexture("HDR", Color);
+    RenderGraphTexture Unused = Graph.CreateTexture("Unused", Color);
+    RenderGraphTexture Bloom = Graph.CreateTexture("Bloom", Color);
+    RenderGraphTexture Final = Graph.CreateTexture("Final", Color);
+
+    uint32 GBufferPass = Graph.AddPass("GBuffer", [&](RenderGraph::PassBuilder& t_Builder)
+    {
+        t_Builder.Write(Albedo, RenderGraphUsage::ColorAttachment);
+        t_Builder.Write(SceneDepth, RenderGraphUsage::DepthAttachment);
+    }, nullptr);
+
+    uint32 LightingPass = Graph.AddPass("Lighting", [&](RenderGraph::PassBuilder& t_Builder)
+    {
+        t_Builder.Read(Albedo, RenderGraphUsage::Sampled);
+        t_Builder.Read(SceneDepth, RenderGraphUsage::Sampled);
+        t_Builder.Write(Hdr, RenderGraphUsage::ColorAttachment);
+    }, nullptr);
+
+    uint32 UnusedPass = Graph.AddPass("Unused", [&](RenderGraph::PassBuilder& t_Builder)
+    {
+        t_Builder.Read(Hdr, RenderGraphUsage::Sampled);
+        t_Builder.Write(Unused, RenderGraphUsage::ColorAttachment);
+    }, nullptr);
+
+    uint32 BloomPass = Graph.AddPass("Bloom", [&](RenderGraph::PassBuilder& t_Builder)
+    {
+        t_Builder.Read(Hdr, RenderGraphUsage::Sampled);
+        t_Builder.Write(Bloom, RenderGraphUsage::ColorAttachment);
+    }, nullptr);
+
+    uint32 CompositePass = Graph.AddPass("Composite", [&](RenderGraph::PassBuilder& t_Builder)
+    {
+        t_Builder.Read(Hdr, RenderGraphUsage::Sampled);
+        t_Builder.Read(Bloom, RenderGraphUsage::Sampled);
+        t_Builder.Write(Final, RenderGraphUsage::ColorAttachment);
+    }, nullptr);
+
+    uint32 ReadbackPass = Graph.AddPass("Readback", [&](RenderGraph::PassBuilder& t_Builder)
+    {
+        t_Builder.SetSideEffects();
+    }, nullptr);
+
+    Graph.ExportTexture(Final, RenderGraphUsage::Sampled);
+    Graph.Compile();
+
+    SECTION("Passes that nothing reads are culled")
+    {
+        REQUIRE(Graph.IsPassCulled(UnusedPass));
+        REQUIRE_FALSE(Graph.IsPassCulled(GBufferPass));
+        REQUIRE_FALSE(Graph.IsPassCulled(LightingPass));
+        REQUIRE_FALSE(Graph.IsPassCulled(BloomPass));
+        REQUIRE_FALSE(Graph.IsPassCulled(CompositePass));
+        REQUIRE_FALSE(Graph.IsPassCulled(ReadbackPass));
+        REQUIRE(Graph.GetExecutionOrder() == std::vector<uint32>{ GBufferPass, LightingPass, BloomPass, CompositePass, ReadbackPass });
+
+        // Textures of culled passes are never created
+        REQUIRE(Graph.GetFirstUse(Unused) == RenderGraph::InvalidIndex);
+    }
+
+    SECTION("Lifetimes")
+    {
+        REQUIRE(Graph.GetFirstUse(Albedo) == 0);
+        REQUIRE(Graph.GetLastUse(Albedo) == 1);
+        REQUIRE(Graph.GetFirstUse(Hdr) == 1);
+        REQUIRE(Graph.GetLastUse(Hdr) == 3);
+        REQUIRE(Graph.GetFirstUse(Bloom) == 2);
+        REQUIRE(Graph.GetLastUse(Bloom) == 3);
+
+        // Exported textures live until the end of the graph
+        REQUIRE(Graph.GetFirstUse(Final) == 3);
+        REQUIRE(Graph.GetLastUse(Final) == 4);
+    }
+
+    SECTION("Barriers")
+    {
+        // Every texture transitions once into each new layout, and the second read of HDR is skipped
+        REQUIRE(Graph.GetBarriers(GBufferPass).size() == 2);
+        REQUIRE(Graph.GetBarriers(LightingPass).size() == 3);
+        REQUIRE(Graph.GetBarriers(BloomPass).size() == 2);
+        REQUIRE(Graph.GetBarriers(CompositePass).size() == 2);
+        REQUIRE(Graph.GetBarriers(ReadbackPass).empty());
+        REQUIRE(Graph.GetExportBarriers().size() == 1);
+        REQUIRE(Graph.GetBarrierCount() == 10);
+        REQUIRE(Graph.GetSkippedBarrierCount() == 1);
+
+        // Depth is sampled in its read only depth layout
+        const RenderGraphBarrier& DepthBarrier = Graph.GetBarriers(LightingPass)[1];
+        REQUIRE(DepthBarrier.Texture == SceneDepth);
+        REQUIRE(DepthBarrier.Before.Layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        REQUIRE(DepthBarrier.After.Layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+
+        // HDR is written again next frame, which has to wait for the last frame's reads
+        const RenderGraphBarrier& HdrBarrier = Graph.GetBarriers(LightingPass)[2];
+        REQUIRE(HdrBarrier.Texture == Hdr);
+        REQUIRE(HdrBarrier.Before.Layout == VK_IMAGE_LAYOUT_UNDEFINED);
+        REQUIRE(HdrBarrier.Before.Stages == VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        REQUIRE(HdrBarrier.After.Layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+        const RenderGraphBarrier& ExportBarrier = Graph.GetExportBarriers()[0];
+        REQUIRE(ExportBarrier.Texture == Final);
+        REQUIRE(ExportBarrier.Before.Access == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+        REQUIRE(ExportBarrier.After.Layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    SECTION("Aliasing")
+    {
+        std::mt19937 Rng(7);
+        std::uniform_int_distribution<uint32> Pass(0, 15);
+        std::uniform_int_distribution<uint32> Size(1, 64);
+        std::uniform_int_distribution<uint32> AlignShift(0, 4);
+
+        std::vector<RenderGraphAllocation> Allocations(300);
+        VkDeviceSize TotalSize = 0;
+        for (RenderGraphAllocation& Alloc : Allocations)
+        {
+            uint32 A = Pass(Rng);
+            uint32 B = Pass(Rng);
+            Alloc.FirstPass = std::min(A, B);
+            Alloc.LastPass = std::max(A, B);
+            Alloc.Size = Size(Rng) * 256;
+            Alloc.Alignment = 256u << AlignShift(Rng);
+            TotalSize += Alloc.Size;
+        }
+
+        const VkDeviceSize HeapSize = RenderGraph::PlaceAllocations(Allocations);
+        REQUIRE(HeapSize < TotalSize);
+
+        for (size_t i = 0; i < Allocations.size(); ++i)
+        {
+            const RenderGraphAllocation& A = Allocations[i];
+            REQUIRE(A.Offset % A.Alignment == 0);
+            REQUIRE(A.Offset + A.Size <= HeapSize);
+
+            for (size_t j = i + 1; j < Allocations.size(); ++j)
+            {
+                const RenderGraphAllocation& B = Allocations[j];
+                const bool AliveTogether = A.FirstPass <= B.LastPass && B.FirstPass <= A.LastPass;
+                const bool SameMemory = A.Offset < B.Offset + B.Size && B.Offset < A.Offset + A.Size;
+                REQUIRE_FALSE((AliveTogether && SameMemory));
+            }
+        }
+    }
+}
+
+TEST_CASE("Bindless texture slots", "[Renderer]")
+{
+    using namespace Fling;
+
+    // The allocator never dereferences the textures, so any unique addresses will do
+    int Storage[4] = {};
+    Texture* A = reinterpret_cast<Texture*>(&Storage[0]);
+    Texture* B = reinterpret_cast<Texture*>(&Storage[1]);
+    Texture* C = reinterpret_cast<Texture*>(&Storage[2]);
+    Texture* D = reinterpret_cast<Texture*>(&Storage[3]);
+
+    const uint32 RetireFrames = 2;
+    TextureSlotAllocator Slots(3, RetireFrames);
+
+    bool IsNew = false;
+    const uint32 SlotA = Slots.Acquire(A, IsNew);
+    REQUIRE(IsNew);
+
+    SECTION("Shared textures share a slot")
+    {
+        REQUIRE(Slots.Acquire(A, IsNew) == SlotA);
+        REQUIRE_FALSE(IsNew);
+
+        // Still referenced once, so the slot stays
+        Slots.Release(A);
+        for (uint32 i = 0; i < RetireFrames + 1; ++i)
+        {
+            Slots.NextFrame();
+        }
+        REQUIRE(Slots.GetSlot(A) == SlotA);
+    }
+
+    SECTION("Released slots wait for the frames in flight")
+    {
+        const uint32 SlotB = Slots.Acquire(B, IsNew);
+        const uint32 SlotC = Slots.Acquire(C, IsNew);
+        REQUIRE(SlotB != SlotA);
+        REQUIRE(SlotC != SlotA);
+        REQUIRE(SlotC != SlotB);
+
+        // Full
+        REQUIRE(Slots.Acquire(D, IsNew) == TextureSlotAllocator::InvalidSlot);
+        REQUIRE_FALSE(IsNew);
+
+        Slots.Release(B);
+        Slots.NextFrame();
+        REQUIRE(Slots.Acquire(D, IsNew) == TextureSlotAllocator::InvalidSlot);
+
+        Slots.NextFrame();
+        REQUIRE(Slots.GetSlot(B) == TextureSlotAllocator::InvalidSlot);
+        REQUIRE(Slots.Acquire(D, IsNew) == SlotB);
+        REQUIRE(IsNew);
+        REQUIRE(Slots.GetUsedCount() == 3);
+    }
+
+    SECTION("Acquiring a retiring texture keeps its slot")
+    {
+        Slots.Release(A);
+        Slots.NextFrame();
+
+        REQUIRE(Slots.Acquire(A, IsNew) == SlotA);
+        REQUIRE_FALSE(IsNew);
+
+        // Released again later, so the first release must not free it
+        Slots.NextFrame();
+        Slots.Release(A);
+        Slots.NextFrame();
+        REQUIRE(Slots.GetSlot(A) == SlotA);
+
+        Slots.NextFrame();
+        REQUIRE(Slots.GetSlot(A) == TextureSlotAllocator::InvalidSlot);
+        REQUIRE(Slots.GetUsedCount() == 0);
+    }
+}
+
+TEST_CASE("Pipeline keys", "[Renderer]")
+{
+    using namespace Fling;
+
+    const auto MakeKey = [](uint32 t_CullMode, const std::vector<uint32>& t_Blend)
+    {
+        PipelineKey Key;
+        Key.Add(t_CullMode);
+        Key.AddArray(t_Blend.data(), t_Blend.size());
+        Key.Add(1.0f);
+        return Key;
+    };
+
+    const PipelineKey Base = MakeKey(2, { 0xf, 0xf });
+
+    SECTION("The same state makes the same key")
+    {
+        const PipelineKey Same = MakeKey(2, { 0xf, 0xf });
+        REQUIRE(Same == Base);
+        REQUIRE(Same.GetHash() == Base.GetHash());
+    }
+
+    SECTION("Any change to the state makes a different key")
+    {
+        REQUIRE(MakeKey(1, { 0xf, 0xf }) != Base);
+        REQUIRE(MakeKey(2, { 0xf, 0x0 }) != Base);
+        REQUIRE(MakeKey(2, { 0xf }) != Base);
+    }
+
+    SECTION("Arrays keep their boundaries")
+    {
+        PipelineKey Split;
+        const uint32 First[2] = { 1, 2 };
+        const uint32 Second[1] = { 3 };
+        Split.AddArray(First, 2);
+        Split.AddArray(Second, 1);
+
+        PipelineKey Moved;
+        Moved.AddArray(First, 1);
+        Moved.AddArray(First + 1, 1);
+        Moved.AddArray(Second, 1);
+
+        REQUIRE(Split != Moved);
+    }
+
+    SECTION("Keys dedupe in a hash map")
+    {
+        std::unordered_map<PipelineKey, int, PipelineKey::Hasher> Cache;
+        Cache[Base] = 1;
+        Cache[MakeKey(2, { 0xf, 0xf })] = 2;
+        Cache[MakeKey(0, { 0xf, 0xf })] = 3;
+        REQUIRE(Cache.size() == 2);
+        REQUIRE(Cache[Base] == 2);
+    }
+}
+
+TEST_CASE("GPU timestamps", "[Renderer]")
+{
+    using namespace Fling;
+
+    const uint64 Mask32 = 0xffffffffULL;
+
+    SECTION("Ticks are scaled by the timestamp period")
+    {
+        REQUIRE(GpuProfiler::TicksToMilliseconds(1000, 3000000, ~0ULL, 1.0f) == Approx(2.999));
+        REQUIRE(GpuProfiler::TicksToMilliseconds(0, 1000, ~0ULL, 52.08f) == Approx(0.05208));
+    }
+
+    SECTION("Counters with fewer valid bits wrap around")
+    {
+        REQUIRE(GpuProfiler::TicksToMilliseconds(Mask32 - 999, 1000, Mask32, 1.0f) == Approx(0.002));
+    }
+
+    SECTION("Bits above the valid ones are ignored")
+    {
+        REQUIRE(GpuProfiler::TicksToMilliseconds(0xabcd00000000ULL, 0x123400000000ULL + 500000, Mask32, 1.0f) == Approx(0.5));
+    }
+}
+
+TEST_CASE("Mesh LODs", "[Renderer]")
+{
+    using namespace Fling;
+
+    // A welded UV sphere, the seam column is duplicated like an imported mesh would have it
+    const uint32 Rings = 32;
+    const uint32 Segments = 64;
+    const float Pi = 3.14159265f;
+    std::vector<Vertex> Verts;
+    std::vector<uint32> Indices;
+    for (uint32 r = 0; r <= Rings; ++r)
+    {
+        for (uint32 s = 0; s <= Segments; ++s)
+        {
+            const float Theta = Pi * static_cast<float>(r) / static_cast<float>(Rings);
+            const float Phi = 2.0f * Pi * static_cast<float>(s) / static_cast<float>(Segments);
+
+            Vertex Vert = {};
+            Vert.Pos = glm::vec3(std::sin(Theta) * std::cos(Phi), std::cos(Theta), std::sin(Theta) * std::sin(Phi));
+            Vert.Normal = Vert.Pos;
+            Vert.TexCoord = glm::vec2(static_cast<float>(s) / Segments, static_cast<float>(r) / Rings);
+            Verts.push_back(Vert);
+        }
+    }
+    for (uint32 r = 0; r < Rings; ++r)
+    {
+        for (uint32 s = 0; s < Segments; ++s)
+        {
+            const uint32 A = r * (Segments + 1) + s;
+            const uint32 B = A + Segments + 1;
+            const uint32 Quad[6] = { A, B, A + 1, A + 1, B, B + 1 };
+            Indices.insert(Indices.end(), Quad, Quad + 6);
+        }
+    }
+
+    const auto CheckTriangles = [&](const uint32* t_Indices, uint32 t_Count)
+    {
+        for (uint32 i = 0; i < t_Count; i += 3)
+        {
+            REQUIRE(t_Indices[i] < Verts.size());
+            REQUIRE(t_Indices[i + 1] < Verts.size());
+            REQUIRE(t_Indices[i + 2] < Verts.size());
+            REQUIRE(t_Indices[i] != t_Indices[i + 1]);
+            REQUIRE(t_Indices[i] != t_Indices[i + 2]);
+            REQUIRE(t_Indices[i + 1] != t_Indices[i + 2]);
+        }
+    };
+
+    SECTION("Simplifying reaches the target and stays close to the surface")
+    {
+        const uint32 Target = static_cast<uint32>(Indices.size()) / 4 / 3 * 3;
+        float Error = 0.0f;
+        std::vector<uint32> Simplified = MeshSimplifier::Simplify(Verts.data(), static_cast<uint32>(Verts.size()), Indices.data(), static_cast<uint32>(Indices.size()), Target, 0.1f, &Error);
+
+        REQUIRE(Simplified.size() % 3 == 0);
+        REQUIRE(Simplified.size() <= Target);
+        REQUIRE(Error > 0.0f);
+        REQUIRE(Error <= 0.1f);
+        CheckTriangles(Simplified.data(), static_cast<uint32>(Simplified.size()));
+    }
+
+    SECTION("The error limit stops simplification")
+    {
+        float Error = 0.0f;
+        std::vector<uint32> Simplified = MeshSimplifier::Simplify(Verts.data(), static_cast<uint32>(Verts.size()), Indices.data(), static_cast<uint32>(Indices.size()), 0, 0.001f, &Error);
+        REQUIRE(Simplified.size() > Indices.size() / 2);
+        REQUIRE(Error <= 0.001f);
+    }
+
+    SECTION("Open borders don't move")
+    {
+        // Only the top half of the sphere, every vertex on the equator is on a border
+        std::vector<uint32> Half(Indices.begin(), Indices.begin() + Indices.size() / 2);
+        std::vector<uint32> Simplified = MeshSimplifier::Simplify(Verts.data(), static_cast<uint32>(Verts.size()), Half.data(), static_cast<uint32>(Half.size()), 0, 1.0f);
+
+        const uint32 Equator = (Rings / 2) * (Segments + 1);
+        for (uint32 s = 0; s < Segments; ++s)
+        {
+            REQUIRE(std::find(Simplified.begin(), Simplified.end(), Equator + s) != Simplified.end());
+        }
+    }
+
+    SECTION("The LOD chain shares the index buffer")
+    {
+        std::vector<uint32> Chain = Indices;
+        LodChainSettings Settings;
+        std::vector<MeshLod> Lods = MeshSimplifier::BuildLodChain(Verts, Chain, Settings);
+
+        REQUIRE(Lods.size() == Settings.MaxLevels);
+        REQUIRE(Lods[0].FirstIndex == 0);
+        REQUIRE(Lods[0].IndexCount == Indices.size());
+        REQUIRE(Lods[0].Error == 0.0f);
+        for (size_t i = 1; i < Lods.size(); ++i)
+        {
+            REQUIRE(Lods[i].FirstIndex == Lods[i - 1].FirstIndex + Lods[i - 1].IndexCount);
+            REQUIRE(Lods[i].IndexCount < Lods[i - 1].IndexCount);
+            REQUIRE(Lods[i].Error >= Lods[i - 1].Error);
+            CheckTriangles(Chain.data() + Lods[i].FirstIndex, Lods[i].IndexCount);
+        }
+        REQUIRE(Chain.size() == Lods.back().FirstIndex + Lods.back().IndexCount);
+    }
+
+    SECTION("Selection uses screen size with hysteresis")
+    {
+        std::vector<MeshLod> Lods(3);
+        Lods[1].Error = 0.01f;
+        Lods[2].Error = 0.04f;
+
+        LodSelector Selector;
+        Selector.PixelsPerUnit = 1000.0f;
+        Selector.ThresholdPixels = 1.0f;
+        Selector.Hysteresis = 0.25f;
+
+        BoundingSphere Sphere;
+        Sphere.Radius = 1.0f;
+
+        const auto SelectAt = [&](float t_Distance, uint32 t_Current)
+        {
+            return Selector.Select(Lods, Sphere, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -(t_Distance + 1.0f))), t_Current);
+        };
+
+        // Level 1 covers a pixel at 10 units and level 2 at 40
+        REQUIRE(SelectAt(0.5f, 2) == 0);
+        REQUIRE(SelectAt(20.0f, 0) == 1);
+        REQUIRE(SelectAt(100.0f, 0) == 2);
+
+        // Just past the threshold isn't enough to go coarser, but it's enough to stay there
+        REQUIRE(SelectAt(11.0f, 0) == 0);
+        REQUIRE(SelectAt(11.0f, 1) == 1);
+        REQUIRE(SelectAt(9.0f, 1) == 0);
+
+        // Scaling the object up scales its error with it
+        const glm::mat4 Scaled = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -22.0f)), glm::vec3(2.0f));
+        REQUIRE(Selector.Select(Lods, Sphere, Scaled, 0) == 0);
+
+        Selector.ThresholdPixels = 0.0f;
+        REQUIRE(SelectAt(100.0f, 2) == 0);
+    }
+}
+
+TEST_CASE("Occlusion culling", "[Renderer]")
+{
+    using namespace Fling;
+
+    // Camera at the origin looking down -Z, with the aspect of the depth buffer
+    glm::mat4 View = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 Proj = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 100.0f);
+
+    // A 10x10 wall 5 units in front of the camera
+    std::vector<glm::vec3> Wall(4);
+    Wall[0] = glm::vec3(-5.0f, -5.0f, 0.0f);
+    Wall[1] = glm::vec3(5.0f, -5.0f, 0.0f);
+    Wall[2] = glm::vec3(5.0f, 5.0f, 0.0f);
+    Wall[3] = glm::vec3(-5.0f, 5.0f, 0.0f);
+    const std::vector<uint32> WallIndices = { 0, 1, 2, 0, 2, 3 };
+    const glm::mat4 WallWorld = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.0f));
+
+    const auto Box = [](const glm::vec3& t_Center, float t_HalfSize)
+    {
+        AABB Result;
+        Result.Expand(t_Center - glm::vec3(t_HalfSize));
+        Result.Expand(t_Center + glm::vec3(t_HalfSize));
+        return Result;
+    };
+
+    OcclusionCuller Culler;
+    Culler.BeginFrame(Proj * View);
+
+    SECTION("Nothing is hidden without occluders")
+    {
+        Culler.Rasterize();
+        REQUIRE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -50.0f), 1.0f)));
+    }
+
+    SECTION("Boxes behind the wall are hidden")
+    {
+        Culler.AddOccluder(Wall.data(), WallIndices.data(), static_cast<uint32>(WallIndices.size()), WallWorld);
+        Culler.Rasterize();
+        REQUIRE(Culler.GetTriangleCount() == 2);
+
+        REQUIRE_FALSE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f)));
+        REQUIRE_FALSE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -5.6f), 0.5f)));
+        REQUIRE_FALSE(Culler.IsVisible(Box(glm::vec3(3.0f, -3.0f, -20.0f), 2.0f)));
+
+        // In front of it, through it, or sticking out past its edge
+        REQUIRE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -2.0f), 1.0f)));
+        REQUIRE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -5.0f), 1.0f)));
+        REQUIRE(Culler.IsVisible(Box(glm::vec3(8.0f, 0.0f, -6.0f), 1.0f)));
+
+        // Crossing the near plane
+        REQUIRE(Culler.IsVisible(Box(glm::vec3(0.0f), 1.0f)));
+    }
+
+    SECTION("Occluders crossing the near plane are clipped")
+    {
+        // A floor running from behind the camera to far in front of it, both sides are drawn
+        std::vector<glm::vec3> Floor(4);
+        Floor[0] = glm::vec3(-50.0f, -1.0f, 10.0f);
+        Floor[1] = glm::vec3(50.0f, -1.0f, 10.0f);
+        Floor[2] = glm::vec3(50.0f, -1.0f, -90.0f);
+        Floor[3] = glm::vec3(-50.0f, -1.0f, -90.0f);
+        Culler.AddOccluder(Floor.data(), WallIndices.data(), static_cast<uint32>(WallIndices.size()), glm::mat4(1.0f));
+        Culler.Rasterize();
+        REQUIRE(Culler.GetTriangleCount() > 2);
+
+        REQUIRE_FALSE(Culler.IsVisible(Box(glm::vec3(0.0f, -3.0f, -10.0f), 1.0f)));
+        REQUIRE(Culler.IsVisible(Box(glm::vec3(0.0f, 1.0f, -10.0f), 1.0f)));
+    }
+
+    SECTION("The result doesn't depend on the thread count")
+    {
+        std::mt19937 Rng(7);
+        std::uniform_real_distribution<float> Dist(-10.0f, 10.0f);
+        std::vector<glm::vec3> Verts(600);
+        std::vector<uint32> Indices(Verts.size());
+        for (uint32 i = 0; i < Verts.size(); ++i)
+        {
+            Verts[i] = glm::vec3(Dist(Rng), Dist(Rng), Dist(Rng) - 20.0f);
+            Indices[i] = i;
+        }
+
+        OcclusionCuller Threaded(3);
+        Threaded.BeginFrame(Proj * View);
+        for (OcclusionCuller* Current : { &Culler, &Threaded })
+        {
+            Current->AddOccluder(Verts.data(), Indices.data(), static_cast<uint32>(Indices.size()), glm::mat4(1.0f));
+            Current->Rasterize();
+        }
+
+        REQUIRE(Threaded.GetDepth() == Culler.GetDepth());
+        for (uint32 y = 0; y < OcclusionCuller::BlocksY; ++y)
+        {
+            for (uint32 x = 0; x < OcclusionCuller::BlocksX; ++x)
+            {
+                REQUIRE(Threaded.GetBlockDepth(x, y) == Culler.GetBlockDepth(x, y));
+            }
+        }
+
+        // Running it again with the same occluders gives the same thing
+        Threaded.Rasterize();
+        REQUIRE(Threaded.GetDepth() == Culler.GetDepth());
+    }
+}
+
+TEST_CASE("Dynamic resolution", "[Renderer]")
+{
+    using namespace Fling;
+
+    DynamicResolutionSettings Settings;
+    Settings.TargetMilliseconds = 16.0f;
+    Settings.MinScale = 0.5f;
+    Settings.MaxScale = 1.0f;
+    Settings.Headroom = 0.2f;
+    Settings.MaxStep = 0.25f;
+    Settings.SampleFrames = 4;
+    Settings.LatencyFrames = 2;
+
+    DynamicResolution Res(Settings);
+    const VkExtent2D Output = { 1920, 1080 };
+
+    // Feeds frames until the scale changes, returns how many it took
+    const auto FeedUntilChange = [&](float t_Milliseconds)
+    {
+        for (uint32 i = 1; i <= 100; ++i)
+        {
+            if (Res.AddFrameTime(t_Milliseconds))
+            {
+                return i;
+            }
+        }
+        return 0u;
+    };
+
+    SECTION("Starts at the max scale and holds inside of the band")
+    {
+        REQUIRE(Res.GetScale() == 1.0f);
+        REQUIRE(Res.GetRenderExtent(Output).width == 1920);
+        REQUIRE(FeedUntilChange(14.0f) == 0);
+        REQUIRE(Res.GetScale() == 1.0f);
+    }
+
+    SECTION("Drops when slow and waits for the frames in flight")
+    {
+        // Twice the pixels it can afford, frame time follows the pixel count
+        REQUIRE(FeedUntilChange(32.0f) == Settings.SampleFrames);
+        REQUIRE(Res.GetScale() == Approx(0.75f));
+
+        float Scale = Res.GetScale();
+        uint32 Frames = FeedUntilChange(32.0f * Scale * Scale);
+        REQUIRE(Frames == Settings.LatencyFrames + Settings.SampleFrames);
+
+        // Settles between the headroom and the target
+        for (uint32 i = 0; i < 10; ++i)
+        {
+            Scale = Res.GetScale();
+            FeedUntilChange(32.0f * Scale * Scale);
+        }
+        const float FrameTime = 32.0f * Res.GetScale() * Res.GetScale();
+        REQUIRE(FrameTime <= Settings.TargetMilliseconds);
+        REQUIRE(FrameTime >= Settings.TargetMilliseconds * (1.0f - Settings.Headroom));
+    }
+
+    SECTION("Stays inside of the bounds")
+    {
+        for (uint32 i = 0; i < 10; ++i)
+        {
+            FeedUntilChange(1000.0f);
+        }
+        REQUIRE(Res.GetScale() == Settings.MinScale);
+
+        const VkExtent2D Render = Res.GetRenderExtent(Output);
+        REQUIRE(Render.width == 960);
+        REQUIRE(Render.height == 540);
+
+        for (uint32 i = 0; i < 10; ++i)
+        {
+            FeedUntilChange(1.0f);
+        }
+        REQUIRE(Res.GetScale() == Settings.MaxScale);
+    }
+
+    SECTION("Targets are allocated for the max scale")
+    {
+        Settings.MaxScale = 1.5f;
+        DynamicResolution Supersampled(Settings);
+
+        const VkExtent2D Allocated = Supersampled.GetAllocatedExtent(Output);
+        REQUIRE(Allocated.width == 2880);
+        REQUIRE(Allocated.height == 1620);
+
+        const VkExtent2D Render = Supersampled.GetRenderExtent(Output);
+        REQUIRE(Render.width == Allocated.width);
+        REQUIRE(Render.height == Allocated.height);
+    }
+}
+
+TEST_CASE("Depth prepass selection", "[Renderer]")
+{
+    using namespace Fling;
+
+    REQUIRE(DepthPrepassSelector::ParseMode("Off") == DepthPrepassMode::Off);
+    REQUIRE(DepthPrepassSelector::ParseMode("on") == DepthPrepassMode::On);
+    REQUIRE(DepthPrepassSelector::ParseMode("AUTO") == DepthPrepassMode::Auto);
+    REQUIRE(DepthPrepassSelector::ParseMode("sometimes") == DepthPrepassMode::Off);
+
+    DepthPrepassSettings Settings;
+    Settings.Mode = DepthPrepassMode::Auto;
+    Settings.SampleFrames = 4;
+    Settings.LatencyFrames = 2;
+    Settings.RetestFrames = 50;
+    Settings.Margin = 0.1f;
+
+    // Feeds the cost of whichever choice is current until it changes, returns how many frames it took
+    const auto FeedUntilChange = [](DepthPrepassSelector& t_Selector, float t_CostOn, float t_CostOff)
+    {
+        for (uint32 i = 1; i <= 200; ++i)
+        {
+            if (t_Selector.AddFrameCost(t_Selector.IsEnabled() ? t_CostOn : t_CostOff))
+            {
+                return i;
+            }
+        }
+        return 0u;
+    };
+
+    SECTION("On and Off never change")
+    {
+        for (DepthPrepassMode Mode : { DepthPrepassMode::On, DepthPrepassMode::Off })
+        {
+            Settings.Mode = Mode;
+            DepthPrepassSelector Selector(Settings);
+            REQUIRE(Selector.IsEnabled() == (Mode == DepthPrepassMode::On));
+            REQUIRE_FALSE(Selector.IsMeasuring());
+            REQUIRE(FeedUntilChange(Selector, 1.0f, 100.0f) == 0);
+            REQUIRE(FeedUntilChange(Selector, 100.0f, 1.0f) == 0);
+        }
+    }
+
+    SECTION("Keeps the prepass when it is cheaper")
+    {
+        DepthPrepassSelector Selector(Settings);
+        REQUIRE_FALSE(Selector.IsEnabled());
+        REQUIRE(Selector.IsMeasuring());
+
+        // Measures without it first, then tries it
+        REQUIRE(FeedUntilChange(Selector, 1.0f, 2.0f) == Settings.LatencyFrames + Settings.SampleFrames);
+        REQUIRE(Selector.IsEnabled());
+
+        // Frames that were in flight without the prepass are ignored, then it is kept
+        for (uint32 i = 0; i < Settings.LatencyFrames + Settings.SampleFrames; ++i)
+        {
+            REQUIRE_FALSE(Selector.AddFrameCost(i < Settings.LatencyFrames ? 2.0f : 1.0f));
+        }
+        REQUIRE(Selector.IsEnabled());
+        REQUIRE_FALSE(Selector.IsMeasuring());
+
+        // Tested again after a while, the scene got simpler and it isn't worth it anymore
+        REQUIRE(FeedUntilChange(Selector, 2.0f, 1.0f) == Settings.RetestFrames + Settings.SampleFrames);
+        REQUIRE_FALSE(Selector.IsEnabled());
+        for (uint32 i = 0; i < Settings.LatencyFrames + Settings.SampleFrames; ++i)
+        {
+            REQUIRE_FALSE(Selector.AddFrameCost(1.0f));
+        }
+        REQUIRE_FALSE(Selector.IsEnabled());
+        REQUIRE_FALSE(Selector.IsMeasuring());
+    }
+
+    SECTION("Goes back when the prepass is more expensive")
+    {
+        DepthPrepassSelector Selector(Settings);
+        REQUIRE(FeedUntilChange(Selector, 3.0f, 2.0f) > 0);
+        REQUIRE(Selector.IsEnabled());
+
+        REQUIRE(FeedUntilChange(Selector, 3.0f, 2.0f) == Settings.LatencyFrames + Settings.SampleFrames);
+        REQUIRE_FALSE(Selector.IsEnabled());
+        REQUIRE_FALSE(Selector.IsMeasuring());
+    }
+
+    SECTION("Differences inside of the margin don't switch")
+    {
+        DepthPrepassSelector Selector(Settings);
+        for (uint32 i = 0; i < 10; ++i)
+        {
+            FeedUntilChange(Selector, 0.95f, 1.0f);
+            FeedUntilChange(Selector, 0.95f, 1.0f);
+            REQUIRE_FALSE(Selector.IsEnabled());
+        }
+    }
+
+    SECTION("Frames without a cost are skipped")
+    {
+        DepthPrepassSelector Selector(Settings);
+        for (uint32 i = 0; i < 100; ++i)
+        {
+            REQUIRE_FALSE(Selector.AddFrameCost(0.0f));
+        }
+        REQUIRE(Selector.IsMeasuring());
+        REQUIRE_FALSE(Selector.IsEnabled());
+    }
+}
+
+TEST_CASE("Compact vertices", "[Renderer]")
+{
+    using namespace Fling;
+
+    SECTION("Attributes match the layout")
+    {
+        REQUIRE(Vertex::GetBindingDescription(VertexFormat::Full).stride == sizeof(Vertex));
+        REQUIRE(Vertex::GetBindingDescription(VertexFormat::Compact).stride == sizeof(CompactVertex));
+        REQUIRE(Vertex::GetAttributeDescriptions(VertexFormat::Full).size() == 5);
+
+        // Same locations as the full vertex without the color, and nothing past the end of the vertex
+        const std::vector<VkVertexInputAttributeDescription> Compact = Vertex::GetAttributeDescriptions(VertexFormat::Compact);
+        REQUIRE(Compact.size() == 4);
+        for (const VkVertexInputAttributeDescription& Attrib : Compact)
+        {
+            REQUIRE(Attrib.location != 1);
+            REQUIRE(Attrib.offset < sizeof(CompactVertex));
+        }
+    }
+
+    SECTION("Position stream")
+    {
+        // Positions only, at the same location and in the same format as in the full stream
+        for (VertexFormat Format : { VertexFormat::Full, VertexFormat::Compact })
+        {
+            const VkVertexInputAttributeDescription Position = Vertex::GetPositionAttributeDescription(Format);
+            REQUIRE(Position.location == 0);
+            REQUIRE(Position.offset == 0);
+            REQUIRE(Position.format == Vertex::GetAttributeDescriptions(Format)[0].format);
+            REQUIRE(Vertex::GetPositionBindingDescription(Format).stride == Vertex::GetPositionStride(Format));
+        }
+
+        REQUIRE(Vertex::GetPositionStride(VertexFormat::Full) * 4 < sizeof(Vertex));
+        REQUIRE(Vertex::GetPositionStride(VertexFormat::Compact) * 2 < sizeof(CompactVertex));
+    }
+
+    SECTION("Round trip error")
+    {
+        std::mt19937 Rng(42);
+        std::uniform_real_distribution<float> Dist(-1.0f, 1.0f);
+
+        AABB Bounds;
+        Bounds.Min = glm::vec3(-10.0f, 0.0f, -2.5f);
+        Bounds.Max = glm::vec3(10.0f, 40.0f, 2.5f);
+        const glm::vec3 Size = Bounds.Max - Bounds.Min;
+
+        for (uint32 i = 0; i < 1000; ++i)
+        {
+            Vertex Vert = {};
+            Vert.Pos = Bounds.GetCenter() + glm::vec3(Dist(Rng), Dist(Rng), Dist(Rng)) * Bounds.GetExtents();
+            Vert.Normal = glm::normalize(glm::vec3(Dist(Rng), Dist(Rng), Dist(Rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+            Vert.Tangent = glm::normalize(glm::cross(Vert.Normal, glm::vec3(0.0f, 1.0f, 0.0f)) + glm::vec3(1e-3f, 0.0f, 0.0f));
+            Vert.TexCoord = glm::vec2(Dist(Rng), Dist(Rng)) * 4.0f;
+
+            const Vertex Decoded = CompactVertex::Unpack(CompactVertex::Pack(Vert, Bounds), Bounds);
+
+            // Half a step of 16 bits across the bounds
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                REQUIRE(glm::abs(Decoded.Pos[Axis] - Vert.Pos[Axis]) <= Size[Axis] / 65535.0f);
+            }
+
+            // 16 bit octahedral is well under a hundredth of a degree
+            REQUIRE(glm::dot(Decoded.Normal, Vert.Normal) > 0.99999f);
+            REQUIRE(glm::dot(Decoded.Tangent, Vert.Tangent) > 0.99999f);
+
+            // Half floats have 11 bits of precision
+            REQUIRE(glm::abs(Decoded.TexCoord.x - Vert.TexCoord.x) <= 4.0f / 2048.0f);
+            REQUIRE(glm::abs(Decoded.TexCoord.y - Vert.TexCoord.y) <= 4.0f / 2048.0f);
+        }
+    }
+
+    SECTION("Flat bounds")
+    {
+        // A quad has no depth, every vertex has to land back on its plane
+        AABB Bounds;
+        Bounds.Min = glm::vec3(0.0f, 0.0f, 0.0f);
+        Bounds.Max = glm::vec3(1.0f, 1.0f, 0.0f);
+
+        Vertex Vert = {};
+        Vert.Pos = glm::vec3(0.25f, 1.0f, 0.0f);
+        Vert.Normal = glm::vec3(0.0f, 0.0f, -1.0f);
+        Vert.Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+
+        const Vertex Decoded = CompactVertex::Unpack(CompactVertex::Pack(Vert, Bounds), Bounds);
+        REQUIRE(Decoded.Pos.z == 0.0f);
+        REQUIRE(Decoded.Pos.y == 1.0f);
+        REQUIRE(Decoded.Normal.z == Approx(-1.0f));
+    }
+}
+
+TEST_CASE("Debug draw", "[Renderer]")
+{
+    using namespace Fling;
+
+    DebugDrawList List;
+    const glm::vec4 Red(1.0f, 0.0f, 0.0f, 1.0f);
+
+    SECTION("Shapes are lines")
+    {
+        List.Line(glm::vec3(0.0f), glm::vec3(1.0f), Red);
+        REQUIRE(List.GetLineCount() == 1);
+        REQUIRE(List.GetVertices()[0].Color == 0xff0000ffu);
+
+        AABB Box;
+        Box.Min = glm::vec3(-1.0f, -2.0f, -3.0f);
+        Box.Max = glm::vec3(1.0f, 2.0f, 3.0f);
+        List.Box(Box, Red);
+        REQUIRE(List.GetLineCount() == 13);
+
+        // Every edge of a box runs along one axis and is as long as the box is along it
+        const glm::vec3 Size = Box.Max - Box.Min;
+        for (uint32 i = 2; i < List.GetVertices().size(); i += 2)
+        {
+            const glm::vec3 Edge = glm::abs(List.GetVertices()[i + 1].Pos - List.GetVertices()[i].Pos);
+            const uint32 Axes = (Edge.x > 0.0f) + (Edge.y > 0.0f) + (Edge.z > 0.0f);
+            REQUIRE(Axes == 1);
+            REQUIRE(glm::dot(Edge, glm::vec3(1.0f)) == Approx(glm::dot(Edge, Size) / glm::length(Edge)));
+        }
+
+        List.Sphere(glm::vec3(5.0f), 2.0f, Red, 8);
+        REQUIRE(List.GetLineCount() == 13 + 3 * 8);
+        for (uint32 i = 26; i < List.GetVertices().size(); ++i)
+        {
+            REQUIRE(glm::length(List.GetVertices()[i].Pos - glm::vec3(5.0f)) == Approx(2.0f));
+        }
+
+        List.Clear();
+        REQUIRE(List.GetVertices().empty());
+    }
+
+    SECTION("Frustum corners")
+    {
+        // An identity view projection is the clip space box, x and y from -1 to 1 and depth from 0 to 1
+        List.Frustum(glm::mat4(1.0f), Red);
+        REQUIRE(List.GetLineCount() == 12);
+        for (const DebugVertex& Vert : List.GetVertices())
+        {
+            REQUIRE(glm::abs(Vert.Pos.x) == Approx(1.0f));
+            REQUIRE(glm::abs(Vert.Pos.y) == Approx(1.0f));
+            REQUIRE((Vert.Pos.z == Approx(0.0f) || Vert.Pos.z == Approx(1.0f)));
+        }
+
+        // The far corners of a perspective frustum are on the far plane
+        const glm::mat4 Proj = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+        List.Clear();
+        List.Frustum(Proj, Red);
+        float FarthestZ = 0.0f;
+        for (const DebugVertex& Vert : List.GetVertices())
+        {
+            FarthestZ = glm::min(FarthestZ, Vert.Pos.z);
+        }
+        REQUIRE(FarthestZ == Approx(-100.0f).epsilon(1e-3));
+    }
+
+    SECTION("Text projection")
+    {
+        const glm::mat4 Proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+        const glm::vec2 Screen(800.0f, 600.0f);
+
+        glm::vec2 Pixel;
+        REQUIRE(DebugDrawList::ProjectToScreen(Proj, glm::vec3(0.0f, 0.0f, -10.0f), Screen, Pixel));
+        REQUIRE(Pixel.x == Approx(400.0f));
+        REQUIRE(Pixel.y == Approx(300.0f));
+
+        // Nothing behind the camera
+        REQUIRE_FALSE(DebugDrawList::ProjectToScreen(Proj, glm::vec3(0.0f, 0.0f, 10.0f), Screen, Pixel));
+
+        List.Text(glm::vec3(1.0f), "Light", Red);
+        REQUIRE(List.GetTexts().size() == 1);
+        REQUIRE(List.GetLineCount() == 0);
+    }
+}
+
+TEST_CASE("Render handoff", "[Renderer]")
+{
+    using namespace Fling;
+
+    RenderHandoff Handoff;
+
+    SECTION("Slots alternate")
+    {
+        const uint32 First = Handoff.BeginWrite();
+        Handoff.Submit(First);
+        REQUIRE(Handoff.GetPendingCount() == 1);
+
+        // The main thread can fill the other slot while the first is waiting to be drawn
+        const uint32 Second = Handoff.BeginWrite();
+        REQUIRE(Second != First);
+        Handoff.Submit(Second);
+        REQUIRE(Handoff.GetPendingCount() == 2);
+
+        // Read in the order that they were submitted
+        uint32 Slot = RenderHandoff::SlotCount;
+        REQUIRE(Handoff.BeginRead(Slot));
+        REQUIRE(Slot == First);
+        Handoff.EndRead(Slot);
+
+        REQUIRE(Handoff.BeginRead(Slot));
+        REQUIRE(Slot == Second);
+        Handoff.EndRead(Slot);
+
+        REQUIRE(Handoff.GetPendingCount() == 0);
+        REQUIRE(Handoff.BeginWrite() == First);
+    }
+
+    SECTION("A slot is never written while it is read")
+    {
+        constexpr uint32 FrameCount = 2000;
+        std::array<std::vector<uint32>, RenderHandoff::SlotCount> Snapshots;
+        std::vector<uint32> Rendered;
+        bool bTorn = false;
+
+        std::thread RenderThread([&]()
+        {
+            uint32 Slot = 0;
+            while (Handoff.BeginRead(Slot))
+            {
+                // Every value is the frame number, a write from the main thread would mix two frames
+                const std::vector<uint32>& Snapshot = Snapshots[Slot];
+                std::this_thread::yield();
+                bTorn |= std::any_of(Snapshot.begin(), Snapshot.end(), [&](uint32 t_Value) { return t_Value != Snapshot.front(); });
+                Rendered.push_back(Snapshot.front());
+                Handoff.EndRead(Slot);
+            }
+        });
+
+        for (uint32 Frame = 0; Frame < FrameCount; ++Frame)
+        {
+            const uint32 Slot = Handoff.BeginWrite();
+            Snapshots[Slot].assign(64, Frame);
+            Handoff.Submit(Slot);
+        }
+
+        Handoff.Stop();
+        RenderThread.join();
+
+        REQUIRE_FALSE(bTorn);
+        REQUIRE(Rendered.size() == FrameCount);
+
+        // No frame is skipped or drawn twice
+        bool bInOrder = true;
+        for (uint32 i = 0; i < FrameCount; ++i)
+        {
+            bInOrder &= Rendered[i] == i;
+        }
+        REQUIRE(bInOrder);
+    }
+
+    SECTION("Stop draws what was submitted")
+    {
+        const uint32 Slot = Handoff.BeginWrite();
+        Handoff.Submit(Slot);
+        Handoff.Stop();
+
+        uint32 Read = RenderHandoff::SlotCount;
+        REQUIRE(Handoff.BeginRead(Read));
+        REQUIRE(Read == Slot);
+        Handoff.EndRead(Read);
+
+        REQUIRE_FALSE(Handoff.BeginRead(Read));
+        Handoff.WaitIdle();
+        REQUIRE(Handoff.GetPendingCount() == 0);
+    }
+}
+
+TEST_CASE("Geometry ranges", "[Renderer]")
+{
+    using namespace Fling;
+
+    const uint32 RetireFrames = 2;
+    RangeAllocator Ranges(100, RetireFrames);
+
+    const uint32 A = Ranges.Allocate(30);
+    const uint32 B = Ranges.Allocate(30);
+    const uint32 C = Ranges.Allocate(30);
+    REQUIRE(A == 0);
+    REQUIRE(B == 30);
+    REQUIRE(C == 60);
+    REQUIRE(Ranges.GetUsedSize() == 90);
+
+    SECTION("Full")
+    {
+        REQUIRE(Ranges.Allocate(11) == RangeAllocator::InvalidOffset);
+        REQUIRE(Ranges.Allocate(10) == 90);
+        REQUIRE(Ranges.GetLargestFreeRange() == 0);
+    }
+
+    SECTION("Freed ranges wait for the frames in flight")
+    {
+        Ranges.Free(B, 30);
+        Ranges.NextFrame();
+        REQUIRE(Ranges.Allocate(20) == RangeAllocator::InvalidOffset);
+        REQUIRE(Ranges.GetUsedSize() == 90);
+
+        Ranges.NextFrame();
+        REQUIRE(Ranges.GetUsedSize() == 60);
+
+        // First fit, so the hole in the middle is used before the end
+        REQUIRE(Ranges.Allocate(20) == B);
+        REQUIRE(Ranges.Allocate(10) == B + 20);
+        REQUIRE(Ranges.Allocate(10) == 90);
+    }
+
+    SECTION("Neighbours are merged")
+    {
+        Ranges.Free(A, 30);
+        Ranges.Free(C, 30);
+        for (uint32 i = 0; i < RetireFrames; ++i)
+        {
+            Ranges.NextFrame();
+        }
+
+        // C merged with the free space at the end, A is on its own
+        REQUIRE(Ranges.GetFreeRangeCount() == 2);
+        REQUIRE(Ranges.GetLargestFreeRange() == 40);
+
+        Ranges.Free(B, 30);
+        for (uint32 i = 0; i < RetireFrames; ++i)
+        {
+            Ranges.NextFrame();
+        }
+        REQUIRE(Ranges.GetFreeRangeCount() == 1);
+        REQUIRE(Ranges.GetLargestFreeRange() == 100);
+        REQUIRE(Ranges.Allocate(100) == 0);
+    }
+
+    SECTION("Growing adds to the end")
+    {
+        Ranges.Grow(200);
+        REQUIRE(Ranges.GetCapacity() == 200);
+        REQUIRE(Ranges.GetLargestFreeRange() == 110);
+        REQUIRE(Ranges.GetFreeRangeCount() == 1);
+        REQUIRE(Ranges.Allocate(110) == 90);
+    }
+
+    SECTION("Random allocations never overlap")
+    {
+        RangeAllocator Big(4096, RetireFrames);
+        std::mt19937 Rng(7);
+        std::vector<std::pair<uint32, uint32>> Live;
+        std::vector<uint8> Owned(4096, 0);
+
+        for (uint32 Step = 0; Step < 2000; ++Step)
+        {
+            if (Live.empty() || Rng() % 3 != 0)
+            {
+                const uint32 Size = 1 + Rng() % 64;
+                const uint32 Offset = Big.Allocate(Size);
+                if (Offset != RangeAllocator::InvalidOffset)
+                {
+                    REQUIRE(Offset + Size <= 4096);
+                    for (uint32 i = Offset; i < Offset + Size; ++i)
+                    {
+                        REQUIRE(Owned[i] == 0);
+                        Owned[i] = 1;
+                    }
+                    Live.emplace_back(Offset, Size);
+                }
+            }
+            else
+            {
+                const size_t Index = Rng() % Live.size();
+                Big.Free(Live[Index].first, Live[Index].second);
+                for (uint32 i = Live[Index].first; i < Live[Index].first + Live[Index].second; ++i)
+                {
+                    Owned[i] = 0;
+                }
+                Live.erase(Live.begin() + Index);
+            }
+            Big.NextFrame();
+        }
+
+        for (const std::pair<uint32, uint32>& Range : Live)
+        {
+            Big.Free(Range.first, Range.second);
+        }
+        for (uint32 i = 0; i < RetireFrames; ++i)
+        {
+            Big.NextFrame();
+        }
+        REQUIRE(Big.GetUsedSize() == 0);
+        REQUIRE(Big.GetFreeRangeCount() == 1);
+    }
+}
+
+TEST_CASE("Geometry ranges with the render thread", "[Renderer]")
+{
+    using namespace Fling;
+
+    // VkConfig::MAX_FRAMES_IN_FLIGHT, which needs Vulkan
+    const uint32 FramesInFlight = 2;
+    const uint32 MeshSize = 16;
+
+    // Plays the handoff on one thread with the main thread as far ahead as it can get and the
+    // GPU as far behind as the fences let it be. A mesh is freed right after snapshot FreedAfter
+    // was extracted, and a new one takes its range as soon as it is free again.
+    // @return True if no snapshot that drew the old mesh could still be on the GPU by then
+    auto ReusesSafely = [&](uint32 t_RetireFrames)
+    {
+        RangeAllocator Ranges(MeshSize, t_RetireFrames);
+        RenderHandoff Handoff;
+
+        const uint32 OldMesh = Ranges.Allocate(MeshSize);
+        REQUIRE(OldMesh == 0);
+
+        const uint32 FreedAfter = 3;
+        uint32 Extracted = 0;
+        uint32 Drawn = 0;
+
+        // Last snapshot that the GPU is known to be done with, -1 for none yet
+        int64 Completed = -1;
+        bool Reused = false;
+
+        while (!Reused && Extracted < 32)
+        {
+            if (Handoff.GetPendingCount() < RenderHandoff::SlotCount)
+            {
+                // Main thread, same order as VulkanApp::Update
+                const uint32 Slot = Handoff.BeginWrite();
+                Ranges.NextFrame();
+
+                if (Extracted == FreedAfter)
+                {
+                    Ranges.Free(OldMesh, MeshSize);
+                }
+                else if (Extracted > FreedAfter && Ranges.Allocate(MeshSize) != RangeAllocator::InvalidOffset)
+                {
+                    // The new mesh is uploaded over the old one right away
+                    if (Completed < static_cast<int64>(FreedAfter))
+                    {
+                        return false;
+                    }
+                    Reused = true;
+                }
+
+                Handoff.Submit(Slot);
+                ++Extracted;
+            }
+            else
+            {
+                // Render thread, recording a frame waits on the fence of the one that used its slot last
+                uint32 Slot = 0;
+                REQUIRE(Handoff.BeginRead(Slot));
+                Completed = static_cast<int64>(Drawn) - FramesInFlight;
+                ++Drawn;
+                Handoff.EndRead(Slot);
+            }
+        }
+
+        REQUIRE(Reused);
+        return true;
+    };
+
+    // What VkConfig::RETIRE_FRAMES is, and what it was before the handoff was counted
+    REQUIRE(ReusesSafely(FramesInFlight + RenderHandoff::SlotCount));
+    REQUIRE_FALSE(ReusesSafely(FramesInFlight + 1));
+}
+
+TEST_CASE("Meshlets", "[Renderer]")
+{
+    using namespace Fling;
+
+    // A UV sphere like the one the LOD tests use, dense enough that a meshlet only covers a small patch
+    const uint32 Rings = 64;
+    const uint32 Segments = 128;
+    const float Pi = 3.14159265f;
+    std::vector<Vertex> Verts;
+    std::vector<uint32> Indices;
+    for (uint32 r = 0; r <= Rings; ++r)
+    {
+        for (uint32 s = 0; s <= Segments; ++s)
+        {
+            const float Theta = Pi * static_cast<float>(r) / static_cast<float>(Rings);
+            const float Phi = 2.0f * Pi * static_cast<float>(s) / static_cast<float>(Segments);
+
+            Vertex Vert = {};
+            Vert.Pos = glm::vec3(std::sin(Theta) * std::cos(Phi), std::cos(Theta), std::sin(Theta) * std::sin(Phi));
+            Vert.Normal = Vert.Pos;
+            Verts.push_back(Vert);
+        }
+    }
+    for (uint32 r = 0; r < Rings; ++r)
+    {
+        for (uint32 s = 0; s < Segments; ++s)
+        {
+            const uint32 A = r * (Segments + 1) + s;
+            const uint32 B = A + Segments + 1;
+            // Skip the triangles that collapse at the poles
+            if (r != 0)
+            {
+                const uint32 Tri[3] = { A, B, A + 1 };
+                Indices.insert(Indices.end(), Tri, Tri + 3);
+            }
+            if (r != Rings - 1)
+            {
+                const uint32 Tri[3] = { A + 1, B, B + 1 };
+                Indices.insert(Indices.end(), Tri, Tri + 3);
+            }
+        }
+    }
+
+    // Triangles rotated so their smallest index is first, which keeps the winding
+    const auto SortedTriangles = [](const uint32* t_Indices, uint32 t_Count)
+    {
+        std::vector<std::array<uint32, 3>> Tris;
+        for (uint32 i = 0; i < t_Count; i += 3)
+        {
+            std::array<uint32, 3> Tri = { t_Indices[i], t_Indices[i + 1], t_Indices[i + 2] };
+            std::rotate(Tri.begin(), std::min_element(Tri.begin(), Tri.end()), Tri.end());
+            Tris.push_back(Tri);
+        }
+        std::sort(Tris.begin(), Tris.end());
+        return Tris;
+    };
+
+    // Put a second copy after the first to check that ranges that don't start at 0 work
+    const uint32 Offset = static_cast<uint32>(Indices.size());
+    const std::vector<uint32> Original(Indices.begin(), Indices.end());
+    Indices.insert(Indices.end(), Original.begin(), Original.end());
+
+    const std::vector<Meshlet> Meshlets = MeshletBuilder::Build(Verts, Indices, Offset, static_cast<uint32>(Original.size()));
+    REQUIRE(Meshlets.size() > 1);
+
+    SECTION("Meshlets cover the range within the limits")
+    {
+        REQUIRE(std::equal(Original.begin(), Original.end(), Indices.begin()));
+        REQUIRE(SortedTriangles(Indices.data() + Offset, static_cast<uint32>(Original.size())) == SortedTriangles(Original.data(), static_cast<uint32>(Original.size())));
+
+        uint32 Next = Offset;
+        for (const Meshlet& Cluster : Meshlets)
+        {
+            REQUIRE(Cluster.FirstIndex == Next);
+            REQUIRE(Cluster.IndexCount % 3 == 0);
+            REQUIRE(Cluster.IndexCount / 3 <= MeshletBuilder::MaxTriangles);
+            REQUIRE(Cluster.VertexCount <= MeshletBuilder::MaxVertices);
+            Next += Cluster.IndexCount;
+
+            std::vector<uint32> Unique(Indices.begin() + Cluster.FirstIndex, Indices.begin() + Cluster.FirstIndex + Cluster.IndexCount);
+            std::sort(Unique.begin(), Unique.end());
+            Unique.erase(std::unique(Unique.begin(), Unique.end()), Unique.end());
+            REQUIRE(Unique.size() == Cluster.VertexCount);
+
+            for (uint32 Index : Unique)
+            {
+                REQUIRE(glm::length(Verts[Index].Pos - Cluster.Bounds.Center) <= Cluster.Bounds.Radius + 1e-4f);
+            }
+        }
+        REQUIRE(Next == Offset + Original.size());
+
+        // Growing over neighbours should fill most meshlets instead of leaving scraps
+        REQUIRE(Meshlets.size() <= (Original.size() / 3) / (MeshletBuilder::MaxTriangles / 2));
+    }
+
+    SECTION("Back facing meshlets really face away")
+    {
+        std::mt19937 Rng(11);
+        std::uniform_real_distribution<float> Dist(-4.0f, 4.0f);
+
+        uint32 CulledCount = 0;
+        for (uint32 Test = 0; Test < 64; ++Test)
+        {
+            const glm::vec3 Camera(Dist(Rng), Dist(Rng), Dist(Rng));
+            if (glm::length(Camera) < 1.5f)
+            {
+                continue;
+            }
+
+            for (const Meshlet& Cluster : Meshlets)
+            {
+                if (!MeshletBuilder::IsBackFacing(Cluster, Camera))
+                {
+                    continue;
+                }
+                ++CulledCount;
+
+                for (uint32 i = Cluster.FirstIndex; i < Cluster.FirstIndex + Cluster.IndexCount; i += 3)
+                {
+                    const glm::vec3& A = Verts[Indices[i]].Pos;
+                    const glm::vec3 Normal = glm::cross(Verts[Indices[i + 1]].Pos - A, Verts[Indices[i + 2]].Pos - A);
+                    REQUIRE(glm::dot(Normal, A - Camera) >= -1e-5f);
+                }
+            }
+        }
+        REQUIRE(CulledCount > 0);
+    }
+
+    SECTION("Culling merges what is left into ranges")
+    {
+        glm::mat4 View = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 Proj = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+        Frustum ViewFrustum(Proj * View);
+        const glm::vec3 Camera(0.0f, 0.0f, 5.0f);
+
+        std::vector<IndexRange> Ranges;
+        MeshletCullStats CullStats;
+        MeshletBuilder::Cull(Meshlets.data(), static_cast<uint32>(Meshlets.size()), glm::mat4(1.0f), Camera, ViewFrustum, 0, Ranges, CullStats);
+
+        // About half of a sphere faces away, the cones are conservative so only part of that is culled
+        REQUIRE(CullStats.Clusters == Meshlets.size());
+        REQUIRE(CullStats.Triangles == Original.size() / 3);
+        REQUIRE(CullStats.CulledClusters > 0);
+        REQUIRE(CullStats.CulledTriangles > CullStats.Triangles / 10);
+        REQUIRE(CullStats.CulledTriangles < CullStats.Triangles / 2 + MeshletBuilder::MaxTriangles);
+
+        uint32 Drawn = 0;
+        for (size_t r = 0; r < Ranges.size(); ++r)
+        {
+            Drawn += Ranges[r].IndexCount / 3;
+            if (r > 0)
+            {
+                // Touching ranges would have been one
+                REQUIRE(Ranges[r].FirstIndex > Ranges[r - 1].FirstIndex + Ranges[r - 1].IndexCount);
+            }
+        }
+        REQUIRE(Drawn == CullStats.Triangles - CullStats.CulledTriangles);
+
+        // Fewer draws cost some of the culled triangles
+        std::vector<IndexRange> Merged;
+        MeshletCullStats MergedStats;
+        MeshletBuilder::Cull(Meshlets.data(), static_cast<uint32>(Meshlets.size()), glm::mat4(1.0f), Camera, ViewFrustum, 2, Merged, MergedStats);
+        REQUIRE(Merged.size() <= 2);
+        REQUIRE(MergedStats.CulledClusters == CullStats.CulledClusters);
+        REQUIRE(MergedStats.CulledTriangles <= CullStats.CulledTriangles);
+        for (const IndexRange& Range : Ranges)
+        {
+            const bool Covered = std::any_of(Merged.begin(), Merged.end(), [&](const IndexRange& t_Merged)
+            {
+                return Range.FirstIndex >= t_Merged.FirstIndex && Range.FirstIndex + Range.IndexCount <= t_Merged.FirstIndex + t_Merged.IndexCount;
+            });
+            REQUIRE(Covered);
+        }
+
+        // Moved out of the frustum, everything goes
+        std::vector<IndexRange> Hidden;
+        MeshletCullStats HiddenStats;
+        MeshletBuilder::Cull(Meshlets.data(), static_cast<uint32>(Meshlets.size()), glm::translate(glm::vec3(0.0f, 0.0f, 20.0f)), Camera, ViewFrustum, 0, Hidden, HiddenStats);
+        REQUIRE(Hidden.empty());
+        REQUIRE(HiddenStats.CulledTriangles == HiddenStats.Triangles);
+    }
+}
+
+TEST_CASE("Draw sort keys", "[Renderer]")
+{
+    using namespace Fling;
+
+    SECTION("Fields round trip and keep their priority")
+    {
+        const uint64 Key = DrawSortKey::Make(3, 17, 0x1234, 0xBEEF, 1.0f);
+        REQUIRE(DrawSortKey::GetPass(Key) == 3);
+        REQUIRE(DrawSortKey::GetPipeline(Key) == 17);
+        REQUIRE(DrawSortKey::GetMaterial(Key) == 0x1234);
+        REQUIRE(DrawSortKey::GetMesh(Key) == 0xBEEF);
+        REQUIRE(DrawSortKey::GetDepthBucket(Key) == (1u << DrawSortKey::DepthBucketBits) - 1);
+        REQUIRE(DrawSortKey::GetDepth(Key) == (1u << DrawSortKey::DepthBits) - 1);
+
+        // Each field wins over everything below it
+        REQUIRE(DrawSortKey::Make(0, 63, 0xFFFF, 0xFFFF, 1.0f) < DrawSortKey::Make(1, 0, 0, 0, 0.0f));
+        REQUIRE(DrawSortKey::Make(0, 0, 0xFFFF, 0xFFFF, 1.0f) < DrawSortKey::Make(0, 1, 0, 0, 0.0f));
+        REQUIRE(DrawSortKey::Make(0, 0, 0xFFFF, 0xFFFF, 0.1f) < DrawSortKey::Make(0, 0, 0, 0, 0.5f));
+        REQUIRE(DrawSortKey::Make(0, 0, 1, 0xFFFF, 0.5f) < DrawSortKey::Make(0, 0, 2, 0, 0.5f));
+        REQUIRE(DrawSortKey::Make(0, 0, 1, 1, 0.5f) < DrawSortKey::Make(0, 0, 1, 2, 0.5f));
+        REQUIRE(DrawSortKey::Make(0, 0, 1, 1, 0.5f) < DrawSortKey::Make(0, 0, 1, 1, 0.5001f));
+    }
+
+    SECTION("Depth is clamped and ordered")
+    {
+        REQUIRE(DrawSortKey::GetDepth(DrawSortKey::Make(0, 0, 0, 0, -5.0f)) == 0);
+        REQUIRE(DrawSortKey::GetDepth(DrawSortKey::Make(0, 0, 0, 0, 7.0f)) == (1u << DrawSortKey::DepthBits) - 1);
+        REQUIRE(DrawSortKey::GetDepth(DrawSortKey::Make(0, 0, 0, 0, std::nanf(""))) == (1u << DrawSortKey::DepthBits) - 1);
+
+        uint64 Last = 0;
+        for (uint32 i = 0; i <= 1000; ++i)
+        {
+            const uint64 Key = DrawSortKey::Make(0, 0, 5, 5, static_cast<float>(i) / 1000.0f);
+            REQUIRE(Key >= Last);
+            Last = Key;
+        }
+
+        // Buckets are finer close to the camera
+        REQUIRE(DrawSortKey::GetDepthBucket(DrawSortKey::Make(0, 0, 0, 0, 0.05f)) > DrawSortKey::GetDepthBucket(DrawSortKey::Make(0, 0, 0, 0, 0.0f)) + 5);
+    }
+
+    SECTION("Wide ids are folded")
+    {
+        REQUIRE(DrawSortKey::FoldId(0x1234, 16) == 0x1234);
+        REQUIRE(DrawSortKey::FoldId(0x00010000, 16) == 1);
+        REQUIRE(DrawSortKey::FoldId(0x00010000, 16) != DrawSortKey::FoldId(0, 16));
+        REQUIRE(DrawSortKey::FoldId(0xDEADBEEF, 32) == 0xDEADBEEF);
+        REQUIRE(DrawSortKey::FoldId(0xFFFFFFFF, 6) < 64);
+    }
+
+    SECTION("Radix sort matches a stable sort")
+    {
+        std::mt19937_64 Rng(7);
+        for (uint32 Workers : { 0u, 3u })
+        {
+            DrawSorter Sorter(Workers);
+
+            std::vector<uint32> Order;
+            Sorter.Sort({}, Order);
+            REQUIRE(Order.empty());
+
+            for (uint32 Count : { 1u, 37u, DrawSorter::MinParallelCount - 1, DrawSorter::MinParallelCount * 3 + 11 })
+            {
+                // Few distinct values in some fields, so there are plenty of equal keys to keep stable
+                std::vector<uint64> Keys(Count);
+                for (uint64& Key : Keys)
+                {
+                    Key = DrawSortKey::Make(static_cast<uint32>(Rng() % 2), 0, static_cast<uint32>(Rng() % 8), static_cast<uint32>(Rng() % 64), static_cast<float>(Rng() % 100) / 100.0f);
+                }
+
+                std::vector<uint32> Expected(Count);
+                for (uint32 i = 0; i < Count; ++i)
+                {
+                    Expected[i] = i;
+                }
+                std::stable_sort(Expected.begin(), Expected.end(), [&](uint32 t_A, uint32 t_B) { return Keys[t_A] < Keys[t_B]; });
+
+                // Twice, the second sort reuses the memory of the first
+                for (uint32 Repeat = 0; Repeat < 2; ++Repeat)
+                {
+                    Sorter.Sort(Keys, Order);
+                    REQUIRE(Order == Expected);
+                }
+            }
+        }
+    }
+
+    SECTION("Bytes that never change are skipped")
+    {
+        DrawSorter Sorter;
+        std::vector<uint64> Keys;
+        for (uint32 i = 0; i < 200; ++i)
+        {
+            Keys.push_back(DrawSortKey::Make(1, 2, 3, 4, 0.0f) | ((i * 37) % 200));
+        }
+
+        std::vector<uint32> Order;
+        Sorter.Sort(Keys, Order);
+        REQUIRE(Sorter.GetLastPassCount() == 1);
+        for (size_t i = 1; i < Order.size(); ++i)
+        {
+            REQUIRE(Keys[Order[i - 1]] < Keys[Order[i]]);
+        }
+
+        const std::vector<uint64> Same(50, Keys[0]);
+        Sorter.Sort(Same, Order);
+        REQUIRE(Sorter.GetLastPassCount() == 0);
+        for (uint32 i = 0; i < 50; ++i)
+        {
+            REQUIRE(Order[i] == i);
+        }
+    }
+}
+
+TEST_CASE("Dynamic BVH benchmark", "[Renderer][.benchmark]")
+{
+    using namespace Fling;
+    using Clock = std::chrono::high_resolution_clock;
+
+    std::mt19937 Rng(42);
+    std::uniform_real_distribution<float> Dist(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> Step(-0.5f, 0.5f);
+
+    const uint32 StaticCount = 100000;
+    const uint32 MovingCount = 1000;
+    const uint32 FrameCount = 100;
+
+    DynamicBVH Tree;
+    std::vector<AABB> Boxes;
+    std::vector<int32> Proxies;
+    for (uint32 i = 0; i < StaticCount + MovingCount; ++i)
+    {
+        Boxes.emplace_back(MakeBox(glm::vec3(Dist(Rng), Dist(Rng) * 0.05f, Dist(Rng)), 1.0f));
+        Proxies.emplace_back(Tree.CreateProxy(Boxes.back(), i));
+    }
+    Tree.Rebuild();
+
+    glm::mat4 Proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+    std::vector<uint32> Inside;
+    std::vector<uint32> Intersecting;
+    double UpdateMs = 0.0;
+    double QueryMs = 0.0;
+    size_t VisibleTotal = 0;
+
+    for (uint32 Frame = 0; Frame < FrameCount; ++Frame)
+    {
+        Clock::time_point Start = Clock::now();
+        for (uint32 i = StaticCount; i < StaticCount + MovingCount; ++i)
+        {
+            glm::vec3 Offset(Step(Rng), 0.0f, Step(Rng));
+            Boxes[i].Min += Offset;
+            Boxes[i].Max += Offset;
+            Tree.MoveProxy(Proxies[i], Boxes[i]);
+        }
+        if (Tree.GetReinsertCount() > Tree.GetProxyCount() / 4)
+        {
+            Tree.Rebuild();
+        }
+        Clock::time_point Updated = Clock::now();
+
+        glm::vec3 Eye(Frame * 5.0f - 250.0f, 10.0f, 0.0f);
+        Frustum ViewFrustum(Proj * glm::lookAt(Eye, Eye + glm::vec3(1.0f, -0.1f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        Tree.QueryFrustum(ViewFrustum, Inside, Intersecting);
+        Clock::time_point Queried = Clock::now();
+
+        UpdateMs += std::chrono::duration<double, std::milli>(Updated - Start).count();
+        QueryMs += std::chrono::duration<double, std::milli>(Queried - Updated).count();
+        VisibleTotal += Inside.size() + Intersecting.size();
+    }
+
+    WARN("BVH " << StaticCount << " static + " << MovingCount << " moving: update " << (UpdateMs / FrameCount)
+        << " ms, frustum query " << (QueryMs / FrameCount) << " ms, avg candidates " << (VisibleTotal / FrameCount));
+    REQUIRE(Tree.GetProxyCount() == StaticCount + MovingCount);
+}
@@ -52,6 +52,20 @@ TEST_CASE("Engine Config File", "[resource]")
         REQUIRE(Words == "Billy Bob Joe");
     }
 
+    SECTION("Command Line Options")
+    {
+        // Arguments that aren't options are only logged by Init, so this is fine before the logger exists
+        char Exe[] = "Fling";
+        char LauncherFlag[] = "-NSDocumentRevisionsDebugMode";
+        char NoKey[] = "--TestRead";
+        char Option[] = "--TestRead.CommandLineNum=7";
+        char* Args[] = { Exe, LauncherFlag, NoKey, Option };
+        REQUIRE(FlingConfig::Get().LoadCommandLineOpts(4, Args) == 1);
+        REQUIRE(FlingConfig::Get().GetInt("TestRead", "CommandLineNum") == 7);
+
+        FlingConfig::Get().Init();
+    }
+
 
     ResourceManager::Get().Shutdown();
     Logger::Get().Shutdown();
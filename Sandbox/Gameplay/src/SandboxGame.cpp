@@ -136,7 +136,8 @@ namespace Sandbox
 		AddFloor("Models/cube.obj", "Materials/Cobblestone.mat", glm::vec3(40.0f, 0.1f, 40.0f));
 
 		// Add a bunch of random light bois
-		for (size_t i = 0; i < DeferredLightSettings::MaxPointLights; i++)
+		const size_t PointLightCount = 128;
+		for (size_t i = 0; i < PointLightCount; i++)
 		{
 			AddRandomPointLight();
 		}
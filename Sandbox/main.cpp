@@ -12,6 +12,10 @@
 int main(int argc, char* argv[])
 {
 	Fling::Engine Engine = {};
+
+	// Lets any config option be overridden, like --Headless.Enabled. The logger isn't up yet,
+	// so arguments that are ignored are only reported once the engine starts
+	Fling::FlingConfig::Get().LoadCommandLineOpts(argc, argv);
     
 	try
 	{